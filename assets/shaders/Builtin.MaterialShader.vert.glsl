@@ -3,16 +3,15 @@
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_texture_coordinate;
 
+// Per-instance model matrix, stepped once per instance of an instanced draw.
+// Takes locations 2 to 5, one per column
+layout(location = 2) in mat4 in_model;
+
 layout(set = 0, binding = 0) uniform global_uniform_object {
     mat4 projection;
     mat4 view;
 } global_ubo;
 
-layout(push_constant) uniform push_constant {
-    // Can be guaranteed only at 128 bytes
-    mat4 model; // 64 bytes
-} u_push_constants;
-
 layout(location = 0) out int out_mode;
 
 // We are passing the texture coordinates in the vertex shader
@@ -28,6 +27,6 @@ void main() {
     out_dto.texture_coordinate = in_texture_coordinate;
     gl_Position = global_ubo.projection *
                   global_ubo.view *
-                  u_push_constants.model *
+                  in_model *
                   vec4(in_position, 1.0);
 }
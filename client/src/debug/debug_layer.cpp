@@ -8,8 +8,10 @@
 #    include <core/logger.hpp>
 #    include <imgui.h>
 #    include <implot.h>
+#    include <memory/allocation_profiler.hpp>
 #    include <memory/arena.hpp>
 #    include <memory/arena_debug.hpp>
+#    include <systems/layout_render_system.hpp>
 #    include <ui/icons.hpp>
 #    include <utils/string.hpp>
 
@@ -104,7 +106,10 @@ render_arena_utilization_bar(Arena             *arena,
     ImDrawList *draw_list = ImGui::GetWindowDrawList();
     ImVec2      cursor    = ImGui::GetCursorScreenPos();
 
-    f32 total    = (f32)arena->committed_memory;
+    // Positions continue across the chained blocks, the map spans up to the
+    // end of the committed part of the block in use
+    f32 total = (f32)(arena->current->base_position +
+                      arena->current->committed_memory);
     f32 zoomed_w = bar_width * zoom_level;
     f32 max_scroll =
         (zoomed_w > bar_width) ? (zoomed_w - bar_width) / zoomed_w : 0.0f;
@@ -270,7 +275,8 @@ render_arena_utilization_bar(Arena             *arena,
 
                 if (!found)
                 {
-                    u64 free_bytes = arena->committed_memory - arena->offset;
+                    u64 free_bytes = arena->current->committed_memory -
+                                     arena->current->offset;
                     ImGui::BeginTooltip();
                     ImGui::TextDisabled("Free (committed)");
                     imgui_tooltip_bytes("Size", free_bytes);
@@ -369,11 +375,23 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
         total_padding += entry->records[i].padding;
     }
 
+    u64 position = arena_position(arena);
+
+    // Chained blocks start where the reservation of the previous one ends
+    u64 reserved_extent =
+        arena->current->base_position + arena->current->reserved_memory;
+
+    u32 block_count = 0;
+    for (Arena *block = arena->current; block; block = block->prev)
+    {
+        ++block_count;
+    }
+
     f32 utilization = 0.0f;
-    if (arena->committed_memory > ARENA_HEADER_SIZE)
+    if (arena->total_committed > ARENA_HEADER_SIZE)
     {
-        utilization = (f32)(arena->offset - ARENA_HEADER_SIZE) /
-                      (f32)(arena->committed_memory - ARENA_HEADER_SIZE) *
+        utilization = (f32)(position - ARENA_HEADER_SIZE) /
+                      (f32)(arena->total_committed - ARENA_HEADER_SIZE) *
                       100.0f;
     }
 
@@ -390,17 +408,16 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
     ImGui::Columns(4, nullptr, false);
 
     ImGui::Text("Reserved");
-    imgui_text_bytes_colored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f),
-                             arena->reserved_memory);
+    imgui_text_bytes_colored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), reserved_extent);
     ImGui::NextColumn();
 
     ImGui::Text("Committed");
     imgui_text_bytes_colored(ImVec4(0.54f, 0.71f, 0.98f, 1.0f),
-                             arena->committed_memory);
+                             arena->total_committed);
     ImGui::NextColumn();
 
     ImGui::Text("Used");
-    imgui_text_bytes_colored(ImVec4(0.65f, 0.89f, 0.63f, 1.0f), arena->offset);
+    imgui_text_bytes_colored(ImVec4(0.65f, 0.89f, 0.63f, 1.0f), position);
     ImGui::NextColumn();
 
     ImGui::Text("Waste (padding)");
@@ -408,6 +425,45 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
     ImGui::NextColumn();
     ImGui::Columns(1);
 
+    // High water marks and the memory the pops gave back to the OS
+    ImGui::Columns(4, nullptr, false);
+
+    ImGui::Text("Peak Committed");
+    imgui_text_bytes_colored(ImVec4(0.54f, 0.71f, 0.98f, 1.0f),
+                             arena->peak_committed);
+    ImGui::NextColumn();
+
+    ImGui::Text("Peak Used");
+    imgui_text_bytes_colored(ImVec4(0.65f, 0.89f, 0.63f, 1.0f),
+                             arena->peak_offset);
+    ImGui::NextColumn();
+
+    ImGui::Text("Retained");
+    imgui_text_bytes_colored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f),
+                             arena->retain_size);
+    ImGui::NextColumn();
+
+    ImGui::Text("Decommitted (%llu)", entry->decommit_count);
+    imgui_text_bytes_colored(ImVec4(0.86f, 0.55f, 0.16f, 1.0f),
+                             entry->decommitted_memory);
+    ImGui::NextColumn();
+    ImGui::Columns(1);
+
+    if (enum_has_any(arena->flags, Arena_Flags::LARGE_PAGES))
+    {
+        ImGui::TextDisabled("Backed by large pages");
+    }
+
+    if (enum_has_any(arena->flags, Arena_Flags::CONCURRENT))
+    {
+        ImGui::TextDisabled("Takes concurrent pushes");
+    }
+
+    if (block_count > 1)
+    {
+        ImGui::TextDisabled("Chained over %u blocks", block_count);
+    }
+
     ImGui::Spacing();
 
     // Reserved vs committed overview bar
@@ -420,16 +476,15 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
 
         dl->AddRectFilled(p, ImVec2(p.x + bar_w, p.y + bar_h), COLOR_BAR_BG);
 
-        if (arena->reserved_memory > 0)
+        if (reserved_extent > 0)
         {
-            f32 committed_w = bar_w * ((f32)arena->committed_memory /
-                                       (f32)arena->reserved_memory);
+            f32 committed_w = bar_w * ((f32)arena->total_committed /
+                                       (f32)reserved_extent);
             dl->AddRectFilled(p,
                               ImVec2(p.x + committed_w, p.y + bar_h),
                               IM_COL32(137, 180, 250, 100));
 
-            f32 used_w =
-                bar_w * ((f32)arena->offset / (f32)arena->reserved_memory);
+            f32 used_w = bar_w * ((f32)position / (f32)reserved_extent);
             dl->AddRectFilled(p,
                               ImVec2(p.x + used_w, p.y + bar_h),
                               IM_COL32(166, 227, 161, 150));
@@ -441,9 +496,9 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
         if (ImGui::IsItemHovered())
         {
             ImGui::BeginTooltip();
-            imgui_tooltip_bytes("Reserved ", arena->reserved_memory);
-            imgui_tooltip_bytes("Committed", arena->committed_memory);
-            imgui_tooltip_bytes("Used     ", arena->offset);
+            imgui_tooltip_bytes("Reserved ", reserved_extent);
+            imgui_tooltip_bytes("Committed", arena->total_committed);
+            imgui_tooltip_bytes("Used     ", position);
             ImGui::EndTooltip();
         }
     }
@@ -639,6 +694,182 @@ render_arena_detail(Arena_Debug_Entry *entry, Debug_Layer_State *state)
     render_allocation_table(entry);
 }
 
+INTERNAL_FUNC void
+render_layout_lod_window(Debug_Layer_State *state, f32 delta_time)
+{
+    Layout_Render_Stats stats;
+    layout_render_system_get_stats(&stats);
+
+    if (stats.units_per_pixel <= 0.0)
+        return;
+
+    u32 head = state->layout_sample_head;
+
+    state->layout_units_per_pixel[head] = stats.units_per_pixel;
+    state->layout_frame_ms[head]        = delta_time * 1000.0;
+    state->layout_sample_head = (head + 1) % DEBUG_LAYOUT_SAMPLE_COUNT;
+    state->layout_sample_count =
+        MIN(state->layout_sample_count + 1, DEBUG_LAYOUT_SAMPLE_COUNT);
+
+    ImGui::Begin(ICON_FA_LAYER_GROUP " Layout LOD");
+
+    ImGui::Text("Draws: %u (%llu dropped)",
+                stats.draw_count,
+                stats.dropped_count);
+    ImGui::Text("Units per pixel: %.2f", stats.units_per_pixel);
+    ImGui::Text("Collect: %.3f ms", stats.collect_time * 1000.0);
+    ImGui::Separator();
+
+    for (u32 level = 0; level < LAYOUT_LOD_LEVEL_COUNT; ++level)
+    {
+        ImGui::Text("Level %u (%u px): %llu placements",
+                    level,
+                    layout_lod_level_resolution(level),
+                    stats.lod.level_placements[level]);
+    }
+
+    ImGui::Text("Bounds: %llu placements", stats.lod.bounds_placements);
+    ImGui::Text("Detailed: %llu placements", stats.lod.detailed_placements);
+    ImGui::Spacing();
+
+    if (ImPlot::BeginPlot("##LayoutFrameTime",
+                          ImVec2(-1, 200),
+                          ImPlotFlags_NoMouseText))
+    {
+        ImPlot::SetupAxes("Units per pixel",
+                          "Frame (ms)",
+                          ImPlotAxisFlags_AutoFit,
+                          ImPlotAxisFlags_AutoFit);
+        ImPlot::SetupAxisScale(ImAxis_X1, ImPlotScale_Log10);
+
+        ImPlot::PlotScatter("Frames",
+                            state->layout_units_per_pixel,
+                            state->layout_frame_ms,
+                            (s32)state->layout_sample_count);
+
+        ImPlot::EndPlot();
+    }
+
+    ImGui::End();
+}
+
+// Sites of the allocation profiler by estimated bytes. The size histogram and
+// the stack of a site show on hover
+INTERNAL_FUNC void
+render_allocation_profile_window()
+{
+    ImGui::Begin(ICON_FA_CHART_BAR " Allocation Profile");
+
+    b8 is_enabled = allocation_profiler_is_enabled();
+    if (ImGui::Checkbox("Sampling", &is_enabled))
+        allocation_profiler_set_enabled(is_enabled);
+
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+        allocation_profiler_reset();
+
+    ImGui::SameLine();
+    if (ImGui::Button("Dump"))
+        allocation_profiler_dump(DEBUG_ALLOCATION_PROFILE_PATH);
+
+    auto scratch = scratch_begin(nullptr, 0);
+
+    Allocation_Profile profile;
+    allocation_profiler_snapshot(scratch.arena, &profile);
+
+    ImGui::Text("%llu samples, one every %llu KiB (%llu dropped)",
+                profile.sample_count,
+                profile.sample_interval / KiB,
+                profile.dropped_count);
+    ImGui::Text("Estimated:");
+    ImGui::SameLine();
+    imgui_text_bytes(profile.estimated_bytes);
+    ImGui::Separator();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable |
+                            ImGuiTableFlags_SizingStretchProp;
+
+    if (ImGui::BeginTable("##AllocationProfile", 4, flags))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Estimated",
+                                ImGuiTableColumnFlags_WidthFixed,
+                                90.0f);
+        ImGui::TableSetupColumn("Samples",
+                                ImGuiTableColumnFlags_WidthFixed,
+                                70.0f);
+        ImGui::TableSetupColumn("Kind",
+                                ImGuiTableColumnFlags_WidthFixed,
+                                50.0f);
+        ImGui::TableSetupColumn("Site", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        for (u32 i = 0; i < profile.site_count; ++i)
+        {
+            Allocation_Site *site = &profile.sites[i];
+
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            imgui_text_bytes(site->estimated_bytes);
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", site->sample_count);
+
+            ImGui::TableNextColumn();
+            ImGui::TextDisabled("%s",
+                                site->source == Allocation_Source::ARENA
+                                    ? "arena"
+                                    : "heap");
+
+            ImGui::TableNextColumn();
+            String name = arena_display_name(site->file, site->line);
+            ImGui::Text("%.*s:%d",
+                        (s32)name.size,
+                        name.buff ? (const char *)name.buff : "",
+                        site->line);
+
+            if (!ImGui::IsItemHovered())
+                continue;
+
+            f32 histogram[ALLOCATION_PROFILER_SIZE_BUCKETS];
+            u32 last_bucket = 0;
+
+            for (u32 b = 0; b < ALLOCATION_PROFILER_SIZE_BUCKETS; ++b)
+            {
+                histogram[b] = (f32)site->size_histogram[b];
+                if (site->size_histogram[b] > 0)
+                    last_bucket = b;
+            }
+
+            ImGui::BeginTooltip();
+            ImGui::Text("%s:%d", site->file, site->line);
+            imgui_tooltip_bytes("Sampled", site->sampled_bytes);
+            ImGui::PlotHistogram("Sizes (log2)",
+                                 histogram,
+                                 (s32)last_bucket + 1,
+                                 0,
+                                 nullptr,
+                                 0.0f,
+                                 FLT_MAX,
+                                 ImVec2(240.0f, 60.0f));
+
+            for (u32 f = 0; f < site->stack_depth; ++f)
+                ImGui::TextDisabled("#%u %p", f, site->stack[f]);
+
+            ImGui::EndTooltip();
+        }
+
+        ImGui::EndTable();
+    }
+
+    scratch_end(scratch);
+
+    ImGui::End();
+}
+
 void
 debug_layer_on_attach(void *state_ptr)
 {
@@ -647,6 +878,8 @@ debug_layer_on_attach(void *state_ptr)
     state->selected_arena_index = -1;
     state->zoom_level           = 1.0f;
     state->scroll_x             = 0.0f;
+    state->layout_sample_head   = 0;
+    state->layout_sample_count  = 0;
 
     CLIENT_INFO("Debug layer attached");
 }
@@ -674,14 +907,22 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
 
     if (g_state->is_debug_layer_visible)
     {
+        render_layout_lod_window(l_state, ctx->delta_t);
+        render_allocation_profile_window();
+
         ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.80f);
         ImGui::Begin(ICON_FA_BUG " Memory Inspector",
                      &g_state->is_debug_layer_visible,
                      ImGuiWindowFlags_NoDocking);
 
+        // Held for the whole window, the workers would otherwise grow the
+        // records being drawn
+        arena_debug_lock();
+
         Arena_Debug_Registry *registry = arena_debug_get_registry();
         if (!registry)
         {
+            arena_debug_unlock();
             ImGui::Text("Debug registry not initialized.");
             ImGui::End();
             ImGui::PopStyleVar();
@@ -708,17 +949,18 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
                 String name = arena_display_name(arena->allocation_file,
                                                  arena->allocation_line);
 
+                u64 position = arena_position(arena);
+
                 f32 pct = 0.0f;
-                if (arena->committed_memory > 0)
+                if (arena->total_committed > 0)
                 {
-                    pct = (f32)arena->offset / (f32)arena->committed_memory *
-                          100.0f;
+                    pct = (f32)position / (f32)arena->total_committed * 100.0f;
                 }
 
                 f64 measurement_unit = (f64)MiB;
 
                 // Arena label with utilization %
-                if (arena->offset < MiB)
+                if (position < MiB)
                     measurement_unit = (f64)KiB;
 
                 String display_measurement_unit = (measurement_unit == (f64)MiB)
@@ -732,9 +974,9 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
                             "%.*s:%d  —  %.2f %.*s / %.2f %.*s  (%.0f%c)",
                             (s32)(name).size, (name).buff ? (const char *)(name).buff : "",
                             arena->allocation_line,
-                            arena->offset / measurement_unit,
+                            position / measurement_unit,
                             (s32)(display_measurement_unit).size, (display_measurement_unit).buff ? (const char *)(display_measurement_unit).buff : "",
-                            arena->committed_memory / measurement_unit,
+                            arena->total_committed / measurement_unit,
                             (s32)(display_measurement_unit).size, (display_measurement_unit).buff ? (const char *)(display_measurement_unit).buff : "",
                             pct,
                             '%');
@@ -810,7 +1052,7 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
             f64 measurement_unit = (f64)MiB;
 
             // Arena label with utilization %
-            if (arena->offset < MiB)
+            if (arena_position(arena) < MiB)
                 measurement_unit = (f64)KiB;
 
             String display_measurement_unit = (measurement_unit == (f64)MiB)
@@ -820,9 +1062,9 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
             String arena_summary =
                 string_fmt(scratch.arena,
                         "  %.2f %.*s / %.2f %.*s  (%u allocs)",
-                        arena->offset / measurement_unit,
+                        arena_position(arena) / measurement_unit,
                         (s32)(display_measurement_unit).size, (display_measurement_unit).buff ? (const char *)(display_measurement_unit).buff : "",
-                        arena->committed_memory / measurement_unit,
+                        arena->total_committed / measurement_unit,
                         (s32)(display_measurement_unit).size, (display_measurement_unit).buff ? (const char *)(display_measurement_unit).buff : "",
                         entry->record_count);
 
@@ -871,6 +1113,8 @@ debug_layer_on_render(void *layer_state, void *global_state, Frame_Context *ctx)
 
         ImGui::EndChild();
 
+        arena_debug_unlock();
+
         ImGui::End();
         ImGui::PopStyleVar();
     }
@@ -5,11 +5,23 @@
 #    include "defines.hpp"
 #    include "ui/ui_types.hpp"
 
+// Frame time against the zoom of the layout view, to check that it stays
+// flat from the whole die down to single shapes
+constexpr u32 DEBUG_LAYOUT_SAMPLE_COUNT = 2048;
+
+// Written by the Dump button of the allocation profile
+#    define DEBUG_ALLOCATION_PROFILE_PATH "allocation_profile.txt"
+
 struct Debug_Layer_State
 {
     s32 selected_arena_index;
     f32 zoom_level;
     f32 scroll_x;
+
+    f64 layout_units_per_pixel[DEBUG_LAYOUT_SAMPLE_COUNT];
+    f64 layout_frame_ms[DEBUG_LAYOUT_SAMPLE_COUNT];
+    u32 layout_sample_head;
+    u32 layout_sample_count;
 };
 
 void debug_layer_on_attach(void *state);
@@ -12,6 +12,7 @@
 #include <imgui.h>
 #include <math/math.hpp>
 #include <renderer/renderer_frontend.hpp>
+#include <systems/layout_render_system.hpp>
 #include <ui/icons.hpp>
 #include <ui/ui_themes.hpp>
 #include <ui/ui_widgets.hpp>
@@ -24,6 +25,8 @@ constexpr f32 VIEWPORT_CAMERA_MIN_ZOOM     = 0.01f;
 constexpr f32 VIEWPORT_CAMERA_MAX_ZOOM     = 1e8f;
 constexpr f32 VIEWPORT_2D_CAMERA_NEAR      = -16.0f;
 constexpr f32 VIEWPORT_2D_CAMERA_FAR       = 16.0f;
+// Layouts default to 1 nm database units
+constexpr f64 VIEWPORT_DEFAULT_DATABASE_UNITS_PER_MM = 1e6;
 #ifdef DEBUG_BUILD
 constexpr f32 VIEWPORT_DEBUG_CAMERA_ROTATE_SENSITIVITY            = 0.16f;
 constexpr f32 VIEWPORT_DEBUG_CAMERA_SPEED_BOOST                   = 3.0f;
@@ -94,6 +97,10 @@ INTERNAL_FUNC void
 viewport_component_update_matrices(Editor_Layer_State *state);
 INTERNAL_FUNC void
 viewport_component_update_cursor_world(Editor_Layer_State *state);
+INTERNAL_FUNC void
+viewport_component_update_visible_region(Editor_Layer_State *state,
+                                         f32                 half_w,
+                                         f32                 half_h);
 INTERNAL_FUNC b8
 viewport_component_render_cursor_panel(Editor_Layer_State     *state,
                                        const UI_Theme_Palette &palette);
@@ -169,6 +176,12 @@ viewport_component_on_attach(Editor_Layer_State *state)
     state->viewport_image_pos    = {0.0f, 0.0f};
     state->viewport_image_size   = {0.0f, 0.0f};
     state->grid_spacing          = 1.0f; // mm
+    state->shape_index           = nullptr;
+    state->database_units_per_mm = VIEWPORT_DEFAULT_DATABASE_UNITS_PER_MM;
+    state->visible_region        = layout_box_empty();
+    state->visible_shape_count   = 0;
+    state->layout                = nullptr;
+    state->layout_lod            = nullptr;
 
     u32 width  = 0;
     u32 height = 0;
@@ -694,6 +707,44 @@ viewport_component_update_matrices(Editor_Layer_State *state)
 
     renderer_set_projection(projection);
     renderer_set_view(view);
+
+    viewport_component_update_visible_region(state, half_w, half_h);
+}
+
+INTERNAL_FUNC s32
+viewport_component_to_database_units(const Editor_Layer_State *state,
+                                     f64                       mm)
+{
+    f64 units = mm * state->database_units_per_mm;
+
+    // Zoomed far out the view can reach past the coordinate range
+    return (s32)CLAMP(units, -2147483647.0, 2147483647.0);
+}
+
+INTERNAL_FUNC void
+viewport_component_update_visible_region(Editor_Layer_State *state,
+                                         f32                 half_w,
+                                         f32                 half_h)
+{
+    f64 center_x = state->camera.position.x;
+    f64 center_y = state->camera.position.y;
+
+    state->visible_region = {
+        viewport_component_to_database_units(state, center_x - half_w),
+        viewport_component_to_database_units(state, center_y - half_h),
+        viewport_component_to_database_units(state, center_x + half_w),
+        viewport_component_to_database_units(state, center_y + half_h)};
+
+    state->visible_shape_count =
+        state->shape_index ? spatial_index_query(state->shape_index,
+                                                 state->visible_region,
+                                                 nullptr)
+                           : 0;
+
+    // The layout renderer only recollects when the view actually changed
+    layout_render_system_set_view(state->visible_region,
+                                  state->database_units_per_mm /
+                                      state->camera.zoom);
 }
 
 INTERNAL_FUNC void
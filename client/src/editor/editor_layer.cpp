@@ -3,14 +3,25 @@
 #include "components/viewport_component.hpp"
 #include "global_client_state.hpp"
 
+#include <core/application.hpp>
 #include <core/frame_context.hpp>
 #include <core/logger.hpp>
+#include <core/thread_context.hpp>
 #include <events/events.hpp>
 #include <imgui.h>
 #include <math/math.hpp>
 #include <memory/memory.hpp>
+#include <platform/filesystem.hpp>
 #include <renderer/renderer_frontend.hpp>
+#include <systems/layout_render_system.hpp>
+#include <systems/resource_system.hpp>
+#include <systems/texture_system.hpp>
 #include <ui/icons.hpp>
+#include <utils/string.hpp>
+
+// Flattened shapes past this many are not indexed, their entries alone would
+// take hundreds of megabytes while the LOD already bounds what is drawn
+constexpr u64 EDITOR_SHAPE_INDEX_MAX_SHAPES = 8 * 1024 * 1024;
 
 // Static pointer to editor state for event callbacks
 internal_var Editor_Layer_State *editor_state = nullptr;
@@ -20,6 +31,10 @@ INTERNAL_FUNC void render_statistics_window(Editor_Layer_State *state,
 INTERNAL_FUNC void render_signal_analyzer(Editor_Layer_State *state,
                                           f32                 delta_time);
 
+INTERNAL_FUNC void open_default_layout(Editor_Layer_State *state);
+INTERNAL_FUNC Spatial_Index *build_shape_index(Layout *layout);
+INTERNAL_FUNC void close_layout(Editor_Layer_State *state);
+
 // Event callbacks
 INTERNAL_FUNC b8 on_mouse_wheel(const Event *event);
 INTERNAL_FUNC b8 on_mouse_moved(const Event *event);
@@ -31,6 +46,7 @@ editor_layer_on_attach(void *state_ptr)
     editor_state              = state;
 
     viewport_component_on_attach(state);
+    open_default_layout(state);
 
     // Initialize metrics state
     state->fps             = 0.0f;
@@ -60,6 +76,8 @@ editor_layer_on_detach(void *state_ptr)
                                on_mouse_wheel);
     events_unregister_callback(Event_Type::MOUSE_MOVED, on_mouse_moved);
 
+    close_layout((Editor_Layer_State *)state_ptr);
+
     editor_state = nullptr;
 
     CLIENT_INFO("Editor layer detached");
@@ -100,6 +118,147 @@ editor_layer_on_render(void          *layer_state,
     return true;
 }
 
+INTERNAL_FUNC void
+open_default_layout(Editor_Layer_State *state)
+{
+    auto scratch = scratch_begin(nullptr, 0);
+
+    String path = string_fmt(scratch.arena,
+                             "%s/layouts/default.gds",
+                             resource_system_base_path());
+
+    Resource resource = {};
+    if (!filesystem_exists((const char *)path.buff) ||
+        !resource_system_load(scratch.arena,
+                              "default",
+                              Resource_Type::LAYOUT,
+                              &resource))
+    {
+        scratch_end(scratch);
+        return;
+    }
+
+    scratch_end(scratch);
+
+    Layout     *layout = (Layout *)resource.data;
+    Layout_LOD *lod    = layout_lod_build(layout);
+
+    CLIENT_INFO("Layout LOD built: %llu rects, %.1f MiB in %.3f s",
+                lod->rect_count,
+                layout_lod_memory_usage(lod) / (1024.0 * 1024.0),
+                lod->build_time);
+
+    state->layout                = layout;
+    state->layout_lod            = lod;
+    state->shape_index           = build_shape_index(layout);
+    state->database_units_per_mm = 1.0 / (layout->database_unit * 1e3);
+    state->camera.dirty          = true;
+
+    layout_render_system_set_layout(layout, lod);
+}
+
+// Every rect and polygon under the top cell, by its bounds in root coordinates
+INTERNAL_FUNC Spatial_Index *
+build_shape_index(Layout *layout)
+{
+    if (layout->top_cell == INVALID_ID)
+        return nullptr;
+
+    Cell *top = &layout->cells[layout->top_cell];
+
+    if (top->flat_shape_count > EDITOR_SHAPE_INDEX_MAX_SHAPES)
+    {
+        CLIENT_WARN("Layout has %llu flattened shapes, the shape index is "
+                    "limited to %llu",
+                    top->flat_shape_count,
+                    EDITOR_SHAPE_INDEX_MAX_SHAPES);
+        return nullptr;
+    }
+
+    Arena         *entries_arena = arena_create();
+    Spatial_Entry *entries =
+        push_array(entries_arena, Spatial_Entry, top->flat_shape_count);
+    u32 entry_count = 0;
+
+    Layout_Flattener flattener;
+    layout_flatten_begin(&flattener, layout, layout->top_cell, top->bounds);
+
+    Layout_Placement placement;
+    while (layout_flatten_next(&flattener, &placement))
+    {
+        Cell *cell = &layout->cells[placement.cell];
+
+        for (u32 i = 0; i < cell->layer_count; ++i)
+        {
+            Cell_Layer *shapes = &cell->layers[i];
+
+            for (u32 r = 0; r < shapes->rect_count; ++r)
+            {
+                Layout_Box local = {shapes->rect_min_x[r],
+                                    shapes->rect_min_y[r],
+                                    shapes->rect_max_x[r],
+                                    shapes->rect_max_y[r]};
+
+                entries[entry_count].box =
+                    layout_transform_box(&placement.transform, local);
+                entries[entry_count].id = entry_count;
+                entry_count++;
+            }
+
+            for (u32 p = 0; p < shapes->polygon_count; ++p)
+            {
+                Layout_Box local = layout_box_empty();
+                for (u32 v = shapes->polygon_offsets[p];
+                     v < shapes->polygon_offsets[p + 1];
+                     ++v)
+                {
+                    local = layout_box_union(local,
+                                             {shapes->vertex_x[v],
+                                              shapes->vertex_y[v],
+                                              shapes->vertex_x[v],
+                                              shapes->vertex_y[v]});
+                }
+
+                entries[entry_count].box =
+                    layout_transform_box(&placement.transform, local);
+                entries[entry_count].id = entry_count;
+                entry_count++;
+            }
+        }
+    }
+
+    Spatial_Index *index = spatial_index_create(top->bounds);
+    spatial_index_build(index, entries, entry_count);
+
+    arena_release(entries_arena);
+
+    CLIENT_INFO("Shape index built: %u shapes, %.1f MiB",
+                entry_count,
+                spatial_index_memory_usage(index) / (1024.0 * 1024.0));
+
+    return index;
+}
+
+INTERNAL_FUNC void
+close_layout(Editor_Layer_State *state)
+{
+    if (!state->layout)
+        return;
+
+    layout_render_system_set_layout(nullptr, nullptr);
+
+    if (state->shape_index)
+        spatial_index_destroy(state->shape_index);
+
+    layout_lod_destroy(state->layout_lod);
+    layout_destroy(state->layout);
+
+    state->layout              = nullptr;
+    state->layout_lod          = nullptr;
+    state->shape_index         = nullptr;
+    state->visible_shape_count = 0;
+}
+
 INTERNAL_FUNC b8
 on_mouse_wheel(const Event *event)
 {
@@ -132,9 +291,65 @@ render_statistics_window(Editor_Layer_State *state, f32 delta_time)
 
     ImGui::Text("FPS: %.1f", state->fps);
     ImGui::Text("Frame Time: %.2f ms", state->frame_time_ms);
+
+    Frame_Pacing_Stats pacing;
+    application_get_frame_pacing_stats(&pacing);
+    ImGui::Text("Frame Wait: %.2f ms sleep, %.2f ms spin%s",
+                pacing.sleep_time * 1000.0,
+                pacing.spin_time * 1000.0,
+                pacing.is_idle            ? " (idle)"
+                : pacing.is_present_paced ? " (vsync)"
+                                          : "");
+
+    // Frames without any change are skipped, so the redraw rate is what
+    // reaches the GPU while the loop keeps polling at the idle rate
+    Application_Frame_Stats frame_stats;
+    application_get_frame_stats(&frame_stats);
+    ImGui::Text("Redraws: %.1f/s of %.1f loops/s, CPU %.0f%%",
+                frame_stats.drawn_frame_rate,
+                frame_stats.loop_rate,
+                frame_stats.cpu_busy_ratio * 100.0);
+    ImGui::Text("Skipped Frames: %llu", frame_stats.skipped_frame_count);
     ImGui::Separator();
     ImGui::Text("Allocations: %llu", memory_get_allocations_count());
 
+    // Instancing folds the draws of a geometry into a single call
+    Renderer_Draw_Stats draw_stats;
+    renderer_get_draw_stats(&draw_stats);
+    ImGui::Text("Draw Calls: %u for %u geometries",
+                draw_stats.draw_call_count,
+                draw_stats.geometry_count);
+    ImGui::Text("State Changes: %u (%u saved)",
+                draw_stats.binds.change_count,
+                draw_stats.binds.saved_count);
+
+    // Cooked textures are block compressed and carry their mip chain
+    Texture_Streaming_Stats texture_stats;
+    texture_system_get_streaming_stats(&texture_stats);
+    ImGui::Text("Texture Memory: %.2f MiB (%llu cached, %llu cooked)",
+                (f64)texture_stats.memory_size / MiB,
+                texture_stats.cache_hit_count,
+                texture_stats.cooked_count);
+
+    if (state->shape_index)
+    {
+        ImGui::Separator();
+        ImGui::Text("Visible Shapes: %llu / %llu",
+                    state->visible_shape_count,
+                    state->shape_index->entry_count);
+    }
+
+    if (state->layout)
+    {
+        Layout_Render_Stats stats;
+        layout_render_system_get_stats(&stats);
+
+        ImGui::Separator();
+        ImGui::Text("Layout Draws: %u (%llu dropped)",
+                    stats.draw_count,
+                    stats.dropped_count);
+    }
+
     ImGui::End();
 }
 
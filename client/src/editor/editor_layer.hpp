@@ -1,6 +1,8 @@
 #pragma once
 
 #include "defines.hpp"
+#include "layout/layout_lod.hpp"
+#include "layout/spatial_index.hpp"
 #include "math/math_types.hpp"
 #include "ui/ui_types.hpp"
 
@@ -51,6 +53,20 @@ struct Editor_Layer_State
     vec2 cursor_world_position;
     f32  grid_spacing;
 
+    // Shapes of the top cell of the open layout, flattened and indexed by
+    // their bounds in database units. The visible region is refreshed with
+    // the matrices, queried against the index and handed to the layout
+    // renderer
+    Spatial_Index *shape_index;
+    f64            database_units_per_mm;
+    Layout_Box     visible_region;
+    u64            visible_shape_count;
+
+    // Layout drawn in the viewport through its LOD, loaded from
+    // layouts/default.gds when present
+    Layout     *layout;
+    Layout_LOD *layout_lod;
+
     // Metrics tracking
     f32 fps;
     f32 frame_time_ms;
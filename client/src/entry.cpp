@@ -14,6 +14,7 @@
 
 // Interfaces from core library
 #include <core/frame_context.hpp>
+#include <core/frame_pacing.hpp>
 #include <core/logger.hpp>
 #include <entry.hpp>
 #include <events/events.hpp>
@@ -124,6 +125,10 @@ request_client_config()
     client_config.height = 900;
     client_config.theme  = UI_Theme::CATPPUCCIN;
 
+    // The editor waits for input most of the time
+    client_config.target_fps = FRAME_PACING_DEFAULT_TARGET_FPS;
+    client_config.idle_fps   = FRAME_PACING_DEFAULT_IDLE_FPS;
+
     return client_config;
 }
 
@@ -13,6 +13,13 @@ struct App_Config
     String   name;
     u32      width;
     u32      height;
+
+    // Frames per second of the main loop, zero does not limit it
+    u32 target_fps;
+
+    // Redraws per second without input nor animation, zero always draws at
+    // the target frame rate
+    u32 idle_fps;
 };
 
 // Application structure - similar to Game struct in koala_engine
@@ -4,17 +4,21 @@
 #include "core/absolute_clock.hpp"
 #include "core/asserts.hpp"
 #include "core/frame_context.hpp"
+#include "core/frame_pacing.hpp"
 #include "core/logger.hpp"
 #include "core/thread_context.hpp"
 #include "events/events.hpp"
 #include "input/input.hpp"
 #include "math/math.hpp"
 #include "memory/arena.hpp"
+#include "memory/memory.hpp"
 #include "platform/platform.hpp"
 #include "renderer/renderer_frontend.hpp"
 
 #include "resources/resource_types.hpp"
 #include "systems/geometry_system.hpp"
+#include "systems/job_system.hpp"
+#include "systems/layout_render_system.hpp"
 #include "systems/material_system.hpp"
 #include "systems/resource_system.hpp"
 #include "systems/texture_system.hpp"
@@ -22,10 +26,12 @@
 #include "utils/string.hpp"
 
 // Application configuration
-constexpr u32         TARGET_FPS                        = 120;
-constexpr f64         TARGET_FRAME_TIME                 = 1 / (f64)TARGET_FPS;
 constexpr f32         TEST_LAYER_SPACING_Z              = 1.5f;
 constexpr f32         TEST_SECOND_LAYER_ROTATION_FACTOR = -0.70f;
+constexpr u32         MAX_LAYOUT_DRAW_COUNT             = 65536;
+constexpr f64         MAX_FRAME_DELTA_TIME              = 0.1;
+constexpr f64         SUSPENDED_WAIT_TIME               = 0.25;
+constexpr f64         FRAME_STATS_WINDOW                = 0.5;
 constexpr const char *TEST_LAYER_TEXTURES[]             = {"metal",
                                                            "space_parallax",
                                                            "yellow_track"};
@@ -50,19 +56,35 @@ struct Engine_State
     u16 height;
 
     Absolute_Clock clock;
+    Frame_Pacer    pacer;
+    f64            last_frame_time; // Start of the last frame drawn
+
+    // Frames are only drawn when something changed since the last one
+    u64 drawn_scene_generation;
+    b8  is_redraw_requested;
+
+    // Counts of the current stats window
+    f64 stats_window_start;
+    f64 stats_sleep_time;
+    u32 stats_drawn_count;
+    u32 stats_skipped_count;
+
+    Application_Frame_Stats stats;
 
     Event_Queue *event_queue;
 
     // Subsystem state
-    Platform_State        *platform;
-    Input_State           *inputs;
-    Event_State           *events;
-    Resource_System_State *resources;
-    Renderer_System_State *renderer;
-    Texture_System_State  *textures;
-    Material_System_State *materials;
-    Geometry_System_State *geometries;
-    UI_State              *ui;
+    Platform_State             *platform;
+    Job_System_State           *jobs;
+    Input_State                *inputs;
+    Event_State                *events;
+    Resource_System_State      *resources;
+    Renderer_System_State      *renderer;
+    Texture_System_State       *textures;
+    Material_System_State      *materials;
+    Geometry_System_State      *geometries;
+    Layout_Render_System_State *layout_renderer;
+    UI_State                   *ui;
 
     Geometry *test_geometry;
     Geometry *test_geometry_secondary;
@@ -117,7 +139,8 @@ app_on_debug_event(const Event *event)
     if (engine_state->test_geometry && engine_state->test_geometry->material)
     {
         engine_state->test_geometry->material->diffuse_map.texture =
-            texture_system_acquire(TEST_LAYER_TEXTURES[primary_index], true);
+            texture_system_acquire_async(TEST_LAYER_TEXTURES[primary_index],
+                                         true);
         if (!engine_state->test_geometry->material->diffuse_map.texture)
         {
             CORE_WARN("event_on_debug_event not nexture! using default");
@@ -130,7 +153,8 @@ app_on_debug_event(const Event *event)
         engine_state->test_geometry_secondary->material)
     {
         engine_state->test_geometry_secondary->material->diffuse_map.texture =
-            texture_system_acquire(TEST_LAYER_TEXTURES[secondary_index], true);
+            texture_system_acquire_async(TEST_LAYER_TEXTURES[secondary_index],
+                                         true);
         if (!engine_state->test_geometry_secondary->material->diffuse_map
                  .texture)
         {
@@ -152,6 +176,57 @@ application_get_framebuffer_size(u32 *width, u32 *height)
     *height = engine_state->height;
 }
 
+void
+application_set_target_fps(u32 target_fps)
+{
+    frame_pacer_set_target_fps(&engine_state->pacer, target_fps);
+}
+
+void
+application_get_frame_pacing_stats(Frame_Pacing_Stats *out_stats)
+{
+    *out_stats = engine_state->pacer.stats;
+}
+
+void
+application_request_redraw()
+{
+    engine_state->is_redraw_requested = true;
+}
+
+void
+application_get_frame_stats(Application_Frame_Stats *out_stats)
+{
+    *out_stats = engine_state->stats;
+}
+
+// Rates are averaged over a window, single frames say little once most of
+// the loop iterations are skipped
+INTERNAL_FUNC void
+update_frame_stats()
+{
+    f64 now     = platform_get_absolute_time();
+    f64 elapsed = now - engine_state->stats_window_start;
+
+    if (elapsed < FRAME_STATS_WINDOW)
+        return;
+
+    Application_Frame_Stats *stats = &engine_state->stats;
+
+    u32 loop_count =
+        engine_state->stats_drawn_count + engine_state->stats_skipped_count;
+
+    stats->drawn_frame_rate = engine_state->stats_drawn_count / elapsed;
+    stats->loop_rate        = loop_count / elapsed;
+    stats->cpu_busy_ratio =
+        CLAMP((elapsed - engine_state->stats_sleep_time) / elapsed, 0.0, 1.0);
+
+    engine_state->stats_window_start  = now;
+    engine_state->stats_sleep_time    = 0.0;
+    engine_state->stats_drawn_count   = 0;
+    engine_state->stats_skipped_count = 0;
+}
+
 INTERNAL_FUNC b8
 app_on_resized_callback(const Event *event)
 {
@@ -226,6 +301,13 @@ application_init(App_Config *config)
                                            config->height);
     ENSURE(engine_state->platform);
 
+    // Job system, one thread per logical processor
+    Job_System_Config job_config = {};
+
+    engine_state->jobs =
+        job_system_init(engine_state->persistent_arena, job_config);
+    ENSURE(engine_state->jobs);
+
     // Event system, queue and input
     engine_state->events = events_init(engine_state->persistent_arena);
     ENSURE(engine_state->events);
@@ -245,6 +327,10 @@ application_init(App_Config *config)
     resource_config.asset_base_path = "../assets";
 #endif
 
+    // Packed by resource_system_pack, the loose files are used without it
+    resource_config.archive_path =
+        "../assets/assets" RESOURCE_ARCHIVE_EXTENSION;
+
     engine_state->resources =
         resource_system_init(engine_state->persistent_arena, resource_config);
     ENSURE(engine_state->resources);
@@ -273,6 +359,11 @@ application_init(App_Config *config)
         geometry_system_init(engine_state->persistent_arena, geometry_config);
     ENSURE(engine_state->geometries);
 
+    Layout_Render_System_Config layout_render_config = {MAX_LAYOUT_DRAW_COUNT};
+    engine_state->layout_renderer = layout_render_system_init(
+        engine_state->persistent_arena, layout_render_config);
+    ENSURE(engine_state->layout_renderer);
+
     // TODO: Temp - test plane geometry
     Geometry_Config g_config =
         geometry_system_generate_plane_config(engine_state->persistent_arena,
@@ -355,6 +446,90 @@ application_init(App_Config *config)
     return engine_state->client;
 }
 
+// Updates the client and the UI, then draws and presents a frame
+INTERNAL_FUNC void
+draw_frame(Frame_Context *frame_ctx)
+{
+    if (engine_state->client->update)
+    {
+        if (!engine_state->client->update(engine_state->client, frame_ctx))
+        {
+            CORE_FATAL("Client update failed. Aborting...");
+            engine_state->is_running = false;
+        }
+    }
+
+    if (engine_state->client->render)
+    {
+        if (!engine_state->client->render(engine_state->client, frame_ctx))
+        {
+            CORE_FATAL("Client render failed. Aborting...");
+            engine_state->is_running = false;
+        }
+    }
+
+    Render_Context *packet =
+        push_struct(frame_ctx->frame_arena, Render_Context);
+
+    // TODO: temp - viewport geometry
+    Geometry_Render_Data *test_renders =
+        push_array(frame_ctx->frame_arena, Geometry_Render_Data, 2);
+
+    // Swap draw order for depth-behaviour testing.
+    test_renders[0].geometry = engine_state->test_geometry_secondary;
+    test_renders[1].geometry = engine_state->test_geometry;
+
+    // Animate both layers around Z at different speeds.
+    engine_state->layer_rotation += frame_ctx->delta_t;
+    mat4 top_rotation =
+        mat4_euler_xyz(0.0f, 0.0f, engine_state->layer_rotation);
+
+    mat4 primary_model =
+        top_rotation * mat4_translation({0.0f, 0.0f, -TEST_LAYER_SPACING_Z});
+
+    mat4 bottom_rotation =
+        mat4_euler_xyz(0.0f,
+                       0.0f,
+                       engine_state->layer_rotation *
+                           TEST_SECOND_LAYER_ROTATION_FACTOR);
+
+    // Keep layers parallel and separated only by Z, avoiding debug
+    // tilt/offset distortions that can look like depth inversion.
+    mat4 secondary_model = bottom_rotation;
+
+    // Keep each transform attached to the same geometry after swap.
+    test_renders[0].model = secondary_model;
+    test_renders[1].model = primary_model;
+
+    // The layout of the editor, drawn after the test planes
+    Geometry_Render_Data *layout_draws = nullptr;
+    u32                   layout_draw_count =
+        layout_render_system_get_draws(&layout_draws);
+
+    Geometry_Render_Data *geometries =
+        push_array(frame_ctx->frame_arena,
+                   Geometry_Render_Data,
+                   2 + layout_draw_count);
+
+    geometries[0] = test_renders[0];
+    geometries[1] = test_renders[1];
+    memory_copy(geometries + 2,
+                layout_draws,
+                sizeof(Geometry_Render_Data) * layout_draw_count);
+
+    packet->geometry_count = 2 + layout_draw_count;
+    packet->geometries     = geometries;
+
+    ui_update_layers(engine_state->ui, frame_ctx);
+
+    packet->ui_data.draw_list = ui_draw_layers(engine_state->ui, frame_ctx);
+
+    if (!renderer_draw_frame(frame_ctx, packet))
+    {
+        engine_state->is_running = false;
+    }
+}
+
 void
 application_run()
 {
@@ -390,8 +565,14 @@ application_run()
         }
     }
 
-    // Frame rate limiting variables
-    f64 last_time = platform_get_absolute_time();
+    Frame_Pacing_Config pacing_config = {};
+    pacing_config.target_fps          = engine_state->config.target_fps;
+    pacing_config.idle_fps            = engine_state->config.idle_fps;
+
+    frame_pacer_init(&engine_state->pacer, pacing_config);
+
+    engine_state->last_frame_time = platform_get_absolute_time();
+    engine_state->stats_window_start = engine_state->last_frame_time;
 
     Frame_Context frame_ctx = {};
 
@@ -412,105 +593,77 @@ application_run()
         // frames
         event_queue_flush(frame_ctx.event_queue);
 
-        // Frame
-        if (!engine_state->is_suspended)
+        // A minimized window draws nothing, there is no point in polling
+        if (engine_state->is_suspended)
         {
-
-            f64 frame_start_time = platform_get_absolute_time();
-            f64 delta_time       = frame_start_time - last_time;
-            last_time            = frame_start_time;
-
-            frame_ctx.delta_t = delta_time;
-
-            // DEBUG: Check frame timing consistency
-            // CORE_DEBUG("delta: %.4f ms", delta_time * 1000.0);
-
-            if (engine_state->client->update)
+            f64 wait_start = platform_get_absolute_time();
+            platform_wait_for_events(SUSPENDED_WAIT_TIME);
+            engine_state->stats_sleep_time +=
+                platform_get_absolute_time() - wait_start;
+        }
+        else
+        {
+            // Upload the textures streamed in since the last frame, their
+            // upload changes the scene
+            texture_system_update();
+
+            // Input or a moving animation keeps the loop at the target frame
+            // rate. Without either, and with the scene unchanged since the
+            // last frame drawn, the next frame would be identical: it is
+            // skipped and the loop idles until the next event
+            b8 is_active =
+                frame_ctx.platform_event_count > 0 ||
+                ui_is_animating(engine_state->ui) ||
+                renderer_get_scene_generation() !=
+                    engine_state->drawn_scene_generation ||
+                engine_state->is_redraw_requested;
+
+            frame_pacer_report_activity(&engine_state->pacer, is_active);
+
+            if (frame_pacer_is_idle(&engine_state->pacer))
             {
-                if (!engine_state->client->update(engine_state->client,
-                                                  &frame_ctx))
-                {
-                    CORE_FATAL("Client update failed. Aborting...");
-                    engine_state->is_running = false;
-                }
+                engine_state->stats_skipped_count++;
+                engine_state->stats.skipped_frame_count++;
             }
-
-            if (engine_state->client->render)
+            else
             {
-                if (!engine_state->client->render(engine_state->client,
-                                                  &frame_ctx))
-                {
-                    CORE_FATAL("Client render failed. Aborting...");
-                    engine_state->is_running = false;
-                }
-            }
-
-            Render_Context *packet =
-                push_struct(frame_ctx.frame_arena, Render_Context);
-
-            // TODO: temp - viewport geometry
-            Geometry_Render_Data *test_renders =
-                push_array(frame_ctx.frame_arena, Geometry_Render_Data, 2);
-
-            // Swap draw order for depth-behaviour testing.
-            test_renders[0].geometry = engine_state->test_geometry_secondary;
-            test_renders[1].geometry = engine_state->test_geometry;
+                f64 frame_start_time = platform_get_absolute_time();
+                f64 delta_time =
+                    frame_start_time - engine_state->last_frame_time;
 
-            // Animate both layers around Z at different speeds.
-            engine_state->layer_rotation += delta_time;
-            mat4 top_rotation =
-                mat4_euler_xyz(0.0f, 0.0f, engine_state->layer_rotation);
+                engine_state->last_frame_time = frame_start_time;
 
-            mat4 primary_model =
-                top_rotation *
-                mat4_translation({0.0f, 0.0f, -TEST_LAYER_SPACING_Z});
+                // The first frame after idling would otherwise advance the
+                // animations by the whole idle time
+                frame_ctx.delta_t = MIN(delta_time, MAX_FRAME_DELTA_TIME);
 
-            mat4 bottom_rotation =
-                mat4_euler_xyz(0.0f,
-                               0.0f,
-                               engine_state->layer_rotation *
-                                   TEST_SECOND_LAYER_ROTATION_FACTOR);
+                // Changes made while drawing are drawn by the next frame
+                engine_state->drawn_scene_generation =
+                    renderer_get_scene_generation();
+                engine_state->is_redraw_requested = false;
 
-            // Keep layers parallel and separated only by Z, avoiding debug
-            // tilt/offset distortions that can look like depth inversion.
-            mat4 secondary_model = bottom_rotation;
+                draw_frame(&frame_ctx);
 
-            // Keep each transform attached to the same geometry after swap.
-            test_renders[0].model = secondary_model;
-            test_renders[1].model = primary_model;
-
-            packet->geometry_count = 2;
-            packet->geometries     = test_renders;
-
-            ui_update_layers(engine_state->ui, &frame_ctx);
-
-            packet->ui_data.draw_list =
-                ui_draw_layers(engine_state->ui, &frame_ctx);
-
-            if (!renderer_draw_frame(&frame_ctx, packet))
-            {
-                engine_state->is_running = false;
+                engine_state->stats_drawn_count++;
+                engine_state->stats.drawn_frame_count++;
             }
 
-            // Frame rate limiting
-            f64 frame_end_time = platform_get_absolute_time();
-            f64 frame_duration = frame_end_time - frame_start_time;
+            frame_pacer_set_present_pacing(
+                &engine_state->pacer,
+                renderer_is_present_paced(),
+                platform_get_display_refresh_rate(engine_state->platform));
 
-            if (frame_duration < TARGET_FRAME_TIME)
-            {
-                u64 sleep_ms =
-                    (u64)((TARGET_FRAME_TIME - frame_duration) * 1000.0);
+            frame_pacer_wait(&engine_state->pacer);
 
-                if (sleep_ms > 0)
-                {
-                    platform_sleep(sleep_ms);
-                }
-            }
+            engine_state->stats_sleep_time +=
+                engine_state->pacer.stats.sleep_time;
 
             // Update input state each frame
             input_update();
         }
 
+        update_frame_stats();
+
         scratch_end(frame_scratch);
     }
 
@@ -534,12 +687,21 @@ application_shutdown()
 
     arena_release(engine_state->client_arena);
 
+    CORE_DEBUG("Shutting down layout render subsystem...");
+    layout_render_system_shutdown();
+
     CORE_DEBUG("Shutting down material subsystem...");
     material_system_shutdown();
 
     CORE_DEBUG("Shutting down texture subsystem...");
     texture_system_shutdown();
 
+    CORE_DEBUG("Shutting down resource subsystem...");
+    resource_system_shutdown();
+
+    CORE_DEBUG("Shutting down job subsystem...");
+    job_system_shutdown();
+
     CORE_DEBUG("Shutting down platform subsystem...");
     platform_shutdown(engine_state->platform);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "client_types.hpp"
+#include "core/frame_pacing.hpp"
 #include "defines.hpp"
 
 // Forward declaration for client state (defined in client_types.hpp)
@@ -8,6 +9,30 @@ struct Client;
 
 VOLTRUM_API void application_get_framebuffer_size(u32 *width, u32 *height);
 
+// Zero does not limit the frame rate
+VOLTRUM_API void application_set_target_fps(u32 target_fps);
+VOLTRUM_API void application_get_frame_pacing_stats(
+    Frame_Pacing_Stats *out_stats);
+
+struct Application_Frame_Stats
+{
+    // Per second, averaged over the last half second. Frames without any
+    // change are skipped, so only drawn frames reach the GPU
+    f64 drawn_frame_rate;
+    f64 loop_rate;
+
+    // Share of the time the main thread did not sleep or wait for events
+    f64 cpu_busy_ratio;
+
+    u64 drawn_frame_count;
+    u64 skipped_frame_count;
+};
+
+// Draws the next frame even if nothing the loop tracks has changed
+VOLTRUM_API void application_request_redraw();
+VOLTRUM_API void application_get_frame_stats(
+    Application_Frame_Stats *out_stats);
+
 // Initialize application with client state
 VOLTRUM_API Client *application_init(App_Config *config);
 
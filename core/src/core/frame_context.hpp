@@ -10,4 +10,8 @@ struct Frame_Context
     Arena       *frame_arena;
     Event_Queue *event_queue;
     f32          delta_t;
+
+    // Events polled by the message pump of the frame, including the ones only
+    // the UI listens to
+    u32 platform_event_count;
 };
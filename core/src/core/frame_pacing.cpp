@@ -0,0 +1,162 @@
+#include "core/frame_pacing.hpp"
+
+#include "math/math.hpp"
+#include "platform/platform.hpp"
+
+// Short steps keep the overshoot of the last sleep small, whatever the
+// granularity of the OS timer
+constexpr u64 FRAME_PACING_SLEEP_STEP_NS = 1000000;
+constexpr f64 FRAME_PACING_SLEEP_STEP    = 0.001;
+
+// Weight of a new measurement in the running estimate of a sleep step
+constexpr f64 FRAME_PACING_ESTIMATE_WEIGHT = 0.05;
+
+INTERNAL_FUNC f64
+sleep_estimate(const Frame_Pacer *pacer)
+{
+    return pacer->sleep_mean + math_sqrt((f32)pacer->sleep_variance);
+}
+
+INTERNAL_FUNC void
+update_sleep_estimate(Frame_Pacer *pacer, f64 observed)
+{
+    f64 delta = observed - pacer->sleep_mean;
+
+    pacer->sleep_mean += FRAME_PACING_ESTIMATE_WEIGHT * delta;
+    pacer->sleep_variance =
+        (1.0 - FRAME_PACING_ESTIMATE_WEIGHT) *
+        (pacer->sleep_variance + FRAME_PACING_ESTIMATE_WEIGHT * delta * delta);
+}
+
+// Presentation alone reaches a target at or above the refresh rate, waiting
+// on top of it would only add latency
+INTERNAL_FUNC b8
+is_left_to_present(const Frame_Pacer *pacer)
+{
+    if (!pacer->is_present_paced)
+        return false;
+
+    return pacer->refresh_rate <= 0.0 ||
+           (f64)pacer->config.target_fps >= pacer->refresh_rate - 0.5;
+}
+
+INTERNAL_FUNC void
+start_frame(Frame_Pacer *pacer, f64 now)
+{
+    pacer->stats.frame_time       = now - pacer->frame_start;
+    pacer->stats.sleep_estimate   = sleep_estimate(pacer);
+    pacer->stats.is_idle          = frame_pacer_is_idle(pacer);
+    pacer->stats.is_present_paced = pacer->is_present_paced;
+
+    pacer->frame_start = now;
+}
+
+void
+frame_pacer_init(Frame_Pacer *pacer, Frame_Pacing_Config config)
+{
+    *pacer        = {};
+    pacer->config = config;
+
+    // Until measured, a step is assumed to overshoot by half a step
+    pacer->sleep_mean     = FRAME_PACING_SLEEP_STEP;
+    pacer->sleep_variance = 0.25 * FRAME_PACING_SLEEP_STEP *
+                            FRAME_PACING_SLEEP_STEP;
+
+    pacer->frame_start = platform_get_absolute_time();
+    pacer->deadline    = pacer->frame_start;
+}
+
+void
+frame_pacer_set_target_fps(Frame_Pacer *pacer, u32 target_fps)
+{
+    pacer->config.target_fps = target_fps;
+    pacer->deadline          = platform_get_absolute_time();
+}
+
+void
+frame_pacer_set_present_pacing(Frame_Pacer *pacer,
+                               b8           is_present_paced,
+                               f64          refresh_rate)
+{
+    pacer->is_present_paced = is_present_paced;
+    pacer->refresh_rate     = refresh_rate;
+}
+
+void
+frame_pacer_report_activity(Frame_Pacer *pacer, b8 is_active)
+{
+    if (is_active)
+        pacer->quiet_frame_count = 0;
+    else if (pacer->quiet_frame_count < FRAME_PACING_IDLE_GRACE_FRAMES)
+        pacer->quiet_frame_count++;
+}
+
+b8
+frame_pacer_is_idle(const Frame_Pacer *pacer)
+{
+    return pacer->config.idle_fps > 0 &&
+           pacer->quiet_frame_count >= FRAME_PACING_IDLE_GRACE_FRAMES;
+}
+
+void
+frame_pacer_wait(Frame_Pacer *pacer)
+{
+    f64 now = platform_get_absolute_time();
+
+    pacer->stats.sleep_time = 0.0;
+    pacer->stats.spin_time  = 0.0;
+
+    if (frame_pacer_is_idle(pacer))
+    {
+        platform_wait_for_events(1.0 / pacer->config.idle_fps);
+
+        f64 woken = platform_get_absolute_time();
+
+        // The cadence restarts from the event that woke the loop up
+        pacer->stats.sleep_time = woken - now;
+        pacer->deadline         = woken;
+
+        start_frame(pacer, woken);
+        return;
+    }
+
+    if (pacer->config.target_fps == 0 || is_left_to_present(pacer))
+    {
+        pacer->deadline = now;
+        start_frame(pacer, now);
+        return;
+    }
+
+    // Deadlines advance by whole periods so that the errors of the waits do
+    // not add up. A frame later than its deadline restarts the cadence
+    f64 deadline = pacer->deadline + 1.0 / pacer->config.target_fps;
+
+    if (deadline <= now)
+    {
+        pacer->deadline = now;
+        start_frame(pacer, now);
+        return;
+    }
+
+    f64 sleep_start = now;
+
+    while (deadline - now > sleep_estimate(pacer))
+    {
+        f64 step_start = now;
+        platform_sleep_ns(FRAME_PACING_SLEEP_STEP_NS);
+        now = platform_get_absolute_time();
+
+        update_sleep_estimate(pacer, now - step_start);
+    }
+
+    f64 spin_start = now;
+
+    while (now < deadline)
+        now = platform_get_absolute_time();
+
+    pacer->stats.sleep_time = spin_start - sleep_start;
+    pacer->stats.spin_time  = now - spin_start;
+    pacer->deadline         = deadline;
+
+    start_frame(pacer, now);
+}
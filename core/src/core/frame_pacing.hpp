@@ -0,0 +1,73 @@
+#pragma once
+
+#include "defines.hpp"
+
+constexpr u32 FRAME_PACING_DEFAULT_TARGET_FPS = 120;
+constexpr u32 FRAME_PACING_DEFAULT_IDLE_FPS   = 4;
+
+// Frames drawn after the last activity before the loop goes idle, so that the
+// UI settles (hover states, closing popups) before it stops being redrawn
+constexpr u32 FRAME_PACING_IDLE_GRACE_FRAMES = 3;
+
+struct Frame_Pacing_Config
+{
+    u32 target_fps; // Zero does not limit the frame rate
+    u32 idle_fps;   // Redraws per second without activity, zero never idles
+};
+
+struct Frame_Pacing_Stats
+{
+    f64 frame_time; // Seconds between the starts of the last two frames
+    f64 sleep_time; // Seconds slept by the last wait
+    f64 spin_time;  // Seconds spun by the last wait
+
+    // Expected duration of a sleep step, mean plus one deviation
+    f64 sleep_estimate;
+
+    b8 is_idle;
+    b8 is_present_paced;
+};
+
+// Paces the main loop to the target frame rate. A wait sleeps in short steps
+// while the time left is longer than a step is expected to take, then spins
+// up to the deadline, so the frame rate does not lose the rounding of the OS
+// timer. The duration of the steps is measured on every wait
+struct Frame_Pacer
+{
+    Frame_Pacing_Config config;
+
+    f64 deadline;    // Start of the next frame
+    f64 frame_start; // Start of the current frame
+
+    // Running estimate of the duration of a sleep step
+    f64 sleep_mean;
+    f64 sleep_variance;
+
+    // Presentation blocking on the vertical blank already paces the frames
+    b8  is_present_paced;
+    f64 refresh_rate; // Hz, zero when unknown
+
+    u32 quiet_frame_count; // Frames since the last activity
+
+    Frame_Pacing_Stats stats;
+};
+
+void frame_pacer_init(Frame_Pacer *pacer, Frame_Pacing_Config config);
+
+void frame_pacer_set_target_fps(Frame_Pacer *pacer, u32 target_fps);
+
+// With a FIFO present mode frames are already paced at the refresh rate, so
+// targets at or above it are left to presentation
+void frame_pacer_set_present_pacing(Frame_Pacer *pacer,
+                                    b8           is_present_paced,
+                                    f64          refresh_rate);
+
+// Whether the frame just drawn had input or a running animation. The pacer
+// goes idle after FRAME_PACING_IDLE_GRACE_FRAMES frames without
+void frame_pacer_report_activity(Frame_Pacer *pacer, b8 is_active);
+
+b8 frame_pacer_is_idle(const Frame_Pacer *pacer);
+
+// Waits until the next frame should start. While idle it waits for platform
+// events instead, for at most a period of the idle frame rate
+void frame_pacer_wait(Frame_Pacer *pacer);
@@ -1,5 +1,6 @@
 #include "thread_context.hpp"
 #include "core/logger.hpp"
+#include "memory/slab_allocator.hpp"
 
 THREAD_STATIC Thread_Context *thread_local_context;
 
@@ -24,6 +25,9 @@ thread_context_release(Thread_Context *context)
     Arena *arena1 = context->arenas[1];
     arena_release(context->arenas[0]);
     arena_release(arena1);
+
+    // The blocks cached by the thread go back to the other threads
+    slab_release_thread_cache();
 }
 
 void
@@ -6,27 +6,33 @@
 #include "memory/arena.hpp"
 #include "memory/memory.hpp"
 
-constexpr u64 DEFAULT_DYNAMIC_ARRAY_CAPACITY = 16;
-
-// The autoarray is a dynamic array implementation that manages memory elements
-// in a contigous memory layout
+constexpr u64 DEFAULT_DYNAMIC_ARRAY_CAPACITY       = 16;
+constexpr u64 DEFAULT_DYNAMIC_ARRAY_DIRECTORY_SIZE = 8;
+
+// The autoarray is a dynamic array implementation that grows in fixed size
+// chunks pushed from the arena, so elements never move once added. A chunk
+// directory maps an index to its chunk in constant time. The chunk size is a
+// power of two, which turns the lookup into a shift and a mask.
+// When nothing else is pushed on the arena between two growths, the chunks end
+// up adjacent in memory and the whole array can be used as a flat buffer
+// through data(). The directory is only filled in once that stops being the
+// case, until then the chunks are found from the first one and the directory
+// never has to grow between two of them
 template <typename T>
 struct Dynamic_Array
 {
-    struct Dynamic_Chunk
-    {
-        Dynamic_Chunk *next;
-
-        u64 offset;
-        T  *elements;
-    };
-
-    u64 granularity; // Size of each chunk equal to the initial capacity value
+    u64 granularity; // Elements per chunk, initial capacity rounded to pow2
+    u64 granularity_shift;
     u64 capacity;
     u64 size;
 
-    Dynamic_Chunk *current;
-    Dynamic_Chunk *first;
+    // Directory, chunks[i] holds [i * granularity, (i + 1) * ...). Only
+    // chunks[0] is set while the array is contiguous
+    T **chunks;
+    u64 chunk_count;
+    u64 directory_capacity;
+
+    b8 is_contiguous;
 
     Arena *_allocator; // Should not be accessed externally
 
@@ -36,73 +42,101 @@ struct Dynamic_Array
         RUNTIME_ASSERT(allocator != nullptr);
         RUNTIME_ASSERT(initial_size > 0);
 
-        _allocator  = allocator;
-        capacity    = initial_size;
-        granularity = capacity;
-        size        = 0;
-
-        first = push_struct(_allocator, Dynamic_Chunk);
+        _allocator        = allocator;
+        granularity       = 1;
+        granularity_shift = 0;
 
-        current           = first;
-        current->elements = push_array(_allocator, T, capacity);
-        current->next     = nullptr;
-        current->offset   = 0;
+        while (granularity < initial_size)
+        {
+            granularity <<= 1;
+            granularity_shift++;
+        }
 
-        // current->prev     = nullptr;
+        capacity           = granularity;
+        size               = 0;
+        is_contiguous      = true;
+        chunk_count        = 1;
+        directory_capacity = DEFAULT_DYNAMIC_ARRAY_DIRECTORY_SIZE;
+
+        // The directory is pushed before the first chunk so that the chunks
+        // that follow can be adjacent to it. It is not pushed again before
+        // the chunks stop being adjacent
+        chunks    = push_array(_allocator, T *, directory_capacity);
+        chunks[0] = push_array(_allocator, T, granularity);
     }
 
     FORCE_INLINE T &
     operator[](u64 index)
     {
-        RUNTIME_ASSERT_MSG(index < capacity && index >= 0,
+        RUNTIME_ASSERT_MSG(index < capacity,
                            "dynamic_array - Index out of bounds");
 
-        u64 index_in_chunk = index % granularity;
-        u64 chunk_number   = index / granularity;
+        if (is_contiguous)
+            return chunks[0][index];
 
-        Dynamic_Chunk *chunk = first;
+        return chunks[index >> granularity_shift][index & (granularity - 1)];
+    };
+
+    // Flat view of the elements, nullptr when the chunks are not adjacent
+    FORCE_INLINE T *
+    data()
+    {
+        return is_contiguous ? chunks[0] : nullptr;
+    }
+
+    FORCE_INLINE void
+    _resize()
+    {
+        T *chunk = push_array(_allocator, T, granularity);
 
-        for (u64 i = 0; i < capacity / granularity; ++i)
+        if (is_contiguous)
         {
-            if (chunk_number == i)
-                break;
+            if (chunk == chunks[0] + capacity)
+            {
+                capacity += granularity;
+                chunk_count++;
+                return;
+            }
+
+            // The chunks are no longer adjacent, the directory is filled in
+            // now that pushing it cannot separate them anymore
+            is_contiguous = false;
 
-            chunk = chunk->next;
+            for (u64 i = 1; i < chunk_count && i < directory_capacity; ++i)
+                chunks[i] = chunks[0] + i * granularity;
         }
 
-        RUNTIME_ASSERT_MSG(chunk != nullptr,
-                           "dynamic_array - Error while indexing element");
+        if (chunk_count >= directory_capacity)
+        {
+            u64 new_capacity = directory_capacity * 2;
+            while (new_capacity <= chunk_count)
+                new_capacity *= 2;
 
-        return *(chunk->elements + index_in_chunk);
-    };
+            // The old directory stays in the arena, it is only
+            // directory_capacity pointers
+            T **directory = push_array(_allocator, T *, new_capacity);
+            memory_copy(directory, chunks, sizeof(T *) * directory_capacity);
 
-    FORCE_INLINE void
-    _resize()
-    {
-        current->next = push_struct(_allocator, Dynamic_Chunk);
-        current       = current->next;
+            for (u64 i = directory_capacity; i < chunk_count; ++i)
+                directory[i] = chunks[0] + i * granularity;
 
-        current->elements = push_array(_allocator, T, granularity);
-        current->next     = nullptr;
-        current->offset   = 0;
+            chunks             = directory;
+            directory_capacity = new_capacity;
+        }
 
+        chunks[chunk_count++] = chunk;
         capacity += granularity;
     }
 
     FORCE_INLINE void
     add(const T &value)
     {
-        if (current->offset >= granularity && size >= capacity)
+        if (size >= capacity)
             _resize();
 
-        RUNTIME_ASSERT_MSG(
-            current->offset < granularity && size <= capacity,
-            "dynamic_array_add - Not enough space to add new element");
-
-        T *current_location = current->elements + current->offset;
+        T *current_location = &(*this)[size];
         memory_copy(current_location, &value, sizeof(T));
 
-        current->offset += 1;
         size += 1;
     }
 
@@ -112,25 +146,48 @@ struct Dynamic_Array
         RUNTIME_ASSERT_MSG(index <= size,
                            "dynamic_array_insert_at - Index out of bounds");
 
-        if (current->offset >= granularity && size >= capacity)
+        if (size >= capacity)
             _resize();
 
-        // Shift elements from the end down to the insertion index
-        for (u64 i = size; i > index; --i)
+        if (is_contiguous)
         {
-            (*this)[i] = (*this)[i - 1];
+            T *elements = chunks[0];
+            memory_move(elements + index + 1,
+                        elements + index,
+                        sizeof(T) * (size - index));
         }
+        else
+        {
+            // Shift [index, size) by one, one memmove per chunk starting from
+            // the last one. The last element of each previous chunk is carried
+            // over to the first slot of the next one
+            u64 mask        = granularity - 1;
+            u64 first_chunk = index >> granularity_shift;
+            u64 last_chunk  = size >> granularity_shift;
+
+            for (u64 c = last_chunk; c > first_chunk; --c)
+            {
+                u64 count = c == last_chunk ? (size & mask) : mask;
+
+                memory_move(chunks[c] + 1, chunks[c], sizeof(T) * count);
+                memory_copy(chunks[c], chunks[c - 1] + mask, sizeof(T));
+            }
+
+            u64 start = index & mask;
+            u64 end   = first_chunk == last_chunk ? (size & mask) : mask;
 
-        (*this)[index] = value;
+            memory_move(chunks[first_chunk] + start + 1,
+                        chunks[first_chunk] + start,
+                        sizeof(T) * (end - start));
+        }
 
-        // Update the current chunk offset and total size
-        current->offset += 1;
+        memory_copy(&(*this)[index], &value, sizeof(T));
         size += 1;
     }
 
     struct Iterator
     {
-        Dynamic_Chunk *chunk;
+        T **chunk;
 
         u64 index; // index within current chunk
         u64 granularity;
@@ -138,16 +195,16 @@ struct Dynamic_Array
         FORCE_INLINE T &
         operator*()
         {
-            return chunk->elements[index];
+            return (*chunk)[index];
         }
 
         FORCE_INLINE Iterator &
         operator++()
         {
             ++index;
-            if (index >= granularity && chunk->next != nullptr)
+            if (index >= granularity)
             {
-                chunk = chunk->next;
+                ++chunk;
                 index = 0;
             }
             return *this;
@@ -160,15 +217,21 @@ struct Dynamic_Array
         }
     };
 
+    // Contiguous arrays are walked as a single chunk
     FORCE_INLINE Iterator
     begin()
     {
-        return Iterator{first, 0, granularity};
+        return Iterator{chunks, 0, is_contiguous ? ~(u64)0 : granularity};
     }
 
     FORCE_INLINE Iterator
     end()
     {
-        return Iterator{current, current->offset, granularity};
+        if (is_contiguous)
+            return Iterator{chunks, size, ~(u64)0};
+
+        return Iterator{chunks + (size >> granularity_shift),
+                        size & (granularity - 1),
+                        granularity};
     }
 };
@@ -0,0 +1,622 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "memory/arena.hpp"
+
+constexpr u32 DEFAULT_FREELIST_NODE_CHUNK = 256;
+
+enum class Freelist_Policy : u8
+{
+    FIRST_FIT, // Lowest offset that fits, keeps the allocations packed
+    BEST_FIT   // Smallest range that fits, keeps the large ranges intact
+};
+
+// Snapshot of the freelist occupancy. Fragmentation is expressed as the part of
+// the free space that cannot be served by a single allocation:
+// 0 means all free space is contiguous, values close to 1 mean that the free
+// space is scattered in many small holes
+struct Freelist_Stats
+{
+    u64 total_size;
+    u64 free_space;
+    u64 largest_free_block;
+    u32 free_block_count;
+    f32 fragmentation;
+};
+
+// Range allocator over [0, total_size). T is the unit of the ranges: bytes of a
+// GPU buffer (u64), slots of a registry (u32), etc. The freelist does not own
+// the memory that it describes, it only hands out offsets.
+//
+// Every free range is a node that lives in two treaps at the same time:
+//  - ordered by offset, where each node also stores the largest size in its
+//    subtree. Used for first-fit and to find the neighbours to coalesce with
+//  - ordered by (size, offset). Used for best-fit
+// so allocate and free are O(log n) in the number of holes.
+//
+// Bookkeeping nodes are pushed in chunks from the arena and recycled through an
+// internal spare list, so the arena usage is bounded by the peak number of
+// holes, not by the number of allocate/free calls
+template <typename T>
+struct Freelist
+{
+    struct Node
+    {
+        T   offset;
+        T   size;
+        T   max_size; // Largest size in the offset ordered subtree
+        u32 priority;
+
+        Node *offset_children[2]; // [0] doubles as the link of the spare list
+        Node *size_children[2];
+    };
+
+    T   total_size;
+    T   free_space;
+    u32 free_block_count;
+
+    Freelist_Policy policy;
+
+    Node *offset_root;
+    Node *size_root;
+    Node *spare_nodes;
+    u32   random_state;
+
+    Arena *_allocator; // Should not be accessed externally
+
+    FORCE_INLINE void
+    init(Arena          *allocator,
+         T               size,
+         Freelist_Policy allocation_policy = Freelist_Policy::FIRST_FIT)
+    {
+        ENSURE(allocator);
+
+        RUNTIME_ASSERT_MSG(size > 0,
+                           "freelist_init - Size must be greater than 0");
+
+        _allocator       = allocator;
+        policy           = allocation_policy;
+        total_size       = size;
+        free_space       = size;
+        free_block_count = 1;
+        offset_root      = nullptr;
+        size_root        = nullptr;
+        spare_nodes      = nullptr;
+        random_state     = 0x9E3779B9;
+
+        _insert(_acquire_node(0, size));
+    }
+
+    // On success writes the start of the reserved range
+    FORCE_INLINE b8
+    allocate(T size, T *out_offset)
+    {
+        RUNTIME_ASSERT(out_offset != nullptr);
+
+        if (size == 0 || size > free_space || !offset_root ||
+            offset_root->max_size < size)
+            return false;
+
+        Node *node = policy == Freelist_Policy::BEST_FIT
+                         ? _find_best_fit(size)
+                         : _find_first_fit(size);
+
+        *out_offset = node->offset;
+
+        if (node->size == size)
+        {
+            // Exact fit, the whole range is consumed
+            _remove(node);
+            _release_node(node);
+            free_block_count--;
+        }
+        else
+        {
+            _resize(node, node->offset + size, node->size - size);
+        }
+
+        free_space -= size;
+        return true;
+    }
+
+    // Returns the range to the freelist, merging it with adjacent free ranges
+    FORCE_INLINE b8
+    free(T offset, T size)
+    {
+        if (size == 0 || offset > total_size || size > total_size - offset)
+        {
+            CORE_ERROR("freelist_free - Range [%llu, %llu) is out of bounds",
+                       (u64)offset,
+                       (u64)offset + size);
+            return false;
+        }
+
+        Node *previous = _find_previous(offset);
+        Node *next     = _find_next(offset);
+
+        // A range that intersects a free range was either never allocated or
+        // it is being freed twice
+        if ((previous && previous->offset + previous->size > offset) ||
+            (next && offset + size > next->offset))
+        {
+            CORE_ERROR(
+                "freelist_free - Range [%llu, %llu) overlaps with a free range",
+                (u64)offset,
+                (u64)offset + size);
+            return false;
+        }
+
+        b8 merges_previous =
+            previous && previous->offset + previous->size == offset;
+        b8 merges_next = next && offset + size == next->offset;
+
+        if (merges_previous && merges_next)
+        {
+            // The range bridges the gap between two free ranges
+            T merged_size = previous->size + size + next->size;
+            _remove(next);
+            _release_node(next);
+            _resize(previous, previous->offset, merged_size);
+            free_block_count--;
+        }
+        else if (merges_previous)
+        {
+            _resize(previous, previous->offset, previous->size + size);
+        }
+        else if (merges_next)
+        {
+            _resize(next, offset, next->size + size);
+        }
+        else
+        {
+            _insert(_acquire_node(offset, size));
+            free_block_count++;
+        }
+
+        free_space += size;
+        return true;
+    }
+
+    // Extends the managed range. The new tail is merged with the last free
+    // range when they touch
+    FORCE_INLINE void
+    grow(T new_total_size)
+    {
+        RUNTIME_ASSERT_MSG(new_total_size > total_size,
+                           "freelist_grow - The new size must be larger");
+
+        T old_total_size = total_size;
+        total_size       = new_total_size;
+
+        free(old_total_size, new_total_size - old_total_size);
+    }
+
+    // Marks the whole range as free again. Live offsets become invalid
+    FORCE_INLINE void
+    reset()
+    {
+        _release_subtree(offset_root);
+
+        offset_root      = nullptr;
+        size_root        = nullptr;
+        free_space       = total_size;
+        free_block_count = 1;
+
+        _insert(_acquire_node(0, total_size));
+    }
+
+    FORCE_INLINE Freelist_Stats
+    get_stats() const
+    {
+        Freelist_Stats stats     = {};
+        stats.total_size         = total_size;
+        stats.free_space         = free_space;
+        stats.free_block_count   = free_block_count;
+        stats.largest_free_block = offset_root ? offset_root->max_size : 0;
+
+        stats.fragmentation =
+            free_space > 0
+                ? 1.0f - (f32)stats.largest_free_block / (f32)free_space
+                : 0.0f;
+
+        return stats;
+    }
+
+    // Leftmost node whose subtree can serve the request
+    FORCE_INLINE Node *
+    _find_first_fit(T size)
+    {
+        Node *node = offset_root;
+
+        while (node)
+        {
+            Node *left = node->offset_children[0];
+
+            if (left && left->max_size >= size)
+                node = left;
+            else if (node->size >= size)
+                return node;
+            else
+                node = node->offset_children[1];
+        }
+
+        return nullptr;
+    }
+
+    // Smallest node with size >= request, ties resolved by the lowest offset
+    FORCE_INLINE Node *
+    _find_best_fit(T size)
+    {
+        Node *best = nullptr;
+        Node *node = size_root;
+
+        while (node)
+        {
+            if (node->size >= size)
+            {
+                best = node;
+                node = node->size_children[0];
+            }
+            else
+            {
+                node = node->size_children[1];
+            }
+        }
+
+        return best;
+    }
+
+    // Free range with the largest offset <= offset
+    FORCE_INLINE Node *
+    _find_previous(T offset)
+    {
+        Node *result = nullptr;
+        Node *node   = offset_root;
+
+        while (node)
+        {
+            if (node->offset <= offset)
+            {
+                result = node;
+                node   = node->offset_children[1];
+            }
+            else
+            {
+                node = node->offset_children[0];
+            }
+        }
+
+        return result;
+    }
+
+    // Free range with the smallest offset > offset
+    FORCE_INLINE Node *
+    _find_next(T offset)
+    {
+        Node *result = nullptr;
+        Node *node   = offset_root;
+
+        while (node)
+        {
+            if (node->offset > offset)
+            {
+                result = node;
+                node   = node->offset_children[0];
+            }
+            else
+            {
+                node = node->offset_children[1];
+            }
+        }
+
+        return result;
+    }
+
+    FORCE_INLINE void
+    _insert(Node *node)
+    {
+        node->offset_children[0] = nullptr;
+        node->offset_children[1] = nullptr;
+        node->size_children[0]   = nullptr;
+        node->size_children[1]   = nullptr;
+        node->max_size           = node->size;
+
+        offset_root = _insert_by_offset(offset_root, node);
+        size_root   = _insert_by_size(size_root, node);
+    }
+
+    FORCE_INLINE void
+    _remove(Node *node)
+    {
+        offset_root = _remove_by_offset(offset_root, node);
+        size_root   = _remove_by_size(size_root, node);
+    }
+
+    // Changes the range of a node without changing its position in the offset
+    // order (ranges never overlap, so shrinking or extending a range cannot
+    // move it past a neighbour). Only the size order has to be rebuilt
+    FORCE_INLINE void
+    _resize(Node *node, T new_offset, T new_size)
+    {
+        size_root = _remove_by_size(size_root, node);
+
+        node->offset           = new_offset;
+        node->size             = new_size;
+        node->size_children[0] = nullptr;
+        node->size_children[1] = nullptr;
+
+        size_root = _insert_by_size(size_root, node);
+        _refresh_max_size(offset_root, node);
+    }
+
+    FORCE_INLINE static b8
+    _size_key_less(const Node *node, T size, T offset)
+    {
+        return node->size < size ||
+               (node->size == size && node->offset < offset);
+    }
+
+    FORCE_INLINE static T
+    _subtree_max_size(Node *node)
+    {
+        return node ? node->max_size : 0;
+    }
+
+    FORCE_INLINE static void
+    _update_max_size(Node *node)
+    {
+        T children_max = MAX(_subtree_max_size(node->offset_children[0]),
+                             _subtree_max_size(node->offset_children[1]));
+
+        node->max_size = MAX(node->size, children_max);
+    }
+
+    // Splits into the nodes with offset < key and the nodes with offset >= key
+    static void
+    _split_by_offset(Node *root, T key, Node **out_left, Node **out_right)
+    {
+        if (!root)
+        {
+            *out_left  = nullptr;
+            *out_right = nullptr;
+            return;
+        }
+
+        if (root->offset < key)
+        {
+            _split_by_offset(root->offset_children[1],
+                             key,
+                             &root->offset_children[1],
+                             out_right);
+            *out_left = root;
+        }
+        else
+        {
+            _split_by_offset(root->offset_children[0],
+                             key,
+                             out_left,
+                             &root->offset_children[0]);
+            *out_right = root;
+        }
+
+        _update_max_size(root);
+    }
+
+    // Every offset of left must be lower than the offsets of right
+    static Node *
+    _merge_by_offset(Node *left, Node *right)
+    {
+        if (!left)
+            return right;
+        if (!right)
+            return left;
+
+        if (left->priority > right->priority)
+        {
+            left->offset_children[1] =
+                _merge_by_offset(left->offset_children[1], right);
+            _update_max_size(left);
+            return left;
+        }
+
+        right->offset_children[0] =
+            _merge_by_offset(left, right->offset_children[0]);
+        _update_max_size(right);
+        return right;
+    }
+
+    // Same as above with (size, offset) as key
+    static void
+    _split_by_size(Node *root,
+                   T     size,
+                   T     offset,
+                   Node **out_left,
+                   Node **out_right)
+    {
+        if (!root)
+        {
+            *out_left  = nullptr;
+            *out_right = nullptr;
+            return;
+        }
+
+        if (_size_key_less(root, size, offset))
+        {
+            _split_by_size(root->size_children[1],
+                           size,
+                           offset,
+                           &root->size_children[1],
+                           out_right);
+            *out_left = root;
+        }
+        else
+        {
+            _split_by_size(root->size_children[0],
+                           size,
+                           offset,
+                           out_left,
+                           &root->size_children[0]);
+            *out_right = root;
+        }
+    }
+
+    static Node *
+    _merge_by_size(Node *left, Node *right)
+    {
+        if (!left)
+            return right;
+        if (!right)
+            return left;
+
+        if (left->priority > right->priority)
+        {
+            left->size_children[1] =
+                _merge_by_size(left->size_children[1], right);
+            return left;
+        }
+
+        right->size_children[0] = _merge_by_size(left, right->size_children[0]);
+        return right;
+    }
+
+    // Descends until the node has a higher priority than the subtree root and
+    // splits that subtree around it
+    static Node *
+    _insert_by_offset(Node *root, Node *node)
+    {
+        if (!root || node->priority > root->priority)
+        {
+            _split_by_offset(root,
+                             node->offset,
+                             &node->offset_children[0],
+                             &node->offset_children[1]);
+            _update_max_size(node);
+            return node;
+        }
+
+        u32 side = root->offset < node->offset;
+
+        root->offset_children[side] =
+            _insert_by_offset(root->offset_children[side], node);
+
+        _update_max_size(root);
+        return root;
+    }
+
+    // Replaces the node by the merge of its children
+    static Node *
+    _remove_by_offset(Node *root, Node *node)
+    {
+        if (root == node)
+            return _merge_by_offset(node->offset_children[0],
+                                    node->offset_children[1]);
+
+        u32 side = root->offset < node->offset;
+
+        root->offset_children[side] =
+            _remove_by_offset(root->offset_children[side], node);
+
+        _update_max_size(root);
+        return root;
+    }
+
+    // Recomputes the subtree maximums on the path from the root to the node
+    static void
+    _refresh_max_size(Node *root, Node *node)
+    {
+        if (root != node)
+        {
+            u32 side = root->offset < node->offset;
+            _refresh_max_size(root->offset_children[side], node);
+        }
+
+        _update_max_size(root);
+    }
+
+    static Node *
+    _insert_by_size(Node *root, Node *node)
+    {
+        if (!root || node->priority > root->priority)
+        {
+            _split_by_size(root,
+                           node->size,
+                           node->offset,
+                           &node->size_children[0],
+                           &node->size_children[1]);
+            return node;
+        }
+
+        u32 side = _size_key_less(root, node->size, node->offset);
+
+        root->size_children[side] =
+            _insert_by_size(root->size_children[side], node);
+
+        return root;
+    }
+
+    static Node *
+    _remove_by_size(Node *root, Node *node)
+    {
+        if (root == node)
+            return _merge_by_size(node->size_children[0],
+                                  node->size_children[1]);
+
+        u32 side = _size_key_less(root, node->size, node->offset);
+
+        root->size_children[side] =
+            _remove_by_size(root->size_children[side], node);
+
+        return root;
+    }
+
+    void
+    _release_subtree(Node *node)
+    {
+        if (!node)
+            return;
+
+        _release_subtree(node->offset_children[0]);
+        _release_subtree(node->offset_children[1]);
+        _release_node(node);
+    }
+
+    FORCE_INLINE Node *
+    _acquire_node(T offset, T size)
+    {
+        if (!spare_nodes)
+        {
+            Node *chunk =
+                push_array(_allocator, Node, DEFAULT_FREELIST_NODE_CHUNK);
+
+            for (u32 i = 0; i < DEFAULT_FREELIST_NODE_CHUNK - 1; ++i)
+                chunk[i].offset_children[0] = &chunk[i + 1];
+
+            chunk[DEFAULT_FREELIST_NODE_CHUNK - 1].offset_children[0] = nullptr;
+            spare_nodes                                               = chunk;
+        }
+
+        Node *node  = spare_nodes;
+        spare_nodes = node->offset_children[0];
+
+        // xorshift32, the treap only needs the priorities to be uncorrelated
+        // with the keys
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+
+        node->offset   = offset;
+        node->size     = size;
+        node->priority = random_state;
+        return node;
+    }
+
+    FORCE_INLINE void
+    _release_node(Node *node)
+    {
+        node->offset_children[0] = spare_nodes;
+        spare_nodes              = node;
+    }
+};
@@ -10,6 +10,17 @@
 // TODO: Use C++ 20 modules for exporting template data structures to avoid
 // parsing the classes for every translation unit
 
+// Group probing compares 16 control bytes at once. It can be disabled with
+// VOLTRUM_HASHMAP_SCALAR_PROBE, in which case every slot is probed one by one
+#if !defined(VOLTRUM_HASHMAP_SCALAR_PROBE) &&                                  \
+    (defined(__SSE2__) || defined(_M_X64))
+#    define HASHMAP_SIMD_PROBE 1
+#    include <emmintrin.h>
+#    if _MSC_VER
+#        include <intrin.h>
+#    endif
+#endif
+
 // Simple hashmap implementation. For non-pointer values the map retains a copy
 // of the value. For pointer types the hashtmap does not take ownership of the
 // pointer, so the lifetime of the object should be managed outside the hashmap
@@ -17,15 +28,14 @@
 // This hashmap is an open addressing flat hashmap implementation, since voltrum
 // does not satifsy the main reasons to why we would want to use a closed
 // addressing hashmap:
-// 1. 	Unbounded or unpredictable growth - In voltrum we usually know
-// 		beforehand the amount of data that will be stored in the hashmap
-// and we can resize in compile time, without requiring resizing dynamically
+// 1. 	Unpredictable growth - The registries grow with the size of the
+// 		loaded design, but only ever by doubling, so the table is migrated
+// 		incrementally instead of paying for a full rehash in a single add
 // 2.	Highly variable key lifetime - The lifetime of the
 // 		elements stored in the buckets will be predictable, usually tied
 // to the lifetime of the application for the resources
-// 3. 	High load factors - Since the number of the elements will be known in
-//		compile time, we can just resize in compile time to keep the
-//		load factor pretty low
+// 3. 	High load factors - The table doubles before the load factor reaches
+//		7/8, which keeps the Robin Hood probe sequences short
 // The hashmap will have power of two ceiling capacities, so that we can apply
 // the modulus operation by simple bitmask operations
 
@@ -35,23 +45,53 @@ struct Hashmap_Item
 {
     T      value;
     b8     is_occupied;
-    String key;      // Arena-owned copy of the key
+    String key;      // Copy of the key owned by the hashmap key store
+    u64    hash;     // Full key hash, compared before the key itself
     u32    distance; // Will store the probe sequence length for each item
 };
 
 constexpr u64 HASHMAP_DEFAULT_CAPACITY = 16;
 
+// The table grows when an add would take it above 7/8 of its capacity
+constexpr u64 HASHMAP_MAX_LOAD_NUMERATOR   = 7;
+constexpr u64 HASHMAP_MAX_LOAD_DENOMINATOR = 8;
+
+// Slots of the previous table moved to the new one on every add. Anything
+// above 2 is enough to finish the migration before the new table fills up
+constexpr u64 HASHMAP_MIGRATION_STEP = 16;
+
+// Control bytes mirror the occupancy of the items so that a whole group can be
+// matched with a couple of SIMD instructions. Occupied slots store the top 7
+// bits of the hash, empty slots have the high bit set
+constexpr u64 HASHMAP_GROUP_WIDTH   = 16;
+constexpr u8  HASHMAP_CONTROL_EMPTY = 0x80;
+
+// Removed keys are recycled through power of two size classes starting from
+// 16 bytes. Longer keys are left in the arena
+constexpr u64 HASHMAP_KEY_CLASS_COUNT    = 8;
+constexpr u64 HASHMAP_KEY_MIN_CLASS_SIZE = 16;
+
 // NOTE: This hashmap implementation does not maange the lifetime of the
 // elements stored inside. If the elements T hold resources, these elements
 // should be first cleaned manually before the hashmap goes out of scope
 
-// Currently, the hashmap is not resizable
+// NOTE: The tables replaced by a growth stay in the arena until it is cleared
 template <typename T>
 struct Hashmap
 {
     u64 capacity; // The largest power of two that accomodates all elements
-    u64 count;
+    u64 count;    // Elements in both tables while migrating
     Hashmap_Item<T> *items;
+    u8              *control; // capacity + HASHMAP_GROUP_WIDTH mirrored bytes
+
+    // Previous table, drained into items by HASHMAP_MIGRATION_STEP slots on
+    // every add. Slots below migrate_index have already been moved
+    u64              old_capacity;
+    u64              migrate_index;
+    Hashmap_Item<T> *old_items;
+    u8              *old_control;
+
+    char *free_keys[HASHMAP_KEY_CLASS_COUNT];
 
     Arena *_allocator; // Add arena pointer to make the hashmap be backed by an
                        // arena
@@ -59,9 +99,11 @@ struct Hashmap
     FORCE_INLINE
     Hashmap()
     {
-        capacity = 0;
-        count    = 0;
-        items    = nullptr;
+        capacity  = 0;
+        count     = 0;
+        items     = nullptr;
+        control   = nullptr;
+        old_items = nullptr;
     }
 
     FORCE_INLINE void
@@ -79,10 +121,15 @@ struct Hashmap
 
         _allocator = allocator;
 
+        count         = 0;
+        old_capacity  = 0;
+        migrate_index = 0;
+        old_items     = nullptr;
+        old_control   = nullptr;
+        memory_zero(free_keys, sizeof(free_keys));
+
         // Use the power of 2 ceiling value for hashmap size
-        capacity = math_next_power_of_2(requested_capacity);
-        count    = 0;
-        items    = push_array(_allocator, Hashmap_Item<T>, capacity);
+        _allocate_table(math_next_power_of_2(requested_capacity));
     }
 
     FORCE_INLINE b8
@@ -95,73 +142,48 @@ struct Hashmap
             return false;
         }
 
-        if (count == capacity)
-        {
-            CORE_WARN("Hashmap is full and cannot accept any more elements");
-            return false;
-        }
-
-        // By exploiting the capacity as a power of two instead of using the %
-        // operator to map all possible hash addresses inside the bounds of the
-        // array, we instead just create a bitmask and apply a bitwise and op.
-        u64 address = string_hash(key) & (capacity - 1);
-
-        RUNTIME_ASSERT(address < capacity);
-
-        Hashmap_Item<T> current_item = {};
-        current_item.value           = *value;
-        current_item.key             = string_copy(_allocator, key);
-        current_item.distance        = 0;
-        // Mark already as occupied because if we will use this element, we are
-        // adding willingly the element inside the hash map
-        current_item.is_occupied = true;
+        u64 hash = string_hash(key);
 
-        u64 probe = 0;
-
-        // Collision detected
-        while (probe < capacity)
+        Hashmap_Item<T> *existing = _lookup(key, hash);
+        if (existing)
         {
-            // If the position is empty, write straight away
-            if (!items[address].is_occupied)
+            if (overwrite)
             {
-                items[address] = current_item;
-                count++;
+                existing->value = *value;
                 return true;
             }
 
-            if (items[address].is_occupied &&
-                string_match(items[address].key, current_item.key))
-            {
-                if (overwrite)
-                {
-                    items[address].value = current_item.value;
-                    return true;
-                }
-
-                CORE_WARN("Key '%.*s' is already present in the hashmap",
-                    (int)current_item.key.size,
-                    current_item.key.buff);
-                return false;
-            }
+            CORE_WARN("Key '%.*s' is already present in the hashmap",
+                (int)key.size,
+                key.buff);
+            return false;
+        }
 
-            // If we are at distance x from the "proper" position and we
-            // encouter an element that is very close to its own "proper"
-            // position, instead of propagating the new value and exagerating
-            // the tail of the current element's bucket, we swap the two
-            // elements and instead start propagating the "rich" element
-            if (items[address].distance < current_item.distance)
-            {
-                Hashmap_Item<T> temp = items[address];
-                items[address]       = current_item;
-                current_item         = temp;
-            }
+        if ((count + 1) * HASHMAP_MAX_LOAD_DENOMINATOR >
+            capacity * HASHMAP_MAX_LOAD_NUMERATOR)
+        {
+            // Only reachable with a migration step too small for the growth
+            // factor, but finishing it keeps a single old table at a time
+            if (old_items)
+                _migrate(old_capacity);
 
-            probe++;
-            address = (address + 1) & (capacity - 1); // Wraparound the address
-            current_item.distance++;
+            _grow();
         }
 
-        return false;
+        Hashmap_Item<T> item = {};
+        item.value           = *value;
+        item.key             = _copy_key(key);
+        item.hash            = hash;
+        item.distance        = 0;
+        item.is_occupied     = true;
+
+        _place(item);
+        count++;
+
+        if (old_items)
+            _migrate(HASHMAP_MIGRATION_STEP);
+
+        return true;
     }
 
     FORCE_INLINE b8
@@ -174,34 +196,17 @@ struct Hashmap
             return false;
         }
 
-        u64 address = string_hash(key) & (capacity - 1);
-
-        RUNTIME_ASSERT(address < capacity);
-
-        u64 probe = 0;
-
-        // Collision detected
-        while (probe < capacity)
+        Hashmap_Item<T> *item = _lookup(key, string_hash(key));
+        if (!item)
         {
-            if (!items[address].is_occupied)
-            {
-                CORE_WARN("Key '%.*s' is not present inside the hashmap",
-                    (int)key.size,
-                    key.buff);
-                return false;
-            }
-
-            if (string_match(items[address].key, key))
-            {
-                *out_ptr = &items[address].value;
-                return true;
-            }
-
-            probe++;
-            address = next_address(address); // Wraparound the address
+            CORE_WARN("Key '%.*s' is not present inside the hashmap",
+                (int)key.size,
+                key.buff);
+            return false;
         }
 
-        return false;
+        *out_ptr = &item->value;
+        return true;
     }
 
     FORCE_INLINE b8
@@ -214,34 +219,17 @@ struct Hashmap
             return false;
         }
 
-        u64 address = string_hash(key) & (capacity - 1);
-
-        RUNTIME_ASSERT(address < capacity);
-
-        u64 probe = 0;
-
-        // Collision detected
-        while (probe < capacity)
+        Hashmap_Item<T> *item = _lookup(key, string_hash(key));
+        if (!item)
         {
-            if (!items[address].is_occupied)
-            {
-                CORE_WARN("Key '%.*s' is not present inside the hashmap",
-                    (int)key.size,
-                    key.buff);
-                return false;
-            }
-
-            if (string_match(items[address].key, key))
-            {
-                memory_copy(out_copy, &items[address].value, sizeof(T));
-                return true;
-            }
-
-            probe++;
-            address = next_address(address); // Wraparound the address
+            CORE_WARN("Key '%.*s' is not present inside the hashmap",
+                (int)key.size,
+                key.buff);
+            return false;
         }
 
-        return false;
+        memory_copy(out_copy, &item->value, sizeof(T));
+        return true;
     }
 
     FORCE_INLINE b8
@@ -254,77 +242,55 @@ struct Hashmap
             return false;
         }
 
-        u64 address = string_hash(key) & (capacity - 1);
+        // Shifting the old table could move unmigrated items below
+        // migrate_index, so removals finish the migration first
+        if (old_items)
+            _migrate(old_capacity);
 
-        RUNTIME_ASSERT(address < capacity);
+        u64 hash    = string_hash(key);
+        u64 address = _probe(items, control, capacity, key, hash);
 
-        u64 probe         = 0;
-        b8  found         = false;
-        u64 found_address = -1; // Invalid address
-
-        // Linear probing after computing hash function
-        while (probe < capacity)
+        if (address == capacity)
         {
-            if (!items[address].is_occupied)
-            {
-                CORE_WARN("Key '%.*s' is not present inside the hashmap",
-                    (int)key.size,
-                    key.buff);
-                return false;
-            }
-
-            if (string_match(items[address].key, key))
-            {
-                found         = true;
-                found_address = address;
-                break;
-            }
-
-            probe++;
-            address = next_address(address); // Wraparound the address
+            CORE_WARN("Key '%.*s' is not present inside the hashmap",
+                (int)key.size,
+                key.buff);
+            return false;
         }
 
-        // To delete the item we shift every element until we reach a new
-        // element properly aligned by 1, in an attempt to improve their
-        // respective distances
-        if (found)
-        {
-            probe   = 0;
-            address = found_address;
-
-            while (probe < capacity)
-            {
-                // If the next element in line is already at the optimal
-                // location we stop
-                auto *next_item = &items[next_address(address)];
-                if (next_item->distance == 0 || !next_item->is_occupied)
-                {
-                    memory_zero(&items[address], sizeof(Hashmap_Item<T>));
-                    count--;
-                    return true;
-                }
+        _release_key(items[address].key);
 
-                // In theory we can optimize this further because tecnically,
-                // I just need to copy the data from the next items, without
-                // propagating the data to be deleted to the next location,
-                // however it is easier to visualize the algorithm this way
-                items[address] = *next_item;
-                items[address].distance--;
+        // To delete the item we shift every element of the run back by one
+        // until we reach an element already at its home slot. The run keeps
+        // no gaps, so no tombstones are needed
+        u64 next = next_address(address);
+        while (items[next].is_occupied && items[next].distance > 0)
+        {
+            items[address] = items[next];
+            items[address].distance--;
+            _set_control(address, control[next]);
 
-                probe++;
-                address = next_address(address);
-            }
+            address = next;
+            next    = next_address(address);
         }
 
-        return false;
+        memory_zero(&items[address], sizeof(Hashmap_Item<T>));
+        _set_control(address, HASHMAP_CONTROL_EMPTY);
+        count--;
+
+        return true;
     }
 
     // Helper function for looping over the hashmap in a for loop without
     // handling the empty/not-empty logic. Useful when destroying the resources
     // tied or managed by the hashmap elements T
     FORCE_INLINE u64
-    next_occupied_index(u64 start_index) const
+    next_occupied_index(u64 start_index)
     {
+        // Iteration only walks items, so everything has to be moved there
+        if (old_items)
+            _migrate(old_capacity);
+
         for (u64 i = start_index; i < capacity; ++i)
         {
             if (items[i].is_occupied)
@@ -336,7 +302,7 @@ struct Hashmap
     }
 
     FORCE_INLINE void
-    debug_log_table() const
+    debug_log_table()
     {
         CORE_INFO("HashMap debug view with count='%llu' and capacity='%llu')",
             count,
@@ -367,9 +333,255 @@ struct Hashmap
         return (current_address + 1) & (capacity - 1);
     }
 
-    FORCE_INLINE b8
-    full()
+    FORCE_INLINE void
+    _allocate_table(u64 new_capacity)
+    {
+        capacity = new_capacity;
+        items    = push_array(_allocator, Hashmap_Item<T>, capacity);
+        control  = push_array(_allocator, u8, capacity + HASHMAP_GROUP_WIDTH);
+
+        memory_set(control, HASHMAP_CONTROL_EMPTY,
+            capacity + HASHMAP_GROUP_WIDTH);
+    }
+
+    FORCE_INLINE void
+    _set_control(u64 address, u8 value)
+    {
+        control[address] = value;
+
+        // The first group is mirrored after the end of the table so that a
+        // group load starting near the end wraps around without a branch
+        if (address < HASHMAP_GROUP_WIDTH)
+            control[capacity + address] = value;
+    }
+
+    // Returns the address of the key in the given table, or table_capacity if
+    // it is not present
+    FORCE_INLINE u64
+    _probe(Hashmap_Item<T> *table,
+        u8                 *table_control,
+        u64                 table_capacity,
+        String              key,
+        u64                 hash)
     {
-        return count == capacity;
+        u64 mask    = table_capacity - 1;
+        u64 address = hash & mask;
+
+#if HASHMAP_SIMD_PROBE
+        if (table_capacity >= HASHMAP_GROUP_WIDTH)
+        {
+            __m128i tag = _mm_set1_epi8((char)(hash >> 57));
+
+            for (u64 probed = 0; probed < table_capacity;
+                probed += HASHMAP_GROUP_WIDTH)
+            {
+                __m128i group = _mm_loadu_si128(
+                    (const __m128i *)(table_control + address));
+
+                u32 matches =
+                    (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, tag));
+                u32 empties = (u32)_mm_movemask_epi8(group);
+
+                // The run of the key ends at the first empty slot, matches
+                // after it belong to other runs
+                if (empties)
+                    matches &= (empties & (0 - empties)) - 1;
+
+                while (matches)
+                {
+                    u64 slot = (address + _first_set_bit(matches)) & mask;
+
+                    if (table[slot].hash == hash &&
+                        string_match(table[slot].key, key))
+                        return slot;
+
+                    matches &= matches - 1;
+                }
+
+                if (empties)
+                    return table_capacity;
+
+                address = (address + HASHMAP_GROUP_WIDTH) & mask;
+            }
+
+            return table_capacity;
+        }
+#endif
+
+        for (u32 distance = 0; distance < table_capacity; ++distance)
+        {
+            Hashmap_Item<T> *item = &table[address];
+
+            // Robin Hood keeps every run sorted by distance, so a slot closer
+            // to its home than we are to ours means the key is not here
+            if (!item->is_occupied || item->distance < distance)
+                return table_capacity;
+
+            if (item->hash == hash && string_match(item->key, key))
+                return address;
+
+            address = (address + 1) & mask;
+        }
+
+        return table_capacity;
+    }
+
+#if HASHMAP_SIMD_PROBE
+    FORCE_INLINE u32
+    _first_set_bit(u32 mask)
+    {
+#    if _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (u32)index;
+#    else
+        return (u32)__builtin_ctz(mask);
+#    endif
+    }
+#endif
+
+    FORCE_INLINE Hashmap_Item<T> *
+    _lookup(String key, u64 hash)
+    {
+        u64 address = _probe(items, control, capacity, key, hash);
+        if (address != capacity)
+            return &items[address];
+
+        if (old_items)
+        {
+            // A hit below migrate_index is a stale copy, the live one would
+            // have been found in items
+            address = _probe(old_items, old_control, old_capacity, key, hash);
+            if (address != old_capacity && address >= migrate_index)
+                return &old_items[address];
+        }
+
+        return nullptr;
+    }
+
+    // Robin Hood insertion of an item that is known not to be in the table
+    FORCE_INLINE void
+    _place(Hashmap_Item<T> item)
+    {
+        u64 address = item.hash & (capacity - 1);
+
+        for (;;)
+        {
+            if (!items[address].is_occupied)
+            {
+                items[address] = item;
+                _set_control(address, (u8)(item.hash >> 57));
+                return;
+            }
+
+            // If we are at distance x from the "proper" position and we
+            // encouter an element that is very close to its own "proper"
+            // position, instead of propagating the new value and exagerating
+            // the tail of the current element's bucket, we swap the two
+            // elements and instead start propagating the "rich" element
+            if (items[address].distance < item.distance)
+            {
+                Hashmap_Item<T> temp = items[address];
+                items[address]       = item;
+                item                 = temp;
+                _set_control(address, (u8)(items[address].hash >> 57));
+            }
+
+            address = next_address(address); // Wraparound the address
+            item.distance++;
+        }
+    }
+
+    FORCE_INLINE void
+    _grow()
+    {
+        old_items     = items;
+        old_control   = control;
+        old_capacity  = capacity;
+        migrate_index = 0;
+
+        _allocate_table(capacity * 2);
+    }
+
+    // Moves up to slot_count slots of the old table into the current one
+    FORCE_INLINE void
+    _migrate(u64 slot_count)
+    {
+        u64 end = MIN(migrate_index + slot_count, old_capacity);
+
+        for (; migrate_index < end; ++migrate_index)
+        {
+            Hashmap_Item<T> item = old_items[migrate_index];
+            if (!item.is_occupied)
+                continue;
+
+            // The hash is stored, so moving never touches the key bytes
+            item.distance = 0;
+            _place(item);
+        }
+
+        if (migrate_index == old_capacity)
+        {
+            old_items     = nullptr;
+            old_control   = nullptr;
+            old_capacity  = 0;
+            migrate_index = 0;
+        }
+    }
+
+    // Index of the smallest size class that fits size bytes, or
+    // HASHMAP_KEY_CLASS_COUNT if the key is too long to be recycled
+    FORCE_INLINE u64
+    _key_class(u64 size)
+    {
+        u64 key_class  = 0;
+        u64 class_size = HASHMAP_KEY_MIN_CLASS_SIZE;
+
+        while (class_size < size && key_class < HASHMAP_KEY_CLASS_COUNT)
+        {
+            class_size <<= 1;
+            key_class++;
+        }
+
+        return key_class;
+    }
+
+    FORCE_INLINE String
+    _copy_key(String key)
+    {
+        u64 key_class = _key_class(key.size + 1);
+        if (key_class == HASHMAP_KEY_CLASS_COUNT)
+            return string_copy(_allocator, key);
+
+        char *buff = free_keys[key_class];
+        if (buff)
+        {
+            // Freed blocks store the next free block in their first bytes
+            memory_copy(&free_keys[key_class], buff, sizeof(char *));
+        }
+        else
+        {
+            buff = push_array(_allocator,
+                char,
+                HASHMAP_KEY_MIN_CLASS_SIZE << key_class);
+        }
+
+        if (key.size > 0)
+            memory_copy(buff, key.buff, key.size);
+
+        buff[key.size] = 0;
+
+        return String{buff, key.size};
+    }
+
+    FORCE_INLINE void
+    _release_key(String key)
+    {
+        u64 key_class = _key_class(key.size + 1);
+        if (key_class == HASHMAP_KEY_CLASS_COUNT)
+            return;
+
+        memory_copy(key.buff, &free_keys[key_class], sizeof(char *));
+        free_keys[key_class] = key.buff;
     }
 };
@@ -3,10 +3,17 @@
 #include "defines.hpp"
 
 #include "core/asserts.hpp"
+#include "math/math.hpp"
 #include "memory/arena.hpp"
 
+#include <atomic>
+
 constexpr u64 DEFAULT_RING_QUEUE_CAPACITY = 256;
 
+// Head and tail of the concurrent queues live on their own cache lines so the
+// producer and the consumer do not invalidate each other's line on every op
+constexpr u64 RING_QUEUE_CACHE_LINE_SIZE = 64;
+
 // Fixed-size ring buffer queue backed by an arena.
 // When full, new pushes are dropped and a warning is logged.
 template <typename T>
@@ -89,3 +96,224 @@ struct Ring_Queue
         tail  = 0;
     }
 };
+
+// Lock-free single-producer/single-consumer ring queue backed by an arena.
+// Exactly one thread may enqueue and exactly one thread may dequeue. The
+// capacity is rounded up to a power of two so wrapping is a mask, and head and
+// tail grow monotonically. Unlike Ring_Queue a full queue is not an error, the
+// producer decides what to do with the rejected element
+template <typename T>
+struct SPSC_Ring_Queue
+{
+    // Consumer side
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<u64> head;
+    u64 cached_tail; // Last tail seen by the consumer
+
+    // Producer side
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<u64> tail;
+    u64 cached_head; // Last head seen by the producer
+
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) u64 capacity;
+    u64    mask;
+    T     *elements;
+    Arena *_allocator; // Should not be accessed externally
+
+    FORCE_INLINE void
+    init(Arena *allocator, u64 requested_capacity = DEFAULT_RING_QUEUE_CAPACITY)
+    {
+        RUNTIME_ASSERT(allocator != nullptr);
+        RUNTIME_ASSERT(requested_capacity > 0);
+
+        _allocator = allocator;
+        capacity   = math_next_power_of_2(requested_capacity);
+        mask       = capacity - 1;
+        elements   = push_array(_allocator, T, capacity);
+
+        reset();
+    }
+
+    // Producer only
+    FORCE_INLINE b8
+    enqueue(const T &value)
+    {
+        u64 current_tail = tail.load(std::memory_order_relaxed);
+
+        // The consumer head is only reloaded when the cached one says the
+        // queue is full, which keeps the shared line out of the common path
+        if (current_tail - cached_head >= capacity)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+            if (current_tail - cached_head >= capacity)
+                return false;
+        }
+
+        elements[current_tail & mask] = value;
+        tail.store(current_tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only
+    FORCE_INLINE b8
+    dequeue(T *out)
+    {
+        RUNTIME_ASSERT(out != nullptr);
+
+        u64 current_head = head.load(std::memory_order_relaxed);
+
+        if (current_head == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (current_head == cached_tail)
+                return false;
+        }
+
+        *out = elements[current_head & mask];
+        head.store(current_head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Approximate when called while the other side is running
+    FORCE_INLINE u64
+    count()
+    {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+    FORCE_INLINE b8
+    is_empty()
+    {
+        return count() == 0;
+    }
+
+    // Not thread safe, neither side may be running
+    FORCE_INLINE void
+    reset()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        cached_head = 0;
+        cached_tail = 0;
+    }
+};
+
+// Bounded lock-free multi-producer/single-consumer ring queue backed by an
+// arena. Every cell carries a sequence number that tells whether it is ready
+// to be written for a given lap of the tail or to be read for a given lap of
+// the head, so producers only contend on a single compare-exchange of the tail
+template <typename T>
+struct MPSC_Ring_Queue
+{
+    struct Cell
+    {
+        std::atomic<u64> sequence;
+        T                value;
+    };
+
+    // Consumer side, a single thread so no atomics are needed
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) u64 head;
+
+    // Shared by the producers
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<u64> tail;
+
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) u64 capacity;
+    u64    mask;
+    Cell  *cells;
+    Arena *_allocator; // Should not be accessed externally
+
+    FORCE_INLINE void
+    init(Arena *allocator, u64 requested_capacity = DEFAULT_RING_QUEUE_CAPACITY)
+    {
+        RUNTIME_ASSERT(allocator != nullptr);
+        RUNTIME_ASSERT(requested_capacity > 1);
+
+        _allocator = allocator;
+        capacity   = math_next_power_of_2(requested_capacity);
+        mask       = capacity - 1;
+        cells      = push_array(_allocator, Cell, capacity);
+
+        reset();
+    }
+
+    // Any thread
+    FORCE_INLINE b8
+    enqueue(const T &value)
+    {
+        u64   position = tail.load(std::memory_order_relaxed);
+        Cell *cell;
+
+        for (;;)
+        {
+            cell         = &cells[position & mask];
+            u64 sequence = cell->sequence.load(std::memory_order_acquire);
+            s64 lag      = (s64)(sequence - position);
+
+            if (lag == 0)
+            {
+                // The cell is free for this lap, claim the slot. On failure
+                // position is reloaded with the current tail
+                if (tail.compare_exchange_weak(position,
+                        position + 1,
+                        std::memory_order_relaxed))
+                    break;
+            }
+            else if (lag < 0)
+            {
+                // The consumer has not released the cell of the previous lap
+                return false;
+            }
+            else
+            {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only
+    FORCE_INLINE b8
+    dequeue(T *out)
+    {
+        RUNTIME_ASSERT(out != nullptr);
+
+        Cell *cell     = &cells[head & mask];
+        u64   sequence = cell->sequence.load(std::memory_order_acquire);
+
+        // The producer that claimed the slot may still be writing it
+        if (sequence != head + 1)
+            return false;
+
+        *out = cell->value;
+
+        // Hand the cell over to the producers of the next lap
+        cell->sequence.store(head + capacity, std::memory_order_release);
+        head++;
+
+        return true;
+    }
+
+    // Consumer only
+    FORCE_INLINE b8
+    is_empty()
+    {
+        return cells[head & mask].sequence.load(std::memory_order_acquire) !=
+               head + 1;
+    }
+
+    // Not thread safe, no producer or consumer may be running
+    FORCE_INLINE void
+    reset()
+    {
+        head = 0;
+        tail.store(0, std::memory_order_relaxed);
+
+        for (u64 i = 0; i < capacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+};
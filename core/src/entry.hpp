@@ -5,6 +5,7 @@
 #include "core/logger.hpp"
 #include "core/thread_context.hpp"
 #include "defines.hpp"
+#include "memory/allocation_profiler.hpp"
 
 #ifdef DEBUG_BUILD
 #    include "memory/arena_debug.hpp"
@@ -21,6 +22,9 @@ main()
     arena_debug_init();
 #endif
 
+    // Sampled, so it stays on in release builds
+    allocation_profiler_init();
+
     Thread_Context *thread_context = thread_context_allocate();
     thread_context->thread_name    = "Application main thread";
     thread_context_select(thread_context);
@@ -46,6 +50,8 @@ main()
 
     thread_context_release(thread_context);
 
+    allocation_profiler_shutdown();
+
 #ifdef DEBUG_BUILD
     arena_debug_shutdown();
 #endif
@@ -19,7 +19,12 @@ event_queue_produce(Event_Queue  *eq,
                     const Event  &event)
 {
     RUNTIME_ASSERT(eq != nullptr);
-    eq->queue.enqueue(event);
+
+    if (!eq->queue.enqueue(event))
+    {
+        CORE_WARN("Event queue full, dropping event of type %u",
+                  (u32)event.type);
+    }
 }
 
 INTERNAL_FUNC b8
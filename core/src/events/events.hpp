@@ -116,11 +116,13 @@ struct Event_State
     Event_Callback_Bucket callback_buckets[(u32)Event_Type::MAX_EVENTS];
 };
 
-// Opaque event queue wrapper - hides Ring_Queue<Event> from consumers
-// of Frame_Context. Include this header to produce or flush events.
+// Opaque event queue wrapper - hides SPSC_Ring_Queue<Event> from consumers
+// of Frame_Context. Include this header to produce or flush events. Events can
+// be produced from one thread (e.g. the platform thread) while another one
+// flushes them
 struct Event_Queue
 {
-    Ring_Queue<Event> queue;
+    SPSC_Ring_Queue<Event> queue;
 };
 
 // Event queue lifecycle
@@ -0,0 +1,609 @@
+#include "layout/gdsii_reader.hpp"
+
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "core/thread_context.hpp"
+#include "platform/platform.hpp"
+#include "systems/job_system.hpp"
+
+#include <atomic>
+#include <math.h>
+
+// An XY record holds at most (65535 - 4) / 8 points
+constexpr u32 GDSII_MAX_POINTS = 8192;
+
+constexpr u16 GDSII_STRANS_REFLECTION = 0x8000;
+
+enum class GDSII_Path_Type : u16
+{
+    FLUSH    = 0,
+    ROUND    = 1, // Approximated by a square end
+    EXTENDED = 2,
+    CUSTOM   = 4,
+};
+
+struct GDSII_Structure_Range
+{
+    u64 begin; // Offset of the BGNSTR record
+    u64 end;   // Offset past the ENDSTR record
+};
+
+struct GDSII_Record_View
+{
+    GDSII_Record type;
+    const u8    *payload;
+    u32          payload_size;
+};
+
+struct GDSII_Cursor
+{
+    const u8 *data;
+    u64       offset;
+    u64       end;
+};
+
+// Element between a BOUNDARY/PATH/... record and its ENDEL
+struct GDSII_Element
+{
+    GDSII_Record kind;
+
+    u16 layer;
+    u16 datatype;
+
+    s32             width;
+    GDSII_Path_Type path_type;
+    s32             begin_extension;
+    s32             end_extension;
+
+    String sname;
+    u16    strans;
+    f64    magnification;
+    f64    angle;
+    u16    columns;
+    u16    rows;
+
+    const u8 *xy;
+    u32       point_count;
+};
+
+struct GDSII_Read_Context
+{
+    const u8              *data;
+    GDSII_Structure_Range *structures;
+
+    Layout            *layout;
+    Platform_Semaphore commit_lock;
+
+    std::atomic<u64> element_count;
+    std::atomic<b8>  failed;
+    std::atomic<b8>  warned_angle;
+};
+
+FORCE_INLINE u16
+read_u16(const u8 *bytes)
+{
+    return (u16)((bytes[0] << 8) | bytes[1]);
+}
+
+FORCE_INLINE s32
+read_s32(const u8 *bytes)
+{
+    return (s32)(((u32)bytes[0] << 24) | ((u32)bytes[1] << 16) |
+                 ((u32)bytes[2] << 8) | (u32)bytes[3]);
+}
+
+// Excess-64 base-16 floating point: sign, 7 bit exponent, 56 bit mantissa
+INTERNAL_FUNC f64
+read_real8(const u8 *bytes)
+{
+    u64 bits = 0;
+    for (u32 i = 0; i < 8; ++i)
+        bits = (bits << 8) | bytes[i];
+
+    s32 exponent = (s32)((bits >> 56) & 0x7F) - 64;
+    u64 mantissa = bits & 0x00FFFFFFFFFFFFFFull;
+
+    f64 value = ldexp((f64)mantissa, exponent * 4 - 56);
+
+    return (bits >> 63) ? -value : value;
+}
+
+// Strings are padded with a zero byte to an even length
+INTERNAL_FUNC String
+read_string(GDSII_Record_View *record)
+{
+    u64 size = record->payload_size;
+    while (size > 0 && record->payload[size - 1] == '\0')
+        size--;
+
+    return {(char *)record->payload, size};
+}
+
+INTERNAL_FUNC b8
+next_record(GDSII_Cursor *cursor, GDSII_Record_View *out_record)
+{
+    if (cursor->offset + 4 > cursor->end)
+        return false;
+
+    const u8 *header = cursor->data + cursor->offset;
+    u16       length = read_u16(header);
+
+    if (length < 4 || cursor->offset + length > cursor->end)
+        return false;
+
+    out_record->type         = (GDSII_Record)header[2];
+    out_record->payload      = header + 4;
+    out_record->payload_size = length - 4;
+
+    cursor->offset += length;
+
+    return true;
+}
+
+INTERNAL_FUNC void
+emit_path(Cell_Builder *builder, GDSII_Element *element, s32 *xs, s32 *ys)
+{
+    f64 half_width = (element->width < 0 ? -element->width : element->width) /
+                     2.0;
+
+    // Zero width paths have no area to draw
+    if (half_width == 0.0 || element->point_count < 2)
+        return;
+
+    f64 begin_extension = 0.0;
+    f64 end_extension   = 0.0;
+
+    switch (element->path_type)
+    {
+        case GDSII_Path_Type::ROUND:
+        case GDSII_Path_Type::EXTENDED:
+            begin_extension = half_width;
+            end_extension   = half_width;
+            break;
+        case GDSII_Path_Type::CUSTOM:
+            begin_extension = element->begin_extension;
+            end_extension   = element->end_extension;
+            break;
+        default:
+            break;
+    }
+
+    u32 segment_count = element->point_count - 1;
+
+    for (u32 i = 0; i < segment_count; ++i)
+    {
+        f64 x0 = xs[i];
+        f64 y0 = ys[i];
+        f64 dx = (f64)xs[i + 1] - x0;
+        f64 dy = (f64)ys[i + 1] - y0;
+
+        f64 length = sqrt(dx * dx + dy * dy);
+        if (length == 0.0)
+            continue;
+
+        // Inner joints are extended by half the width, which fills the
+        // corners of Manhattan paths
+        f64 start = i == 0 ? begin_extension : half_width;
+        f64 end   = i == segment_count - 1 ? end_extension : half_width;
+
+        f64 ux = dx / length;
+        f64 uy = dy / length;
+
+        f64 ax = x0 - ux * start;
+        f64 ay = y0 - uy * start;
+        f64 bx = xs[i + 1] + ux * end;
+        f64 by = ys[i + 1] + uy * end;
+
+        f64 nx = -uy * half_width;
+        f64 ny = ux * half_width;
+
+        if (dx == 0.0 || dy == 0.0)
+        {
+            Layout_Box rect = {(s32)lround(MIN(ax, bx) - fabs(nx)),
+                               (s32)lround(MIN(ay, by) - fabs(ny)),
+                               (s32)lround(MAX(ax, bx) + fabs(nx)),
+                               (s32)lround(MAX(ay, by) + fabs(ny))};
+
+            cell_builder_add_rect(
+                builder, element->layer, element->datatype, rect);
+            continue;
+        }
+
+        s32 quad_x[] = {(s32)lround(ax + nx),
+                        (s32)lround(bx + nx),
+                        (s32)lround(bx - nx),
+                        (s32)lround(ax - nx)};
+        s32 quad_y[] = {(s32)lround(ay + ny),
+                        (s32)lround(by + ny),
+                        (s32)lround(by - ny),
+                        (s32)lround(ay - ny)};
+
+        cell_builder_add_polygon(
+            builder, element->layer, element->datatype, quad_x, quad_y, 4);
+    }
+}
+
+INTERNAL_FUNC b8
+emit_instance(GDSII_Read_Context *context,
+              Cell_Builder       *builder,
+              GDSII_Element      *element,
+              s32                *xs,
+              s32                *ys)
+{
+    u32 required_points = element->kind == GDSII_Record::AREF ? 3 : 1;
+    if (element->point_count < required_points || element->sname.size == 0)
+        return false;
+
+    // Orientations are limited to quarter turns, other angles are rounded
+    f64 quarter_turns = element->angle / 90.0;
+    s64 rotation      = lround(quarter_turns);
+
+    if (fabs(quarter_turns - rotation) > 1e-6 &&
+        !context->warned_angle.exchange(true))
+    {
+        CORE_WARN("gdsii_read - Instance of '%.*s' rotated by %.3f degrees, "
+                  "arbitrary angles are rounded to quarter turns",
+                  (int)element->sname.size,
+                  element->sname.buff,
+                  element->angle);
+    }
+
+    u8 orientation = (u8)(rotation & LAYOUT_ROTATION_MASK);
+    if (element->strans & GDSII_STRANS_REFLECTION)
+        orientation |= LAYOUT_MIRROR_BIT;
+
+    Cell_Instance instance           = {};
+    instance.columns                 = 1;
+    instance.rows                    = 1;
+    instance.transform.offset_x      = xs[0];
+    instance.transform.offset_y      = ys[0];
+    instance.transform.magnification = (f32)element->magnification;
+    instance.transform.orientation   = (Layout_Orientation)orientation;
+
+    if (element->kind == GDSII_Record::AREF)
+    {
+        if (element->columns == 0 || element->rows == 0)
+            return false;
+
+        instance.columns = element->columns;
+        instance.rows    = element->rows;
+
+        instance.column_step_x = (xs[1] - xs[0]) / element->columns;
+        instance.column_step_y = (ys[1] - ys[0]) / element->columns;
+        instance.row_step_x    = (xs[2] - xs[0]) / element->rows;
+        instance.row_step_y    = (ys[2] - ys[0]) / element->rows;
+    }
+
+    cell_builder_add_instance(builder, element->sname, &instance);
+
+    return true;
+}
+
+INTERNAL_FUNC b8
+emit_element(GDSII_Read_Context *context,
+             Cell_Builder       *builder,
+             GDSII_Element      *element,
+             s32                *xs,
+             s32                *ys)
+{
+    for (u32 i = 0; i < element->point_count; ++i)
+    {
+        xs[i] = read_s32(element->xy + i * 8);
+        ys[i] = read_s32(element->xy + i * 8 + 4);
+    }
+
+    switch (element->kind)
+    {
+        case GDSII_Record::BOUNDARY:
+        case GDSII_Record::BOX:
+            if (element->point_count < 4)
+                return false;
+
+            cell_builder_add_polygon(builder,
+                                     element->layer,
+                                     element->datatype,
+                                     xs,
+                                     ys,
+                                     element->point_count);
+            return true;
+
+        case GDSII_Record::PATH:
+            emit_path(builder, element, xs, ys);
+            return true;
+
+        case GDSII_Record::SREF:
+        case GDSII_Record::AREF:
+            return emit_instance(context, builder, element, xs, ys);
+
+        default:
+            // Text and nodes carry no geometry
+            return true;
+    }
+}
+
+INTERNAL_FUNC b8
+parse_structure(GDSII_Read_Context    *context,
+                GDSII_Structure_Range *range,
+                Cell_Builder          *builder,
+                s32                   *xs,
+                s32                   *ys)
+{
+    GDSII_Cursor cursor = {context->data, range->begin, range->end};
+
+    GDSII_Record_View record;
+    GDSII_Element     element       = {};
+    b8                in_element    = false;
+    b8                has_name      = false;
+    u64               element_count = 0;
+
+    while (next_record(&cursor, &record))
+    {
+        const u8 *payload = record.payload;
+
+        switch (record.type)
+        {
+            case GDSII_Record::STRNAME:
+                cell_builder_begin(builder, read_string(&record));
+                has_name = true;
+                break;
+
+            case GDSII_Record::BOUNDARY:
+            case GDSII_Record::BOX:
+            case GDSII_Record::PATH:
+            case GDSII_Record::SREF:
+            case GDSII_Record::AREF:
+            case GDSII_Record::TEXT:
+            case GDSII_Record::NODE:
+                element               = {};
+                element.kind          = record.type;
+                element.magnification = 1.0;
+                in_element            = true;
+                break;
+
+            case GDSII_Record::LAYER:
+                element.layer = read_u16(payload);
+                break;
+
+            case GDSII_Record::DATATYPE:
+            case GDSII_Record::BOXTYPE:
+                element.datatype = read_u16(payload);
+                break;
+
+            case GDSII_Record::WIDTH:
+                element.width = read_s32(payload);
+                break;
+
+            case GDSII_Record::PATHTYPE:
+                element.path_type = (GDSII_Path_Type)read_u16(payload);
+                break;
+
+            case GDSII_Record::BGNEXTN:
+                element.begin_extension = read_s32(payload);
+                break;
+
+            case GDSII_Record::ENDEXTN:
+                element.end_extension = read_s32(payload);
+                break;
+
+            case GDSII_Record::SNAME:
+                element.sname = read_string(&record);
+                break;
+
+            case GDSII_Record::STRANS:
+                element.strans = read_u16(payload);
+                break;
+
+            case GDSII_Record::MAG:
+                element.magnification = read_real8(payload);
+                break;
+
+            case GDSII_Record::ANGLE:
+                element.angle = read_real8(payload);
+                break;
+
+            case GDSII_Record::COLROW:
+                element.columns = read_u16(payload);
+                element.rows    = read_u16(payload + 2);
+                break;
+
+            case GDSII_Record::XY:
+                element.xy          = payload;
+                element.point_count = record.payload_size / 8;
+                break;
+
+            case GDSII_Record::ENDEL:
+                if (!has_name || !in_element ||
+                    !emit_element(context, builder, &element, xs, ys))
+                {
+                    CORE_ERROR("gdsii_read - Malformed element at offset "
+                               "%llu in structure '%.*s'",
+                               cursor.offset,
+                               (int)builder->name.size,
+                               builder->name.buff);
+                    return false;
+                }
+
+                in_element = false;
+                element_count++;
+                break;
+
+            case GDSII_Record::ENDSTR:
+            {
+                if (!has_name)
+                {
+                    CORE_ERROR("gdsii_read - Structure at offset %llu has no "
+                               "name",
+                               range->begin);
+                    return false;
+                }
+
+                // The geometry is copied before taking the lock, the layout
+                // arena takes concurrent pushes
+                Cell_Layer *layers =
+                    layout_copy_cell_layers(context->layout, builder);
+
+                platform_semaphore_wait(&context->commit_lock);
+                u32 cell =
+                    layout_commit_cell(context->layout, builder, layers);
+                platform_semaphore_signal(&context->commit_lock, 1);
+
+                context->element_count.fetch_add(element_count,
+                                                 std::memory_order_relaxed);
+
+                return cell != INVALID_ID;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    CORE_ERROR("gdsii_read - Structure at offset %llu is truncated",
+               range->begin);
+
+    return false;
+}
+
+INTERNAL_FUNC void
+parse_structures(u64 start, u64 end, void *data)
+{
+    auto *context = (GDSII_Read_Context *)data;
+
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    s32 *xs = push_array(scratch.arena, s32, GDSII_MAX_POINTS);
+    s32 *ys = push_array(scratch.arena, s32, GDSII_MAX_POINTS);
+
+    for (u64 i = start; i < end; ++i)
+    {
+        if (context->failed.load(std::memory_order_relaxed))
+            break;
+
+        if (!parse_structure(
+                context, &context->structures[i], &builder, xs, ys))
+        {
+            context->failed.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    scratch_end(scratch);
+    cell_builder_shutdown(&builder);
+}
+
+VOLTRUM_API Layout *
+gdsii_read(const u8 *data, u64 size, GDSII_Read_Stats *out_stats)
+{
+    f64 start_time = platform_get_absolute_time();
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    Dynamic_Array<GDSII_Structure_Range> structures;
+    structures.init(scratch.arena, 1024);
+
+    // Index pass, only the record headers are read
+    GDSII_Cursor      cursor = {data, 0, size};
+    GDSII_Record_View record;
+    f64               database_unit = LAYOUT_DEFAULT_DATABASE_UNIT;
+    b8                found_end     = false;
+    u64               begin         = 0;
+
+    while (!found_end)
+    {
+        u64 offset = cursor.offset;
+
+        if (!next_record(&cursor, &record))
+        {
+            CORE_ERROR("gdsii_read - Invalid record at offset %llu", offset);
+            scratch_end(scratch);
+            return nullptr;
+        }
+
+        switch (record.type)
+        {
+            case GDSII_Record::UNITS:
+                if (record.payload_size >= 16)
+                    database_unit = read_real8(record.payload + 8);
+                break;
+
+            case GDSII_Record::BGNSTR:
+                begin = offset;
+                break;
+
+            case GDSII_Record::ENDSTR:
+                structures.add({begin, cursor.offset});
+                break;
+
+            case GDSII_Record::ENDLIB:
+                found_end = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    f64 index_end_time = platform_get_absolute_time();
+
+    // Contiguous copy for the jobs, the dynamic array may be chunked
+    u32 structure_count = (u32)structures.size;
+
+    auto *ranges =
+        push_array(scratch.arena, GDSII_Structure_Range, structure_count);
+    for (u32 i = 0; i < structure_count; ++i)
+        ranges[i] = structures[i];
+
+    auto *context       = push_struct(scratch.arena, GDSII_Read_Context);
+    context->data       = data;
+    context->structures = ranges;
+    context->layout     = layout_create(database_unit);
+
+    if (!platform_semaphore_create(1, &context->commit_lock))
+    {
+        CORE_ERROR("gdsii_read - Failed to create the commit lock");
+        layout_destroy(context->layout);
+        scratch_end(scratch);
+        return nullptr;
+    }
+
+    // Structures are independent, each batch stages them in its own builder
+    // and copies them into the layout. Only the cell declarations are
+    // serialized
+    job_system_parallel_for(structure_count, 0, parse_structures, context);
+
+    platform_semaphore_destroy(&context->commit_lock);
+
+    f64 parse_end_time = platform_get_absolute_time();
+
+    Layout *layout = context->layout;
+    b8      failed = context->failed.load();
+
+    if (!failed && !layout_finalize(layout))
+        failed = true;
+
+    f64 end_time = platform_get_absolute_time();
+
+    if (out_stats)
+    {
+        out_stats->byte_count      = size;
+        out_stats->structure_count = structure_count;
+        out_stats->element_count   = context->element_count.load();
+        out_stats->index_time      = index_end_time - start_time;
+        out_stats->parse_time      = parse_end_time - index_end_time;
+        out_stats->finalize_time   = end_time - parse_end_time;
+        out_stats->megabytes_per_second =
+            (size / (1024.0 * 1024.0)) / MAX(end_time - start_time, 1e-9);
+    }
+
+    scratch_end(scratch);
+
+    if (failed)
+    {
+        layout_destroy(layout);
+        return nullptr;
+    }
+
+    return layout;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "defines.hpp"
+#include "layout/layout.hpp"
+
+// GDSII record types handled by the reader, the other records are skipped
+enum class GDSII_Record : u8
+{
+    HEADER   = 0x00,
+    BGNLIB   = 0x01,
+    LIBNAME  = 0x02,
+    UNITS    = 0x03,
+    ENDLIB   = 0x04,
+    BGNSTR   = 0x05,
+    STRNAME  = 0x06,
+    ENDSTR   = 0x07,
+    BOUNDARY = 0x08,
+    PATH     = 0x09,
+    SREF     = 0x0A,
+    AREF     = 0x0B,
+    TEXT     = 0x0C,
+    LAYER    = 0x0D,
+    DATATYPE = 0x0E,
+    WIDTH    = 0x0F,
+    XY       = 0x10,
+    ENDEL    = 0x11,
+    SNAME    = 0x12,
+    COLROW   = 0x13,
+    NODE     = 0x15,
+    STRANS   = 0x1A,
+    MAG      = 0x1B,
+    ANGLE    = 0x1C,
+    PATHTYPE = 0x21,
+    BOX      = 0x2D,
+    BOXTYPE  = 0x2E,
+    BGNEXTN  = 0x30,
+    ENDEXTN  = 0x31,
+};
+
+struct GDSII_Read_Stats
+{
+    u64 byte_count;
+    u32 structure_count;
+    u64 element_count;
+
+    // Seconds spent finding the structures, parsing them and finalizing
+    f64 index_time;
+    f64 parse_time;
+    f64 finalize_time;
+
+    f64 megabytes_per_second;
+};
+
+// Builds a layout from a GDSII stream. The stream is read in place, a first
+// pass only walks the record headers to find the structures, which are then
+// parsed in parallel through the job system. Returns nullptr when the stream
+// is malformed, the layout has to be released with layout_destroy
+VOLTRUM_API Layout *gdsii_read(const u8        *data,
+                               u64              size,
+                               GDSII_Read_Stats *out_stats = nullptr);
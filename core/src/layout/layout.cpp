@@ -0,0 +1,920 @@
+#include "layout/layout.hpp"
+
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "core/thread_context.hpp"
+#include "memory/memory.hpp"
+
+constexpr u64 LAYOUT_ARENA_COMMIT_SIZE      = 1 * MiB;
+constexpr u64 CELL_BUILDER_ARENA_RESERVE    = 4 * GiB;
+constexpr u64 CELL_BUILDER_DEFAULT_CAPACITY = 256;
+constexpr u64 CELL_BUILDER_DEFAULT_LAYERS   = 16;
+
+INTERNAL_FUNC void
+orient_point(Layout_Orientation orientation, s64 *x, s64 *y)
+{
+    u8  bits = (u8)orientation;
+    s64 px   = *x;
+    s64 py   = (bits & LAYOUT_MIRROR_BIT) ? -*y : *y;
+
+    switch (bits & LAYOUT_ROTATION_MASK)
+    {
+        case 0:
+            *x = px;
+            *y = py;
+            break;
+        case 1:
+            *x = -py;
+            *y = px;
+            break;
+        case 2:
+            *x = -px;
+            *y = -py;
+            break;
+        case 3:
+            *x = py;
+            *y = -px;
+            break;
+    }
+}
+
+// Applies orientation and magnification, without the offset
+INTERNAL_FUNC void
+transform_vector(const Layout_Transform *transform,
+                 s32                     x,
+                 s32                     y,
+                 s32                    *out_x,
+                 s32                    *out_y)
+{
+    s64 vx = x;
+    s64 vy = y;
+
+    orient_point(transform->orientation, &vx, &vy);
+
+    if (transform->magnification != 1.0f)
+    {
+        f64 magnification = transform->magnification;
+
+        vx = (s64)(vx * magnification + (vx < 0 ? -0.5 : 0.5));
+        vy = (s64)(vy * magnification + (vy < 0 ? -0.5 : 0.5));
+    }
+
+    *out_x = (s32)vx;
+    *out_y = (s32)vy;
+}
+
+VOLTRUM_API void
+layout_transform_point(const Layout_Transform *transform,
+                       s32                     x,
+                       s32                     y,
+                       s32                    *out_x,
+                       s32                    *out_y)
+{
+    transform_vector(transform, x, y, out_x, out_y);
+
+    *out_x += transform->offset_x;
+    *out_y += transform->offset_y;
+}
+
+VOLTRUM_API Layout_Box
+layout_transform_box(const Layout_Transform *transform, Layout_Box box)
+{
+    s32 x0, y0, x1, y1;
+    layout_transform_point(transform, box.min_x, box.min_y, &x0, &y0);
+    layout_transform_point(transform, box.max_x, box.max_y, &x1, &y1);
+
+    return {MIN(x0, x1), MIN(y0, y1), MAX(x0, x1), MAX(y0, y1)};
+}
+
+VOLTRUM_API Layout_Transform
+layout_transform_combine(const Layout_Transform *parent,
+                         const Layout_Transform *child)
+{
+    // R^a M^m R^b M^n = R^(a +- b) M^(m ^ n), since M R^b = R^-b M
+    u8 p = (u8)parent->orientation;
+    u8 c = (u8)child->orientation;
+
+    u8 parent_rotation = p & LAYOUT_ROTATION_MASK;
+    u8 child_rotation  = c & LAYOUT_ROTATION_MASK;
+
+    u8 rotation = (p & LAYOUT_MIRROR_BIT)
+                      ? (u8)(parent_rotation - child_rotation)
+                      : (u8)(parent_rotation + child_rotation);
+
+    Layout_Transform result;
+    result.orientation =
+        (Layout_Orientation)((rotation & LAYOUT_ROTATION_MASK) |
+                             ((p ^ c) & LAYOUT_MIRROR_BIT));
+    result.magnification = parent->magnification * child->magnification;
+
+    layout_transform_point(parent,
+                           child->offset_x,
+                           child->offset_y,
+                           &result.offset_x,
+                           &result.offset_y);
+
+    return result;
+}
+
+VOLTRUM_API Layout *
+layout_create(f64 database_unit)
+{
+    // Layouts of real chips take gigabytes, large pages keep the TLB misses of
+    // the traversals down. The readers copy cells in from several threads
+    Arena *arena = arena_create(LAYOUT_ARENA_RESERVE,
+                                LAYOUT_ARENA_COMMIT_SIZE,
+                                ARENA_DEFAULT_RETAIN_SIZE,
+                                Arena_Flags::LARGE_PAGES |
+                                    Arena_Flags::CONCURRENT);
+
+    auto *layout          = push_struct(arena, Layout);
+    layout->arena         = arena;
+    layout->database_unit = database_unit;
+    layout->top_cell      = INVALID_ID;
+
+    layout->cells.init(arena, LAYOUT_DEFAULT_CELL_CAPACITY);
+    layout->cell_lookup.init(arena, LAYOUT_DEFAULT_CELL_CAPACITY);
+
+    return layout;
+}
+
+VOLTRUM_API void
+layout_destroy(Layout *layout)
+{
+    ENSURE(layout);
+
+    // The layout struct lives in its own arena
+    arena_release(layout->arena);
+}
+
+VOLTRUM_API u64
+layout_memory_usage(Layout *layout)
+{
+    return arena_position(layout->arena);
+}
+
+VOLTRUM_API u32
+layout_find_cell(Layout *layout, String name)
+{
+    u32 index;
+    if (layout->cell_lookup.find(name, &index))
+        return index;
+
+    return INVALID_ID;
+}
+
+VOLTRUM_API u32
+layout_declare_cell(Layout *layout, String name)
+{
+    u32 index = layout_find_cell(layout, name);
+    if (index != INVALID_ID)
+        return index;
+
+    index = (u32)layout->cells.size;
+
+    Cell cell   = {};
+    cell.name   = string_copy(layout->arena, name);
+    cell.bounds = layout_box_empty();
+
+    layout->cells.add(cell);
+    layout->cell_lookup.add(cell.name, &index);
+
+    layout->is_finalized = false;
+
+    return index;
+}
+
+VOLTRUM_API void
+cell_builder_init(Cell_Builder *builder)
+{
+    memory_zero(builder, sizeof(Cell_Builder));
+
+    builder->arena =
+        arena_create(CELL_BUILDER_ARENA_RESERVE, LAYOUT_ARENA_COMMIT_SIZE);
+}
+
+VOLTRUM_API void
+cell_builder_shutdown(Cell_Builder *builder)
+{
+    arena_release(builder->arena);
+    memory_zero(builder, sizeof(Cell_Builder));
+}
+
+VOLTRUM_API void
+cell_builder_begin(Cell_Builder *builder, String name)
+{
+    arena_clear(builder->arena);
+
+    builder->name       = string_copy(builder->arena, name);
+    builder->last_layer = INVALID_ID;
+
+    builder->layers.init(builder->arena, CELL_BUILDER_DEFAULT_LAYERS);
+    builder->instances.init(builder->arena, CELL_BUILDER_DEFAULT_CAPACITY);
+    builder->instance_names.init(builder->arena, CELL_BUILDER_DEFAULT_CAPACITY);
+}
+
+INTERNAL_FUNC Cell_Builder_Layer *
+builder_get_layer(Cell_Builder *builder, u16 layer, u16 datatype)
+{
+    if (builder->last_layer != INVALID_ID)
+    {
+        Cell_Builder_Layer *last = &builder->layers[builder->last_layer];
+        if (last->layer == layer && last->datatype == datatype)
+            return last;
+    }
+
+    for (u64 i = 0; i < builder->layers.size; ++i)
+    {
+        Cell_Builder_Layer *candidate = &builder->layers[i];
+        if (candidate->layer == layer && candidate->datatype == datatype)
+        {
+            builder->last_layer = (u32)i;
+            return candidate;
+        }
+    }
+
+    Cell_Builder_Layer new_layer = {};
+    new_layer.layer              = layer;
+    new_layer.datatype           = datatype;
+
+    new_layer.rects.init(builder->arena, CELL_BUILDER_DEFAULT_CAPACITY);
+    new_layer.polygon_offsets.init(builder->arena,
+                                   CELL_BUILDER_DEFAULT_CAPACITY);
+    new_layer.vertex_x.init(builder->arena, CELL_BUILDER_DEFAULT_CAPACITY);
+    new_layer.vertex_y.init(builder->arena, CELL_BUILDER_DEFAULT_CAPACITY);
+
+    builder->last_layer = (u32)builder->layers.size;
+    builder->layers.add(new_layer);
+
+    return &builder->layers[builder->last_layer];
+}
+
+VOLTRUM_API void
+cell_builder_add_rect(Cell_Builder *builder,
+                      u16           layer,
+                      u16           datatype,
+                      Layout_Box    rect)
+{
+    builder_get_layer(builder, layer, datatype)->rects.add(rect);
+}
+
+VOLTRUM_API void
+cell_builder_add_polygon(Cell_Builder *builder,
+                         u16           layer,
+                         u16           datatype,
+                         const s32    *xs,
+                         const s32    *ys,
+                         u32           vertex_count)
+{
+    if (vertex_count > 1 && xs[0] == xs[vertex_count - 1] &&
+        ys[0] == ys[vertex_count - 1])
+    {
+        vertex_count--;
+    }
+
+    if (vertex_count < 3)
+    {
+        CORE_WARN("cell_builder_add_polygon - Degenerate polygon in '%.*s'",
+                  (int)builder->name.size,
+                  builder->name.buff);
+        return;
+    }
+
+    // Most layout boundaries are rectangles, which have a much cheaper form
+    if (vertex_count == 4)
+    {
+        b8 is_rect = (xs[0] == xs[1] && ys[1] == ys[2] && xs[2] == xs[3] &&
+                      ys[3] == ys[0]) ||
+                     (ys[0] == ys[1] && xs[1] == xs[2] && ys[2] == ys[3] &&
+                      xs[3] == xs[0]);
+
+        if (is_rect)
+        {
+            Layout_Box rect = {MIN(xs[0], xs[2]),
+                               MIN(ys[0], ys[2]),
+                               MAX(xs[0], xs[2]),
+                               MAX(ys[0], ys[2])};
+
+            cell_builder_add_rect(builder, layer, datatype, rect);
+            return;
+        }
+    }
+
+    Cell_Builder_Layer *target = builder_get_layer(builder, layer, datatype);
+
+    target->polygon_offsets.add((u32)target->vertex_x.size);
+
+    for (u32 i = 0; i < vertex_count; ++i)
+    {
+        target->vertex_x.add(xs[i]);
+        target->vertex_y.add(ys[i]);
+    }
+}
+
+VOLTRUM_API void
+cell_builder_add_instance(Cell_Builder        *builder,
+                          String               cell_name,
+                          const Cell_Instance *instance)
+{
+    Cell_Instance staged = *instance;
+    staged.cell          = INVALID_ID;
+    staged.columns       = MAX(staged.columns, 1);
+    staged.rows          = MAX(staged.rows, 1);
+
+    builder->instances.add(staged);
+    builder->instance_names.add(string_copy(builder->arena, cell_name));
+}
+
+VOLTRUM_API Cell_Layer *
+layout_copy_cell_layers(Layout *layout, Cell_Builder *builder)
+{
+    Arena *arena = layout->arena;
+
+    u32   layer_count = (u32)builder->layers.size;
+    auto *layers      = push_array(arena, Cell_Layer, layer_count);
+
+    for (u32 i = 0; i < layer_count; ++i)
+    {
+        Cell_Builder_Layer *staged = &builder->layers[i];
+        Cell_Layer         *layer  = &layers[i];
+
+        layer->layer    = staged->layer;
+        layer->datatype = staged->datatype;
+        layer->bounds   = layout_box_empty();
+
+        u32 rect_count    = (u32)staged->rects.size;
+        layer->rect_count = rect_count;
+        layer->rect_min_x = push_array(arena, s32, rect_count);
+        layer->rect_min_y = push_array(arena, s32, rect_count);
+        layer->rect_max_x = push_array(arena, s32, rect_count);
+        layer->rect_max_y = push_array(arena, s32, rect_count);
+
+        for (u32 r = 0; r < rect_count; ++r)
+        {
+            Layout_Box rect = staged->rects[r];
+
+            layer->rect_min_x[r] = rect.min_x;
+            layer->rect_min_y[r] = rect.min_y;
+            layer->rect_max_x[r] = rect.max_x;
+            layer->rect_max_y[r] = rect.max_y;
+
+            layer->bounds = layout_box_union(layer->bounds, rect);
+        }
+
+        u32 polygon_count    = (u32)staged->polygon_offsets.size;
+        u32 vertex_count     = (u32)staged->vertex_x.size;
+        layer->polygon_count = polygon_count;
+        layer->polygon_offsets = push_array(arena, u32, polygon_count + 1);
+        layer->vertex_x        = push_array(arena, s32, vertex_count);
+        layer->vertex_y        = push_array(arena, s32, vertex_count);
+
+        for (u32 p = 0; p < polygon_count; ++p)
+            layer->polygon_offsets[p] = staged->polygon_offsets[p];
+
+        layer->polygon_offsets[polygon_count] = vertex_count;
+
+        for (u32 v = 0; v < vertex_count; ++v)
+        {
+            s32 x = staged->vertex_x[v];
+            s32 y = staged->vertex_y[v];
+
+            layer->vertex_x[v] = x;
+            layer->vertex_y[v] = y;
+
+            layer->bounds = layout_box_union(layer->bounds, {x, y, x, y});
+        }
+    }
+
+    return layers;
+}
+
+VOLTRUM_API u32
+layout_commit_cell(Layout *layout, Cell_Builder *builder, Cell_Layer *layers)
+{
+    u32 index = layout_declare_cell(layout, builder->name);
+
+    // Chunks of the cell array never move, the pointer survives the
+    // declarations of the children below
+    Cell *cell = &layout->cells[index];
+
+    if (cell->is_defined)
+    {
+        CORE_ERROR("layout_commit_cell - Cell '%.*s' is defined twice",
+                   (int)builder->name.size,
+                   builder->name.buff);
+        return INVALID_ID;
+    }
+
+    Arena *arena = layout->arena;
+
+    cell->is_defined  = true;
+    cell->layer_count = (u32)builder->layers.size;
+    cell->layers =
+        layers ? layers : layout_copy_cell_layers(layout, builder);
+
+    cell->instance_count = (u32)builder->instances.size;
+    cell->instances = push_array(arena, Cell_Instance, cell->instance_count);
+
+    for (u32 i = 0; i < cell->instance_count; ++i)
+    {
+        cell->instances[i]      = builder->instances[i];
+        cell->instances[i].cell =
+            layout_declare_cell(layout, builder->instance_names[i]);
+    }
+
+    layout->is_finalized = false;
+
+    return index;
+}
+
+// Union of every element box of an array, which is the element (0, 0) box
+// stretched by the offsets of the corner elements
+INTERNAL_FUNC Layout_Box
+array_bounds(Layout_Box element, const Cell_Instance *instance, s32 step[4])
+{
+    s32 last_column_x = step[0] * (instance->columns - 1);
+    s32 last_column_y = step[1] * (instance->columns - 1);
+    s32 last_row_x    = step[2] * (instance->rows - 1);
+    s32 last_row_y    = step[3] * (instance->rows - 1);
+
+    s32 min_dx = MIN(0, last_column_x) + MIN(0, last_row_x);
+    s32 max_dx = MAX(0, last_column_x) + MAX(0, last_row_x);
+    s32 min_dy = MIN(0, last_column_y) + MIN(0, last_row_y);
+    s32 max_dy = MAX(0, last_column_y) + MAX(0, last_row_y);
+
+    return {element.min_x + min_dx,
+            element.min_y + min_dy,
+            element.max_x + max_dx,
+            element.max_y + max_dy};
+}
+
+INTERNAL_FUNC void
+finalize_cell(Layout *layout, Cell *cell)
+{
+    cell->bounds              = layout_box_empty();
+    cell->depth               = 1;
+    cell->flat_shape_count    = 0;
+    cell->flat_instance_count = 0;
+
+    for (u32 i = 0; i < cell->layer_count; ++i)
+    {
+        Cell_Layer *layer = &cell->layers[i];
+
+        cell->bounds = layout_box_union(cell->bounds, layer->bounds);
+        cell->flat_shape_count += layer->rect_count + layer->polygon_count;
+    }
+
+    for (u32 i = 0; i < cell->instance_count; ++i)
+    {
+        Cell_Instance *instance = &cell->instances[i];
+        Cell          *child    = &layout->cells[instance->cell];
+
+        u64 element_count = (u64)instance->columns * instance->rows;
+
+        cell->depth = MAX(cell->depth, child->depth + 1);
+        cell->flat_shape_count += element_count * child->flat_shape_count;
+        cell->flat_instance_count +=
+            element_count * (1 + child->flat_instance_count);
+
+        if (layout_box_is_empty(child->bounds))
+            continue;
+
+        s32 step[4] = {instance->column_step_x,
+                       instance->column_step_y,
+                       instance->row_step_x,
+                       instance->row_step_y};
+
+        Layout_Box element =
+            layout_transform_box(&instance->transform, child->bounds);
+
+        cell->bounds = layout_box_union(cell->bounds,
+                                        array_bounds(element, instance, step));
+    }
+}
+
+VOLTRUM_API b8
+layout_finalize(Layout *layout)
+{
+    u32 cell_count = (u32)layout->cells.size;
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    // 0 unvisited, 1 on the stack, 2 finalized
+    u8  *visit_state = push_array(scratch.arena, u8, cell_count);
+    u32 *stack_cell  = push_array(scratch.arena, u32, cell_count);
+    u32 *stack_next  = push_array(scratch.arena, u32, cell_count);
+
+    for (u32 i = 0; i < cell_count; ++i)
+        layout->cells[i].parent_count = 0;
+
+    for (u32 i = 0; i < cell_count; ++i)
+    {
+        Cell *cell = &layout->cells[i];
+
+        if (!cell->is_defined)
+        {
+            CORE_WARN("layout_finalize - Cell '%.*s' is referenced but never "
+                      "defined, it is left empty",
+                      (int)cell->name.size,
+                      cell->name.buff);
+        }
+
+        for (u32 j = 0; j < cell->instance_count; ++j)
+            layout->cells[cell->instances[j].cell].parent_count++;
+    }
+
+    // Iterative post-order walk, so children are finalized before parents
+    // however deep the hierarchy is
+    for (u32 root = 0; root < cell_count; ++root)
+    {
+        if (visit_state[root] != 0)
+            continue;
+
+        u32 stack_size    = 1;
+        stack_cell[0]     = root;
+        stack_next[0]     = 0;
+        visit_state[root] = 1;
+
+        while (stack_size > 0)
+        {
+            u32   top  = stack_size - 1;
+            Cell *cell = &layout->cells[stack_cell[top]];
+
+            if (stack_next[top] < cell->instance_count)
+            {
+                u32 child = cell->instances[stack_next[top]++].cell;
+
+                if (visit_state[child] == 1)
+                {
+                    CORE_ERROR("layout_finalize - Cell '%.*s' instantiates "
+                               "itself through its children",
+                               (int)layout->cells[child].name.size,
+                               layout->cells[child].name.buff);
+                    scratch_end(scratch);
+                    return false;
+                }
+
+                if (visit_state[child] == 0)
+                {
+                    visit_state[child]     = 1;
+                    stack_cell[stack_size] = child;
+                    stack_next[stack_size] = 0;
+                    stack_size++;
+                }
+
+                continue;
+            }
+
+            finalize_cell(layout, cell);
+
+            if (cell->depth > LAYOUT_MAX_HIERARCHY_DEPTH)
+            {
+                CORE_ERROR("layout_finalize - Cell '%.*s' nests %u levels, "
+                           "more than the supported %u",
+                           (int)cell->name.size,
+                           cell->name.buff,
+                           cell->depth,
+                           LAYOUT_MAX_HIERARCHY_DEPTH);
+                scratch_end(scratch);
+                return false;
+            }
+
+            visit_state[stack_cell[top]] = 2;
+            stack_size--;
+        }
+    }
+
+    scratch_end(scratch);
+
+    layout->top_cell = INVALID_ID;
+
+    for (u32 i = 0; i < cell_count; ++i)
+    {
+        Cell *cell = &layout->cells[i];
+        if (cell->parent_count > 0 || !cell->is_defined)
+            continue;
+
+        if (layout->top_cell == INVALID_ID ||
+            cell->flat_shape_count >
+                layout->cells[layout->top_cell].flat_shape_count)
+        {
+            layout->top_cell = i;
+        }
+    }
+
+    layout->is_finalized = true;
+
+    return true;
+}
+
+INTERNAL_FUNC s64
+floor_div(s64 a, s64 b)
+{
+    s64 quotient = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0)))
+        quotient--;
+
+    return quotient;
+}
+
+// Narrows [*first, *last] to the elements whose box, shifted by index * step,
+// overlaps [region_min, region_max] along one axis
+INTERNAL_FUNC void
+clip_element_range(s32  box_min,
+                   s32  box_max,
+                   s32  step,
+                   s32  region_min,
+                   s32  region_max,
+                   s64 *first,
+                   s64 *last)
+{
+    if (step == 0)
+    {
+        if (box_max < region_min || box_min > region_max)
+            *last = *first - 1;
+
+        return;
+    }
+
+    s64 low;
+    s64 high;
+
+    if (step > 0)
+    {
+        low  = -floor_div(-((s64)region_min - box_max), step);
+        high = floor_div((s64)region_max - box_min, step);
+    }
+    else
+    {
+        low  = -floor_div(-((s64)region_max - box_min), step);
+        high = floor_div((s64)region_min - box_max, step);
+    }
+
+    *first = MAX(*first, low);
+    *last  = MIN(*last, high);
+}
+
+// Prepares the element walk of the current instance of the frame. Returns
+// false when no element can overlap the region
+INTERNAL_FUNC b8
+enter_instance(Layout_Flattener *flattener, Layout_Flatten_Frame *frame)
+{
+    Layout    *layout = flattener->layout;
+    Cell      *cell   = &layout->cells[frame->cell];
+    Layout_Box region = flattener->region;
+
+    Cell_Instance *instance = &cell->instances[frame->instance_index];
+    Cell          *child    = &layout->cells[instance->cell];
+
+    if (layout_box_is_empty(child->bounds))
+        return false;
+
+    frame->element_transform =
+        layout_transform_combine(&frame->transform, &instance->transform);
+    frame->element_bounds =
+        layout_transform_box(&frame->element_transform, child->bounds);
+
+    transform_vector(&frame->transform,
+                     instance->column_step_x,
+                     instance->column_step_y,
+                     &frame->column_step_x,
+                     &frame->column_step_y);
+    transform_vector(&frame->transform,
+                     instance->row_step_x,
+                     instance->row_step_y,
+                     &frame->row_step_x,
+                     &frame->row_step_y);
+
+    s64 column_first = 0;
+    s64 column_last  = instance->columns - 1;
+    s64 row_first    = 0;
+    s64 row_last     = instance->rows - 1;
+
+    Layout_Box box = frame->element_bounds;
+
+    // Arrays whose steps follow the axes, which is nearly all of them, map
+    // each axis of the region to a range of columns or rows
+    if (frame->column_step_y == 0 && frame->row_step_x == 0)
+    {
+        clip_element_range(box.min_x, box.max_x, frame->column_step_x,
+            region.min_x, region.max_x, &column_first, &column_last);
+        clip_element_range(box.min_y, box.max_y, frame->row_step_y,
+            region.min_y, region.max_y, &row_first, &row_last);
+    }
+    else if (frame->column_step_x == 0 && frame->row_step_y == 0)
+    {
+        clip_element_range(box.min_y, box.max_y, frame->column_step_y,
+            region.min_y, region.max_y, &column_first, &column_last);
+        clip_element_range(box.min_x, box.max_x, frame->row_step_x,
+            region.min_x, region.max_x, &row_first, &row_last);
+    }
+
+    if (column_first > column_last || row_first > row_last)
+        return false;
+
+    frame->column_first = (u32)column_first;
+    frame->column_last  = (u32)column_last;
+    frame->row_last     = (u32)row_last;
+    frame->column       = (u32)column_first;
+    frame->row          = (u32)row_first;
+
+    return true;
+}
+
+VOLTRUM_API void
+layout_flatten_begin(Layout_Flattener *flattener,
+                     Layout           *layout,
+                     u32               root_cell,
+                     Layout_Box        region,
+                     u32               max_depth,
+                     s64               lod_extent)
+{
+    RUNTIME_ASSERT_MSG(layout->is_finalized,
+        "layout_flatten_begin - The layout must be finalized first");
+
+    flattener->layout       = layout;
+    flattener->region       = region;
+    flattener->max_depth    = MIN(max_depth, LAYOUT_MAX_HIERARCHY_DEPTH - 1);
+    flattener->lod_extent   = lod_extent;
+    flattener->stack_size   = 0;
+    flattener->root_pending = false;
+    flattener->root_coarse  = false;
+
+    Cell *root = &layout->cells[root_cell];
+    if (!layout_box_overlaps(root->bounds, region))
+        return;
+
+    Layout_Flatten_Frame *frame = &flattener->stack[0];
+    memory_zero(frame, sizeof(Layout_Flatten_Frame));
+
+    frame->cell      = root_cell;
+    frame->transform = layout_transform_identity();
+
+    if (lod_extent > 0 && layout_box_extent(root->bounds) <= lod_extent)
+    {
+        flattener->root_pending = true;
+        flattener->root_coarse  = true;
+        return;
+    }
+
+    flattener->stack_size   = 1;
+    flattener->root_pending = root->layer_count > 0;
+}
+
+VOLTRUM_API b8
+layout_flatten_next(Layout_Flattener *flattener,
+                    Layout_Placement *out_placement)
+{
+    Layout *layout = flattener->layout;
+
+    if (flattener->root_pending)
+    {
+        flattener->root_pending = false;
+
+        out_placement->cell      = flattener->stack[0].cell;
+        out_placement->depth     = 0;
+        out_placement->transform = flattener->stack[0].transform;
+        out_placement->is_coarse = flattener->root_coarse;
+
+        return true;
+    }
+
+    while (flattener->stack_size > 0)
+    {
+        u32                   depth = flattener->stack_size - 1;
+        Layout_Flatten_Frame *frame = &flattener->stack[depth];
+        Cell                 *cell  = &layout->cells[frame->cell];
+
+        if (!frame->in_instance)
+        {
+            if (frame->instance_index >= cell->instance_count ||
+                depth >= flattener->max_depth)
+            {
+                flattener->stack_size--;
+                continue;
+            }
+
+            frame->in_instance = enter_instance(flattener, frame);
+            if (!frame->in_instance)
+                frame->instance_index++;
+
+            continue;
+        }
+
+        if (frame->row > frame->row_last)
+        {
+            frame->in_instance = false;
+            frame->instance_index++;
+            continue;
+        }
+
+        u32 column = frame->column;
+        u32 row    = frame->row;
+
+        if (++frame->column > frame->column_last)
+        {
+            frame->column = frame->column_first;
+            frame->row++;
+        }
+
+        s32 dx = frame->column_step_x * (s32)column +
+                 frame->row_step_x * (s32)row;
+        s32 dy = frame->column_step_y * (s32)column +
+                 frame->row_step_y * (s32)row;
+
+        Layout_Box element = {frame->element_bounds.min_x + dx,
+                              frame->element_bounds.min_y + dy,
+                              frame->element_bounds.max_x + dx,
+                              frame->element_bounds.max_y + dy};
+
+        if (!layout_box_overlaps(element, flattener->region))
+            continue;
+
+        u32   child_index = cell->instances[frame->instance_index].cell;
+        Cell *child       = &layout->cells[child_index];
+
+        Layout_Transform transform = frame->element_transform;
+        transform.offset_x += dx;
+        transform.offset_y += dy;
+
+        if (flattener->lod_extent > 0 &&
+            layout_box_extent(element) <= flattener->lod_extent)
+        {
+            out_placement->cell      = child_index;
+            out_placement->depth     = depth + 1;
+            out_placement->transform = transform;
+            out_placement->is_coarse = true;
+
+            return true;
+        }
+
+        if (child->instance_count > 0)
+        {
+            Layout_Flatten_Frame *next = &flattener->stack[depth + 1];
+            memory_zero(next, sizeof(Layout_Flatten_Frame));
+
+            next->cell      = child_index;
+            next->transform = transform;
+
+            flattener->stack_size++;
+        }
+
+        if (child->layer_count > 0)
+        {
+            out_placement->cell      = child_index;
+            out_placement->depth     = depth + 1;
+            out_placement->transform = transform;
+            out_placement->is_coarse = false;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+VOLTRUM_API u64
+layout_flatten_rects(Layout                    *layout,
+                     u32                        root_cell,
+                     u16                        layer,
+                     u16                        datatype,
+                     Layout_Box                 region,
+                     Dynamic_Array<Layout_Box> *out_rects)
+{
+    u64 appended = 0;
+
+    Layout_Flattener flattener;
+    layout_flatten_begin(&flattener, layout, root_cell, region);
+
+    Layout_Placement placement;
+    while (layout_flatten_next(&flattener, &placement))
+    {
+        Cell *cell = &layout->cells[placement.cell];
+
+        for (u32 i = 0; i < cell->layer_count; ++i)
+        {
+            Cell_Layer *shapes = &cell->layers[i];
+            if (shapes->layer != layer || shapes->datatype != datatype)
+                continue;
+
+            for (u32 r = 0; r < shapes->rect_count; ++r)
+            {
+                Layout_Box local = {shapes->rect_min_x[r],
+                                    shapes->rect_min_y[r],
+                                    shapes->rect_max_x[r],
+                                    shapes->rect_max_y[r]};
+
+                Layout_Box rect =
+                    layout_transform_box(&placement.transform, local);
+
+                if (layout_box_overlaps(rect, region))
+                {
+                    out_rects->add(rect);
+                    appended++;
+                }
+            }
+        }
+    }
+
+    return appended;
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include "data_structures/dynamic_array.hpp"
+#include "data_structures/hashmap.hpp"
+#include "defines.hpp"
+#include "memory/arena.hpp"
+#include "resources/resource_types.hpp"
+#include "utils/string.hpp"
+
+// Cells nest deeper than this are rejected by layout_finalize, it also bounds
+// the stack of the flattener
+constexpr u32 LAYOUT_MAX_HIERARCHY_DEPTH = 64;
+
+constexpr u32 LAYOUT_DEFAULT_CELL_CAPACITY = 1024;
+
+constexpr u64 LAYOUT_ARENA_RESERVE = 16 * GiB;
+
+// Meters per database unit, GDSII files commonly use a nanometer
+constexpr f64 LAYOUT_DEFAULT_DATABASE_UNIT = 1e-9;
+
+// Coordinates are integer database units, like in GDSII
+struct Layout_Box
+{
+    s32 min_x;
+    s32 min_y;
+    s32 max_x;
+    s32 max_y;
+};
+
+// Quarter turns counter-clockwise in the low two bits. The mirror about the x
+// axis is applied before the rotation, which is the GDSII STRANS order
+enum class Layout_Orientation : u8
+{
+    R0         = 0,
+    R90        = 1,
+    R180       = 2,
+    R270       = 3,
+    MIRROR_X   = 4,
+    MX_R90     = 5,
+    MX_R180    = 6,
+    MX_R270    = 7,
+};
+
+constexpr u8 LAYOUT_ROTATION_MASK = 0x3;
+constexpr u8 LAYOUT_MIRROR_BIT    = 0x4;
+
+// p' = offset + magnification * orientation(p)
+struct Layout_Transform
+{
+    s32                offset_x;
+    s32                offset_y;
+    f32                magnification;
+    Layout_Orientation orientation;
+};
+
+// A single placement (SREF) or a columns x rows array of placements (AREF) of
+// another cell. Element (c, r) is placed at transform offset + c * column
+// step + r * row step, the steps are in the coordinates of the parent
+struct Cell_Instance
+{
+    u32              cell;
+    u16              columns;
+    u16              rows;
+    Layout_Transform transform;
+
+    s32 column_step_x;
+    s32 column_step_y;
+    s32 row_step_x;
+    s32 row_step_y;
+};
+
+// Shapes of one layer/datatype pair of a cell, stored as structure of arrays so
+// that culling and transforming only touch the coordinates they need
+struct Cell_Layer
+{
+    u16 layer;
+    u16 datatype;
+
+    Layout_Box bounds;
+
+    u32  rect_count;
+    s32 *rect_min_x;
+    s32 *rect_min_y;
+    s32 *rect_max_x;
+    s32 *rect_max_y;
+
+    // Polygon i uses the vertices [polygon_offsets[i], polygon_offsets[i + 1])
+    u32  polygon_count;
+    u32 *polygon_offsets;
+    s32 *vertex_x;
+    s32 *vertex_y;
+};
+
+// Definition of a cell, shared by all its instances. Memory scales with the
+// unique cells, a placement only costs its Cell_Instance in the parent
+struct Cell
+{
+    String name;
+    b8     is_defined; // False while only referenced by instances
+
+    Cell_Layer    *layers;
+    u32            layer_count;
+    Cell_Instance *instances;
+    u32            instance_count;
+
+    // Computed by layout_finalize
+    Layout_Box bounds; // Own shapes and all children
+    u32        depth;  // 1 for leaf cells
+    u32        parent_count;
+    u64        flat_shape_count;    // Shapes once fully flattened
+    u64        flat_instance_count; // Placements of descendants
+
+    // Render geometry of the layers, created by the renderer on demand
+    u16        geometry_count;
+    Geometry **geometry;
+};
+
+struct Layout
+{
+    Arena *arena;
+    f64    database_unit;
+
+    Dynamic_Array<Cell> cells;
+    Hashmap<u32>        cell_lookup; // Name to index in cells
+
+    u32 top_cell; // Root with the most flattened shapes, set by finalize
+    b8  is_finalized;
+};
+
+// Staging area for the shapes and instances of one cell. Builders only touch
+// their own arena, so several cells can be parsed in parallel and committed
+// afterwards
+struct Cell_Builder_Layer
+{
+    u16 layer;
+    u16 datatype;
+
+    Dynamic_Array<Layout_Box> rects;
+    Dynamic_Array<u32>        polygon_offsets;
+    Dynamic_Array<s32>        vertex_x;
+    Dynamic_Array<s32>        vertex_y;
+};
+
+struct Cell_Builder
+{
+    Arena *arena;
+    String name;
+
+    Dynamic_Array<Cell_Builder_Layer> layers;
+    u32                               last_layer; // Consecutive shapes usually
+                                                  // share their layer
+
+    // Instance cell fields are resolved from the names on commit
+    Dynamic_Array<Cell_Instance> instances;
+    Dynamic_Array<String>        instance_names;
+};
+
+// Depth-first walk over the placements of a cell hierarchy that intersect a
+// region. Nothing is expanded ahead of time, arrays are clipped to the
+// elements overlapping the region before being visited
+struct Layout_Placement
+{
+    u32              cell;
+    u32              depth; // 0 for the root
+    Layout_Transform transform;
+
+    // No larger than the LOD extent of the walk, the cells below it are not
+    // visited and the whole subtree is stood in for by this placement
+    b8 is_coarse;
+};
+
+struct Layout_Flatten_Frame
+{
+    u32              cell;
+    Layout_Transform transform; // Cell to root coordinates
+
+    u32 instance_index; // Instance being visited
+    b8  in_instance;
+
+    // Element (0, 0) of the instance and the steps between elements, in root
+    // coordinates
+    Layout_Transform element_transform;
+    Layout_Box       element_bounds;
+    s32              column_step_x;
+    s32              column_step_y;
+    s32              row_step_x;
+    s32              row_step_y;
+
+    // Elements that may overlap the region, and the next one to test
+    u32 column_first;
+    u32 column_last;
+    u32 row_last;
+    u32 column;
+    u32 row;
+};
+
+struct Layout_Flattener
+{
+    Layout    *layout;
+    Layout_Box region;
+    u32        max_depth;
+    s64        lod_extent;
+
+    Layout_Flatten_Frame stack[LAYOUT_MAX_HIERARCHY_DEPTH];
+    u32                  stack_size;
+    b8                   root_pending;
+    b8                   root_coarse;
+};
+
+FORCE_INLINE Layout_Box
+layout_box_empty()
+{
+    return {0x7FFFFFFF, 0x7FFFFFFF, -0x7FFFFFFF - 1, -0x7FFFFFFF - 1};
+}
+
+FORCE_INLINE b8
+layout_box_is_empty(Layout_Box box)
+{
+    return box.min_x > box.max_x || box.min_y > box.max_y;
+}
+
+FORCE_INLINE b8
+layout_box_overlaps(Layout_Box a, Layout_Box b)
+{
+    return a.min_x <= b.max_x && b.min_x <= a.max_x && a.min_y <= b.max_y &&
+           b.min_y <= a.max_y;
+}
+
+FORCE_INLINE Layout_Box
+layout_box_union(Layout_Box a, Layout_Box b)
+{
+    return {MIN(a.min_x, b.min_x),
+            MIN(a.min_y, b.min_y),
+            MAX(a.max_x, b.max_x),
+            MAX(a.max_y, b.max_y)};
+}
+
+// Largest side of the box
+FORCE_INLINE s64
+layout_box_extent(Layout_Box box)
+{
+    return MAX((s64)box.max_x - box.min_x, (s64)box.max_y - box.min_y);
+}
+
+FORCE_INLINE Layout_Transform
+layout_transform_identity()
+{
+    return {0, 0, 1.0f, Layout_Orientation::R0};
+}
+
+VOLTRUM_API void layout_transform_point(const Layout_Transform *transform,
+                                        s32                     x,
+                                        s32                     y,
+                                        s32                    *out_x,
+                                        s32                    *out_y);
+
+// Exact for every orientation since all of them are Manhattan
+VOLTRUM_API Layout_Box layout_transform_box(const Layout_Transform *transform,
+                                            Layout_Box              box);
+
+// Transform applying child first, then parent
+VOLTRUM_API Layout_Transform
+layout_transform_combine(const Layout_Transform *parent,
+                         const Layout_Transform *child);
+
+// The layout owns an arena that holds every committed cell
+VOLTRUM_API Layout *layout_create(
+    f64 database_unit = LAYOUT_DEFAULT_DATABASE_UNIT);
+VOLTRUM_API void layout_destroy(Layout *layout);
+
+// Bytes used by the cell database
+VOLTRUM_API u64 layout_memory_usage(Layout *layout);
+
+VOLTRUM_API u32 layout_find_cell(Layout *layout, String name);
+
+// Returns the cell with this name, adding an undefined one if needed so that
+// instances can refer to cells defined later in a file
+VOLTRUM_API u32 layout_declare_cell(Layout *layout, String name);
+
+VOLTRUM_API void cell_builder_init(Cell_Builder *builder);
+VOLTRUM_API void cell_builder_shutdown(Cell_Builder *builder);
+
+// Clears the staging arena, the builder can then hold the next cell
+VOLTRUM_API void cell_builder_begin(Cell_Builder *builder, String name);
+
+VOLTRUM_API void cell_builder_add_rect(Cell_Builder *builder,
+                                       u16           layer,
+                                       u16           datatype,
+                                       Layout_Box    rect);
+
+// Axis aligned rectangles are stored as rects. A closing vertex repeating the
+// first one is dropped
+VOLTRUM_API void cell_builder_add_polygon(Cell_Builder *builder,
+                                          u16           layer,
+                                          u16           datatype,
+                                          const s32    *xs,
+                                          const s32    *ys,
+                                          u32           vertex_count);
+
+VOLTRUM_API void cell_builder_add_instance(Cell_Builder        *builder,
+                                           String               cell_name,
+                                           const Cell_Instance *instance);
+
+// Copies the staged geometry into the layout arena. Needs no lock, the arena of
+// a layout takes concurrent pushes, so the readers copy outside of the commit
+VOLTRUM_API Cell_Layer *layout_copy_cell_layers(Layout       *layout,
+                                                Cell_Builder *builder);
+
+// Packs the staged cell into the layout arena, with the layers copied by
+// layout_copy_cell_layers when given. Returns the cell index, or INVALID_ID
+// when a cell with this name was already defined
+VOLTRUM_API u32 layout_commit_cell(Layout       *layout,
+                                   Cell_Builder *builder,
+                                   Cell_Layer   *layers = nullptr);
+
+// Computes bounds, depths and flattened counts bottom-up and picks the top
+// cell. Fails on recursive or too deep hierarchies
+VOLTRUM_API b8 layout_finalize(Layout *layout);
+
+// Placements deeper than max_depth below the root are not visited. With a
+// lod_extent, placements whose bounds are no wider or taller than it are
+// emitted as coarse and their subtree is skipped
+VOLTRUM_API void
+layout_flatten_begin(Layout_Flattener *flattener,
+                     Layout           *layout,
+                     u32               root_cell,
+                     Layout_Box        region,
+                     u32               max_depth  = LAYOUT_MAX_HIERARCHY_DEPTH,
+                     s64               lod_extent = 0);
+
+// Emits the next cell placement overlapping the region, the root included.
+// Returns false when the walk is over
+VOLTRUM_API b8 layout_flatten_next(Layout_Flattener *flattener,
+                                   Layout_Placement *out_placement);
+
+// Appends the rects of a layer found under root_cell that overlap the region,
+// in root coordinates. Returns the number of rects appended
+VOLTRUM_API u64 layout_flatten_rects(Layout                    *layout,
+                                     u32                        root_cell,
+                                     u16                        layer,
+                                     u16                        datatype,
+                                     Layout_Box                 region,
+                                     Dynamic_Array<Layout_Box> *out_rects);
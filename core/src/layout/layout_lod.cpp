@@ -0,0 +1,686 @@
+#include "layout/layout_lod.hpp"
+
+#include "core/absolute_clock.hpp"
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "memory/memory.hpp"
+
+constexpr u64 LAYOUT_LOD_ARENA_COMMIT_SIZE   = 1 * MiB;
+constexpr u64 LAYOUT_LOD_BUILD_ARENA_RESERVE = 4 * GiB;
+constexpr u64 LAYOUT_LOD_DEFAULT_KEY_COUNT   = 64;
+constexpr u64 LAYOUT_LOD_DEFAULT_RECT_COUNT  = 4096;
+
+// Grid of square pixels laid over the bounds of the cell being built, the
+// resolution is along the longer side. Pixel (x, y) covers
+// [min_x + x * pixel_size, min_x + (x + 1) * pixel_size) and the same along y,
+// the last column and row reach the bounds
+struct LOD_Raster
+{
+    Layout_Box bounds;
+    s64        pixel_size;
+    u32        columns;
+    u32        rows;
+    u8        *pixels;
+};
+
+// Horizontal run of set pixels, and the rect it extends
+struct LOD_Run
+{
+    u32 first;
+    u32 last;
+    u64 rect;
+};
+
+INTERNAL_FUNC u32
+layer_key(u16 layer, u16 datatype)
+{
+    return ((u32)layer << 16) | datatype;
+}
+
+INTERNAL_FUNC Cell_Layer *
+find_cell_layer(Cell *cell, u32 key)
+{
+    for (u32 i = 0; i < cell->layer_count; ++i)
+    {
+        if (layer_key(cell->layers[i].layer, cell->layers[i].datatype) == key)
+            return &cell->layers[i];
+    }
+
+    return nullptr;
+}
+
+INTERNAL_FUNC Cell_LOD_Layer *
+find_lod_layer(Cell_LOD *cell_lod, u32 key)
+{
+    u32 low  = 0;
+    u32 high = cell_lod->layer_count;
+
+    while (low < high)
+    {
+        u32 middle = (low + high) / 2;
+        u32 middle_key =
+            layer_key(cell_lod->layers[middle].layer,
+                      cell_lod->layers[middle].datatype);
+
+        if (middle_key == key)
+            return &cell_lod->layers[middle];
+
+        if (middle_key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return nullptr;
+}
+
+INTERNAL_FUNC Layout_Transform
+element_transform(const Cell_Instance *instance, u32 column, u32 row)
+{
+    Layout_Transform transform = instance->transform;
+    transform.offset_x += instance->column_step_x * (s32)column +
+                          instance->row_step_x * (s32)row;
+    transform.offset_y += instance->column_step_y * (s32)column +
+                          instance->row_step_y * (s32)row;
+
+    return transform;
+}
+
+// Steps are linear, so the corner elements bound the whole array
+INTERNAL_FUNC Layout_Box
+array_bounds(const Cell_Instance *instance, Layout_Box box)
+{
+    u32 last_column = instance->columns - 1;
+    u32 last_row    = instance->rows - 1;
+
+    Layout_Transform corners[] = {
+        element_transform(instance, 0, 0),
+        element_transform(instance, last_column, 0),
+        element_transform(instance, 0, last_row),
+        element_transform(instance, last_column, last_row),
+    };
+
+    Layout_Box bounds = layout_box_empty();
+    for (u32 i = 0; i < ARRAY_COUNT(corners); ++i)
+        bounds = layout_box_union(bounds,
+                                  layout_transform_box(&corners[i], box));
+
+    return bounds;
+}
+
+INTERNAL_FUNC Layout_Box
+polygon_bounds(Cell_Layer *shapes, u32 polygon)
+{
+    Layout_Box bounds = layout_box_empty();
+
+    for (u32 v = shapes->polygon_offsets[polygon];
+         v < shapes->polygon_offsets[polygon + 1];
+         ++v)
+    {
+        bounds.min_x = MIN(bounds.min_x, shapes->vertex_x[v]);
+        bounds.min_y = MIN(bounds.min_y, shapes->vertex_y[v]);
+        bounds.max_x = MAX(bounds.max_x, shapes->vertex_x[v]);
+        bounds.max_y = MAX(bounds.max_y, shapes->vertex_y[v]);
+    }
+
+    return bounds;
+}
+
+INTERNAL_FUNC void
+raster_begin(LOD_Raster *raster, Layout_Box bounds, u32 resolution)
+{
+    s64 width  = (s64)bounds.max_x - bounds.min_x;
+    s64 height = (s64)bounds.max_y - bounds.min_y;
+
+    raster->bounds     = bounds;
+    raster->pixel_size = MAX(width, height) / resolution + 1;
+    raster->columns    = (u32)(width / raster->pixel_size) + 1;
+    raster->rows       = (u32)(height / raster->pixel_size) + 1;
+
+    memory_zero(raster->pixels, (u64)raster->columns * raster->rows);
+}
+
+// Sets every pixel the box touches, so the coverage is never smaller than the
+// shapes
+INTERNAL_FUNC void
+raster_mark(LOD_Raster *raster, Layout_Box box)
+{
+    s64 min_x = MAX(box.min_x, raster->bounds.min_x);
+    s64 min_y = MAX(box.min_y, raster->bounds.min_y);
+    s64 max_x = MIN(box.max_x, raster->bounds.max_x);
+    s64 max_y = MIN(box.max_y, raster->bounds.max_y);
+
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    s64 size = raster->pixel_size;
+    u32 x0   = (u32)((min_x - raster->bounds.min_x) / size);
+    u32 y0   = (u32)((min_y - raster->bounds.min_y) / size);
+    u32 x1   = (u32)((max_x - raster->bounds.min_x) / size);
+    u32 y1   = (u32)((max_y - raster->bounds.min_y) / size);
+
+    for (u32 y = y0; y <= y1; ++y)
+    {
+        memory_set(
+            raster->pixels + (u64)y * raster->columns + x0, 1, x1 - x0 + 1);
+    }
+}
+
+// Merges the set pixels into rects, runs of a row extend the rect of an
+// identical run on the row below. Appends rects in cell coordinates
+INTERNAL_FUNC u32
+raster_merge(LOD_Raster                *raster,
+             LOD_Run                   *previous_runs,
+             LOD_Run                   *current_runs,
+             Dynamic_Array<Layout_Box> *out_rects)
+{
+    u64 first_rect     = out_rects->size;
+    u32 previous_count = 0;
+    u32 columns        = raster->columns;
+    s64 size           = raster->pixel_size;
+
+    for (u32 y = 0; y < raster->rows; ++y)
+    {
+        const u8 *row = raster->pixels + (u64)y * columns;
+
+        s64 row_top = raster->bounds.min_y + (y + 1) * size;
+        s32 top     = (s32)MIN(row_top, (s64)raster->bounds.max_y);
+
+        u32 current_count = 0;
+        u32 previous      = 0;
+
+        for (u32 x = 0; x < columns;)
+        {
+            if (!row[x])
+            {
+                x++;
+                continue;
+            }
+
+            u32 first = x;
+            while (x < columns && row[x])
+                x++;
+            u32 last = x - 1;
+
+            while (previous < previous_count &&
+                   previous_runs[previous].first < first)
+                previous++;
+
+            LOD_Run *run = &current_runs[current_count++];
+            run->first   = first;
+            run->last    = last;
+
+            if (previous < previous_count &&
+                previous_runs[previous].first == first &&
+                previous_runs[previous].last == last)
+            {
+                run->rect                     = previous_runs[previous].rect;
+                (*out_rects)[run->rect].max_y = top;
+                continue;
+            }
+
+            s64 min_x = raster->bounds.min_x + first * size;
+            s64 max_x = raster->bounds.min_x + (last + 1) * size;
+
+            run->rect = out_rects->size;
+            out_rects->add({(s32)min_x,
+                            (s32)(raster->bounds.min_y + y * size),
+                            (s32)MIN(max_x, (s64)raster->bounds.max_x),
+                            top});
+        }
+
+        LOD_Run *swap  = previous_runs;
+        previous_runs  = current_runs;
+        current_runs   = swap;
+        previous_count = current_count;
+    }
+
+    return (u32)(out_rects->size - first_rect);
+}
+
+INTERNAL_FUNC void
+rasterize_layer(Layout_LOD *lod, Cell *cell, u32 key, LOD_Raster *raster)
+{
+    Cell_Layer *shapes = find_cell_layer(cell, key);
+    if (shapes)
+    {
+        for (u32 r = 0; r < shapes->rect_count; ++r)
+        {
+            raster_mark(raster,
+                        {shapes->rect_min_x[r],
+                         shapes->rect_min_y[r],
+                         shapes->rect_max_x[r],
+                         shapes->rect_max_y[r]});
+        }
+
+        for (u32 p = 0; p < shapes->polygon_count; ++p)
+            raster_mark(raster, polygon_bounds(shapes, p));
+    }
+
+    u64 pixel_count = (u64)raster->columns * raster->rows;
+
+    for (u32 i = 0; i < cell->instance_count; ++i)
+    {
+        Cell_Instance  *instance  = &cell->instances[i];
+        Cell           *child     = &lod->layout->cells[instance->cell];
+        Cell_LOD       *child_lod = &lod->cells[instance->cell];
+        Cell_LOD_Layer *coverage  = find_lod_layer(child_lod, key);
+
+        if (!coverage)
+            continue;
+
+        // Arrays denser than the raster would mark most of their pixels anyway
+        if ((u64)instance->columns * instance->rows > pixel_count)
+        {
+            raster_mark(raster, array_bounds(instance, coverage->bounds));
+            continue;
+        }
+
+        for (u32 row = 0; row < instance->rows; ++row)
+        {
+            for (u32 column = 0; column < instance->columns; ++column)
+            {
+                Layout_Transform transform =
+                    element_transform(instance, column, row);
+
+                Layout_Box element =
+                    layout_transform_box(&transform, child->bounds);
+
+                f64 span =
+                    (f64)layout_box_extent(element) / raster->pixel_size;
+
+                if (span <= 1.0)
+                {
+                    raster_mark(raster,
+                                layout_transform_box(&transform,
+                                                     coverage->bounds));
+                    continue;
+                }
+
+                // Children with few shapes stop at a coarser level, which is
+                // blockier but still covers them
+                u32 level = MIN(layout_lod_select_level(span),
+                                child_lod->level_count - 1);
+
+                Layout_LOD_Level *rects = &coverage->levels[level];
+
+                for (u32 r = 0; r < rects->rect_count; ++r)
+                {
+                    Layout_Box rect =
+                        child_lod->rects[rects->rect_offset + r];
+
+                    raster_mark(raster, layout_transform_box(&transform, rect));
+                }
+            }
+        }
+    }
+}
+
+INTERNAL_FUNC void
+build_cell(Layout_LOD *lod,
+           u32         cell_index,
+           Arena      *build_arena,
+           LOD_Raster *raster,
+           LOD_Run    *runs)
+{
+    Cell     *cell     = &lod->layout->cells[cell_index];
+    Cell_LOD *cell_lod = &lod->cells[cell_index];
+
+    if (!cell->is_defined || layout_box_is_empty(cell->bounds))
+        return;
+
+    u64 position = arena_position(build_arena);
+
+    // Layers of the cell and of everything below it, sorted
+    Dynamic_Array<u32> keys;
+    keys.init(build_arena, LAYOUT_LOD_DEFAULT_KEY_COUNT);
+
+    auto add_key = [&keys](u32 key) {
+        u64 slot = 0;
+        while (slot < keys.size && keys[slot] < key)
+            slot++;
+
+        if (slot == keys.size || keys[slot] != key)
+            keys.insert_at(slot, key);
+    };
+
+    for (u32 i = 0; i < cell->layer_count; ++i)
+        add_key(layer_key(cell->layers[i].layer, cell->layers[i].datatype));
+
+    for (u32 i = 0; i < cell->instance_count; ++i)
+    {
+        Cell_LOD *child_lod = &lod->cells[cell->instances[i].cell];
+
+        for (u32 l = 0; l < child_lod->layer_count; ++l)
+        {
+            add_key(layer_key(child_lod->layers[l].layer,
+                              child_lod->layers[l].datatype));
+        }
+    }
+
+    // A level is only worth it while the flattened shapes outnumber the
+    // pixels of the level before it
+    cell_lod->level_count = 1;
+    while (cell_lod->level_count < LAYOUT_LOD_LEVEL_COUNT)
+    {
+        u32 previous = layout_lod_level_resolution(cell_lod->level_count - 1);
+        raster_begin(raster, cell->bounds, previous);
+
+        if (cell->flat_shape_count <= (u64)raster->columns * raster->rows)
+            break;
+
+        cell_lod->level_count++;
+    }
+
+    cell_lod->layer_count = (u32)keys.size;
+    cell_lod->layers =
+        push_array(lod->arena, Cell_LOD_Layer, cell_lod->layer_count);
+
+    Dynamic_Array<Layout_Box> rects;
+    rects.init(build_arena, LAYOUT_LOD_DEFAULT_RECT_COUNT);
+
+    for (u32 k = 0; k < cell_lod->layer_count; ++k)
+    {
+        Cell_LOD_Layer *coverage = &cell_lod->layers[k];
+        coverage->layer          = (u16)(keys[k] >> 16);
+        coverage->datatype       = (u16)(keys[k] & 0xFFFF);
+        coverage->bounds         = layout_box_empty();
+
+        Cell_Layer *shapes = find_cell_layer(cell, keys[k]);
+        if (shapes)
+            coverage->bounds = shapes->bounds;
+
+        for (u32 i = 0; i < cell->instance_count; ++i)
+        {
+            Cell_Instance  *instance = &cell->instances[i];
+            Cell_LOD_Layer *child    =
+                find_lod_layer(&lod->cells[instance->cell], keys[k]);
+
+            if (child)
+            {
+                coverage->bounds = layout_box_union(
+                    coverage->bounds, array_bounds(instance, child->bounds));
+            }
+        }
+    }
+
+    for (u32 level = 0; level < cell_lod->level_count; ++level)
+    {
+        u64 level_offset = rects.size;
+
+        for (u32 k = 0; k < cell_lod->layer_count; ++k)
+        {
+            raster_begin(
+                raster, cell->bounds, layout_lod_level_resolution(level));
+            rasterize_layer(lod, cell, keys[k], raster);
+
+            Layout_LOD_Level *range = &cell_lod->layers[k].levels[level];
+            range->rect_offset      = (u32)rects.size;
+            range->rect_count       = raster_merge(
+                raster, runs, runs + LAYOUT_LOD_MAX_RESOLUTION, &rects);
+        }
+
+        // Merged rects can outnumber the shapes of small cells, which are
+        // then cheaper to draw as they are
+        if (level > 0 && rects.size - level_offset >= cell->flat_shape_count)
+        {
+            rects.size            = level_offset;
+            cell_lod->level_count = level;
+        }
+    }
+
+    cell_lod->rects = push_array(lod->arena, Layout_Box, rects.size);
+    for (u64 i = 0; i < rects.size; ++i)
+        cell_lod->rects[i] = rects[i];
+
+    lod->rect_count += rects.size;
+
+    arena_pop_to(build_arena, position);
+}
+
+VOLTRUM_API Layout_LOD *
+layout_lod_build(Layout *layout)
+{
+    RUNTIME_ASSERT_MSG(layout->is_finalized,
+        "layout_lod_build - The layout must be finalized first");
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    Arena *arena =
+        arena_create(LAYOUT_LOD_ARENA_RESERVE, LAYOUT_LOD_ARENA_COMMIT_SIZE);
+
+    auto *lod       = push_struct(arena, Layout_LOD);
+    lod->arena      = arena;
+    lod->layout     = layout;
+    lod->cell_count = (u32)layout->cells.size;
+    lod->cells      = push_array(arena, Cell_LOD, lod->cell_count);
+
+    Arena *build_arena = arena_create(LAYOUT_LOD_BUILD_ARENA_RESERVE,
+                                      LAYOUT_LOD_ARENA_COMMIT_SIZE);
+
+    // Children before parents, a counting sort on the depths of the cells
+    u32 depth_offsets[LAYOUT_MAX_HIERARCHY_DEPTH + 2] = {};
+    for (u32 i = 0; i < lod->cell_count; ++i)
+        depth_offsets[layout->cells[i].depth + 1]++;
+    for (u32 d = 1; d < ARRAY_COUNT(depth_offsets); ++d)
+        depth_offsets[d] += depth_offsets[d - 1];
+
+    u32 *order = push_array(build_arena, u32, lod->cell_count);
+    for (u32 i = 0; i < lod->cell_count; ++i)
+        order[depth_offsets[layout->cells[i].depth]++] = i;
+
+    LOD_Raster raster;
+    raster.pixels = push_array(build_arena,
+                               u8,
+                               (u64)LAYOUT_LOD_MAX_RESOLUTION *
+                                   LAYOUT_LOD_MAX_RESOLUTION);
+
+    // Two rows of runs, a row holds at most one run every other pixel
+    LOD_Run *runs =
+        push_array(build_arena, LOD_Run, 2 * LAYOUT_LOD_MAX_RESOLUTION);
+
+    for (u32 i = 0; i < lod->cell_count; ++i)
+        build_cell(lod, order[i], build_arena, &raster, runs);
+
+    arena_release(build_arena);
+
+    absolute_clock_update(&clock);
+    lod->build_time = clock.elapsed_time;
+
+    CORE_DEBUG("layout_lod_build - %u cells, %llu rects, %.1f KiB in %.3f ms",
+               lod->cell_count,
+               lod->rect_count,
+               layout_lod_memory_usage(lod) / 1024.0,
+               lod->build_time * 1000.0);
+
+    return lod;
+}
+
+VOLTRUM_API void
+layout_lod_destroy(Layout_LOD *lod)
+{
+    ENSURE(lod);
+
+    // The struct lives in its own arena
+    arena_release(lod->arena);
+}
+
+VOLTRUM_API u64
+layout_lod_memory_usage(Layout_LOD *lod)
+{
+    return arena_position(lod->arena);
+}
+
+INTERNAL_FUNC u64
+emit_rect(Layout_Box                      box,
+          u16                             layer,
+          u16                             datatype,
+          Layout_Box                      region,
+          Dynamic_Array<Layout_LOD_Rect> *out_rects)
+{
+    if (!layout_box_overlaps(box, region))
+        return 0;
+
+    out_rects->add({box, layer, datatype});
+    return 1;
+}
+
+INTERNAL_FUNC u64
+emit_shapes(Cell                           *cell,
+            const Layout_Transform         *transform,
+            Layout_Box                      region,
+            Dynamic_Array<Layout_LOD_Rect> *out_rects)
+{
+    u64 appended = 0;
+
+    for (u32 i = 0; i < cell->layer_count; ++i)
+    {
+        Cell_Layer *shapes = &cell->layers[i];
+
+        for (u32 r = 0; r < shapes->rect_count; ++r)
+        {
+            Layout_Box local = {shapes->rect_min_x[r],
+                                shapes->rect_min_y[r],
+                                shapes->rect_max_x[r],
+                                shapes->rect_max_y[r]};
+
+            appended += emit_rect(layout_transform_box(transform, local),
+                                  shapes->layer,
+                                  shapes->datatype,
+                                  region,
+                                  out_rects);
+        }
+
+        for (u32 p = 0; p < shapes->polygon_count; ++p)
+        {
+            appended += emit_rect(
+                layout_transform_box(transform, polygon_bounds(shapes, p)),
+                shapes->layer,
+                shapes->datatype,
+                region,
+                out_rects);
+        }
+    }
+
+    return appended;
+}
+
+VOLTRUM_API u64
+layout_lod_collect(Layout_LOD                     *lod,
+                   u32                             root_cell,
+                   Layout_Box                      region,
+                   f64                             units_per_pixel,
+                   Dynamic_Array<Layout_LOD_Rect> *out_rects,
+                   Layout_LOD_Stats               *out_stats)
+{
+    Layout *layout = lod->layout;
+
+    RUNTIME_ASSERT_MSG(lod->cell_count == layout->cells.size,
+        "layout_lod_collect - Cells were added after the LOD was built");
+
+    Layout_LOD_Stats stats = {};
+    u64              start = out_rects->size;
+
+    s64 lod_extent = units_per_pixel > 0.0
+                         ? (s64)(LAYOUT_LOD_MAX_RESOLUTION * units_per_pixel)
+                         : 0;
+
+    Layout_Flattener flattener;
+    layout_flatten_begin(&flattener,
+                         layout,
+                         root_cell,
+                         region,
+                         LAYOUT_MAX_HIERARCHY_DEPTH,
+                         lod_extent);
+
+    Layout_Placement placement;
+    while (layout_flatten_next(&flattener, &placement))
+    {
+        Cell *cell = &layout->cells[placement.cell];
+
+        if (!placement.is_coarse)
+        {
+            emit_shapes(cell, &placement.transform, region, out_rects);
+            stats.detailed_placements++;
+            continue;
+        }
+
+        Cell_LOD  *cell_lod = &lod->cells[placement.cell];
+        Layout_Box element =
+            layout_transform_box(&placement.transform, cell->bounds);
+
+        f64 extent_in_pixels = layout_box_extent(element) / units_per_pixel;
+        u32 level            = layout_lod_select_level(extent_in_pixels);
+
+        if (extent_in_pixels <= 1.0)
+        {
+            for (u32 l = 0; l < cell_lod->layer_count; ++l)
+            {
+                Cell_LOD_Layer *coverage = &cell_lod->layers[l];
+
+                Layout_Box bounds = layout_transform_box(&placement.transform,
+                                                         coverage->bounds);
+
+                emit_rect(bounds,
+                          coverage->layer,
+                          coverage->datatype,
+                          region,
+                          out_rects);
+            }
+
+            stats.bounds_placements++;
+        }
+        else if (level < cell_lod->level_count)
+        {
+            for (u32 l = 0; l < cell_lod->layer_count; ++l)
+            {
+                Cell_LOD_Layer   *coverage = &cell_lod->layers[l];
+                Layout_LOD_Level *rects    = &coverage->levels[level];
+
+                for (u32 r = 0; r < rects->rect_count; ++r)
+                {
+                    Layout_Box rect = cell_lod->rects[rects->rect_offset + r];
+
+                    emit_rect(layout_transform_box(&placement.transform, rect),
+                              coverage->layer,
+                              coverage->datatype,
+                              region,
+                              out_rects);
+                }
+            }
+
+            stats.level_placements[level]++;
+        }
+        else
+        {
+            // The level was not built since the subtree has fewer shapes than
+            // its pixels, drawing them is as cheap
+            Layout_Flattener subtree;
+            layout_flatten_begin(
+                &subtree, layout, placement.cell, cell->bounds);
+
+            Layout_Placement inner;
+            while (layout_flatten_next(&subtree, &inner))
+            {
+                Layout_Transform transform =
+                    layout_transform_combine(&placement.transform,
+                                             &inner.transform);
+
+                emit_shapes(&layout->cells[inner.cell],
+                            &transform,
+                            region,
+                            out_rects);
+                stats.detailed_placements++;
+            }
+        }
+    }
+
+    u64 appended     = out_rects->size - start;
+    stats.rect_count = appended;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return appended;
+}
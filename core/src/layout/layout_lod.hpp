@@ -0,0 +1,115 @@
+#pragma once
+
+#include "data_structures/dynamic_array.hpp"
+#include "defines.hpp"
+#include "layout/layout.hpp"
+#include "memory/arena.hpp"
+
+// Coverage rasters of levels 0..3 have 4, 16, 64 and 256 square pixels along
+// the longer side of the bounds of a cell
+constexpr u32 LAYOUT_LOD_LEVEL_COUNT      = 4;
+constexpr u32 LAYOUT_LOD_BASE_RESOLUTION  = 4;
+constexpr u32 LAYOUT_LOD_RESOLUTION_SHIFT = 2; // Per level
+constexpr u32 LAYOUT_LOD_MAX_RESOLUTION   = LAYOUT_LOD_BASE_RESOLUTION
+                                          << (LAYOUT_LOD_RESOLUTION_SHIFT *
+                                              (LAYOUT_LOD_LEVEL_COUNT - 1));
+
+constexpr u64 LAYOUT_LOD_ARENA_RESERVE = 16 * GiB;
+
+struct Layout_LOD_Level
+{
+    u32 rect_offset; // Into the rects of the cell
+    u32 rect_count;
+};
+
+// Coverage of one layer/datatype pair by a cell and everything below it. The
+// raster of each level is merged into rects, in cell coordinates
+struct Cell_LOD_Layer
+{
+    u16 layer;
+    u16 datatype;
+
+    Layout_Box       bounds;
+    Layout_LOD_Level levels[LAYOUT_LOD_LEVEL_COUNT];
+};
+
+struct Cell_LOD
+{
+    Cell_LOD_Layer *layers; // Sorted by layer, then datatype
+    u32             layer_count;
+
+    // Levels past this one are not built, the flattened shapes of the cell are
+    // fewer than the pixels of the last level so they are drawn instead
+    u32 level_count;
+
+    Layout_Box *rects;
+};
+
+// Precomputed coverage of every cell, so that a cell seen at a few pixels is
+// drawn from a raster sized to it instead of from its flattened shapes
+struct Layout_LOD
+{
+    Arena  *arena;
+    Layout *layout;
+
+    Cell_LOD *cells; // Parallel to layout->cells
+    u32       cell_count;
+
+    u64 rect_count;
+    f64 build_time;
+};
+
+// A rect to draw, in root coordinates
+struct Layout_LOD_Rect
+{
+    Layout_Box box;
+    u16        layer;
+    u16        datatype;
+};
+
+struct Layout_LOD_Stats
+{
+    u64 level_placements[LAYOUT_LOD_LEVEL_COUNT];
+    u64 bounds_placements;   // At most a pixel, drawn as their layer bounds
+    u64 detailed_placements; // Drawn from their own shapes
+    u64 rect_count;
+};
+
+FORCE_INLINE u32
+layout_lod_level_resolution(u32 level)
+{
+    return LAYOUT_LOD_BASE_RESOLUTION << (LAYOUT_LOD_RESOLUTION_SHIFT * level);
+}
+
+// Coarsest level whose raster has at least as many pixels across as the cell
+// covers on screen, INVALID_ID when none is fine enough
+FORCE_INLINE u32
+layout_lod_select_level(f64 extent_in_pixels)
+{
+    for (u32 level = 0; level < LAYOUT_LOD_LEVEL_COUNT; ++level)
+    {
+        if ((f64)layout_lod_level_resolution(level) >= extent_in_pixels)
+            return level;
+    }
+
+    return INVALID_ID;
+}
+
+// Builds the levels of every cell bottom-up, the layout must be finalized
+VOLTRUM_API Layout_LOD *layout_lod_build(Layout *layout);
+VOLTRUM_API void        layout_lod_destroy(Layout_LOD *lod);
+
+VOLTRUM_API u64 layout_lod_memory_usage(Layout_LOD *lod);
+
+// Appends the rects to draw for the region seen at units_per_pixel database
+// units per pixel. Placements of at most LAYOUT_LOD_MAX_RESOLUTION pixels are
+// drawn from their level, larger ones from their own shapes, so the count
+// stays bounded by the pixels of the viewport rather than by the layout.
+// Polygons are drawn as their bounds. Returns the number of rects appended
+VOLTRUM_API u64
+layout_lod_collect(Layout_LOD                     *lod,
+                   u32                             root_cell,
+                   Layout_Box                      region,
+                   f64                             units_per_pixel,
+                   Dynamic_Array<Layout_LOD_Rect> *out_rects,
+                   Layout_LOD_Stats               *out_stats);
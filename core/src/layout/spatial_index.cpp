@@ -0,0 +1,659 @@
+#include "layout/spatial_index.hpp"
+
+#include "core/asserts.hpp"
+
+constexpr u64 SPATIAL_INDEX_ARENA_COMMIT_SIZE = 4 * MiB;
+constexpr u64 SPATIAL_INDEX_SORT_COMMIT_SIZE  = 64 * MiB;
+constexpr u32 SPATIAL_INDEX_STACK_SIZE =
+    SPATIAL_INDEX_MAX_HEIGHT * SPATIAL_INDEX_NODE_CAPACITY;
+
+// The Hilbert grid has 2^16 cells per side, a value fits in 32 bits
+constexpr u32 HILBERT_ORDER    = 16;
+constexpr f64 HILBERT_MAX_CELL = 65535.0;
+
+INTERNAL_FUNC u32
+hilbert_from_cell(u32 x, u32 y)
+{
+    u32 d = 0;
+
+    for (u32 s = 1u << (HILBERT_ORDER - 1); s > 0; s >>= 1)
+    {
+        u32 rx = (x & s) ? 1 : 0;
+        u32 ry = (y & s) ? 1 : 0;
+
+        d += s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so that the lower bits follow the curve
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = ~x;
+                y = ~y;
+            }
+
+            u32 t = x;
+            x     = y;
+            y     = t;
+        }
+    }
+
+    return d;
+}
+
+INTERNAL_FUNC void
+set_hilbert_space(Spatial_Index *index, Layout_Box space)
+{
+    index->hilbert_space   = space;
+    index->hilbert_scale_x = HILBERT_MAX_CELL /
+                             MAX((f64)space.max_x - (f64)space.min_x, 1.0);
+    index->hilbert_scale_y = HILBERT_MAX_CELL /
+                             MAX((f64)space.max_y - (f64)space.min_y, 1.0);
+}
+
+INTERNAL_FUNC u32
+hilbert_from_box(Spatial_Index *index, Layout_Box box)
+{
+    f64 center_x = ((f64)box.min_x + (f64)box.max_x) * 0.5;
+    f64 center_y = ((f64)box.min_y + (f64)box.max_y) * 0.5;
+
+    f64 cell_x =
+        (center_x - index->hilbert_space.min_x) * index->hilbert_scale_x;
+    f64 cell_y =
+        (center_y - index->hilbert_space.min_y) * index->hilbert_scale_y;
+
+    cell_x = MIN(MAX(cell_x, 0.0), HILBERT_MAX_CELL);
+    cell_y = MIN(MAX(cell_y, 0.0), HILBERT_MAX_CELL);
+
+    return hilbert_from_cell((u32)cell_x, (u32)cell_y);
+}
+
+INTERNAL_FUNC u32
+allocate_node(Spatial_Index *index, b8 is_leaf)
+{
+    u32 node_id;
+
+    if (index->free_node != INVALID_ID)
+    {
+        node_id          = index->free_node;
+        index->free_node = index->nodes[node_id].parent;
+    }
+    else
+    {
+        Spatial_Node *node = push_struct(index->arena, Spatial_Node);
+        RUNTIME_ASSERT(node == index->nodes + index->node_count);
+
+        node_id = index->node_count++;
+    }
+
+    Spatial_Node *node = &index->nodes[node_id];
+    node->parent       = INVALID_ID;
+    node->count        = 0;
+    node->is_leaf      = is_leaf;
+
+    return node_id;
+}
+
+INTERNAL_FUNC void
+release_node(Spatial_Index *index, u32 node_id)
+{
+    index->nodes[node_id].parent = index->free_node;
+    index->free_node             = node_id;
+}
+
+INTERNAL_FUNC Layout_Box
+node_bounds(const Spatial_Node *node)
+{
+    Layout_Box bounds = layout_box_empty();
+
+    for (u32 i = 0; i < node->count; ++i)
+    {
+        bounds.min_x = MIN(bounds.min_x, node->min_x[i]);
+        bounds.min_y = MIN(bounds.min_y, node->min_y[i]);
+        bounds.max_x = MAX(bounds.max_x, node->max_x[i]);
+        bounds.max_y = MAX(bounds.max_y, node->max_y[i]);
+    }
+
+    return bounds;
+}
+
+INTERNAL_FUNC u32
+node_max_hilbert(const Spatial_Node *node)
+{
+    u32 result = 0;
+    for (u32 i = 0; i < node->count; ++i)
+        result = MAX(result, node->hilbert[i]);
+
+    return result;
+}
+
+FORCE_INLINE void
+set_entry(Spatial_Node *node, u32 slot, Layout_Box box, u32 hilbert, u32 child)
+{
+    node->min_x[slot]    = box.min_x;
+    node->min_y[slot]    = box.min_y;
+    node->max_x[slot]    = box.max_x;
+    node->max_y[slot]    = box.max_y;
+    node->hilbert[slot]  = hilbert;
+    node->children[slot] = child;
+}
+
+FORCE_INLINE void
+move_entry(Spatial_Node *to, u32 to_slot, Spatial_Node *from, u32 from_slot)
+{
+    to->min_x[to_slot]    = from->min_x[from_slot];
+    to->min_y[to_slot]    = from->min_y[from_slot];
+    to->max_x[to_slot]    = from->max_x[from_slot];
+    to->max_y[to_slot]    = from->max_y[from_slot];
+    to->hilbert[to_slot]  = from->hilbert[from_slot];
+    to->children[to_slot] = from->children[from_slot];
+}
+
+INTERNAL_FUNC void
+insert_entry(Spatial_Node *node,
+             u32           slot,
+             Layout_Box    box,
+             u32           hilbert,
+             u32           child)
+{
+    RUNTIME_ASSERT(node->count < SPATIAL_INDEX_NODE_CAPACITY);
+
+    for (u32 i = node->count; i > slot; --i)
+        move_entry(node, i, node, i - 1);
+
+    set_entry(node, slot, box, hilbert, child);
+    node->count++;
+}
+
+INTERNAL_FUNC void
+remove_entry(Spatial_Node *node, u32 slot)
+{
+    for (u32 i = slot; i + 1 < node->count; ++i)
+        move_entry(node, i, node, i + 1);
+
+    node->count--;
+}
+
+INTERNAL_FUNC u32
+find_slot(const Spatial_Node *parent, u32 child)
+{
+    for (u32 i = 0; i < parent->count; ++i)
+    {
+        if (parent->children[i] == child)
+            return i;
+    }
+
+    RUNTIME_ASSERT_MSG(false, "spatial_index - Node missing from its parent");
+    return INVALID_ID;
+}
+
+// Recomputes the entries describing the node and its ancestors
+INTERNAL_FUNC void
+refresh_upward(Spatial_Index *index, u32 node_id)
+{
+    while (node_id != index->root)
+    {
+        Spatial_Node *node   = &index->nodes[node_id];
+        Spatial_Node *parent = &index->nodes[node->parent];
+
+        set_entry(parent,
+                  find_slot(parent, node_id),
+                  node_bounds(node),
+                  node_max_hilbert(node),
+                  node_id);
+
+        node_id = node->parent;
+    }
+
+    index->bounds = node_bounds(&index->nodes[index->root]);
+}
+
+// Moves the upper half of a full node to a new sibling placed right after it
+// in the parent, splitting the parent first when it is full as well
+INTERNAL_FUNC u32
+split_node(Spatial_Index *index, u32 node_id)
+{
+    Spatial_Node *node      = &index->nodes[node_id];
+    u32           parent_id = node->parent;
+
+    if (parent_id == INVALID_ID)
+    {
+        RUNTIME_ASSERT_MSG(index->height < SPATIAL_INDEX_MAX_HEIGHT,
+                           "spatial_index - Tree is too tall");
+
+        parent_id = allocate_node(index, false);
+        insert_entry(&index->nodes[parent_id],
+                     0,
+                     node_bounds(node),
+                     node_max_hilbert(node),
+                     node_id);
+
+        node->parent = parent_id;
+        index->root  = parent_id;
+        index->height++;
+    }
+    else if (index->nodes[parent_id].count == SPATIAL_INDEX_NODE_CAPACITY)
+    {
+        split_node(index, parent_id);
+
+        // The node may have moved to the sibling of its parent
+        parent_id = node->parent;
+    }
+
+    u32           sibling_id = allocate_node(index, node->is_leaf);
+    Spatial_Node *sibling    = &index->nodes[sibling_id];
+    u32           half       = node->count / 2;
+
+    for (u32 i = half; i < node->count; ++i)
+    {
+        move_entry(sibling, sibling->count++, node, i);
+
+        if (!node->is_leaf)
+            index->nodes[node->children[i]].parent = sibling_id;
+    }
+
+    node->count     = (u16)half;
+    sibling->parent = parent_id;
+
+    Spatial_Node *parent = &index->nodes[parent_id];
+    u32           slot   = find_slot(parent, node_id);
+
+    set_entry(parent, slot, node_bounds(node), node_max_hilbert(node), node_id);
+    insert_entry(parent,
+                 slot + 1,
+                 node_bounds(sibling),
+                 node_max_hilbert(sibling),
+                 sibling_id);
+
+    return sibling_id;
+}
+
+// LSD radix sort on the Hilbert value held in the upper half of the keys.
+// Returns the buffer holding the sorted keys
+INTERNAL_FUNC u64 *
+radix_sort_keys(u64 *keys, u64 *temp, u64 count)
+{
+    u64 histograms[4][256] = {};
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        for (u32 pass = 0; pass < 4; ++pass)
+            histograms[pass][(keys[i] >> (32 + pass * 8)) & 0xFF]++;
+    }
+
+    for (u32 pass = 0; pass < 4; ++pass)
+    {
+        u64 *histogram = histograms[pass];
+        u32  shift     = 32 + pass * 8;
+
+        // Every key has the same digit, the pass would not move anything
+        if (histogram[(keys[0] >> shift) & 0xFF] == count)
+            continue;
+
+        u64 offset = 0;
+        for (u32 digit = 0; digit < 256; ++digit)
+        {
+            u64 digit_count  = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (u64 i = 0; i < count; ++i)
+            temp[histogram[(keys[i] >> shift) & 0xFF]++] = keys[i];
+
+        u64 *swap = keys;
+        keys      = temp;
+        temp      = swap;
+    }
+
+    return keys;
+}
+
+VOLTRUM_API Spatial_Index *
+spatial_index_create(Layout_Box space_hint)
+{
+    // Nodes are addressed from the start of the block, it must not chain
+    Arena *arena = arena_create(SPATIAL_INDEX_ARENA_RESERVE,
+                                SPATIAL_INDEX_ARENA_COMMIT_SIZE,
+                                ARENA_DEFAULT_RETAIN_SIZE,
+                                Arena_Flags::FIXED);
+
+    auto *index      = push_struct(arena, Spatial_Index);
+    index->arena     = arena;
+    index->free_node = INVALID_ID;
+
+    // The root is the first node, every other one is pushed right after it
+    u64 node_position = ALIGN_UP_POW2(arena_position(arena), 8);
+    index->nodes = (Spatial_Node *)((u8 *)arena->memory + node_position);
+    index->root  = allocate_node(index, true);
+
+    index->height = 1;
+    index->bounds = layout_box_empty();
+
+    set_hilbert_space(index, space_hint);
+
+    return index;
+}
+
+VOLTRUM_API void
+spatial_index_destroy(Spatial_Index *index)
+{
+    ENSURE(index);
+
+    // The index struct lives in its own arena
+    arena_release(index->arena);
+}
+
+VOLTRUM_API u64
+spatial_index_memory_usage(Spatial_Index *index)
+{
+    return (u64)index->node_count * sizeof(Spatial_Node);
+}
+
+VOLTRUM_API void
+spatial_index_build(Spatial_Index       *index,
+                    const Spatial_Entry *entries,
+                    u64                  count)
+{
+    RUNTIME_ASSERT_MSG(count < INVALID_ID,
+                       "spatial_index_build - Too many entries");
+
+    u8 *memory = (u8 *)index->arena->memory;
+    arena_pop_to(index->arena, (u64)((u8 *)index->nodes - memory));
+
+    index->node_count  = 0;
+    index->free_node   = INVALID_ID;
+    index->height      = 1;
+    index->entry_count = count;
+    index->bounds      = layout_box_empty();
+
+    for (u64 i = 0; i < count; ++i)
+        index->bounds = layout_box_union(index->bounds, entries[i].box);
+
+    if (count == 0)
+    {
+        index->root = allocate_node(index, true);
+        return;
+    }
+
+    set_hilbert_space(index,
+                      layout_box_union(index->hilbert_space, index->bounds));
+
+    // Hilbert value in the upper half of the key, entry in the lower half
+    Arena *sort_arena =
+        arena_create(count * 2 * sizeof(u64) + SPATIAL_INDEX_SORT_COMMIT_SIZE,
+                     SPATIAL_INDEX_SORT_COMMIT_SIZE);
+
+    u64 *keys = push_array(sort_arena, u64, count);
+    u64 *temp = push_array(sort_arena, u64, count);
+
+    for (u64 i = 0; i < count; ++i)
+        keys[i] = ((u64)hilbert_from_box(index, entries[i].box) << 32) | i;
+
+    keys = radix_sort_keys(keys, temp, count);
+
+    // Leaves are packed full in curve order, then every level above them
+    u32 level_begin = index->node_count;
+    u32 level_count = 0;
+
+    for (u64 i = 0; i < count; i += SPATIAL_INDEX_NODE_CAPACITY)
+    {
+        Spatial_Node *leaf = &index->nodes[allocate_node(index, true)];
+        u64           end  = MIN(i + SPATIAL_INDEX_NODE_CAPACITY, count);
+
+        for (u64 k = i; k < end; ++k)
+        {
+            const Spatial_Entry *entry = &entries[keys[k] & 0xFFFFFFFF];
+            set_entry(leaf,
+                      leaf->count++,
+                      entry->box,
+                      (u32)(keys[k] >> 32),
+                      entry->id);
+        }
+
+        level_count++;
+    }
+
+    arena_release(sort_arena);
+
+    while (level_count > 1)
+    {
+        u32 next_begin = index->node_count;
+        u32 next_count = 0;
+
+        for (u32 i = 0; i < level_count; i += SPATIAL_INDEX_NODE_CAPACITY)
+        {
+            u32           parent_id = allocate_node(index, false);
+            Spatial_Node *parent    = &index->nodes[parent_id];
+            u32 end = MIN(i + SPATIAL_INDEX_NODE_CAPACITY, level_count);
+
+            for (u32 k = i; k < end; ++k)
+            {
+                Spatial_Node *child = &index->nodes[level_begin + k];
+                child->parent       = parent_id;
+
+                set_entry(parent,
+                          parent->count++,
+                          node_bounds(child),
+                          node_max_hilbert(child),
+                          level_begin + k);
+            }
+
+            next_count++;
+        }
+
+        level_begin = next_begin;
+        level_count = next_count;
+        index->height++;
+    }
+
+    index->root = level_begin;
+}
+
+VOLTRUM_API void
+spatial_index_insert(Spatial_Index *index, Layout_Box box, u32 id)
+{
+    if (index->entry_count == 0 && layout_box_is_empty(index->hilbert_space))
+        set_hilbert_space(index, box);
+
+    u32 hilbert = hilbert_from_box(index, box);
+
+    // Follow the curve down to the first child reaching past the new value
+    u32 node_id = index->root;
+
+    while (!index->nodes[node_id].is_leaf)
+    {
+        Spatial_Node *node = &index->nodes[node_id];
+        u32           slot = node->count - 1;
+
+        for (u32 i = 0; i < node->count; ++i)
+        {
+            if (node->hilbert[i] >= hilbert)
+            {
+                slot = i;
+                break;
+            }
+        }
+
+        node_id = node->children[slot];
+    }
+
+    Spatial_Node *leaf = &index->nodes[node_id];
+    u32           slot = leaf->count;
+
+    for (u32 i = 0; i < leaf->count; ++i)
+    {
+        if (leaf->hilbert[i] > hilbert)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if (leaf->count == SPATIAL_INDEX_NODE_CAPACITY)
+    {
+        u32 sibling_id = split_node(index, node_id);
+
+        if (slot > leaf->count)
+        {
+            slot -= leaf->count;
+            node_id = sibling_id;
+        }
+    }
+
+    insert_entry(&index->nodes[node_id], slot, box, hilbert, id);
+    refresh_upward(index, node_id);
+
+    index->entry_count++;
+}
+
+VOLTRUM_API b8
+spatial_index_remove(Spatial_Index *index, Layout_Box box, u32 id)
+{
+    u32 stack[SPATIAL_INDEX_STACK_SIZE];
+    u32 stack_size = 0;
+
+    stack[stack_size++] = index->root;
+
+    u32 leaf_id = INVALID_ID;
+    u32 slot    = 0;
+
+    while (stack_size > 0 && leaf_id == INVALID_ID)
+    {
+        u32           node_id = stack[--stack_size];
+        Spatial_Node *node    = &index->nodes[node_id];
+
+        for (u32 i = 0; i < node->count; ++i)
+        {
+            if (node->is_leaf)
+            {
+                if (node->children[i] == id && node->min_x[i] == box.min_x &&
+                    node->min_y[i] == box.min_y &&
+                    node->max_x[i] == box.max_x && node->max_y[i] == box.max_y)
+                {
+                    leaf_id = node_id;
+                    slot    = i;
+                    break;
+                }
+            }
+            else if (node->min_x[i] <= box.min_x &&
+                     node->min_y[i] <= box.min_y &&
+                     node->max_x[i] >= box.max_x && node->max_y[i] >= box.max_y)
+            {
+                stack[stack_size++] = node->children[i];
+            }
+        }
+    }
+
+    if (leaf_id == INVALID_ID)
+        return false;
+
+    remove_entry(&index->nodes[leaf_id], slot);
+
+    // Empty nodes are unlinked, the others may stay under half full
+    u32 node_id = leaf_id;
+
+    while (node_id != index->root && index->nodes[node_id].count == 0)
+    {
+        u32 parent_id = index->nodes[node_id].parent;
+
+        remove_entry(&index->nodes[parent_id],
+                     find_slot(&index->nodes[parent_id], node_id));
+        release_node(index, node_id);
+
+        node_id = parent_id;
+    }
+
+    refresh_upward(index, node_id);
+
+    Spatial_Node *root = &index->nodes[index->root];
+
+    while (!root->is_leaf && root->count == 1)
+    {
+        u32 child_id = root->children[0];
+
+        release_node(index, index->root);
+        index->root = child_id;
+        index->height--;
+
+        root         = &index->nodes[child_id];
+        root->parent = INVALID_ID;
+    }
+
+    if (root->count == 0)
+    {
+        root->is_leaf = true;
+        index->height = 1;
+    }
+
+    index->entry_count--;
+
+    return true;
+}
+
+VOLTRUM_API u64
+spatial_index_query(Spatial_Index      *index,
+                    Layout_Box          region,
+                    Dynamic_Array<u32> *out_ids)
+{
+    if (index->entry_count == 0 ||
+        !layout_box_overlaps(index->bounds, region))
+    {
+        return 0;
+    }
+
+    u32 stack[SPATIAL_INDEX_STACK_SIZE];
+    u32 stack_size = 0;
+    u64 found      = 0;
+
+    stack[stack_size++] = index->root;
+
+    while (stack_size > 0)
+    {
+        const Spatial_Node *node = &index->nodes[stack[--stack_size]];
+
+        // Every lane is tested so that the loop vectorizes, the ones past
+        // the count are masked afterwards
+        u8 hits[SPATIAL_INDEX_NODE_CAPACITY];
+        for (u32 i = 0; i < SPATIAL_INDEX_NODE_CAPACITY; ++i)
+        {
+            hits[i] = (node->min_x[i] <= region.max_x) &
+                      (region.min_x <= node->max_x[i]) &
+                      (node->min_y[i] <= region.max_y) &
+                      (region.min_y <= node->max_y[i]);
+        }
+
+        if (node->is_leaf)
+        {
+            for (u32 i = 0; i < node->count; ++i)
+            {
+                if (!hits[i])
+                    continue;
+
+                if (out_ids)
+                    out_ids->add(node->children[i]);
+
+                found++;
+            }
+        }
+        else
+        {
+            for (u32 i = 0; i < node->count; ++i)
+            {
+                if (hits[i])
+                    stack[stack_size++] = node->children[i];
+            }
+        }
+    }
+
+    return found;
+}
+
+VOLTRUM_API u64
+spatial_index_pick(Spatial_Index      *index,
+                   s32                 x,
+                   s32                 y,
+                   Dynamic_Array<u32> *out_ids)
+{
+    return spatial_index_query(index, {x, y, x, y}, out_ids);
+}
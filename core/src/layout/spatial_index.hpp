@@ -0,0 +1,97 @@
+#pragma once
+
+#include "data_structures/dynamic_array.hpp"
+#include "defines.hpp"
+#include "layout/layout.hpp"
+#include "memory/arena.hpp"
+
+constexpr u32 SPATIAL_INDEX_NODE_CAPACITY = 16;
+
+// Bounds the traversal stack, a split leaves both halves at least half full
+// so a tree this tall would hold far more than 2^32 entries
+constexpr u32 SPATIAL_INDEX_MAX_HEIGHT = 32;
+
+constexpr u64 SPATIAL_INDEX_ARENA_RESERVE = 16 * GiB;
+
+struct Spatial_Entry
+{
+    Layout_Box box;
+    u32        id;
+};
+
+// Children are stored as structure of arrays so that the overlap tests of a
+// node run over four contiguous coordinate arrays
+struct Spatial_Node
+{
+    s32 min_x[SPATIAL_INDEX_NODE_CAPACITY];
+    s32 min_y[SPATIAL_INDEX_NODE_CAPACITY];
+    s32 max_x[SPATIAL_INDEX_NODE_CAPACITY];
+    s32 max_y[SPATIAL_INDEX_NODE_CAPACITY];
+
+    // Hilbert value of the entry in leaves, the largest one found below the
+    // child in inner nodes. Children are kept sorted by it
+    u32 hilbert[SPATIAL_INDEX_NODE_CAPACITY];
+
+    u32 children[SPATIAL_INDEX_NODE_CAPACITY]; // Nodes, or entry ids in leaves
+
+    u32 parent; // Next free node once released
+    u16 count;
+    b8  is_leaf;
+};
+
+// Packed Hilbert R-tree over boxes. A bulk load sorts the entries along the
+// Hilbert curve of their centers and packs full nodes bottom-up, inserts then
+// follow the curve down to the leaf that keeps the order and split full nodes
+// in halves
+struct Spatial_Index
+{
+    Arena        *arena; // Only holds nodes, which keeps them contiguous
+    Spatial_Node *nodes;
+    u32           node_count; // Released nodes included
+    u32           free_node;
+
+    u32 root;
+    u32 height; // 1 when the root is a leaf
+    u64 entry_count;
+
+    Layout_Box bounds;
+
+    // Region mapped onto the Hilbert grid, centers outside of it are clamped
+    Layout_Box hilbert_space;
+    f64        hilbert_scale_x;
+    f64        hilbert_scale_y;
+};
+
+// Inserted boxes are mapped on the Hilbert grid of the space hint. Without one
+// the grid is fitted to the first box or to the entries of a bulk load
+VOLTRUM_API Spatial_Index *
+spatial_index_create(Layout_Box space_hint = layout_box_empty());
+VOLTRUM_API void spatial_index_destroy(Spatial_Index *index);
+
+// Bytes held by the nodes
+VOLTRUM_API u64 spatial_index_memory_usage(Spatial_Index *index);
+
+// Replaces the content of the index with a tree packed from the entries
+VOLTRUM_API void spatial_index_build(Spatial_Index       *index,
+                                     const Spatial_Entry *entries,
+                                     u64                  count);
+
+VOLTRUM_API void
+spatial_index_insert(Spatial_Index *index, Layout_Box box, u32 id);
+
+// The box has to be the one the entry was inserted with. Returns false when
+// the entry is not found
+VOLTRUM_API b8
+spatial_index_remove(Spatial_Index *index, Layout_Box box, u32 id);
+
+// Appends the ids of the entries overlapping the region, borders included.
+// Returns their number, out_ids can be nullptr to only count them
+VOLTRUM_API u64 spatial_index_query(Spatial_Index      *index,
+                                    Layout_Box          region,
+                                    Dynamic_Array<u32> *out_ids);
+
+// Entries whose box contains the point
+VOLTRUM_API u64 spatial_index_pick(Spatial_Index      *index,
+                                   s32                 x,
+                                   s32                 y,
+                                   Dynamic_Array<u32> *out_ids);
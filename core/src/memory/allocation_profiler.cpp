@@ -0,0 +1,411 @@
+#include "allocation_profiler.hpp"
+#include "arena.hpp"
+
+#include "core/logger.hpp"
+#include "memory/memory.hpp"
+#include "platform/filesystem.hpp"
+#include "platform/platform.hpp"
+#include "utils/radix_sort.hpp"
+
+#include <atomic>
+#include <stdio.h>
+
+// Slots of the site table, twice the sites so the probes stay short
+constexpr u32 ALLOCATION_PROFILER_TABLE_SIZE =
+    ALLOCATION_PROFILER_MAX_SITES * 2;
+
+// Longest symbol written by the dump
+constexpr u64 ALLOCATION_PROFILER_SYMBOL_LENGTH = 256;
+
+struct Allocation_Profiler_State
+{
+    Arena *arena;
+
+    // Open addressing on the hash of the site, empty slots have no samples
+    Allocation_Site *sites;
+    u32              site_count;
+
+    u64 sample_interval;
+    u64 sample_count;
+    u64 dropped_count;
+
+    std::atomic<b8>  is_enabled;
+    std::atomic<u32> lock; // Samples are rare, a spin is enough
+};
+
+internal_var std::atomic<Allocation_Profiler_State *> profiler = nullptr;
+
+// Seeds the countdowns of this thread
+internal_var THREAD_STATIC u64 sample_random = 0;
+
+// Set while the profiler allocates for itself, its own pushes are not sampled
+internal_var THREAD_STATIC b8 is_thread_suspended = false;
+
+INTERNAL_FUNC u64
+next_random()
+{
+    if (sample_random == 0)
+    {
+        sample_random = (u64)&sample_random ^
+                        (u64)(platform_get_absolute_time() * 1e9) ^
+                        0x9E3779B97F4A7C15ull;
+    }
+
+    // xorshift64
+    sample_random ^= sample_random << 13;
+    sample_random ^= sample_random >> 7;
+    sample_random ^= sample_random << 17;
+
+    return sample_random;
+}
+
+INTERNAL_FUNC u64
+combine_hash(u64 hash, u64 value)
+{
+    hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+INTERNAL_FUNC void
+lock_profiler(Allocation_Profiler_State *state)
+{
+    while (state->lock.exchange(1, std::memory_order_acquire))
+    {
+        while (state->lock.load(std::memory_order_relaxed))
+            platform_thread_yield();
+    }
+}
+
+INTERNAL_FUNC void
+unlock_profiler(Allocation_Profiler_State *state)
+{
+    state->lock.store(0, std::memory_order_release);
+}
+
+void
+allocation_profiler_init(u64 sample_interval)
+{
+    Arena *arena = arena_create();
+
+    auto *state  = push_struct(arena, Allocation_Profiler_State);
+    state->arena = arena;
+    state->sites =
+        push_array(arena, Allocation_Site, ALLOCATION_PROFILER_TABLE_SIZE);
+    state->sample_interval = MAX(1, sample_interval);
+    state->is_enabled.store(true);
+
+    profiler.store(state, std::memory_order_release);
+
+    CORE_INFO("Allocation profiler initialized, one sample every %llu KiB",
+              state->sample_interval / KiB);
+}
+
+void
+allocation_profiler_shutdown()
+{
+    Allocation_Profiler_State *state = profiler.exchange(nullptr);
+
+    if (state)
+        arena_release(state->arena);
+}
+
+void
+allocation_profiler_set_enabled(b8 enabled)
+{
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    if (state)
+        state->is_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+b8
+allocation_profiler_is_enabled()
+{
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    return state && state->is_enabled.load(std::memory_order_relaxed);
+}
+
+void
+allocation_profiler_reset()
+{
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    if (!state)
+        return;
+
+    lock_profiler(state);
+
+    memory_zero(state->sites,
+                sizeof(Allocation_Site) * ALLOCATION_PROFILER_TABLE_SIZE);
+    state->site_count    = 0;
+    state->sample_count  = 0;
+    state->dropped_count = 0;
+
+    unlock_profiler(state);
+}
+
+s64
+allocation_profiler_next_countdown()
+{
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    if (!state || !state->is_enabled.load(std::memory_order_relaxed))
+        return ALLOCATION_PROFILER_DISABLED_COUNTDOWN;
+
+    // Uniform around the interval, so allocations repeating with the period
+    // of the interval do not always land on the sample
+    u64 interval = state->sample_interval;
+
+    return (s64)(interval / 2 + next_random() % interval);
+}
+
+void
+allocation_profiler_record(s64              *countdown,
+                           Allocation_Source source,
+                           u64               size,
+                           const char       *file,
+                           s32               line)
+{
+    *countdown = allocation_profiler_next_countdown();
+
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    if (!state || !state->is_enabled.load(std::memory_order_relaxed) ||
+        is_thread_suspended)
+    {
+        return;
+    }
+
+    // The first frame is this function
+    void *frames[ALLOCATION_PROFILER_STACK_DEPTH + 1];
+    u32   frame_count =
+        platform_capture_stack(frames, ALLOCATION_PROFILER_STACK_DEPTH + 1);
+    u32 stack_depth = frame_count > 0 ? frame_count - 1 : 0;
+
+    u64 hash = combine_hash((u64)file, (u64)line);
+    hash     = combine_hash(hash, (u64)source);
+
+    for (u32 i = 0; i < stack_depth; ++i)
+        hash = combine_hash(hash, (u64)frames[i + 1]);
+
+    // Allocations bigger than the interval are always sampled, each of them
+    // stands for itself
+    u64 estimated_bytes = MAX(size, state->sample_interval);
+
+    u32 bucket = 0;
+    while (bucket + 1 < ALLOCATION_PROFILER_SIZE_BUCKETS &&
+           (size >> (bucket + 1)) != 0)
+    {
+        ++bucket;
+    }
+
+    lock_profiler(state);
+
+    u32              slot = (u32)hash & (ALLOCATION_PROFILER_TABLE_SIZE - 1);
+    Allocation_Site *site = &state->sites[slot];
+
+    while (site->sample_count != 0 && site->hash != hash)
+    {
+        slot = (slot + 1) & (ALLOCATION_PROFILER_TABLE_SIZE - 1);
+        site = &state->sites[slot];
+    }
+
+    if (site->sample_count == 0)
+    {
+        if (state->site_count == ALLOCATION_PROFILER_MAX_SITES)
+        {
+            state->dropped_count++;
+            unlock_profiler(state);
+            return;
+        }
+
+        site->hash        = hash;
+        site->file        = file;
+        site->line        = line;
+        site->source      = source;
+        site->stack_depth = stack_depth;
+
+        for (u32 i = 0; i < stack_depth; ++i)
+            site->stack[i] = frames[i + 1];
+
+        state->site_count++;
+    }
+
+    site->sample_count++;
+    site->sampled_bytes += size;
+    site->estimated_bytes += estimated_bytes;
+    site->size_histogram[bucket]++;
+
+    state->sample_count++;
+
+    unlock_profiler(state);
+}
+
+void
+allocation_profiler_snapshot(Arena *arena, Allocation_Profile *out_profile)
+{
+    memory_zero(out_profile, sizeof(Allocation_Profile));
+
+    Allocation_Profiler_State *state =
+        profiler.load(std::memory_order_acquire);
+
+    if (!state)
+        return;
+
+    // The memory is taken before locking, the pushes of this thread are not
+    // sampled. Other threads can still add sites in between, in which case
+    // the memory is taken again for the new count
+    is_thread_suspended = true;
+
+    u64              position = arena_position(arena);
+    Allocation_Site *sites    = nullptr;
+    u64             *keys     = nullptr;
+    u32             *order    = nullptr;
+
+    for (;;)
+    {
+        lock_profiler(state);
+        u32 capacity = state->site_count;
+        unlock_profiler(state);
+
+        sites = push_array(arena, Allocation_Site, capacity);
+        keys  = push_array(arena, u64, capacity);
+        order = push_array(arena, u32, capacity);
+
+        lock_profiler(state);
+
+        if (state->site_count <= capacity)
+            break;
+
+        unlock_profiler(state);
+        arena_pop_to(arena, position);
+    }
+
+    u32 site_count = 0;
+    for (u32 i = 0; i < ALLOCATION_PROFILER_TABLE_SIZE; ++i)
+    {
+        if (state->sites[i].sample_count != 0)
+            sites[site_count++] = state->sites[i];
+    }
+
+    out_profile->sample_interval = state->sample_interval;
+    out_profile->sample_count    = state->sample_count;
+    out_profile->dropped_count   = state->dropped_count;
+
+    unlock_profiler(state);
+
+    // Largest first
+    for (u32 i = 0; i < site_count; ++i)
+    {
+        keys[i]  = ~sites[i].estimated_bytes;
+        order[i] = i;
+
+        out_profile->estimated_bytes += sites[i].estimated_bytes;
+    }
+
+    radix_sort_u64(arena, keys, order, site_count);
+
+    auto *sorted = push_array(arena, Allocation_Site, site_count);
+    for (u32 i = 0; i < site_count; ++i)
+        sorted[i] = sites[order[i]];
+
+    out_profile->sites      = sorted;
+    out_profile->site_count = site_count;
+
+    is_thread_suspended = false;
+}
+
+b8
+allocation_profiler_dump(const char *path)
+{
+    File_Handle file;
+    if (!filesystem_open(path, File_Modes::WRITE, false, &file))
+    {
+        CORE_ERROR("allocation_profiler_dump - Unable to open file '%s'", path);
+        return false;
+    }
+
+    Arena *arena = arena_create();
+
+    Allocation_Profile profile;
+    allocation_profiler_snapshot(arena, &profile);
+
+    char line[ALLOCATION_PROFILER_SYMBOL_LENGTH + 64];
+    char symbol[ALLOCATION_PROFILER_SYMBOL_LENGTH];
+
+    snprintf(line,
+             sizeof(line),
+             "# Allocation profile: %llu samples of %llu bytes, %u sites, "
+             "%llu dropped",
+             profile.sample_count,
+             profile.sample_interval,
+             profile.site_count,
+             profile.dropped_count);
+
+    b8 result = filesystem_write_line(&file, line);
+
+    for (u32 i = 0; result && i < profile.site_count; ++i)
+    {
+        Allocation_Site *site = &profile.sites[i];
+
+        snprintf(line,
+                 sizeof(line),
+                 "\nsite %u: %s:%d (%s) ~%llu bytes, %llu samples",
+                 i,
+                 site->file ? site->file : "?",
+                 site->line,
+                 site->source == Allocation_Source::ARENA ? "arena" : "heap",
+                 site->estimated_bytes,
+                 site->sample_count);
+        result = filesystem_write_line(&file, line);
+
+        // Non empty buckets only, as "size class: samples"
+        for (u32 b = 0; result && b < ALLOCATION_PROFILER_SIZE_BUCKETS; ++b)
+        {
+            if (site->size_histogram[b] == 0)
+                continue;
+
+            snprintf(line,
+                     sizeof(line),
+                     "  [%llu, %llu): %u",
+                     1ull << b,
+                     2ull << b,
+                     site->size_histogram[b]);
+            result = filesystem_write_line(&file, line);
+        }
+
+        for (u32 f = 0; result && f < site->stack_depth; ++f)
+        {
+            if (!platform_symbolize_address(
+                    site->stack[f], symbol, sizeof(symbol)))
+            {
+                symbol[0] = 0;
+            }
+
+            snprintf(line,
+                     sizeof(line),
+                     "  #%u %p %s",
+                     f,
+                     site->stack[f],
+                     symbol);
+            result = filesystem_write_line(&file, line);
+        }
+    }
+
+    filesystem_close(&file);
+    arena_release(arena);
+
+    if (!result)
+    {
+        CORE_ERROR("allocation_profiler_dump - Failed to write file '%s'",
+                   path);
+    }
+
+    return result;
+}
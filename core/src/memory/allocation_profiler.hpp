@@ -0,0 +1,100 @@
+#pragma once
+
+#include "defines.hpp"
+
+struct Arena;
+
+// Sampled allocation profiler, cheap enough to stay on in release builds.
+// Every allocator keeps a countdown of bytes, the allocation that crosses it
+// is recorded with its call site and stack. On average one sample is taken
+// every sample interval bytes, so the bytes of a site are estimated from its
+// sample count
+constexpr u64 ALLOCATION_PROFILER_DEFAULT_SAMPLE_INTERVAL = 512 * KiB;
+
+// Countdown while the profiler is off. The allocators check back this often,
+// so enabling the profiler later reaches every thread and arena
+constexpr s64 ALLOCATION_PROFILER_DISABLED_COUNTDOWN = 64 * MiB;
+
+constexpr u32 ALLOCATION_PROFILER_MAX_SITES   = 1024;
+constexpr u32 ALLOCATION_PROFILER_STACK_DEPTH = 16;
+
+// Sizes of the samples of a site by power of two: bucket i counts the sizes in
+// [2^i, 2^(i + 1))
+constexpr u32 ALLOCATION_PROFILER_SIZE_BUCKETS = 48;
+
+enum class Allocation_Source : u32
+{
+    ARENA,
+    HEAP, // memory_allocate
+};
+
+// Call site and stack of sampled allocations
+struct Allocation_Site
+{
+    u64               hash;
+    const char       *file;
+    s32               line;
+    Allocation_Source source;
+
+    u32   stack_depth;
+    void *stack[ALLOCATION_PROFILER_STACK_DEPTH];
+
+    u64 sample_count;
+    u64 sampled_bytes;   // Sizes of the sampled allocations
+    u64 estimated_bytes; // Bytes allocated by the site, scaled from the samples
+    u32 size_histogram[ALLOCATION_PROFILER_SIZE_BUCKETS];
+};
+
+// Copy of the sites, by estimated bytes from the largest
+struct Allocation_Profile
+{
+    u64 sample_interval;
+    u64 sample_count;
+    u64 dropped_count; // Samples lost to a full site table
+    u64 estimated_bytes;
+
+    Allocation_Site *sites;
+    u32              site_count;
+};
+
+VOLTRUM_API void
+allocation_profiler_init(u64 sample_interval =
+                             ALLOCATION_PROFILER_DEFAULT_SAMPLE_INTERVAL);
+VOLTRUM_API void allocation_profiler_shutdown();
+
+// Pauses and resumes the sampling, the sites are kept
+VOLTRUM_API void allocation_profiler_set_enabled(b8 enabled);
+VOLTRUM_API b8   allocation_profiler_is_enabled();
+
+VOLTRUM_API void allocation_profiler_reset();
+
+// First countdown of an allocator
+VOLTRUM_API s64 allocation_profiler_next_countdown();
+
+// Records the allocation that crossed the countdown, which is then reset
+VOLTRUM_API void allocation_profiler_record(s64              *countdown,
+                                            Allocation_Source source,
+                                            u64               size,
+                                            const char       *file,
+                                            s32               line);
+
+// Called by the allocators for every allocation, with their own countdown
+FORCE_INLINE void
+allocation_profiler_account(s64              *countdown,
+                            Allocation_Source source,
+                            u64               size,
+                            const char       *file,
+                            s32               line)
+{
+    *countdown -= (s64)size;
+
+    if (*countdown < 0)
+        allocation_profiler_record(countdown, source, size, file, line);
+}
+
+// The sites are copied into the arena
+VOLTRUM_API void allocation_profiler_snapshot(Arena              *arena,
+                                              Allocation_Profile *out_profile);
+
+// Writes the profile as text, with the stacks symbolized where possible
+VOLTRUM_API b8 allocation_profiler_dump(const char *path);
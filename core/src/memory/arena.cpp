@@ -1,13 +1,23 @@
 #include "arena.hpp"
+#include "allocation_profiler.hpp"
 
 #include "core/asserts.hpp"
 #include "core/logger.hpp"
 #include "platform/platform.hpp"
 
+#include <atomic>
+
 #ifdef DEBUG_BUILD
 #    include "arena_debug.hpp"
 #endif
 
+// Pushes to CONCURRENT arenas are padded to this, the offset stays aligned
+// without knowing about the other pushes
+constexpr u64 ARENA_CONCURRENT_ALIGNMENT = 16;
+
+// The pushes to CONCURRENT arenas are sampled per thread
+internal_var THREAD_STATIC s64 concurrent_sample_countdown = 0;
+
 #if ASAN_ENABLED
 // C_LINKAGE const char *
 // __lsan_default_suppressions()
@@ -19,19 +29,42 @@
 // }
 #endif
 
-Arena *
-_arena_create(const char *file, s32 line, u64 reserve_size, u64 commit_size)
+// Reserves a block and commits its first pages. Only the block fields of the
+// header are filled in
+INTERNAL_FUNC Arena *
+arena_create_block(u64 reserve_size, u64 commit_size, Arena_Flags flags)
 {
-
     auto sys_info = platform_query_system_info();
 
-    u64 aligned_reserve_size = ALIGN_UP_POW2(reserve_size, sys_info.page_size);
-    u64 aligned_commit_size  = ALIGN_UP_POW2(commit_size, sys_info.page_size);
+    void       *block         = nullptr;
+    u64         page_size     = sys_info.page_size;
+    Arena_Flags granted_flags = Arena_Flags::NONE;
 
-    void *block = platform_virtual_memory_reserve(aligned_reserve_size);
-    platform_virtual_memory_commit(block, aligned_commit_size);
+    // Falls back to small pages when the platform has no large pages
+    if (enum_has_any(flags, Arena_Flags::LARGE_PAGES) &&
+        sys_info.large_page_size > 0)
+    {
+        u64 large_reserve_size =
+            ALIGN_UP_POW2(reserve_size, sys_info.large_page_size);
 
-    CORE_DEBUG("Arena allocated at %s:%i", file, line);
+        block = platform_virtual_memory_reserve_large(large_reserve_size);
+
+        if (block)
+        {
+            page_size = sys_info.large_page_size;
+            granted_flags |= Arena_Flags::LARGE_PAGES;
+        }
+    }
+
+    u64 aligned_reserve_size = ALIGN_UP_POW2(reserve_size, page_size);
+    u64 aligned_commit_size  = ALIGN_UP_POW2(commit_size, page_size);
+
+    if (!block)
+        block = platform_virtual_memory_reserve(aligned_reserve_size);
+
+    RUNTIME_ASSERT_MSG(block, "arena_create_block - Unable to reserve memory");
+
+    platform_virtual_memory_commit(block, aligned_commit_size);
 
     // Cold cast the arena header point at the start of the allocated block
     Arena *arena              = (Arena *)block;
@@ -40,8 +73,11 @@ _arena_create(const char *file, s32 line, u64 reserve_size, u64 commit_size)
     arena->commit_granularity = aligned_commit_size;
     arena->reserved_memory    = aligned_reserve_size;
     arena->offset             = ARENA_HEADER_SIZE;
-    arena->allocation_file    = file;
-    arena->allocation_line    = line;
+    arena->base_position      = 0;
+    arena->prev               = nullptr;
+    arena->current            = arena;
+    arena->flags              = granted_flags;
+    arena->lock               = 0;
 
     // Poison all committed memory past the header. This marks the region as
     // "off-limits" so ASAN can detect out-of-bounds accesses within the arena.
@@ -50,6 +86,39 @@ _arena_create(const char *file, s32 line, u64 reserve_size, u64 commit_size)
     ASAN_POISON_MEMORY_REGION(static_cast<u8 *>(block) + ARENA_HEADER_SIZE,
                               aligned_commit_size - ARENA_HEADER_SIZE);
 
+    return arena;
+}
+
+INTERNAL_FUNC void
+arena_release_block(Arena *block)
+{
+    // Unpoison everything before releasing so ASAN doesn't complain about
+    // the platform layer touching poisoned memory during decommit/release
+    ASAN_UNPOISON_MEMORY_REGION(block->memory, block->committed_memory);
+    platform_virtual_memory_release(block->memory, block->reserved_memory);
+}
+
+Arena *
+_arena_create(const char *file,
+              s32         line,
+              u64         reserve_size,
+              u64         commit_size,
+              u64         retain_size,
+              Arena_Flags flags)
+{
+    Arena *arena = arena_create_block(reserve_size, commit_size, flags);
+
+    CORE_DEBUG("Arena allocated at %s:%i", file, line);
+
+    arena->retain_size     = retain_size;
+    arena->total_committed = arena->committed_memory;
+    arena->peak_offset     = ARENA_HEADER_SIZE;
+    arena->peak_committed  = arena->committed_memory;
+    arena->flags |= flags & (Arena_Flags::FIXED | Arena_Flags::CONCURRENT);
+    arena->sample_countdown = allocation_profiler_next_countdown();
+    arena->allocation_file = file;
+    arena->allocation_line = line;
+
 #ifdef DEBUG_BUILD
     arena_debug_register(arena);
 #endif
@@ -64,10 +133,210 @@ arena_release(Arena *arena)
     arena_debug_deregister(arena);
 #endif
 
-    // Unpoison everything before releasing so ASAN doesn't complain about
-    // the platform layer touching poisoned memory during decommit/release
-    ASAN_UNPOISON_MEMORY_REGION(arena->memory, arena->committed_memory);
-    platform_virtual_memory_release(arena->memory, arena->reserved_memory);
+    // The first block holds the arena, it goes last
+    Arena *block = arena->current;
+
+    while (block)
+    {
+        Arena *prev = block->prev;
+        arena_release_block(block);
+        block = prev;
+    }
+}
+
+// Spins with a yield, the lock is only held while committing or chaining
+INTERNAL_FUNC void
+arena_lock(Arena *arena)
+{
+    std::atomic_ref<u32> lock(arena->lock);
+
+    while (lock.exchange(1, std::memory_order_acquire))
+    {
+        while (lock.load(std::memory_order_relaxed))
+            platform_thread_yield();
+    }
+}
+
+INTERNAL_FUNC void
+arena_unlock(Arena *arena)
+{
+    std::atomic_ref<u32>(arena->lock).store(0, std::memory_order_release);
+}
+
+// Commits the pages of the block up to the requested offset
+INTERNAL_FUNC FORCE_NOT_INLINE void
+arena_commit(Arena *arena, Arena *block, u64 requested_offset)
+{
+    // Since the requested offset might not necessarily be a power of 2 we
+    // need to round up to an integer multiple of the page size that can
+    // fit the requested_offset manually (cannot use ALIGN_UP_POW2)
+    u64 aligned_requested_commit_offset =
+        ALIGN_UP(requested_offset, block->commit_granularity);
+
+    RUNTIME_ASSERT_MSG(aligned_requested_commit_offset <=
+                           block->reserved_memory,
+                       "_arena_push - Arena exceeds reserved memory");
+
+    u64 commit_size = aligned_requested_commit_offset - block->committed_memory;
+
+    u8 *commit_pointer =
+        static_cast<u8 *>(block->memory) + block->committed_memory;
+
+    platform_virtual_memory_commit(commit_pointer, commit_size);
+
+    // Poison the newly committed pages — they are not yet in use.
+    // The portion that covers the current allocation will be unpoisoned
+    // when the caller unpoisons the result pointer.
+    ASAN_POISON_MEMORY_REGION(commit_pointer, commit_size);
+
+    // Concurrent pushes read the committed size without the lock
+    std::atomic_ref<u64>(block->committed_memory)
+        .store(aligned_requested_commit_offset, std::memory_order_release);
+
+    arena->total_committed += commit_size;
+    arena->peak_committed = MAX(arena->peak_committed, arena->total_committed);
+}
+
+// Chains a block that fits the push when the current one is full. Pushes that
+// do not fit in a regular block get a block of their own, sized to them. The
+// taken size is handed out before the block is published to the other threads
+INTERNAL_FUNC FORCE_NOT_INLINE Arena *
+arena_chain_block(Arena *arena, u64 size, u64 align, u64 taken_size = 0)
+{
+    RUNTIME_ASSERT_MSG(!enum_has_any(arena->flags, Arena_Flags::FIXED),
+                       "_arena_push - Arena exceeds reserved memory");
+
+    Arena *current = arena->current;
+
+    u64 required_size = ALIGN_UP_POW2(ARENA_HEADER_SIZE, align);
+    required_size += size;
+
+    u64 reserve_size = arena->reserved_memory;
+
+    if (required_size > reserve_size)
+        reserve_size = ALIGN_UP(required_size, arena->commit_granularity);
+
+    Arena *block = arena_create_block(reserve_size,
+                                      arena->commit_granularity,
+                                      arena->flags);
+
+    block->base_position = current->base_position + current->reserved_memory;
+    block->prev          = current;
+    block->offset += taken_size;
+
+    std::atomic_ref<Arena *>(arena->current)
+        .store(block, std::memory_order_release);
+
+    arena->total_committed += block->committed_memory;
+    arena->peak_committed = MAX(arena->peak_committed, arena->total_committed);
+
+    CORE_DEBUG("Arena allocated at %s:%i chained a block of %llu KiB",
+               arena->allocation_file,
+               arena->allocation_line,
+               block->reserved_memory / KiB);
+
+    return block;
+}
+
+// Every thread bumps the offset of the block with an atomic add. The threads
+// that overflow the block race for the lock, the first one chains the next
+// block and the others retry in it
+INTERNAL_FUNC void *
+arena_push_concurrent(
+    Arena      *arena,
+    u64         size,
+    u64         align,
+    b8          should_zero,
+    const char *file,
+    s32         line)
+{
+    u64 padded_size = ALIGN_UP_POW2(size, ARENA_CONCURRENT_ALIGNMENT);
+    if (align > ARENA_CONCURRENT_ALIGNMENT)
+        padded_size += align - ARENA_CONCURRENT_ALIGNMENT;
+
+    std::atomic_ref<Arena *> current_block(arena->current);
+
+    Arena *current = current_block.load(std::memory_order_acquire);
+    u64    offset  = 0;
+
+    for (;;)
+    {
+        offset = std::atomic_ref<u64>(current->offset)
+                     .fetch_add(padded_size, std::memory_order_relaxed);
+
+        if (offset + padded_size <= current->reserved_memory)
+            break;
+
+        arena_lock(arena);
+
+        Arena *latest = current_block.load(std::memory_order_relaxed);
+        b8     chains = latest == current;
+
+        if (chains)
+        {
+            latest = arena_chain_block(
+                arena, padded_size, ARENA_CONCURRENT_ALIGNMENT, padded_size);
+        }
+
+        arena_unlock(arena);
+
+        current = latest;
+
+        if (chains)
+        {
+            offset = ARENA_HEADER_SIZE;
+            break;
+        }
+    }
+
+    u64 current_offset   = ALIGN_UP_POW2(offset, align);
+    u64 requested_offset = current_offset + size;
+
+    // Pages past the committed size read here are zero, even when another
+    // thread commits them in the meantime
+    u64 committed = std::atomic_ref<u64>(current->committed_memory)
+                        .load(std::memory_order_acquire);
+
+    u64 size_to_zero = 0;
+    if (should_zero && committed > current_offset)
+        size_to_zero = MIN(committed, requested_offset) - current_offset;
+
+    if (committed < requested_offset)
+    {
+        arena_lock(arena);
+
+        if (current->committed_memory < requested_offset)
+            arena_commit(arena, current, requested_offset);
+
+        arena_unlock(arena);
+    }
+
+    void *result = static_cast<u8 *>(current->memory) + current_offset;
+
+    // Unpoison the region being handed out so ASAN allows access to it
+    ASAN_UNPOISON_MEMORY_REGION(result, size);
+
+    if (should_zero)
+        platform_zero_memory(result, size_to_zero);
+
+    allocation_profiler_account(&concurrent_sample_countdown,
+                                Allocation_Source::ARENA,
+                                size,
+                                file,
+                                line);
+
+#ifdef DEBUG_BUILD
+    // The registry takes its own lock, the records of every arena grow in
+    // the same debug arena
+    arena_debug_record_push(arena,
+                            current->base_position + current_offset,
+                            size,
+                            current_offset - offset,
+                            file,
+                            line);
+#endif
+
+    return result;
 }
 
 void *
@@ -86,13 +355,25 @@ _arena_push(
     // 		8 	->	long, double
     // 		16 	->	SSE
     // 		32 	->	AVX
-    u64 pre_align_offset = arena->offset;
-    u64 current_offset   = ALIGN_UP_POW2(arena->offset, align);
-    u64 requested_offset = current_offset + size;
+    if (enum_has_any(arena->flags, Arena_Flags::CONCURRENT))
+    {
+        return arena_push_concurrent(
+            arena, size, align, should_zero, file, line);
+    }
 
-    RUNTIME_ASSERT_MSG(
-        requested_offset <= arena->reserved_memory,
-        "Arena allocated at %s:%i exceeds reserved memory limit");
+    Arena *current          = arena->current;
+    u64    pre_align_offset = current->offset;
+    u64    current_offset   = ALIGN_UP_POW2(current->offset, align);
+    u64    requested_offset = current_offset + size;
+
+    // The reservation of the block is full, the push goes to a new block
+    if (requested_offset > current->reserved_memory)
+    {
+        current          = arena_chain_block(arena, size, align);
+        pre_align_offset = current->offset;
+        current_offset   = ALIGN_UP_POW2(current->offset, align);
+        requested_offset = current_offset + size;
+    }
 
     // Compute size to be zeroed before commtting the new pages. We consider the
     // memory from the current_offset until the next already commited page. In
@@ -101,57 +382,37 @@ _arena_push(
     if (should_zero)
     {
         size_to_zero =
-            MIN(arena->committed_memory, requested_offset) - current_offset;
+            MIN(current->committed_memory, requested_offset) - current_offset;
     }
 
     // Check if new pages need to be committed
-    if (arena->committed_memory < requested_offset)
-    {
-        // Since the requested offset might not necessarily be a power of 2 we
-        // need to round up to an integer multiple of the page size that can
-        // fit the requested_offset manually (cannot use ALIGN_UP_POW2)
-        u64 aligned_requested_commit_offset =
-            ALIGN_UP(requested_offset, arena->commit_granularity);
-
-        RUNTIME_ASSERT_MSG(aligned_requested_commit_offset <=
-                               arena->reserved_memory,
-                           "_arena_push - Arena exceeds reserved memory");
-
-        u64 commit_size =
-            aligned_requested_commit_offset - arena->committed_memory;
-
-        u8 *commit_pointer =
-            static_cast<u8 *>(arena->memory) + arena->committed_memory;
-
-        platform_virtual_memory_commit(commit_pointer, commit_size);
-
-        // Poison the newly committed pages — they are not yet in use.
-        // The portion that covers the current allocation will be unpoisoned
-        // below when we unpoison the result pointer.
-        ASAN_POISON_MEMORY_REGION(commit_pointer, commit_size);
-
-        arena->committed_memory = aligned_requested_commit_offset;
-    }
+    if (current->committed_memory < requested_offset)
+        arena_commit(arena, current, requested_offset);
 
     RUNTIME_ASSERT_MSG(
-        arena->committed_memory >= requested_offset,
+        current->committed_memory >= requested_offset,
         "_arena_push - Committed memory does not cover the requested "
         "allocation");
 
-    void *result = static_cast<u8 *>(arena->memory) + current_offset;
+    void *result = static_cast<u8 *>(current->memory) + current_offset;
 
     // Unpoison the region being handed out so ASAN allows access to it
     ASAN_UNPOISON_MEMORY_REGION(result, size);
 
-    arena->offset = requested_offset; // Update offset
+    current->offset    = requested_offset; // Update offset
+    arena->peak_offset = MAX(arena->peak_offset,
+                             current->base_position + requested_offset);
 
     if (should_zero)
         platform_zero_memory(result, size_to_zero);
 
+    allocation_profiler_account(
+        &arena->sample_countdown, Allocation_Source::ARENA, size, file, line);
+
 #ifdef DEBUG_BUILD
     arena_debug_record_push(
         arena,
-        current_offset,
+        current->base_position + current_offset,
         size,
         current_offset - pre_align_offset,
         file,
@@ -167,29 +428,81 @@ arena_pop_to(Arena *arena, u64 position)
     u64 new_position = CLAMP_BOT(ARENA_HEADER_SIZE, position);
 
     RUNTIME_ASSERT_MSG(
-        new_position <= arena->offset,
+        new_position <= arena_position(arena),
         "arena_pop_to - Cannot pop to a positon that is ahead of the current "
         "position");
 
+    // Concurrent pushes leave the peak to the owner
+    arena->peak_offset = MAX(arena->peak_offset, arena_position(arena));
+
+    // Blocks chained past the position are released
+    Arena *current = arena->current;
+
+    while (current->prev && current->base_position >= new_position)
+    {
+        Arena *prev = current->prev;
+
+        arena->total_committed -= current->committed_memory;
+        arena_release_block(current);
+
+        current = prev;
+    }
+
+    arena->current = current;
+
+    u64 new_offset =
+        CLAMP_BOT(ARENA_HEADER_SIZE, new_position - current->base_position);
+
+    if (enum_has_any(arena->flags, Arena_Flags::CONCURRENT))
+        new_offset = ALIGN_UP_POW2(new_offset, ARENA_CONCURRENT_ALIGNMENT);
+
+    // The offset of a block that overflowed concurrently is past its end
+    u64 used_end = MIN(current->offset, current->committed_memory);
+
     // Re-poison the region being freed so ASAN catches use-after-pop accesses
-    if (new_position < arena->offset)
+    if (new_offset < used_end)
     {
-        ASAN_POISON_MEMORY_REGION(static_cast<u8 *>(arena->memory) +
-                                      new_position,
-                                  arena->offset - new_position);
+        ASAN_POISON_MEMORY_REGION(static_cast<u8 *>(current->memory) +
+                                      new_offset,
+                                  used_end - new_offset);
     }
 
 #ifdef DEBUG_BUILD
     arena_debug_record_pop_to(arena, new_position);
 #endif
 
-    arena->offset = new_position;
+    current->offset = new_offset;
+
+    // Committed memory past the retained size is given back to the OS. The
+    // retained part is recycled without a commit, which keeps arenas that are
+    // cleared every frame away from the system calls
+    if (current->committed_memory - new_offset > arena->retain_size)
+    {
+        u64 retained_end = ALIGN_UP(new_offset + arena->retain_size,
+                                    current->commit_granularity);
+
+        if (retained_end < current->committed_memory)
+        {
+            u64 decommit_size = current->committed_memory - retained_end;
+
+            platform_virtual_memory_decommit(
+                static_cast<u8 *>(current->memory) + retained_end,
+                decommit_size);
+
+            current->committed_memory = retained_end;
+            arena->total_committed -= decommit_size;
+
+#ifdef DEBUG_BUILD
+            arena_debug_record_decommit(arena, decommit_size);
+#endif
+        }
+    }
 }
 
 void
 arena_pop(Arena *arena, u64 size)
 {
-    u64 new_position = arena->offset - size;
+    u64 new_position = arena_position(arena) - size;
 
     arena_pop_to(arena, new_position);
 }
@@ -204,7 +517,7 @@ arena_clear(Arena *arena)
 Scratch_Arena
 arena_scratch_begin(Arena *arena)
 {
-    u64 position = arena->offset;
+    u64 position = arena_position(arena);
 
     Scratch_Arena scratch{arena, position};
 
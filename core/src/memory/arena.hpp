@@ -1,18 +1,65 @@
 #pragma once
 
 #include "defines.hpp"
+#include "utils/enum.hpp"
 
 // Conservative number that ensures the Arena header struct can fit inside this
 // size
 constexpr u64 ARENA_HEADER_SIZE = 128;
 
+enum class Arena_Flags : u32
+{
+    NONE = 0,
+
+    // Backed by large pages as it is committed, meant for arenas that grow to
+    // hundreds of megabytes. Commits are rounded to whole large pages. Ignored
+    // when the platform has no large pages
+    LARGE_PAGES = 1 << 0,
+
+    // Asserts once the reservation is full instead of chaining another block,
+    // for users that need all of the memory to be contiguous
+    FIXED = 1 << 1,
+
+    // Pushes can come from several threads at once. The offset is bumped with
+    // an atomic add and only the commits and the chaining take a lock. Pops,
+    // clears and positions are for the owner, once the pushes are done
+    CONCURRENT = 1 << 2,
+};
+
+ENABLE_BITMASK(Arena_Flags)
+
+// An arena is a chain of reserved blocks, each starting with this header. The
+// arena handle is the first block. Positions keep growing across the blocks:
+// a block starts where the reservation of the previous one ends, so popping to
+// a position taken earlier releases the blocks chained after it
 struct Arena
 {
-    u64   committed_memory;
-    u64   reserved_memory;
-    u64   commit_granularity; // How many bytes for each commit
-    u64   offset;
-    void *memory;
+    // Block
+    u64    committed_memory;
+    u64    reserved_memory;
+    u64    commit_granularity; // How many bytes for each commit
+    u64    offset;
+    void  *memory;
+    u64    base_position; // Position of the start of the block
+    Arena *prev;          // Block chained before this one
+
+    // Arena, only kept up to date in the first block
+    Arena *current; // Block the pushes go to
+
+    // Committed bytes kept past the position when popping, the rest is given
+    // back to the OS. A spike does not hold on to its memory afterwards
+    u64 retain_size;
+
+    // Stats
+    u64 total_committed; // Of all the blocks
+    u64 peak_offset;     // Highest position
+    u64 peak_committed;  // Highest total_committed
+
+    Arena_Flags flags; // Only the flags the platform could honor
+    u32         lock;  // Taken to commit and chain in CONCURRENT arenas
+
+    // Bytes pushed until the allocation profiler takes a sample
+    s64 sample_countdown;
 
     // Debug - No need to overkill with ifdef clause to disable this
     const char *allocation_file;
@@ -22,18 +69,31 @@ struct Arena
 STATIC_ASSERT(sizeof(Arena) <= ARENA_HEADER_SIZE,
               "Arena header should be smaller that 128 bytes!");
 
+// Also the size of the blocks chained when the reservation is full. Pushes
+// bigger than a block get a block of their own
 constexpr u64 ARENA_DEFAULT_RESERVE_SIZE = 64 * MiB;
 constexpr u64 ARENA_DEFAULT_COMMIT_SIZE  = 64 * KiB;
+constexpr u64 ARENA_DEFAULT_RETAIN_SIZE  = 4 * MiB;
 
 #define arena_create(...)                                                      \
     _arena_create(__FILE__, __LINE__ , ##__VA_ARGS__)
 Arena *_arena_create(const char *file,
                      s32         line,
                      u64         reserve_size = ARENA_DEFAULT_RESERVE_SIZE,
-                     u64         commit_size  = ARENA_DEFAULT_COMMIT_SIZE);
+                     u64         commit_size  = ARENA_DEFAULT_COMMIT_SIZE,
+                     u64         retain_size  = ARENA_DEFAULT_RETAIN_SIZE,
+                     Arena_Flags flags        = Arena_Flags::NONE);
 
 void arena_release(Arena *arena);
 
+// Position of the next push, what arena_pop_to takes
+FORCE_INLINE u64
+arena_position(Arena *arena)
+{
+    Arena *current = arena->current;
+    return current->base_position + current->offset;
+}
+
 #define push_struct(arena, type)                                               \
     (type *)_arena_push(                                                       \
         (arena), sizeof(type), MAX(8, alignof(type)), true,                    \
@@ -57,7 +117,8 @@ void *_arena_push(
     const char *file,
     s32         line);
 
-// Popping functions
+// Popping functions. Committed memory more than the retain size past the new
+// position is decommitted. CONCURRENT arenas round the position up to 16 bytes
 void arena_pop(Arena *arena, u64 size);
 void arena_pop_to(Arena *arena, u64 position);
 
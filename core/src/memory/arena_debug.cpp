@@ -6,9 +6,39 @@
 #include "core/logger.hpp"
 #include "platform/platform.hpp"
 
+#include <atomic>
+
 internal_var Arena               *debug_arena    = nullptr;
 internal_var Arena_Debug_Registry *debug_registry = nullptr;
 
+// Arenas are created and pushed to from the job workers, every access to the
+// registry and to debug_arena goes through this lock. It is reentrant, the
+// records are grown with pushes to debug_arena while it is held
+internal_var std::atomic<u32>   registry_lock       = 0;
+internal_var THREAD_STATIC u32 registry_lock_depth = 0;
+
+void
+arena_debug_lock()
+{
+    if (registry_lock_depth++ > 0)
+        return;
+
+    while (registry_lock.exchange(1, std::memory_order_acquire))
+    {
+        while (registry_lock.load(std::memory_order_relaxed))
+            platform_thread_yield();
+    }
+}
+
+void
+arena_debug_unlock()
+{
+    if (--registry_lock_depth > 0)
+        return;
+
+    registry_lock.store(0, std::memory_order_release);
+}
+
 void
 arena_debug_init()
 {
@@ -20,11 +50,13 @@ arena_debug_init()
     debug_registry->active_count = 0;
     for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
     {
-        debug_registry->entries[i].arena           = nullptr;
-        debug_registry->entries[i].active          = false;
-        debug_registry->entries[i].records         = nullptr;
-        debug_registry->entries[i].record_count    = 0;
-        debug_registry->entries[i].record_capacity = 0;
+        debug_registry->entries[i].arena              = nullptr;
+        debug_registry->entries[i].active             = false;
+        debug_registry->entries[i].records            = nullptr;
+        debug_registry->entries[i].record_count       = 0;
+        debug_registry->entries[i].record_capacity    = 0;
+        debug_registry->entries[i].decommit_count     = 0;
+        debug_registry->entries[i].decommitted_memory = 0;
     }
 
     CORE_INFO("Arena debug registry initialized");
@@ -37,7 +69,10 @@ arena_debug_shutdown()
     {
         CORE_INFO("Arena debug registry shutdown");
         // Deregister the debug arena itself before releasing
+        arena_debug_lock();
         debug_registry = nullptr;
+        arena_debug_unlock();
+
         arena_release(debug_arena);
         debug_arena = nullptr;
     }
@@ -53,6 +88,8 @@ arena_debug_register(Arena *arena)
     if (arena == (Arena *)debug_arena->memory)
         return;
 
+    arena_debug_lock();
+
     // Find a free slot
     for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
     {
@@ -70,11 +107,18 @@ arena_debug_register(Arena *arena)
             entry->record_count    = 0;
             entry->record_capacity = ARENA_DEBUG_INITIAL_RECORD_CAP;
 
+            entry->decommit_count     = 0;
+            entry->decommitted_memory = 0;
+
             debug_registry->active_count++;
+
+            arena_debug_unlock();
             return;
         }
     }
 
+    arena_debug_unlock();
+
     CORE_WARN("Arena debug registry full (%u arenas tracked). "
               "Increase ARENA_DEBUG_MAX_ARENAS.",
               ARENA_DEBUG_MAX_ARENAS);
@@ -86,6 +130,8 @@ arena_debug_deregister(Arena *arena)
     if (!debug_registry)
         return;
 
+    arena_debug_lock();
+
     for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
     {
         Arena_Debug_Entry *entry = &debug_registry->entries[i];
@@ -100,9 +146,11 @@ arena_debug_deregister(Arena *arena)
             entry->record_capacity = 0;
 
             debug_registry->active_count--;
-            return;
+            break;
         }
     }
+
+    arena_debug_unlock();
 }
 
 void
@@ -117,6 +165,8 @@ arena_debug_record_push(
     if (!debug_registry)
         return;
 
+    arena_debug_lock();
+
     for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
     {
         Arena_Debug_Entry *entry = &debug_registry->entries[i];
@@ -154,9 +204,11 @@ arena_debug_record_push(
             record->line    = line;
 
             entry->record_count++;
-            return;
+            break;
         }
     }
+
+    arena_debug_unlock();
 }
 
 void
@@ -165,6 +217,8 @@ arena_debug_record_pop_to(Arena *arena, u64 new_position)
     if (!debug_registry)
         return;
 
+    arena_debug_lock();
+
     for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
     {
         Arena_Debug_Entry *entry = &debug_registry->entries[i];
@@ -186,9 +240,34 @@ arena_debug_record_pop_to(Arena *arena, u64 new_position)
                     break;
                 }
             }
-            return;
+            break;
         }
     }
+
+    arena_debug_unlock();
+}
+
+void
+arena_debug_record_decommit(Arena *arena, u64 size)
+{
+    if (!debug_registry)
+        return;
+
+    arena_debug_lock();
+
+    for (u32 i = 0; i < ARENA_DEBUG_MAX_ARENAS; ++i)
+    {
+        Arena_Debug_Entry *entry = &debug_registry->entries[i];
+
+        if (entry->active && entry->arena == arena)
+        {
+            entry->decommit_count++;
+            entry->decommitted_memory += size;
+            break;
+        }
+    }
+
+    arena_debug_unlock();
 }
 
 Arena_Debug_Registry *
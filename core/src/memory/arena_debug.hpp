@@ -25,6 +25,10 @@ struct Arena_Debug_Entry
     Arena_Allocation_Record *records;
     u32                      record_count;
     u32                      record_capacity;
+
+    // Memory given back to the OS by the pops past the retain size
+    u64 decommit_count;
+    u64 decommitted_memory;
 };
 
 struct Arena_Debug_Registry
@@ -48,6 +52,14 @@ void arena_debug_record_push(Arena      *arena,
 
 void arena_debug_record_pop_to(Arena *arena, u64 new_position);
 
+void arena_debug_record_decommit(Arena *arena, u64 size);
+
+// The registry is only consistent while the lock is held. Taken by every
+// registry function, and by readers for as long as they look at the entries.
+// Reentrant on the thread holding it
+VOLTRUM_API void arena_debug_lock();
+VOLTRUM_API void arena_debug_unlock();
+
 VOLTRUM_API Arena_Debug_Registry *arena_debug_get_registry();
 
 #endif // DEBUG_BUILD
@@ -1,16 +1,25 @@
 #include "memory.hpp"
 
+#include <atomic>
 #include <stdio.h>
 #include <string.h>
 
+#include "allocation_profiler.hpp"
 #include "core/logger.hpp"
 #include "defines.hpp"
 #include "platform/platform.hpp"
+#include "slab_allocator.hpp"
 #include "utils/string.hpp"
 
+// Updated by every thread that allocates. Each tag has a line of its own, so
+// threads allocating with different tags do not contend on the counters
+struct alignas(64) Memory_Tag_Stats {
+    std::atomic<u64> allocated;
+    std::atomic<u64> allocations_count;
+};
+
 struct Memory_Stats {
-    u64 total_allocated;
-    u64 tagged_allocations[(u64)Memory_Tag::MAX_ENTRIES];
+    Memory_Tag_Stats tagged_allocations[(u64)Memory_Tag::MAX_ENTRIES];
 };
 
 // The memory system collects and stores metrics regarding memory utilization,
@@ -21,11 +30,13 @@ struct Memory_Stats {
 // memory subsystem initialization just to test our methods.
 struct Memory_System_State {
     Memory_Stats stats;
-    u64 allocations_count;
 };
 
 internal_var Memory_System_State state = {};
 
+// Bytes allocated by this thread until the allocation profiler takes a sample
+internal_var THREAD_STATIC s64 sample_countdown = 0;
+
 internal_var const char *memory_tag_strings[(u64)Memory_Tag::MAX_ENTRIES] = {
     "UNKNOWN  	:",
     "ARRAY   	:",
@@ -49,31 +60,35 @@ void memory_init() {}
 
 void memory_shutdown(void *state) {}
 
-void *memory_allocate(u64 size, Memory_Tag tag) {
+void *_memory_allocate(
+    u64 size, Memory_Tag tag, b8 should_zero, const char *file, s32 line) {
     if (tag == Memory_Tag::UNKNOWN) {
         CORE_WARN(
             "The memory is being initialized as UNKNOWN. Please allocated it "
             "with the proper tag");
     }
 
-    state.stats.tagged_allocations[(u64)tag] += size;
-    state.stats.total_allocated += size;
-    state.allocations_count++;
+    Memory_Tag_Stats *stats = &state.stats.tagged_allocations[(u64)tag];
+    stats->allocated.fetch_add(size, std::memory_order_relaxed);
+    stats->allocations_count.fetch_add(1, std::memory_order_relaxed);
 
-    // Every chunk of memory will be set to 0 automatically
-    void *block = platform_allocate(size, true);
+    allocation_profiler_account(
+        &sample_countdown, Allocation_Source::HEAP, size, file, line);
 
-    platform_zero_memory(block, size);
+    // Freed blocks are reused as they are, they are only zeroed when asked
+    void *block = slab_allocate(size);
+
+    if (should_zero)
+        platform_zero_memory(block, size);
 
     return block;
 }
 
 void memory_deallocate(void *block, u64 size, Memory_Tag tag) {
+    Memory_Tag_Stats *stats = &state.stats.tagged_allocations[(u64)tag];
+    stats->allocated.fetch_sub(size, std::memory_order_relaxed);
 
-    state.stats.tagged_allocations[(u64)tag] -= size;
-    state.stats.total_allocated -= size;
-
-    return platform_free(block, true);
+    slab_free(block, size);
 }
 
 void *memory_zero(void *block, u64 size) {
@@ -131,20 +146,22 @@ void memory_get_current_usage(char *out_buf) {
         char usage_unit[4] = "XiB";
         f32 amount = 1.0f;
 
-        if (state.stats.tagged_allocations[i] >= GiB) {
+        u64 allocated = memory_get_tag_usage((Memory_Tag)i);
+
+        if (allocated >= GiB) {
             usage_unit[0] = 'G';
-            amount = (float)state.stats.tagged_allocations[i] / GiB;
-        } else if (state.stats.tagged_allocations[i] >= MiB) {
+            amount = (float)allocated / GiB;
+        } else if (allocated >= MiB) {
             usage_unit[0] = 'M';
-            amount = (float)state.stats.tagged_allocations[i] / MiB;
-        } else if (state.stats.tagged_allocations[i] >= KiB) {
+            amount = (float)allocated / MiB;
+        } else if (allocated >= KiB) {
             usage_unit[0] = 'K';
-            amount = (float)state.stats.tagged_allocations[i] / KiB;
+            amount = (float)allocated / KiB;
         } else {
             usage_unit[0] = 'B';
             usage_unit[1] = 0; // Append a null termination character to
                                // overwrite the end of the string
-            amount = (float)state.stats.tagged_allocations[i];
+            amount = (float)allocated;
         }
 
         // snprintf returns the number of writen characters (aka bytes). It
@@ -169,4 +186,18 @@ void memory_get_current_usage(char *out_buf) {
     memory_copy(out_buf, utilization_buffer, copy_len + 1);
 }
 
-u64 memory_get_allocations_count() { return state.allocations_count; }
+u64 memory_get_allocations_count() {
+    u64 count = 0;
+
+    for (u32 i = 0; i < (u32)Memory_Tag::MAX_ENTRIES; ++i) {
+        count += state.stats.tagged_allocations[i].allocations_count.load(
+            std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+u64 memory_get_tag_usage(Memory_Tag tag) {
+    return state.stats.tagged_allocations[(u64)tag].allocated.load(
+        std::memory_order_relaxed);
+}
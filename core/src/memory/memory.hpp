@@ -27,10 +27,20 @@ void memory_init();
 
 void memory_shutdown();
 
-VOLTRUM_API void *memory_allocate(u64 size, Memory_Tag tag);
+// Blocks up to SLAB_MAX_BLOCK_SIZE come from the slab allocator and are
+// aligned to 16 bytes. The call site is passed along for the allocation
+// profiler
+#define memory_allocate(size, tag)                                             \
+    _memory_allocate((size), (tag), true, __FILE__, __LINE__)
 
-VOLTRUM_API void *memory_allocate(u64 size, Memory_Tag tag);
+// For callers that overwrite the whole block anyway
+#define memory_allocate_no_zero(size, tag)                                     \
+    _memory_allocate((size), (tag), false, __FILE__, __LINE__)
 
+VOLTRUM_API void *_memory_allocate(
+    u64 size, Memory_Tag tag, b8 should_zero, const char *file, s32 line);
+
+// The size and the tag have to be the ones the block was allocated with
 VOLTRUM_API void memory_deallocate(void *block, u64 size, Memory_Tag tag);
 
 VOLTRUM_API void *memory_zero(void *block, u64 size);
@@ -44,3 +54,6 @@ VOLTRUM_API void *memory_set(void *block, s32 value, u64 size);
 VOLTRUM_API void memory_get_current_usage(char *out_buf);
 
 VOLTRUM_API u64 memory_get_allocations_count();
+
+// Bytes currently allocated with the tag
+VOLTRUM_API u64 memory_get_tag_usage(Memory_Tag tag);
@@ -0,0 +1,320 @@
+#include "slab_allocator.hpp"
+
+#include "core/asserts.hpp"
+#include "platform/platform.hpp"
+
+#include <atomic>
+
+struct Slab_Magazine
+{
+    Slab_Magazine *next; // In the lists of the depot
+    u32            count;
+    u32            capacity; // Of the class it is loaded with
+    void          *blocks[SLAB_MAGAZINE_CAPACITY];
+};
+
+STATIC_ASSERT(sizeof(Slab_Magazine) == 512,
+              "Slab magazines should fill 512 bytes");
+
+// Classes are locked on their own, aligned so the locks do not share a line
+struct alignas(64) Slab_Class
+{
+    std::atomic<u32> lock;
+
+    Slab_Magazine *full_magazines; // Not necessarily full, never empty
+
+    // Rest of the chunk the blocks are carved from
+    u8 *chunk;
+    u64 chunk_remaining;
+};
+
+struct Slab_Depot
+{
+    Slab_Class classes[SLAB_SIZE_CLASS_COUNT];
+
+    // Shared by the classes
+    std::atomic<u32> lock;
+    Slab_Magazine   *empty_magazines;
+    u8              *magazine_chunk;
+    u64              magazine_chunk_remaining;
+
+    std::atomic<u64> reserved_memory;
+};
+
+// Two magazines per class: frees refill the loaded one, and once it is full
+// the previous one has to be empty. Allocations and frees alternating around
+// a magazine boundary do not go to the depot every time
+struct Slab_Thread_Cache
+{
+    Slab_Magazine *loaded[SLAB_SIZE_CLASS_COUNT];
+    Slab_Magazine *previous[SLAB_SIZE_CLASS_COUNT];
+};
+
+internal_var Slab_Depot depot = {};
+
+internal_var THREAD_STATIC Slab_Thread_Cache thread_cache = {};
+
+// The depot is only taken when a magazine runs out, a spin is enough
+INTERNAL_FUNC void
+lock_slab(std::atomic<u32> *lock)
+{
+    while (lock->exchange(1, std::memory_order_acquire))
+    {
+        while (lock->load(std::memory_order_relaxed))
+            platform_thread_yield();
+    }
+}
+
+INTERNAL_FUNC void
+unlock_slab(std::atomic<u32> *lock)
+{
+    lock->store(0, std::memory_order_release);
+}
+
+INTERNAL_FUNC u8 *
+slab_reserve_chunk()
+{
+    void *chunk = platform_virtual_memory_reserve(SLAB_CHUNK_SIZE);
+    RUNTIME_ASSERT_MSG(chunk, "slab_reserve_chunk - Unable to reserve memory");
+
+    b8 is_committed = platform_virtual_memory_commit(chunk, SLAB_CHUNK_SIZE);
+    RUNTIME_ASSERT_MSG(is_committed,
+                       "slab_reserve_chunk - Unable to commit memory");
+
+    depot.reserved_memory.fetch_add(SLAB_CHUNK_SIZE,
+                                    std::memory_order_relaxed);
+
+    return (u8 *)chunk;
+}
+
+INTERNAL_FUNC u32
+slab_magazine_capacity(u32 size_class)
+{
+    u64 block_size = SLAB_MIN_BLOCK_SIZE << size_class;
+    u64 capacity   = SLAB_MAGAZINE_BYTES / block_size;
+
+    return (u32)CLAMP(capacity, 4, SLAB_MAGAZINE_CAPACITY);
+}
+
+INTERNAL_FUNC Slab_Magazine *
+slab_take_empty_magazine(u32 size_class)
+{
+    lock_slab(&depot.lock);
+
+    Slab_Magazine *magazine = depot.empty_magazines;
+
+    if (magazine)
+    {
+        depot.empty_magazines = magazine->next;
+    }
+    else
+    {
+        if (depot.magazine_chunk_remaining < sizeof(Slab_Magazine))
+        {
+            depot.magazine_chunk           = slab_reserve_chunk();
+            depot.magazine_chunk_remaining = SLAB_CHUNK_SIZE;
+        }
+
+        magazine = (Slab_Magazine *)depot.magazine_chunk;
+        depot.magazine_chunk += sizeof(Slab_Magazine);
+        depot.magazine_chunk_remaining -= sizeof(Slab_Magazine);
+    }
+
+    unlock_slab(&depot.lock);
+
+    magazine->next     = nullptr;
+    magazine->count    = 0;
+    magazine->capacity = slab_magazine_capacity(size_class);
+
+    return magazine;
+}
+
+INTERNAL_FUNC void
+slab_give_empty_magazine(Slab_Magazine *magazine)
+{
+    lock_slab(&depot.lock);
+
+    magazine->next        = depot.empty_magazines;
+    depot.empty_magazines = magazine;
+
+    unlock_slab(&depot.lock);
+}
+
+INTERNAL_FUNC void
+slab_give_full_magazine(u32 size_class, Slab_Magazine *magazine)
+{
+    Slab_Class *slab_class = &depot.classes[size_class];
+
+    lock_slab(&slab_class->lock);
+
+    magazine->next             = slab_class->full_magazines;
+    slab_class->full_magazines = magazine;
+
+    unlock_slab(&slab_class->lock);
+}
+
+// A magazine of freed blocks, or of new ones carved from the chunk of the
+// class when there are none
+INTERNAL_FUNC Slab_Magazine *
+slab_take_full_magazine(u32 size_class)
+{
+    Slab_Class *slab_class = &depot.classes[size_class];
+
+    lock_slab(&slab_class->lock);
+
+    Slab_Magazine *magazine = slab_class->full_magazines;
+    if (magazine)
+        slab_class->full_magazines = magazine->next;
+
+    unlock_slab(&slab_class->lock);
+
+    if (magazine)
+        return magazine;
+
+    magazine = slab_take_empty_magazine(size_class);
+
+    u64 block_size = SLAB_MIN_BLOCK_SIZE << size_class;
+
+    lock_slab(&slab_class->lock);
+
+    // Stored backwards, so the blocks are handed out by increasing address
+    for (u32 i = magazine->capacity; i > 0; --i)
+    {
+        if (slab_class->chunk_remaining < block_size)
+        {
+            slab_class->chunk           = slab_reserve_chunk();
+            slab_class->chunk_remaining = SLAB_CHUNK_SIZE;
+        }
+
+        magazine->blocks[i - 1] = slab_class->chunk;
+        slab_class->chunk += block_size;
+        slab_class->chunk_remaining -= block_size;
+    }
+
+    magazine->count = magazine->capacity;
+
+    unlock_slab(&slab_class->lock);
+
+    return magazine;
+}
+
+INTERNAL_FUNC FORCE_NOT_INLINE void *
+slab_allocate_slow(u32 size_class)
+{
+    Slab_Magazine **loaded   = &thread_cache.loaded[size_class];
+    Slab_Magazine **previous = &thread_cache.previous[size_class];
+
+    if (*previous && (*previous)->count > 0)
+    {
+        Slab_Magazine *magazine = *previous;
+        *previous               = *loaded;
+        *loaded                 = magazine;
+    }
+    else
+    {
+        // Both are empty, the previous one goes back to the depot
+        if (*previous)
+            slab_give_empty_magazine(*previous);
+
+        *previous = *loaded;
+        *loaded   = slab_take_full_magazine(size_class);
+    }
+
+    Slab_Magazine *magazine = *loaded;
+    return magazine->blocks[--magazine->count];
+}
+
+INTERNAL_FUNC FORCE_NOT_INLINE void
+slab_free_slow(void *block, u32 size_class)
+{
+    Slab_Magazine **loaded   = &thread_cache.loaded[size_class];
+    Slab_Magazine **previous = &thread_cache.previous[size_class];
+
+    if (*previous && (*previous)->count < (*previous)->capacity)
+    {
+        Slab_Magazine *magazine = *previous;
+        *previous               = *loaded;
+        *loaded                 = magazine;
+    }
+    else
+    {
+        // Both are full, the previous one goes back to the depot
+        if (*previous)
+            slab_give_full_magazine(size_class, *previous);
+
+        *previous = *loaded;
+        *loaded   = slab_take_empty_magazine(size_class);
+    }
+
+    Slab_Magazine *magazine             = *loaded;
+    magazine->blocks[magazine->count++] = block;
+}
+
+void *
+slab_allocate(u64 size)
+{
+    if (size > SLAB_MAX_BLOCK_SIZE)
+        return platform_allocate(size, true);
+
+    u32            size_class = slab_size_class(size);
+    Slab_Magazine *magazine   = thread_cache.loaded[size_class];
+
+    if (magazine && magazine->count > 0)
+        return magazine->blocks[--magazine->count];
+
+    return slab_allocate_slow(size_class);
+}
+
+void
+slab_free(void *block, u64 size)
+{
+    if (!block)
+        return;
+
+    if (size > SLAB_MAX_BLOCK_SIZE)
+    {
+        platform_free(block, true);
+        return;
+    }
+
+    u32            size_class = slab_size_class(size);
+    Slab_Magazine *magazine   = thread_cache.loaded[size_class];
+
+    if (magazine && magazine->count < magazine->capacity)
+    {
+        magazine->blocks[magazine->count++] = block;
+        return;
+    }
+
+    slab_free_slow(block, size_class);
+}
+
+void
+slab_release_thread_cache()
+{
+    for (u32 i = 0; i < SLAB_SIZE_CLASS_COUNT; ++i)
+    {
+        Slab_Magazine *magazines[] = {thread_cache.loaded[i],
+                                      thread_cache.previous[i]};
+
+        for (Slab_Magazine *magazine : magazines)
+        {
+            if (!magazine)
+                continue;
+
+            if (magazine->count > 0)
+                slab_give_full_magazine(i, magazine);
+            else
+                slab_give_empty_magazine(magazine);
+        }
+
+        thread_cache.loaded[i]   = nullptr;
+        thread_cache.previous[i] = nullptr;
+    }
+}
+
+u64
+slab_reserved_memory()
+{
+    return depot.reserved_memory.load(std::memory_order_relaxed);
+}
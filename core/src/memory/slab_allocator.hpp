@@ -0,0 +1,52 @@
+#pragma once
+
+#include "defines.hpp"
+
+// Blocks for memory_allocate, in power of two size classes from 16 bytes to
+// 32 KiB. Every thread caches freed blocks in magazines, arrays of blocks of
+// one class, so most allocations and frees take no lock. Threads trade full
+// and empty magazines with a depot, which carves new blocks out of chunks
+// of virtual memory. The memory of the classes is kept for reuse and never
+// given back to the OS. Larger blocks come from the platform
+constexpr u64 SLAB_MIN_BLOCK_SIZE   = 16;
+constexpr u32 SLAB_SIZE_CLASS_COUNT = 12;
+constexpr u64 SLAB_MAX_BLOCK_SIZE   = SLAB_MIN_BLOCK_SIZE
+                                    << (SLAB_SIZE_CLASS_COUNT - 1);
+
+// Reserved at once by the depot, for the blocks of one class
+constexpr u64 SLAB_CHUNK_SIZE = 1 * MiB;
+
+// Most blocks a magazine holds. Magazines of the larger classes hold fewer,
+// about SLAB_MAGAZINE_BYTES worth of blocks
+constexpr u32 SLAB_MAGAZINE_CAPACITY = 62;
+constexpr u64 SLAB_MAGAZINE_BYTES    = 64 * KiB;
+
+// Index of the smallest class that fits the size
+FORCE_INLINE u32
+slab_size_class(u64 size)
+{
+    if (size <= SLAB_MIN_BLOCK_SIZE)
+        return 0;
+
+    // log2 of the size rounded up, counted from the smallest class
+#if _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, size - 1);
+    return (u32)index + 1 - 4;
+#else
+    return 64 - (u32)__builtin_clzll(size - 1) - 4;
+#endif
+}
+
+// Aligned to 16 bytes. The memory is not zeroed
+VOLTRUM_API void *slab_allocate(u64 size);
+
+// The size has to be the one given to slab_allocate
+VOLTRUM_API void slab_free(void *block, u64 size);
+
+// Hands the magazines of the calling thread back to the depot, for threads
+// about to exit
+VOLTRUM_API void slab_release_thread_cache();
+
+// Bytes reserved for the size classes
+VOLTRUM_API u64 slab_reserved_memory();
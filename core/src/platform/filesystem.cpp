@@ -10,8 +10,12 @@
 #    include <io.h>
 #    include <sys/stat.h>
 #    include <sys/types.h>
+#    include <windows.h>
 #else
+#    include <fcntl.h>
+#    include <sys/mman.h>
 #    include <sys/stat.h>
+#    include <unistd.h>
 #endif
 
 // TODO: 	Refactor this to not use the standart library but instead the
@@ -205,3 +209,127 @@ b8 filesystem_write(File_Handle *handle,
     }
     return false;
 }
+
+#ifdef PLATFORM_WINDOWS
+b8 filesystem_map(const char *path, File_Mapping *out_mapping) {
+    out_mapping->data = nullptr;
+    out_mapping->size = 0;
+    out_mapping->handle = nullptr;
+
+    HANDLE file = CreateFileA(path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        CORE_ERROR("Error while opening file for mapping: '%s'", path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CORE_ERROR("Error while reading the size of file: '%s'", path);
+        CloseHandle(file);
+        return false;
+    }
+
+    out_mapping->size = (u64)size.QuadPart;
+
+    // Empty files cannot be mapped, they are reported as a valid empty view
+    if (out_mapping->size == 0) {
+        CloseHandle(file);
+        return true;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    // The mapping keeps the file alive on its own
+    CloseHandle(file);
+
+    if (!mapping) {
+        CORE_ERROR("Error while mapping file: '%s'", path);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CORE_ERROR("Error while mapping a view of file: '%s'", path);
+        CloseHandle(mapping);
+        return false;
+    }
+
+    out_mapping->data = (const u8 *)view;
+    out_mapping->handle = mapping;
+
+    return true;
+}
+
+void filesystem_unmap(File_Mapping *mapping) {
+    if (mapping->data) {
+        UnmapViewOfFile(mapping->data);
+        CloseHandle((HANDLE)mapping->handle);
+    }
+
+    mapping->data = nullptr;
+    mapping->size = 0;
+    mapping->handle = nullptr;
+}
+#else
+b8 filesystem_map(const char *path, File_Mapping *out_mapping) {
+    out_mapping->data = nullptr;
+    out_mapping->size = 0;
+    out_mapping->handle = nullptr;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        CORE_ERROR("Error while opening file for mapping: '%s'", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        CORE_ERROR("Error while reading the size of file: '%s'", path);
+        close(fd);
+        return false;
+    }
+
+    out_mapping->size = (u64)info.st_size;
+
+    // Empty files cannot be mapped, they are reported as a valid empty view
+    if (out_mapping->size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void *view =
+        mmap(nullptr, out_mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file alive on its own
+    close(fd);
+
+    if (view == MAP_FAILED) {
+        CORE_ERROR("Error while mapping file: '%s'", path);
+        return false;
+    }
+
+    madvise(view, out_mapping->size, MADV_SEQUENTIAL);
+
+    out_mapping->data = (const u8 *)view;
+
+    return true;
+}
+
+void filesystem_unmap(File_Mapping *mapping) {
+    if (mapping->data) {
+        munmap((void *)mapping->data, mapping->size);
+    }
+
+    mapping->data = nullptr;
+    mapping->size = 0;
+    mapping->handle = nullptr;
+}
+#endif
@@ -8,6 +8,15 @@ struct File_Handle {
     b8 is_valid;  // Used to check externally whether the file handle is valid
 };
 
+// Read-only view of a whole file. Pages are loaded by the OS as they are
+// touched and can be evicted again, so large files cost no resident memory up
+// front
+struct File_Mapping {
+    const u8 *data;
+    u64 size;
+    void *handle; // Platform mapping object, unused on posix
+};
+
 enum class File_Modes : u8 { READ = 1 << 0, WRITE = 1 << 1 };
 
 ENABLE_BITMASK(File_Modes)
@@ -56,3 +65,9 @@ VOLTRUM_API b8 filesystem_write(File_Handle *handle,
     u64 data_size,
     const void *data,
     u64 *out_bytes_written);
+
+// Maps the file for reading. The access hint tells the OS that the mapping is
+// mostly read front to back
+VOLTRUM_API b8 filesystem_map(const char *path, File_Mapping *out_mapping);
+
+VOLTRUM_API void filesystem_unmap(File_Mapping *mapping);
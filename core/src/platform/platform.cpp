@@ -174,8 +174,11 @@ platform_message_pump(Frame_Context *frame_ctx)
 
     b8 quit_flagged = false;
 
+    frame_ctx->platform_event_count = 0;
+
     while (SDL_PollEvent(&sdl_event))
     {
+        frame_ctx->platform_event_count++;
 
         SDL_Keymod    sdl_mods  = SDL_GetModState();
         Key_Modifiers modifiers = Key_Modifiers::NONE;
@@ -389,6 +392,34 @@ platform_sleep(u64 ms)
     SDL_Delay((u32)ms);
 }
 
+void
+platform_sleep_ns(u64 ns)
+{
+    SDL_DelayNS(ns);
+}
+
+b8
+platform_wait_for_events(f64 timeout)
+{
+    // Rounded up, so that the wait is never shorter than asked
+    s32 timeout_ms = (s32)(timeout * 1000.0 + 0.999);
+    return SDL_WaitEventTimeout(nullptr, timeout_ms);
+}
+
+f64
+platform_get_display_refresh_rate(Platform_State *state)
+{
+    if (!state || !state->window)
+        return 0.0;
+
+    SDL_DisplayID display = SDL_GetDisplayForWindow(state->window);
+    if (!display)
+        return 0.0;
+
+    const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(display);
+    return mode ? (f64)mode->refresh_rate : 0.0;
+}
+
 void
 platform_get_drawable_size(u32 *width, u32 *height)
 {
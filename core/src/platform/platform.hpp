@@ -33,6 +33,19 @@ struct Platform_System_Info
     const char *machine_name;
 };
 
+// Entry point of threads spawned through platform_thread_create
+typedef u32 (*PFN_thread_entry)(void *data);
+
+struct Platform_Thread
+{
+    void *handle;
+};
+
+struct Platform_Semaphore
+{
+    void *handle;
+};
+
 struct Platform_Process_Info
 {
     u32         pid;
@@ -63,11 +76,46 @@ void  platform_virtual_memory_release(void *block, u64 size);
 b8    platform_virtual_memory_commit(void *block, u64 size);
 void  platform_virtual_memory_decommit(void *block, u64 size);
 
+// Reserves a range aligned to the large page size, which the OS backs with
+// large pages as it is committed. The size has to be a multiple of the large
+// page size. nullptr when large pages are not available
+void *platform_virtual_memory_reserve_large(u64 size);
+
 Platform_System_Info platform_query_system_info();
 f64                  platform_get_absolute_time();
 void                 platform_sleep(u64 ms);
+void                 platform_sleep_ns(u64 ns);
+
+// Blocks until an event is pending or the timeout in seconds expires, leaving
+// the event to the next message pump. Returns whether an event is pending
+b8 platform_wait_for_events(f64 timeout);
+
+// Refresh rate of the display showing the window in Hz, zero when unknown
+f64 platform_get_display_refresh_rate(Platform_State *state);
+
 void                 platform_get_drawable_size(u32 *width, u32 *height);
 
+// Threads and synchronization primitives, implemented per OS
+b8   platform_thread_create(PFN_thread_entry entry,
+                            void            *data,
+                            Platform_Thread *out_thread);
+void platform_thread_join(Platform_Thread *thread);
+void platform_thread_set_name(const char *name); // Names the calling thread
+void platform_thread_yield();
+
+b8   platform_semaphore_create(u32                 initial_count,
+                               Platform_Semaphore *out_semaphore);
+void platform_semaphore_destroy(Platform_Semaphore *semaphore);
+void platform_semaphore_signal(Platform_Semaphore *semaphore, u32 count);
+void platform_semaphore_wait(Platform_Semaphore *semaphore);
+
+// Return addresses of the calling stack, innermost first. Returns how many
+// were written, 0 where stacks can not be captured
+u32 platform_capture_stack(void **out_frames, u32 max_frame_count);
+
+// Name of the function holding the address, false when it has no symbol
+b8 platform_symbolize_address(void *address, char *out_name, u64 size);
+
 // Window control functions
 VOLTRUM_API void platform_minimize_window(Platform_State *state);
 VOLTRUM_API void platform_maximize_window(Platform_State *state);
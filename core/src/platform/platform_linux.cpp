@@ -3,6 +3,14 @@
 #ifdef PLATFORM_LINUX
 
 #    include "platform.hpp"
+#    include <dlfcn.h>
+#    include <errno.h>
+#    include <execinfo.h>
+#    include <pthread.h>
+#    include <sched.h>
+#    include <semaphore.h>
+#    include <stdio.h>
+#    include <string.h>
 #    include <sys/mman.h>
 #    include <unistd.h>
 
@@ -46,16 +54,241 @@ platform_virtual_memory_decommit(void *block, u64 size)
     }
 }
 
+void *
+platform_virtual_memory_reserve_large(u64 size)
+{
+    u64 large_page_size = platform_query_system_info().large_page_size;
+    if (large_page_size == 0)
+    {
+        return nullptr;
+    }
+
+    // mmap only aligns to small pages. One large page more is reserved and
+    // the unaligned ends are given back
+    u64  padded_size = size + large_page_size;
+    auto block =
+        mmap(NULL, padded_size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (block == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    u64 aligned_address = ALIGN_UP_POW2((u64)block, large_page_size);
+    u8 *aligned         = (u8 *)aligned_address;
+    u64 head_size       = aligned - (u8 *)block;
+    u64 tail_size       = padded_size - head_size - size;
+
+    if (head_size > 0)
+    {
+        munmap(block, head_size);
+    }
+
+    if (tail_size > 0)
+    {
+        munmap(aligned + size, tail_size);
+    }
+
+    // Transparent huge pages, the range is backed by them as it is touched
+    if (madvise(aligned, size, MADV_HUGEPAGE) != 0)
+    {
+        munmap(aligned, size);
+        return nullptr;
+    }
+
+    return aligned;
+}
+
+// Size of the transparent huge pages, 0 when they are disabled
+INTERNAL_FUNC u64
+linux_query_large_page_size()
+{
+    char  mode[128] = "";
+    FILE *enabled = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    b8 has_mode = fgets(mode, sizeof(mode), enabled) != nullptr;
+    fclose(enabled);
+
+    if (!has_mode || strstr(mode, "[never]"))
+    {
+        return 0;
+    }
+
+    unsigned long long size = 0;
+    FILE *page_size =
+        fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+
+    if (page_size)
+    {
+        if (fscanf(page_size, "%llu", &size) != 1)
+        {
+            size = 0;
+        }
+
+        fclose(page_size);
+    }
+
+    return (u64)size;
+}
+
 Platform_System_Info
 platform_query_system_info()
 {
+    // The large page size does not change while running, the files are only
+    // read once
+    local_persist u64 large_page_size = linux_query_large_page_size();
+
     Platform_System_Info info = {};
     info.logical_processor_count = (u32)sysconf(_SC_NPROCESSORS_ONLN);
     info.page_size               = (u64)sysconf(_SC_PAGESIZE);
-    info.large_page_size         = 0;
+    info.large_page_size         = large_page_size;
     info.allocation_granularity  = info.page_size;
 
     return info;
 }
 
+// Threads are started through a trampoline, since pthreads expect a different
+// entry signature. The start info is freed by the new thread
+struct Posix_Thread_Start
+{
+    PFN_thread_entry entry;
+    void            *data;
+};
+
+INTERNAL_FUNC void *
+posix_thread_trampoline(void *start_ptr)
+{
+    Posix_Thread_Start start = *(Posix_Thread_Start *)start_ptr;
+    platform_free(start_ptr, false);
+
+    start.entry(start.data);
+
+    return nullptr;
+}
+
+b8
+platform_thread_create(PFN_thread_entry entry,
+                       void            *data,
+                       Platform_Thread *out_thread)
+{
+    STATIC_ASSERT(sizeof(pthread_t) <= sizeof(void *),
+                  "pthread_t should fit in the thread handle");
+
+    auto *start = (Posix_Thread_Start *)platform_allocate(
+        sizeof(Posix_Thread_Start), false);
+    start->entry = entry;
+    start->data  = data;
+
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, posix_thread_trampoline, start) != 0)
+    {
+        platform_free(start, false);
+        return false;
+    }
+
+    out_thread->handle = nullptr;
+    memcpy(&out_thread->handle, &thread, sizeof(pthread_t));
+
+    return true;
+}
+
+void
+platform_thread_join(Platform_Thread *thread)
+{
+    pthread_t handle;
+    memcpy(&handle, &thread->handle, sizeof(pthread_t));
+
+    pthread_join(handle, nullptr);
+    thread->handle = nullptr;
+}
+
+void
+platform_thread_yield()
+{
+    sched_yield();
+}
+
+void
+platform_thread_set_name(const char *name)
+{
+    // Linux limits thread names to 15 characters plus the terminator
+    char truncated[16];
+    strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = 0;
+
+    pthread_setname_np(pthread_self(), truncated);
+}
+
+b8
+platform_semaphore_create(u32 initial_count, Platform_Semaphore *out_semaphore)
+{
+    auto *semaphore = (sem_t *)platform_allocate(sizeof(sem_t), false);
+
+    if (sem_init(semaphore, 0, initial_count) != 0)
+    {
+        platform_free(semaphore, false);
+        return false;
+    }
+
+    out_semaphore->handle = semaphore;
+
+    return true;
+}
+
+void
+platform_semaphore_destroy(Platform_Semaphore *semaphore)
+{
+    if (semaphore->handle)
+    {
+        sem_destroy((sem_t *)semaphore->handle);
+        platform_free(semaphore->handle, false);
+        semaphore->handle = nullptr;
+    }
+}
+
+void
+platform_semaphore_signal(Platform_Semaphore *semaphore, u32 count)
+{
+    for (u32 i = 0; i < count; ++i)
+        sem_post((sem_t *)semaphore->handle);
+}
+
+void
+platform_semaphore_wait(Platform_Semaphore *semaphore)
+{
+    // Retry when interrupted by a signal handler
+    while (sem_wait((sem_t *)semaphore->handle) != 0 && errno == EINTR)
+    {
+    }
+}
+
+u32
+platform_capture_stack(void **out_frames, u32 max_frame_count)
+{
+    s32 frame_count = backtrace(out_frames, (s32)max_frame_count);
+
+    return frame_count > 0 ? (u32)frame_count : 0;
+}
+
+b8
+platform_symbolize_address(void *address, char *out_name, u64 size)
+{
+    Dl_info info;
+
+    if (!dladdr(address, &info) || !info.dli_sname)
+        return false;
+
+    snprintf(out_name,
+             size,
+             "%s+0x%llx",
+             info.dli_sname,
+             (unsigned long long)((u8 *)address - (u8 *)info.dli_saddr));
+
+    return true;
+}
+
 #endif
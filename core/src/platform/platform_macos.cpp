@@ -3,6 +3,13 @@
 #ifdef PLATFORM_APPLE
 
 #    include "platform.hpp"
+#    include <dispatch/dispatch.h>
+#    include <dlfcn.h>
+#    include <execinfo.h>
+#    include <pthread.h>
+#    include <sched.h>
+#    include <stdio.h>
+#    include <string.h>
 #    include <sys/mman.h>
 #    include <unistd.h>
 
@@ -46,6 +53,15 @@ platform_virtual_memory_decommit(void *block, u64 size)
     }
 }
 
+void *
+platform_virtual_memory_reserve_large(u64 size)
+{
+    // Superpages can only be requested when the memory is mapped, which does
+    // not fit reserving first and committing later
+    (void)size;
+    return nullptr;
+}
+
 Platform_System_Info
 platform_query_system_info()
 {
@@ -58,4 +74,135 @@ platform_query_system_info()
     return info;
 }
 
+// Threads are started through a trampoline, since pthreads expect a different
+// entry signature. The start info is freed by the new thread
+struct Posix_Thread_Start
+{
+    PFN_thread_entry entry;
+    void            *data;
+};
+
+INTERNAL_FUNC void *
+posix_thread_trampoline(void *start_ptr)
+{
+    Posix_Thread_Start start = *(Posix_Thread_Start *)start_ptr;
+    platform_free(start_ptr, false);
+
+    start.entry(start.data);
+
+    return nullptr;
+}
+
+b8
+platform_thread_create(PFN_thread_entry entry,
+                       void            *data,
+                       Platform_Thread *out_thread)
+{
+    STATIC_ASSERT(sizeof(pthread_t) <= sizeof(void *),
+                  "pthread_t should fit in the thread handle");
+
+    auto *start = (Posix_Thread_Start *)platform_allocate(
+        sizeof(Posix_Thread_Start), false);
+    start->entry = entry;
+    start->data  = data;
+
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, posix_thread_trampoline, start) != 0)
+    {
+        platform_free(start, false);
+        return false;
+    }
+
+    out_thread->handle = nullptr;
+    memcpy(&out_thread->handle, &thread, sizeof(pthread_t));
+
+    return true;
+}
+
+void
+platform_thread_join(Platform_Thread *thread)
+{
+    pthread_t handle;
+    memcpy(&handle, &thread->handle, sizeof(pthread_t));
+
+    pthread_join(handle, nullptr);
+    thread->handle = nullptr;
+}
+
+void
+platform_thread_yield()
+{
+    sched_yield();
+}
+
+void
+platform_thread_set_name(const char *name)
+{
+    // On macOS only the calling thread can be named
+    pthread_setname_np(name);
+}
+
+// Unnamed POSIX semaphores are not supported on macOS, dispatch semaphores are
+// used instead
+b8
+platform_semaphore_create(u32 initial_count, Platform_Semaphore *out_semaphore)
+{
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(initial_count);
+    if (!semaphore)
+        return false;
+
+    out_semaphore->handle = (void *)semaphore;
+
+    return true;
+}
+
+void
+platform_semaphore_destroy(Platform_Semaphore *semaphore)
+{
+    if (semaphore->handle)
+    {
+        dispatch_release((dispatch_semaphore_t)semaphore->handle);
+        semaphore->handle = nullptr;
+    }
+}
+
+void
+platform_semaphore_signal(Platform_Semaphore *semaphore, u32 count)
+{
+    for (u32 i = 0; i < count; ++i)
+        dispatch_semaphore_signal((dispatch_semaphore_t)semaphore->handle);
+}
+
+void
+platform_semaphore_wait(Platform_Semaphore *semaphore)
+{
+    dispatch_semaphore_wait((dispatch_semaphore_t)semaphore->handle,
+                            DISPATCH_TIME_FOREVER);
+}
+
+u32
+platform_capture_stack(void **out_frames, u32 max_frame_count)
+{
+    s32 frame_count = backtrace(out_frames, (s32)max_frame_count);
+
+    return frame_count > 0 ? (u32)frame_count : 0;
+}
+
+b8
+platform_symbolize_address(void *address, char *out_name, u64 size)
+{
+    Dl_info info;
+
+    if (!dladdr(address, &info) || !info.dli_sname)
+        return false;
+
+    snprintf(out_name,
+             size,
+             "%s+0x%llx",
+             info.dli_sname,
+             (unsigned long long)((u8 *)address - (u8 *)info.dli_saddr));
+
+    return true;
+}
+
 #endif
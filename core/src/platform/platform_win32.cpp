@@ -67,6 +67,14 @@ platform_virtual_memory_decommit(void *block, u64 size) {
     VirtualFree(block, size, MEM_DECOMMIT);
 }
 
+void *
+platform_virtual_memory_reserve_large(u64 size) {
+    // MEM_LARGE_PAGES has to reserve and commit at once and needs the lock
+    // pages privilege, which does not fit reserving first and committing later
+    (void)size;
+    return nullptr;
+}
+
 Platform_System_Info
 platform_query_system_info() {
 
@@ -82,4 +90,116 @@ platform_query_system_info() {
     return system_info;
 }
 
+// Threads are started through a trampoline, since Win32 expects a different
+// entry signature. The start info is freed by the new thread
+struct W32_Thread_Start {
+    PFN_thread_entry entry;
+    void *data;
+};
+
+INTERNAL_FUNC DWORD WINAPI
+w32_thread_trampoline(LPVOID start_ptr) {
+    W32_Thread_Start start = *(W32_Thread_Start *)start_ptr;
+    platform_free(start_ptr, false);
+
+    return (DWORD)start.entry(start.data);
+}
+
+b8
+platform_thread_create(PFN_thread_entry entry,
+    void *data,
+    Platform_Thread *out_thread) {
+    auto *start = (W32_Thread_Start *)platform_allocate(
+        sizeof(W32_Thread_Start), false);
+    start->entry = entry;
+    start->data = data;
+
+    HANDLE thread =
+        CreateThread(NULL, 0, w32_thread_trampoline, start, 0, NULL);
+
+    if (!thread) {
+        platform_free(start, false);
+        return false;
+    }
+
+    out_thread->handle = thread;
+
+    return true;
+}
+
+void
+platform_thread_join(Platform_Thread *thread) {
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+    thread->handle = nullptr;
+}
+
+void
+platform_thread_set_name(const char *name) {
+    // SetThreadDescription is only available since Windows 10 1607, so it is
+    // loaded at runtime
+    if (!w32_SetThreadDescription_func) {
+        HMODULE kernel = GetModuleHandleA("kernel32.dll");
+        w32_SetThreadDescription_func =
+            (W32_SetThreadDescription_Type *)GetProcAddress(kernel,
+                "SetThreadDescription");
+    }
+
+    if (w32_SetThreadDescription_func) {
+        WCHAR wide_name[64];
+        MultiByteToWideChar(CP_UTF8, 0, name, -1, wide_name, 64);
+        wide_name[63] = 0;
+        w32_SetThreadDescription_func(GetCurrentThread(), wide_name);
+    }
+}
+
+void
+platform_thread_yield() {
+    SwitchToThread();
+}
+
+b8
+platform_semaphore_create(u32 initial_count,
+    Platform_Semaphore *out_semaphore) {
+    HANDLE semaphore = CreateSemaphoreA(NULL, initial_count, LONG_MAX, NULL);
+    if (!semaphore)
+        return false;
+
+    out_semaphore->handle = semaphore;
+
+    return true;
+}
+
+void
+platform_semaphore_destroy(Platform_Semaphore *semaphore) {
+    if (semaphore->handle) {
+        CloseHandle((HANDLE)semaphore->handle);
+        semaphore->handle = nullptr;
+    }
+}
+
+void
+platform_semaphore_signal(Platform_Semaphore *semaphore, u32 count) {
+    ReleaseSemaphore((HANDLE)semaphore->handle, (LONG)count, NULL);
+}
+
+void
+platform_semaphore_wait(Platform_Semaphore *semaphore) {
+    WaitForSingleObject((HANDLE)semaphore->handle, INFINITE);
+}
+
+u32
+platform_capture_stack(void **out_frames, u32 max_frame_count) {
+    return RtlCaptureStackBackTrace(0, max_frame_count, out_frames, nullptr);
+}
+
+b8
+platform_symbolize_address(void *address, char *out_name, u64 size) {
+    // Symbols need dbghelp and the pdb, the addresses are resolved offline
+    (void)address;
+    (void)out_name;
+    (void)size;
+    return false;
+}
+
 #endif
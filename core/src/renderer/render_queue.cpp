@@ -0,0 +1,98 @@
+#include "renderer/render_queue.hpp"
+
+#include "core/asserts.hpp"
+#include "memory/arena.hpp"
+#include "memory/memory.hpp"
+#include "utils/radix_sort.hpp"
+
+constexpr u64 RENDER_QUEUE_BATCH_MASK = ~(u64)0 << RENDER_QUEUE_DEPTH_BITS;
+
+// Maps the float onto an unsigned integer with the same order
+INTERNAL_FUNC u32
+sortable_depth(f32 value)
+{
+    u32 bits;
+    memory_copy(&bits, &value, sizeof(bits));
+
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+VOLTRUM_API u64
+render_queue_make_key(u32 pipeline, u32 material, u32 geometry, f32 view_depth)
+{
+    RUNTIME_ASSERT_MSG(pipeline < (1u << RENDER_QUEUE_PIPELINE_BITS) &&
+                           material < (1u << RENDER_QUEUE_MATERIAL_BITS) &&
+                           geometry < (1u << RENDER_QUEUE_GEOMETRY_BITS),
+                       "render_queue_make_key - Id out of the key range");
+
+    // Closer draws come first so that the depth test rejects what they cover
+    return ((u64)pipeline << RENDER_QUEUE_PIPELINE_SHIFT) |
+           ((u64)material << RENDER_QUEUE_MATERIAL_SHIFT) |
+           ((u64)geometry << RENDER_QUEUE_GEOMETRY_SHIFT) |
+           sortable_depth(-view_depth);
+}
+
+VOLTRUM_API void
+render_queue_build(Arena                      *arena,
+                   const Geometry_Render_Data *draws,
+                   u32                         draw_count,
+                   mat4                        view,
+                   Render_Queue               *out_queue)
+{
+    *out_queue = {};
+
+    u64 *keys    = push_array(arena, u64, draw_count);
+    u32 *indices = push_array(arena, u32, draw_count);
+    u32  count   = 0;
+
+    const f32 *v = view.elements;
+
+    for (u32 i = 0; i < draw_count; ++i)
+    {
+        Geometry *geometry = draws[i].geometry;
+        if (!geometry || geometry->internal_id == INVALID_ID)
+            continue;
+
+        u32 material = geometry->material &&
+                               geometry->material->internal_id != INVALID_ID
+                           ? geometry->material->internal_id
+                           : RENDER_QUEUE_DEFAULT_MATERIAL;
+
+        // Row vectors, the origin of the model lands on its translation row
+        const f32 *m          = draws[i].model.elements;
+        f32        view_depth = m[12] * v[2] + m[13] * v[6] + m[14] * v[10] +
+                         v[14];
+
+        // Only the material pipeline draws geometries for now
+        keys[count]    = render_queue_make_key(0,
+                                            material,
+                                            geometry->internal_id,
+                                            view_depth);
+        indices[count] = i;
+        count++;
+    }
+
+    radix_sort_u64(arena, keys, indices, count);
+
+    out_queue->batches    = push_array(arena, Render_Batch, count);
+    out_queue->transforms = push_array(arena, mat4, count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        const Geometry_Render_Data *draw = &draws[indices[i]];
+
+        if (i == 0 || (keys[i] & RENDER_QUEUE_BATCH_MASK) !=
+                          (keys[i - 1] & RENDER_QUEUE_BATCH_MASK))
+        {
+            Render_Batch *batch   = &out_queue->batches[out_queue->batch_count];
+            batch->geometry       = draw->geometry;
+            batch->first_instance = i;
+            out_queue->batch_count++;
+        }
+
+        out_queue->batches[out_queue->batch_count - 1].instance_count++;
+        out_queue->transforms[i] = draw->model;
+    }
+
+    out_queue->instance_count = count;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "defines.hpp"
+#include "math/math_types.hpp"
+#include "renderer/renderer_types.hpp"
+
+struct Arena;
+
+// Sort keys order the draws by pipeline, then material, then geometry buffer
+// range, then depth front to back, so that each state is bound once and the
+// draws of a geometry become consecutive instances
+constexpr u32 RENDER_QUEUE_PIPELINE_BITS = 4;
+constexpr u32 RENDER_QUEUE_MATERIAL_BITS = 12;
+constexpr u32 RENDER_QUEUE_GEOMETRY_BITS = 16;
+constexpr u32 RENDER_QUEUE_DEPTH_BITS    = 32;
+
+constexpr u32 RENDER_QUEUE_GEOMETRY_SHIFT = RENDER_QUEUE_DEPTH_BITS;
+constexpr u32 RENDER_QUEUE_MATERIAL_SHIFT =
+    RENDER_QUEUE_GEOMETRY_SHIFT + RENDER_QUEUE_GEOMETRY_BITS;
+constexpr u32 RENDER_QUEUE_PIPELINE_SHIFT =
+    RENDER_QUEUE_MATERIAL_SHIFT + RENDER_QUEUE_MATERIAL_BITS;
+
+// Key of the geometries without a material, drawn with the default one
+constexpr u32 RENDER_QUEUE_DEFAULT_MATERIAL =
+    (1 << RENDER_QUEUE_MATERIAL_BITS) - 1;
+
+// Draws with the same pipeline, material and geometry, issued as one
+// instanced draw
+struct Render_Batch
+{
+    Geometry *geometry;
+    u32       first_instance; // Into the transforms of the queue
+    u32       instance_count;
+};
+
+struct Render_Queue
+{
+    Render_Batch *batches;
+    u32           batch_count;
+
+    mat4 *transforms; // Model matrices of every batch, in batch order
+    u32   instance_count;
+};
+
+VOLTRUM_API u64 render_queue_make_key(u32 pipeline,
+                                      u32 material,
+                                      u32 geometry,
+                                      f32 view_depth);
+
+// Builds the sorted batches of the draws in the arena. Draws without an
+// uploaded geometry are left out. view_depth is the view space z of the
+// origin of each model, larger is closer to the camera
+VOLTRUM_API void render_queue_build(Arena                      *arena,
+                                    const Geometry_Render_Data *draws,
+                                    u32                         draw_count,
+                                    mat4                        view,
+                                    Render_Queue               *out_queue);
@@ -23,6 +23,9 @@ renderer_backend_initialize(Renderer_Backend_Type type,
         out_backend->update_global_viewport_state =
             vulkan_update_global_viewport_state;
         out_backend->draw_geometry            = vulkan_draw_geometry;
+        out_backend->draw_geometry_instanced  = vulkan_draw_geometry_instanced;
+        out_backend->get_bind_stats           = vulkan_get_bind_stats;
+        out_backend->is_present_paced         = vulkan_is_present_paced;
         out_backend->draw_grid                = vulkan_draw_grid;
         out_backend->draw_ui                  = vulkan_draw_ui;
         out_backend->set_viewport_clear_color = vulkan_set_viewport_clear_color;
@@ -30,14 +33,17 @@ renderer_backend_initialize(Renderer_Backend_Type type,
         out_backend->start_renderpass  = vulkan_renderpass_start;
         out_backend->finish_renderpass = vulkan_renderpass_finish;
 
-        out_backend->create_texture  = vulkan_create_texture;
-        out_backend->destroy_texture = vulkan_destroy_texture;
+        out_backend->supports_texture_format = vulkan_supports_texture_format;
+        out_backend->create_texture          = vulkan_create_texture;
+        out_backend->destroy_texture         = vulkan_destroy_texture;
 
         out_backend->create_material  = vulkan_create_material;
         out_backend->destroy_material = vulkan_destroy_material;
 
         out_backend->create_geometry  = vulkan_create_geometry;
         out_backend->destroy_geometry = vulkan_destroy_geometry;
+        out_backend->get_geometry_buffer_stats =
+            vulkan_get_geometry_buffer_stats;
 
         // Viewport management
         out_backend->render_viewport       = vulkan_render_viewport;
@@ -5,6 +5,7 @@
 #include "defines.hpp"
 #include "math/math.hpp"
 #include "math/math_types.hpp"
+#include "renderer/render_queue.hpp"
 #include "renderer/renderer_backend.hpp"
 #include "renderer/renderer_types.hpp"
 #include "renderer/vulkan/vulkan_types.hpp"
@@ -22,10 +23,49 @@ struct Renderer_System_State
 
     vec4 grid_color;
     f32  grid_spacing;
+    vec4 clear_color;
+
+    // Bumped by every change to what the viewport shows, frames drawn with
+    // the same generation would be identical
+    u64 scene_generation;
+
+    Renderer_Draw_Stats draw_stats;
 };
 
 internal_var Renderer_System_State *state_ptr;
 
+INTERNAL_FUNC b8
+floats_equal(const f32 *a, const f32 *b, u32 count)
+{
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+// Sorts the draws into batches so that each pipeline, material and geometry
+// is bound once and each geometry is drawn once with all of its instances
+INTERNAL_FUNC void
+draw_geometries(Arena *arena, Geometry_Render_Data *draws, u32 count)
+{
+    Render_Queue queue;
+    render_queue_build(arena, draws, count, state_ptr->view, &queue);
+
+    for (u32 i = 0; i < queue.batch_count; ++i)
+    {
+        Render_Batch *batch = &queue.batches[i];
+        state_ptr->backend.draw_geometry_instanced(
+            batch->geometry,
+            batch->instance_count,
+            queue.transforms + batch->first_instance);
+    }
+
+    state_ptr->draw_stats.geometry_count  = count;
+    state_ptr->draw_stats.draw_call_count = queue.batch_count;
+}
+
 Renderer_System_State *
 renderer_init(Arena          *allocator,
               Platform_State *platform,
@@ -57,6 +97,9 @@ renderer_init(Arena          *allocator,
     state->grid_color   = vec4{0.5f, 0.5f, 0.5f, 0.7f};
     state->grid_spacing = 1.0f;
 
+    // No color can match it, so the first one set reaches the backend
+    state->clear_color = vec4{-1.0f, -1.0f, -1.0f, -1.0f};
+
     state_ptr = state;
 
     CORE_DEBUG("Renderer subsystem initialized");
@@ -70,6 +113,7 @@ void
 renderer_on_resize(u16 width, u16 height)
 {
     state_ptr->backend.resized(width, height);
+    state_ptr->scene_generation++;
 }
 
 b8
@@ -99,12 +143,10 @@ renderer_draw_frame(Frame_Context *frame_ctx, Render_Context *render_ctx)
                                                         vec4_one(),
                                                         0);
 
-        // Draw geometries
-        u32 count = render_ctx->geometry_count;
-        for (u32 i = 0; i < count; ++i)
-        {
-            state_ptr->backend.draw_geometry(render_ctx->geometries[i]);
-        }
+        // Draw geometries, one instanced draw per geometry
+        draw_geometries(frame_ctx->frame_arena,
+                        render_ctx->geometries,
+                        render_ctx->geometry_count);
 
         if (!state_ptr->backend.finish_renderpass(frame_ctx,
                                                   Renderpass_Type::VIEWPORT))
@@ -114,6 +156,9 @@ renderer_draw_frame(Frame_Context *frame_ctx, Render_Context *render_ctx)
                 "Appplication shutting down...");
         }
 
+        // The binds are counted while the pass is recorded, when it finishes
+        state_ptr->backend.get_bind_stats(&state_ptr->draw_stats.binds);
+
         if (!state_ptr->backend.start_renderpass(frame_ctx,
                                                  Renderpass_Type::UI))
         {
@@ -152,28 +197,47 @@ renderer_draw_frame(Frame_Context *frame_ctx, Render_Context *render_ctx)
     return true;
 }
 
+// The setters are called every frame by the client, only actual changes
+// count as a new scene
 void
 renderer_set_view(mat4 view)
 {
+    if (floats_equal(state_ptr->view.elements, view.elements, 16))
+        return;
+
     state_ptr->view = view;
+    state_ptr->scene_generation++;
 }
 
 void
 renderer_set_projection(mat4 projection)
 {
+    if (floats_equal(state_ptr->projection.elements, projection.elements, 16))
+        return;
+
     state_ptr->projection = projection;
+    state_ptr->scene_generation++;
 }
 
 void
 renderer_set_viewport_clear_color(vec4 color)
 {
+    if (floats_equal(state_ptr->clear_color.elements, color.elements, 4))
+        return;
+
+    state_ptr->clear_color = color;
     state_ptr->backend.set_viewport_clear_color(color);
+    state_ptr->scene_generation++;
 }
 
 void
 renderer_set_grid_color(vec4 color)
 {
+    if (floats_equal(state_ptr->grid_color.elements, color.elements, 4))
+        return;
+
     state_ptr->grid_color = color;
+    state_ptr->scene_generation++;
 }
 
 void
@@ -183,7 +247,24 @@ renderer_set_grid_spacing(f32 spacing)
     {
         spacing = 0.000001f;
     }
+
+    if (state_ptr->grid_spacing == spacing)
+        return;
+
     state_ptr->grid_spacing = spacing;
+    state_ptr->scene_generation++;
+}
+
+void
+renderer_mark_scene_changed()
+{
+    state_ptr->scene_generation++;
+}
+
+u64
+renderer_get_scene_generation()
+{
+    return state_ptr->scene_generation;
 }
 
 void
@@ -191,13 +272,38 @@ renderer_create_texture(const u8       *pixels,
                         struct Texture *texture,
                         b8              is_ui_texture)
 {
-    state_ptr->backend.create_texture(pixels, texture, is_ui_texture);
+    Texture_Mip mip;
+    mip.data   = pixels;
+    mip.size   = (u64)texture->width * texture->height * texture->channel_count;
+    mip.width  = texture->width;
+    mip.height = texture->height;
+
+    texture->format    = Texture_Format::RGBA8;
+    texture->mip_count = 1;
+
+    renderer_create_texture_mips(&mip, texture, is_ui_texture);
+}
+
+void
+renderer_create_texture_mips(const Texture_Mip *mips,
+                             struct Texture    *texture,
+                             b8                 is_ui_texture)
+{
+    state_ptr->backend.create_texture(mips, texture, is_ui_texture);
+    state_ptr->scene_generation++;
+}
+
+b8
+renderer_supports_texture_format(Texture_Format format)
+{
+    return state_ptr->backend.supports_texture_format(format);
 }
 
 void
 renderer_destroy_texture(struct Texture *texture)
 {
     state_ptr->backend.destroy_texture(texture);
+    state_ptr->scene_generation++;
 }
 
 void *
@@ -215,12 +321,14 @@ renderer_get_texture_draw_data(struct Texture *texture)
 b8
 renderer_create_material(struct Material *material)
 {
+    state_ptr->scene_generation++;
     return state_ptr->backend.create_material(material);
 }
 
 void
 renderer_destroy_material(struct Material *material)
 {
+    state_ptr->scene_generation++;
     return state_ptr->backend.destroy_material(material);
 }
 
@@ -231,6 +339,7 @@ renderer_create_geometry(Geometry        *geometry,
                          u32              index_count,
                          u32             *indices)
 {
+    state_ptr->scene_generation++;
     return state_ptr->backend.create_geometry(geometry,
                                               vertex_count,
                                               vertices,
@@ -242,6 +351,25 @@ void
 renderer_destroy_geometry(Geometry *geometry)
 {
     state_ptr->backend.destroy_geometry(geometry);
+    state_ptr->scene_generation++;
+}
+
+void
+renderer_get_geometry_buffer_stats(Geometry_Buffer_Stats *out_stats)
+{
+    state_ptr->backend.get_geometry_buffer_stats(out_stats);
+}
+
+void
+renderer_get_draw_stats(Renderer_Draw_Stats *out_stats)
+{
+    *out_stats = state_ptr->draw_stats;
+}
+
+b8
+renderer_is_present_paced()
+{
+    return state_ptr->backend.is_present_paced();
 }
 
 void
@@ -260,6 +388,7 @@ void
 renderer_resize_viewport(u32 width, u32 height)
 {
     state_ptr->backend.resize_viewport(width, height);
+    state_ptr->scene_generation++;
 }
 
 void
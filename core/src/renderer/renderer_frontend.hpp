@@ -10,9 +10,20 @@ void renderer_on_resize(u16 width, u16 height);
 
 b8 renderer_draw_frame(struct Frame_Context *frame_ctx, Render_Context *packet);
 
+// Creates a single mip RGBA8 texture, the size is read from the texture
 void renderer_create_texture(const u8       *pixels,
                              struct Texture *texture,
                              b8              is_ui_texture = false);
+
+// Creates a texture from its mip chain, in the format and with the mip count
+// set on the texture
+void renderer_create_texture_mips(const Texture_Mip *mips,
+                                  struct Texture    *texture,
+                                  b8                 is_ui_texture = false);
+
+// Whether textures of the format can be created and sampled
+b8 renderer_supports_texture_format(Texture_Format format);
+
 void renderer_destroy_texture(struct Texture *texture);
 
 void *renderer_get_texture_draw_data(struct Texture *texture);
@@ -27,6 +38,15 @@ b8   renderer_create_geometry(Geometry        *geometry,
                               u32             *indices);
 void renderer_destroy_geometry(Geometry *geometry);
 
+VOLTRUM_API void renderer_get_geometry_buffer_stats(
+    Geometry_Buffer_Stats *out_stats);
+
+VOLTRUM_API void renderer_get_draw_stats(Renderer_Draw_Stats *out_stats);
+
+// Whether presenting a frame blocks until the vertical blank, which paces the
+// frames at the refresh rate of the display
+b8 renderer_is_present_paced();
+
 // WARN: The exposing of this method from the core library is temporary until
 // the camera system is developed
 VOLTRUM_API void renderer_set_view(mat4 view);
@@ -35,6 +55,12 @@ VOLTRUM_API void renderer_set_viewport_clear_color(vec4 color);
 VOLTRUM_API void renderer_set_grid_color(vec4 color);
 VOLTRUM_API void renderer_set_grid_spacing(f32 spacing);
 
+// The generation of the scene changes with anything the viewport shows: the
+// camera, the settings above and the resources of the renderer. Changes to
+// the draws that do not go through the renderer have to be marked
+VOLTRUM_API void renderer_mark_scene_changed();
+VOLTRUM_API u64  renderer_get_scene_generation();
+
 // Viewport management for editor
 VOLTRUM_API void  renderer_render_viewport();
 VOLTRUM_API void *renderer_get_rendered_viewport();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "data_structures/freelist.hpp"
 #include "defines.hpp"
 #include "math/math_types.hpp"
 #include "memory/arena.hpp"
@@ -17,6 +18,30 @@ struct UI_Render_Data
     struct ImDrawData *draw_list;
 };
 
+// Occupancy of the shared vertex/index buffers that hold all geometries
+struct Geometry_Buffer_Stats
+{
+    Freelist_Stats vertex;
+    Freelist_Stats index;
+};
+
+// Pipeline, descriptor set and buffer binds of the geometry draws. A bind is
+// saved when the draw finds its state already bound by the previous one
+struct Renderer_Bind_Stats
+{
+    u32 change_count;
+    u32 saved_count;
+};
+
+// Geometries submitted in the last frame against the draw calls issued for
+// them once the instances of the same geometry were grouped
+struct Renderer_Draw_Stats
+{
+    u32                 geometry_count;
+    u32                 draw_call_count;
+    Renderer_Bind_Stats binds;
+};
+
 enum class Renderpass_Type : u8
 {
     VIEWPORT,
@@ -51,6 +76,15 @@ struct Renderer_Backend
                             Renderpass_Type       type);
 
     void (*draw_geometry)(Geometry_Render_Data data);
+    // Draws instance_count copies of the geometry in a single call, one per
+    // model matrix of transforms
+    void (*draw_geometry_instanced)(Geometry   *geometry,
+                                    u32         instance_count,
+                                    const mat4 *transforms);
+    // Binds of the last recorded viewport pass
+    void (*get_bind_stats)(Renderer_Bind_Stats *out_stats);
+    // Whether presenting blocks until the vertical blank
+    b8 (*is_present_paced)();
     void (*draw_grid)(mat4 projection,
                       mat4 view,
                       vec4 grid_color,
@@ -59,9 +93,10 @@ struct Renderer_Backend
     void (*draw_ui)(UI_Render_Data data);
 
     // Resource management
-    void (*create_texture)(const u8       *pixels,
-                           struct Texture *texture,
-                           b8              is_ui_texture);
+    b8 (*supports_texture_format)(Texture_Format format);
+    void (*create_texture)(const Texture_Mip *mips,
+                           struct Texture    *texture,
+                           b8                 is_ui_texture);
     void (*destroy_texture)(struct Texture *texture);
 
     b8 (*create_material)(struct Material *material);
@@ -73,6 +108,7 @@ struct Renderer_Backend
                           u32              index_count,
                           const u32       *indices);
     void (*destroy_geometry)(Geometry *geometry);
+    void (*get_geometry_buffer_stats)(Geometry_Buffer_Stats *out_stats);
 
     // Viewport management
     void (*render_viewport)();
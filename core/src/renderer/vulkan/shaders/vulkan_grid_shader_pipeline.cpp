@@ -329,10 +329,10 @@ vulkan_grid_shader_pipeline_destroy(
 void
 vulkan_grid_shader_pipeline_use(
     Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
     Vulkan_Grid_Shader_Pipeline *shader)
 {
-    u32 image_index = context->image_index;
-    vulkan_graphics_pipeline_bind(&context->command_buffers[image_index],
+    vulkan_graphics_pipeline_bind(command_buffer,
                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
                                   &shader->pipeline);
 }
@@ -345,12 +345,6 @@ vulkan_grid_shader_pipeline_update_global_state(
 
     u32 image_index = context->image_index;
 
-    VkCommandBuffer command_buffer =
-        context->command_buffers[image_index].handle;
-
-    VkDescriptorSet global_descriptor =
-        shader->global_descriptor_sets[image_index];
-
     u32 range  = sizeof(Vulkan_Grid_Shader_Global_Ubo);
     u64 offset = shader->global_ubo_stride * image_index;
 
@@ -380,8 +374,18 @@ vulkan_grid_shader_pipeline_update_global_state(
                            &descriptor_write,
                            0,
                            0);
+}
+
+void
+vulkan_grid_shader_pipeline_bind_global_state(
+    Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
+    Vulkan_Grid_Shader_Pipeline *shader)
+{
+    VkDescriptorSet global_descriptor =
+        shader->global_descriptor_sets[context->image_index];
 
-    vkCmdBindDescriptorSets(command_buffer,
+    vkCmdBindDescriptorSets(command_buffer->handle,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             shader->pipeline.pipeline_layout,
                             0,
@@ -394,11 +398,9 @@ vulkan_grid_shader_pipeline_update_global_state(
 void
 vulkan_grid_shader_pipeline_draw(
     Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
     Vulkan_Grid_Shader_Pipeline *shader)
 {
-    u32             image_index    = context->image_index;
-    VkCommandBuffer command_buffer = context->command_buffers[image_index].handle;
-
     // 3 vertices for fullscreen triangle, 1 instance
-    vkCmdDraw(command_buffer, 3, 1, 0, 0);
+    vkCmdDraw(command_buffer->handle, 3, 1, 0, 0);
 }
@@ -10,14 +10,24 @@ void vulkan_grid_shader_pipeline_destroy(
     Vulkan_Context              *context,
     Vulkan_Grid_Shader_Pipeline *shader);
 
+// Commands are recorded into the given command buffer so that the grid can be
+// drawn from a secondary command buffer of the viewport pass
 void vulkan_grid_shader_pipeline_use(
     Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
     Vulkan_Grid_Shader_Pipeline *shader);
 
+// Uploads the global uniforms of the current image, host side only
 void vulkan_grid_shader_pipeline_update_global_state(
     Vulkan_Context              *context,
     Vulkan_Grid_Shader_Pipeline *shader);
 
+void vulkan_grid_shader_pipeline_bind_global_state(
+    Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
+    Vulkan_Grid_Shader_Pipeline *shader);
+
 void vulkan_grid_shader_pipeline_draw(
     Vulkan_Context              *context,
+    Vulkan_Command_Buffer       *command_buffer,
     Vulkan_Grid_Shader_Pipeline *shader);
@@ -156,19 +156,33 @@ vulkan_material_shader_pipeline_create(
     scissor.extent.width                = context->viewport.framebuffer_width;
     scissor.extent.height               = context->viewport.framebuffer_height;
 
+    // Binding 0 steps per vertex through the geometry, binding 1 steps per
+    // instance through the model matrices of the instance buffer
+    constexpr u32                   binding_count = 2;
+    VkVertexInputBindingDescription bindings[binding_count];
+    bindings[0].binding   = 0;
+    bindings[0].stride    = sizeof(Vertex_3d);
+    bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindings[1].binding   = 1;
+    bindings[1].stride    = sizeof(mat4);
+    bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
     // Attributes
-    u32           offset          = 0;
-    constexpr u32 attribute_count = 2;
+    u32           offset                 = 0;
+    constexpr u32 vertex_attribute_count = 2;
+    constexpr u32 model_attribute_count  = 4; // A mat4 takes 4 locations
+    constexpr u32 attribute_count =
+        vertex_attribute_count + model_attribute_count;
 
     VkVertexInputAttributeDescription attribute_descriptions[attribute_count];
 
     // Position, Texture coordinates
-    VkFormat formats[attribute_count] = {VK_FORMAT_R32G32B32_SFLOAT,
-                                         VK_FORMAT_R32G32_SFLOAT};
+    VkFormat formats[vertex_attribute_count] = {VK_FORMAT_R32G32B32_SFLOAT,
+                                                VK_FORMAT_R32G32_SFLOAT};
 
-    u64 sizes[attribute_count] = {sizeof(vec3), sizeof(vec2)};
+    u64 sizes[vertex_attribute_count] = {sizeof(vec3), sizeof(vec2)};
 
-    for (u32 i = 0; i < attribute_count; ++i)
+    for (u32 i = 0; i < vertex_attribute_count; ++i)
     {
         attribute_descriptions[i].binding  = 0;
         attribute_descriptions[i].location = i;
@@ -177,6 +191,18 @@ vulkan_material_shader_pipeline_create(
         offset += sizes[i];
     }
 
+    // Model matrix, one vec4 column per location
+    for (u32 i = 0; i < model_attribute_count; ++i)
+    {
+        VkVertexInputAttributeDescription *attribute =
+            &attribute_descriptions[vertex_attribute_count + i];
+
+        attribute->binding  = 1;
+        attribute->location = vertex_attribute_count + i;
+        attribute->format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attribute->offset   = sizeof(vec4) * i;
+    }
+
     constexpr s32         descriptor_set_layout_count          = 2;
     VkDescriptorSetLayout layouts[descriptor_set_layout_count] = {
         out_shader->global_descriptor_set_layout,
@@ -196,7 +222,8 @@ vulkan_material_shader_pipeline_create(
 
     if (!vulkan_graphics_pipeline_create(context,
                                          &context->viewport_renderpass,
-                                         sizeof(Vertex_3d),
+                                         binding_count,
+                                         bindings,
                                          attribute_count,
                                          attribute_descriptions,
                                          descriptor_set_layout_count,
@@ -320,11 +347,12 @@ vulkan_material_shader_pipeline_destroy(Vulkan_Context *context,
 }
 
 void
-vulkan_material_shader_pipeline_use(Vulkan_Context                  *context,
-                                    Vulkan_Material_Shader_Pipeline *shader)
+vulkan_material_shader_pipeline_use(
+    Vulkan_Context                  *context,
+    Vulkan_Command_Buffer           *command_buffer,
+    Vulkan_Material_Shader_Pipeline *shader)
 {
-    u32 image_index = context->image_index;
-    vulkan_graphics_pipeline_bind(&context->command_buffers[image_index],
+    vulkan_graphics_pipeline_bind(command_buffer,
                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
                                   &shader->pipeline);
 }
@@ -341,12 +369,6 @@ vulkan_material_shader_pipeline_update_global_state(
 
     u32 image_index = context->image_index;
 
-    VkCommandBuffer command_buffer =
-        context->command_buffers[image_index].handle;
-
-    VkDescriptorSet global_descriptor =
-        shader->global_descriptor_sets[image_index];
-
     u32 range  = sizeof(Vulkan_Material_Shader_Global_Ubo);
     u64 offset = sizeof(Vulkan_Material_Shader_Global_Ubo) * image_index;
 
@@ -381,8 +403,18 @@ vulkan_material_shader_pipeline_update_global_state(
                            &descriptor_write,
                            0,
                            0);
+}
 
-    vkCmdBindDescriptorSets(command_buffer,
+void
+vulkan_material_shader_pipeline_bind_global_state(
+    Vulkan_Context                  *context,
+    Vulkan_Command_Buffer           *command_buffer,
+    Vulkan_Material_Shader_Pipeline *shader)
+{
+    VkDescriptorSet global_descriptor =
+        shader->global_descriptor_sets[context->image_index];
+
+    vkCmdBindDescriptorSets(command_buffer->handle,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             shader->pipeline.pipeline_layout,
                             0,
@@ -393,33 +425,7 @@ vulkan_material_shader_pipeline_update_global_state(
 }
 
 void
-vulkan_material_shader_pipeline_set_model(
-    Vulkan_Context                  *context,
-    Vulkan_Material_Shader_Pipeline *shader,
-    mat4                             model)
-{
-
-    if (context && shader)
-    {
-        u32             image_index = context->image_index;
-        VkCommandBuffer command_buffer =
-            context->command_buffers[image_index].handle;
-
-        // Push constants work similar to unfiroms but they can work
-        // without descriptor sets. It can be executed at any point
-        // not necessarily inside a renderpass. Vulkan "has a limitation"
-        // of 128 bytes for push constants
-        vkCmdPushConstants(command_buffer,
-                           shader->pipeline.pipeline_layout,
-                           VK_SHADER_STAGE_VERTEX_BIT,
-                           0,
-                           sizeof(mat4),
-                           &model);
-    }
-}
-
-void
-vulkan_material_shader_pipeline_apply_material(
+vulkan_material_shader_pipeline_update_material(
     Vulkan_Context                  *context,
     Vulkan_Material_Shader_Pipeline *shader,
     Material                        *material)
@@ -428,9 +434,7 @@ vulkan_material_shader_pipeline_apply_material(
     if (!context || !shader)
         return;
 
-    u32             image_index = context->image_index;
-    VkCommandBuffer command_buffer =
-        context->command_buffers[image_index].handle;
+    u32 image_index = context->image_index;
 
     // Obtain material data
     Vulkan_Material_Shader_Object_State *object_state =
@@ -571,9 +575,20 @@ vulkan_material_shader_pipeline_apply_material(
                                0,
                                nullptr);
     }
+}
+
+void
+vulkan_material_shader_pipeline_bind_material(
+    Vulkan_Context                  *context,
+    Vulkan_Command_Buffer           *command_buffer,
+    Vulkan_Material_Shader_Pipeline *shader,
+    Material                        *material)
+{
+    VkDescriptorSet object_descriptor_set =
+        shader->object_states[material->internal_id]
+            .descriptor_sets[context->image_index];
 
-    // Bind the descript set to be updated
-    vkCmdBindDescriptorSets(command_buffer,
+    vkCmdBindDescriptorSets(command_buffer->handle,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             shader->pipeline.pipeline_layout,
                             1,
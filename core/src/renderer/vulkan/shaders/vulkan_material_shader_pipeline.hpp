@@ -8,7 +8,12 @@ b8 vulkan_material_shader_pipeline_create(Vulkan_Context *context,
 void vulkan_material_shader_pipeline_destroy(Vulkan_Context *context,
     Vulkan_Material_Shader_Pipeline *shader);
 
+// Functions taking a command buffer only record into it, so that the jobs
+// recording the viewport pass can call them on their own buffers. The update
+// functions write the uniforms and descriptor sets of the current image and
+// run on the main thread before the recording starts
 void vulkan_material_shader_pipeline_use(Vulkan_Context *context,
+    Vulkan_Command_Buffer *command_buffer,
     Vulkan_Material_Shader_Pipeline *shader);
 
 void vulkan_material_shader_pipeline_update_global_state(
@@ -16,11 +21,17 @@ void vulkan_material_shader_pipeline_update_global_state(
     Vulkan_Material_Shader_Pipeline *shader,
     f32 delta_time);
 
-void vulkan_material_shader_pipeline_set_model(Vulkan_Context *context,
+void vulkan_material_shader_pipeline_bind_global_state(
+    Vulkan_Context *context,
+    Vulkan_Command_Buffer *command_buffer,
+    Vulkan_Material_Shader_Pipeline *shader);
+
+void vulkan_material_shader_pipeline_update_material(Vulkan_Context *context,
     Vulkan_Material_Shader_Pipeline *shader,
-    mat4 model);
+    Material *material);
 
-void vulkan_material_shader_pipeline_apply_material(Vulkan_Context *context,
+void vulkan_material_shader_pipeline_bind_material(Vulkan_Context *context,
+    Vulkan_Command_Buffer *command_buffer,
     Vulkan_Material_Shader_Pipeline *shader,
     Material *material);
 
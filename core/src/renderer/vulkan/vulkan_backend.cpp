@@ -5,6 +5,7 @@
 #include "memory/arena.hpp"
 #include "memory/memory.hpp"
 #include "platform/platform.hpp"
+#include "systems/job_system.hpp"
 #include "systems/material_system.hpp"
 
 #include "math/math.hpp"
@@ -18,6 +19,7 @@
 #include "vulkan_image.hpp"
 #include "vulkan_platform.hpp"
 #include "vulkan_renderpass.hpp"
+#include "vulkan_staging_ring.hpp"
 #include "vulkan_swapchain.hpp"
 #include "vulkan_types.hpp"
 #include "vulkan_utils.hpp"
@@ -63,6 +65,12 @@ INTERNAL_FUNC void regenerate_framebuffers();
 INTERNAL_FUNC b8   present_frame();
 INTERNAL_FUNC b8   get_next_image_index();
 
+// The draws of the viewport pass are split in slices recorded in parallel by
+// the job system, each into a secondary command buffer of its own
+INTERNAL_FUNC b8   create_recording_slices(Vulkan_Context *context);
+INTERNAL_FUNC void destroy_recording_slices(Vulkan_Context *context);
+INTERNAL_FUNC void record_viewport_pass(Vulkan_Command_Buffer *cmd_buffer);
+
 // The recreate_swapchain function is called both when a window resize event
 // has ocurred and was published by the platform layer, or when a graphics ops.
 // (i.e. present or get_next_image_index) finished with a non-optimal result
@@ -72,7 +80,9 @@ INTERNAL_FUNC b8   get_next_image_index();
 // occur.
 INTERNAL_FUNC b8 recreate_swapchain(b8 is_resized_event);
 
-// TODO: Temporary. Will move later
+// Uploads go through the staging ring and are executed with the next flush.
+// Data larger than the whole ring falls back to a dedicated staging buffer and
+// a blocking copy
 INTERNAL_FUNC void
 upload_data_range(Vulkan_Context *context,
                   VkCommandPool   pool,
@@ -83,6 +93,19 @@ upload_data_range(Vulkan_Context *context,
                   u64             size,
                   const void     *data)
 {
+    if (vulkan_staging_ring_upload_buffer(context,
+                                          &context->staging_ring,
+                                          buffer,
+                                          offset,
+                                          size,
+                                          data))
+    {
+        return;
+    }
+
+    // Submit the pending copies first so that they cannot land after (and
+    // overwrite) the blocking one
+    vulkan_staging_ring_flush(context, &context->staging_ring);
 
     VkBufferUsageFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
@@ -111,9 +134,69 @@ upload_data_range(Vulkan_Context *context,
 }
 
 INTERNAL_FUNC void
-free_data_range(Vulkan_Buffer *buffer, u64 offset, u64 size)
+log_data_range_stats(const char *buffer_name, const Freelist<u64> *freelist)
+{
+    Freelist_Stats stats = freelist->get_stats();
+
+    CORE_DEBUG(
+        "%s buffer: %llu/%llu bytes free in %u blocks (largest=%llu, "
+        "fragmentation=%.2f)",
+        buffer_name,
+        stats.free_space,
+        stats.total_size,
+        stats.free_block_count,
+        stats.largest_free_block,
+        stats.fragmentation);
+}
+
+// Reserves a range of the buffer through its freelist. When no free range is
+// large enough, the buffer is grown (at least doubled) and the freelist is
+// extended to cover the new tail
+INTERNAL_FUNC b8
+allocate_data_range(Vulkan_Context *context,
+                    VkCommandPool   pool,
+                    VkQueue         queue,
+                    Vulkan_Buffer  *buffer,
+                    Freelist<u64>  *freelist,
+                    u64             size,
+                    u64            *out_offset)
+{
+    if (freelist->allocate(size, out_offset))
+        return true;
+
+    u64 new_size = MAX(buffer->total_size * 2, buffer->total_size + size);
+
+    CORE_INFO("Geometry buffer out of space for %llu bytes. Growing %llu -> "
+              "%llu bytes",
+              size,
+              buffer->total_size,
+              new_size);
+    log_data_range_stats("Geometry", freelist);
+
+    // The pending copies reference the current buffer handle, which is
+    // destroyed by the resize
+    vulkan_staging_ring_flush(context, &context->staging_ring);
+
+    if (!vulkan_buffer_resize(context, new_size, buffer, queue, pool))
+    {
+        CORE_ERROR("allocate_data_range - Failed to grow geometry buffer");
+        return false;
+    }
+
+    freelist->grow(new_size);
+
+    return freelist->allocate(size, out_offset);
+}
+
+INTERNAL_FUNC void
+free_data_range(Freelist<u64> *freelist, u64 offset, u64 size)
 {
-    // NOTE: Empty because for now it is just a placeholder method
+    if (!freelist->free(offset, size))
+    {
+        CORE_ERROR("free_data_range - Failed to release range [%llu, %llu)",
+                   offset,
+                   offset + size);
+    }
 }
 
 b8
@@ -426,10 +509,38 @@ vulkan_initialize(Arena *allocator, Platform_State *platform, String app_name)
     create_buffers(state_ptr);
     CORE_INFO("Vulkan buffers created.");
 
+    state_ptr->object_vertex_freelist.init(
+        allocator,
+        state_ptr->object_vertex_buffer.total_size);
+    state_ptr->object_index_freelist.init(
+        allocator,
+        state_ptr->object_index_buffer.total_size);
+
+    if (!vulkan_staging_ring_create(state_ptr,
+                                    VULKAN_STAGING_RING_SIZE,
+                                    &state_ptr->staging_ring))
+    {
+        CORE_ERROR("Failed to create the staging ring");
+        return false;
+    }
+
     for (u32 i = 0; i < VULKAN_MAX_GEOMETRY_COUNT; ++i)
     {
         state_ptr->registered_geometries[i].id = INVALID_ID;
     }
+    state_ptr->geometry_slot_freelist.init(allocator,
+                                           VULKAN_MAX_GEOMETRY_COUNT);
+
+    // Every draw has at least an instance, so the instance capacity bounds the
+    // draws of a frame
+    state_ptr->deferred_draws =
+        push_array(allocator, Vulkan_Deferred_Draw, VULKAN_MAX_INSTANCE_COUNT);
+
+    if (!create_recording_slices(state_ptr))
+    {
+        CORE_ERROR("Failed to create the recording slices");
+        return false;
+    }
 
     CORE_INFO("Vulkan backend initialized");
 
@@ -443,6 +554,7 @@ vulkan_shutdown()
     //			there are graphic operation still going on. First, it is
     // better 			to wait until all operations have completed, so
     // we do not get 			errors.
+    vulkan_staging_ring_wait_idle(state_ptr, &state_ptr->staging_ring);
     vkDeviceWaitIdle(state_ptr->device.logical_device);
 
     // Wait for any pending main renderer operations to complete
@@ -481,6 +593,11 @@ vulkan_shutdown()
 
     vulkan_buffer_destroy(state_ptr, &state_ptr->object_vertex_buffer);
     vulkan_buffer_destroy(state_ptr, &state_ptr->object_index_buffer);
+    vulkan_buffer_unlock_memory(state_ptr, &state_ptr->instance_buffer);
+    vulkan_buffer_destroy(state_ptr, &state_ptr->instance_buffer);
+    vulkan_staging_ring_destroy(state_ptr, &state_ptr->staging_ring);
+
+    destroy_recording_slices(state_ptr);
 
     // Destroy shader modules
     vulkan_imgui_shader_pipeline_destroy(state_ptr, &state_ptr->imgui_shader);
@@ -682,6 +799,14 @@ vulkan_begin_frame(Frame_Context *frame_ctx, f32 delta_t)
         &state_ptr->command_buffers[state_ptr->image_index];
 
     vulkan_command_buffer_reset(cmd_buffer);
+
+    // The fence of the image was waited on, so the GPU is done reading its
+    // region of the instance buffer
+    state_ptr->frame_instance_count       = 0;
+    state_ptr->instance_overflow_reported = false;
+    state_ptr->deferred_draw_count        = 0;
+    state_ptr->grid_pending               = false;
+
     // Mark this command buffer NOT as single use since we are using this over
     // and over again
     vulkan_command_buffer_begin(cmd_buffer, false, false, false);
@@ -723,17 +848,11 @@ vulkan_update_global_viewport_state(mat4 projection,
                                     vec4 ambient_colour,
                                     s32  mode)
 {
-    Vulkan_Command_Buffer *cmd_buffer =
-        &state_ptr->command_buffers[state_ptr->image_index];
-
-    // Bind pipeline
-    vulkan_material_shader_pipeline_use(state_ptr, &state_ptr->material_shader);
-
-    // Update uniform buffer data
+    // Update uniform buffer data, the descriptor sets are bound by the slices
+    // recording the viewport pass
     state_ptr->material_shader.global_ubo.projection = projection;
     state_ptr->material_shader.global_ubo.view       = view;
 
-    // Bind descriptor sets
     vulkan_material_shader_pipeline_update_global_state(
         state_ptr,
         &state_ptr->material_shader,
@@ -751,6 +870,14 @@ vulkan_end_frame(Frame_Context *frame_ctx, f32 delta_t)
     // End command buffer recording
     vulkan_command_buffer_end(cmd_buffer);
 
+    // All the uploads recorded since the last frame are submitted in one batch
+    // ahead of the frame, so that the frame sees the uploaded data
+    if (!vulkan_staging_ring_flush(state_ptr, &state_ptr->staging_ring))
+    {
+        CORE_ERROR("vulkan_end_frame - Failed to flush the staging ring");
+        return false;
+    }
+
     // Mark the image fence as in-use by the current frame
     state_ptr->images_in_flight[state_ptr->image_index] =
         &state_ptr->in_flight_fences[state_ptr->current_frame];
@@ -824,6 +951,8 @@ vulkan_renderpass_start(Frame_Context  *frame_ctx,
     u32 fb_width  = 0;
     u32 fb_height = 0;
 
+    VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+
     switch (renderpass_type)
     {
     case Renderpass_Type::VIEWPORT:
@@ -832,6 +961,7 @@ vulkan_renderpass_start(Frame_Context  *frame_ctx,
         framebuffer = state_ptr->viewport.framebuffers[state_ptr->image_index];
         fb_width    = state_ptr->viewport.framebuffer_width;
         fb_height   = state_ptr->viewport.framebuffer_height;
+        contents    = VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
         break;
     }
 
@@ -868,22 +998,16 @@ vulkan_renderpass_start(Frame_Context  *frame_ctx,
     vkCmdSetViewport(cmd_buffer->handle, 0, 1, &viewport);
     vkCmdSetScissor(cmd_buffer->handle, 0, 1, &scissor);
 
-    vulkan_renderpass_begin(cmd_buffer, renderpass, framebuffer);
-
-    switch (renderpass_type)
+    // Dynamic state is not inherited by secondary command buffers, the slices
+    // set it again
+    if (renderpass_type == Renderpass_Type::VIEWPORT)
     {
-
-    case Renderpass_Type::VIEWPORT:
-        vulkan_material_shader_pipeline_use(state_ptr,
-                                            &state_ptr->material_shader);
-        break;
-    case Renderpass_Type::UI:
-        // Commented out for UI rewrite - will be implemented in
-        // vulkan_ui_backend vulkan_imgui_shader_pipeline_use(state_ptr,
-        // &state_ptr->imgui_shader);
-        break;
+        state_ptr->viewport_pass_viewport = viewport;
+        state_ptr->viewport_pass_scissor  = scissor;
     }
 
+    vulkan_renderpass_begin(cmd_buffer, renderpass, framebuffer, contents);
+
     return true;
 }
 
@@ -902,6 +1026,7 @@ vulkan_renderpass_finish(Frame_Context  *frame_ctx,
     {
     case Renderpass_Type::VIEWPORT:
         renderpass = &state_ptr->viewport_renderpass;
+        record_viewport_pass(cmd_buffer);
         break;
     case Renderpass_Type::UI:
         renderpass = &state_ptr->ui_renderpass;
@@ -1125,6 +1250,80 @@ create_command_buffers(Vulkan_Context *context)
                context->swapchain.image_count);
 }
 
+b8
+create_recording_slices(Vulkan_Context *context)
+{
+    // One slice per thread that can run a job, the main thread included
+    context->recording_slice_count = CLAMP(job_system_thread_count(),
+                                           1u,
+                                           VULKAN_MAX_RECORDING_SLICE_COUNT);
+
+    // The buffers are recorded again every frame after their pool is reset
+    VkCommandPoolCreateInfo pool_create_info = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_create_info.queueFamilyIndex = context->device.graphics_queue_index;
+    pool_create_info.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    for (u32 i = 0; i < context->recording_slice_count; ++i)
+    {
+        Vulkan_Recording_Slice *slice = &context->recording_slices[i];
+
+        for (u32 j = 0; j < VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT; ++j)
+        {
+            VkResult result =
+                vkCreateCommandPool(context->device.logical_device,
+                                    &pool_create_info,
+                                    context->allocator,
+                                    &slice->pools[j]);
+            if (!vulkan_result_is_success(result))
+            {
+                CORE_ERROR("create_recording_slices - vkCreateCommandPool "
+                           "failed: '%s'",
+                           vulkan_result_string(result, true));
+                return false;
+            }
+
+            vulkan_command_buffer_allocate(context,
+                                           slice->pools[j],
+                                           false,
+                                           &slice->command_buffers[j]);
+        }
+    }
+
+    CORE_DEBUG("Recording slices created (count=%u)",
+               context->recording_slice_count);
+
+    return true;
+}
+
+void
+destroy_recording_slices(Vulkan_Context *context)
+{
+    // Destroying a pool frees the command buffers allocated from it
+    for (u32 i = 0; i < context->recording_slice_count; ++i)
+    {
+        Vulkan_Recording_Slice *slice = &context->recording_slices[i];
+
+        for (u32 j = 0; j < VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT; ++j)
+        {
+            if (!slice->pools[j])
+                continue;
+
+            vkDestroyCommandPool(context->device.logical_device,
+                                 slice->pools[j],
+                                 context->allocator);
+
+            slice->pools[j]                  = VK_NULL_HANDLE;
+            slice->command_buffers[j].handle = nullptr;
+            slice->command_buffers[j].state =
+                Command_Buffer_State::NOT_ALLOCATED;
+        }
+    }
+
+    context->recording_slice_count = 0;
+    context->recorded_slice_count  = 0;
+}
+
 // We need a framebuffer per swapchain image
 void
 regenerate_framebuffers()
@@ -1401,7 +1600,6 @@ create_buffers(Vulkan_Context *context)
         return false;
     }
 
-    context->geometry_vertex_offset = 0;
     CORE_INFO("Created vertex buffer");
 
     constexpr u64 index_buffer_size = sizeof(u32) * 1024 * 1024; // 64mb
@@ -1421,26 +1619,60 @@ create_buffers(Vulkan_Context *context)
 
     CORE_INFO("Created index buffer");
 
-    context->geometry_index_offset = 0;
+    // Written by the CPU every frame and read once per instance, so it stays
+    // host visible instead of going through the staging ring
+    u32 device_local_bits = context->device.supports_device_local_host_visible
+                                ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                : 0;
 
-    return true;
-}
+    constexpr u64 instance_buffer_size = sizeof(mat4) *
+                                         VULKAN_MAX_INSTANCE_COUNT *
+                                         VULKAN_INSTANCE_BUFFER_REGION_COUNT;
 
-void
-vulkan_create_texture(const u8 *pixels, Texture *texture, b8 is_ui_texture)
-{
-    Vulkan_Texture_Data *data = state_ptr->texture_data_pool.acquire();
+    if (!vulkan_buffer_create(context,
+                              instance_buffer_size,
+                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                              device_local_bits |
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              true,
+                              &state_ptr->instance_buffer))
+    {
+        CORE_ERROR("Error creating instance buffer.");
+        return false;
+    }
 
-    texture->internal_data = data;
+    state_ptr->instance_memory =
+        (mat4 *)vulkan_buffer_lock_memory(context,
+                                          &state_ptr->instance_buffer,
+                                          0,
+                                          instance_buffer_size,
+                                          0);
 
-    data->ui_descriptor_set = VK_NULL_HANDLE;
-    texture->is_ui_texture  = is_ui_texture;
+    CORE_INFO("Created instance buffer");
 
-    VkDeviceSize image_size =
-        texture->width * texture->height * texture->channel_count;
+    return true;
+}
 
-    // NOTE: Assume 8 bits per channel
-    VkFormat image_format = VK_FORMAT_R8G8B8A8_UNORM;
+// Fallback for images that do not fit in the staging ring. Uses a dedicated
+// staging buffer and waits for the copy to complete
+INTERNAL_FUNC void
+upload_image_blocking(Vulkan_Context    *context,
+                      Vulkan_Image      *image,
+                      VkFormat           image_format,
+                      const Texture_Mip *mips,
+                      u32                mip_count)
+{
+    // The mips are packed like in the staging ring
+    u64 mip_offsets[TEXTURE_MAX_MIP_COUNT];
+    u64 image_size = 0;
+
+    for (u32 i = 0; i < mip_count; ++i)
+    {
+        mip_offsets[i] =
+            ALIGN_UP_POW2(image_size, VULKAN_STAGING_MIN_ALIGNMENT);
+        image_size     = mip_offsets[i] + mips[i].size;
+    }
 
     // Create a staging buffer and load data into it
     VkBufferUsageFlags    usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -1449,61 +1681,138 @@ vulkan_create_texture(const u8 *pixels, Texture *texture, b8 is_ui_texture)
         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
     Vulkan_Buffer staging;
-    vulkan_buffer_create(state_ptr,
+    vulkan_buffer_create(context,
                          image_size,
                          usage,
                          memory_prop_flags,
                          true,
                          &staging);
 
-    vulkan_buffer_load_data(state_ptr, &staging, 0, image_size, 0, pixels);
-
-    // Assume the image type is 2D
-    vulkan_image_create(
-        state_ptr,
-        VK_IMAGE_TYPE_2D,
-        texture->width,
-        texture->height,
-        image_format,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        true,
-        VK_IMAGE_ASPECT_COLOR_BIT,
-        &data->image);
+    for (u32 i = 0; i < mip_count; ++i)
+    {
+        vulkan_buffer_load_data(context,
+                                &staging,
+                                mip_offsets[i],
+                                mips[i].size,
+                                0,
+                                mips[i].data);
+    }
 
     // Load the data of the buffer into the image. To load data into the image
     // from the buffer we need to use a command buffer
     Vulkan_Command_Buffer temp_buffer;
-    VkCommandPool         pool  = state_ptr->device.graphics_command_pool;
-    VkQueue               queue = state_ptr->device.graphics_queue;
-    vulkan_command_buffer_startup_single_use(state_ptr, pool, &temp_buffer);
+    VkCommandPool         pool  = context->device.graphics_command_pool;
+    VkQueue               queue = context->device.graphics_queue;
+    vulkan_command_buffer_startup_single_use(context, pool, &temp_buffer);
 
-    vulkan_image_transition_layout(state_ptr,
+    vulkan_image_transition_layout(context,
                                    &temp_buffer,
-                                   &data->image,
+                                   image,
                                    image_format,
                                    VK_IMAGE_LAYOUT_UNDEFINED,
                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    vulkan_image_copy_from_buffer(state_ptr,
-                                  &data->image,
-                                  staging.handle,
-                                  &temp_buffer);
+    for (u32 i = 0; i < mip_count; ++i)
+    {
+        vulkan_image_copy_from_buffer(context,
+                                      image,
+                                      staging.handle,
+                                      mip_offsets[i],
+                                      i,
+                                      &temp_buffer);
+    }
 
-    vulkan_image_transition_layout(state_ptr,
+    vulkan_image_transition_layout(context,
                                    &temp_buffer,
-                                   &data->image,
+                                   image,
                                    image_format,
                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-    vulkan_command_buffer_end_single_use(state_ptr, pool, &temp_buffer, queue);
+    vulkan_command_buffer_end_single_use(context, pool, &temp_buffer, queue);
 
     // Destroy staging buffer AFTER command buffer has been submitted and
     // completed
-    vulkan_buffer_destroy(state_ptr, &staging);
+    vulkan_buffer_destroy(context, &staging);
+}
+
+INTERNAL_FUNC VkFormat
+texture_format_to_vulkan(Texture_Format format)
+{
+    switch (format)
+    {
+        case Texture_Format::RGBA8:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case Texture_Format::BC1:
+            return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case Texture_Format::BC3:
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+b8
+vulkan_supports_texture_format(Texture_Format format)
+{
+    if (format == Texture_Format::RGBA8)
+        return true;
+
+    return state_ptr->device.supports_block_compression;
+}
+
+void
+vulkan_create_texture(const Texture_Mip *mips,
+                      Texture           *texture,
+                      b8                 is_ui_texture)
+{
+    Vulkan_Texture_Data *data = state_ptr->texture_data_pool.acquire();
+
+    texture->internal_data = data;
+
+    data->ui_descriptor_set = VK_NULL_HANDLE;
+    texture->is_ui_texture  = is_ui_texture;
+
+    VkFormat image_format = texture_format_to_vulkan(texture->format);
+
+    // Block compressed images cannot be rendered to
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                              VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    if (texture->format == Texture_Format::RGBA8)
+        usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+    // Assume the image type is 2D
+    vulkan_image_create(state_ptr,
+                        VK_IMAGE_TYPE_2D,
+                        texture->width,
+                        texture->height,
+                        texture->mip_count,
+                        image_format,
+                        VK_IMAGE_TILING_OPTIMAL,
+                        usage,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        true,
+                        VK_IMAGE_ASPECT_COLOR_BIT,
+                        &data->image);
+
+    // The copies and the layout transitions are recorded in the current
+    // staging batch, the image becomes readable with the next flush
+    if (!vulkan_staging_ring_upload_image(state_ptr,
+                                          &state_ptr->staging_ring,
+                                          &data->image,
+                                          image_format,
+                                          mips,
+                                          texture->mip_count))
+    {
+        vulkan_staging_ring_flush(state_ptr, &state_ptr->staging_ring);
+        upload_image_blocking(state_ptr,
+                              &data->image,
+                              image_format,
+                              mips,
+                              texture->mip_count);
+    }
 
     VkSamplerCreateInfo sampler_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
     sampler_info.magFilter           = VK_FILTER_LINEAR;
@@ -1520,7 +1829,7 @@ vulkan_create_texture(const u8 *pixels, Texture *texture, b8 is_ui_texture)
     sampler_info.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     sampler_info.mipLodBias              = 0.0f;
     sampler_info.minLod                  = 0.0f;
-    sampler_info.maxLod                  = 0.0f;
+    sampler_info.maxLod                  = (f32)texture->mip_count;
 
     VkResult result = vkCreateSampler(state_ptr->device.logical_device,
                                       &sampler_info,
@@ -1549,6 +1858,8 @@ vulkan_create_texture(const u8 *pixels, Texture *texture, b8 is_ui_texture)
 void
 vulkan_destroy_texture(Texture *texture)
 {
+    // The image might still be the target of a copy that is not submitted yet
+    vulkan_staging_ring_flush(state_ptr, &state_ptr->staging_ring);
     vkDeviceWaitIdle(state_ptr->device.logical_device);
 
     Vulkan_Texture_Data *data =
@@ -1624,6 +1935,28 @@ vulkan_destroy_material(struct Material *material)
     }
 }
 
+// Rolls back the registry entry of a failed upload. A reupload keeps pointing to
+// its previous ranges, which are still valid, while a new upload frees its slot
+INTERNAL_FUNC void
+discard_geometry_upload(Vulkan_Geometry_Data       *internal_data,
+                        b8                          is_reupload,
+                        const Vulkan_Geometry_Data *old_range)
+{
+    if (is_reupload)
+    {
+        internal_data->vertex_buffer_offset = old_range->vertex_buffer_offset;
+        internal_data->vertex_count         = old_range->vertex_count;
+        internal_data->vertex_size          = old_range->vertex_size;
+        internal_data->index_buffer_offset  = old_range->index_buffer_offset;
+        internal_data->index_count          = old_range->index_count;
+        internal_data->index_size           = old_range->index_size;
+        return;
+    }
+
+    state_ptr->geometry_slot_freelist.free(internal_data->id, 1);
+    internal_data->id = INVALID_ID;
+}
+
 b8
 vulkan_create_geometry(Geometry        *geometry,
                        u32              vertex_count,
@@ -1644,7 +1977,7 @@ vulkan_create_geometry(Geometry        *geometry,
 
     // Check if this geometry is a reupload. If yes, old data must be freed
     b8                   is_reupload = geometry->internal_id != INVALID_ID;
-    Vulkan_Geometry_Data old_range;
+    Vulkan_Geometry_Data old_range   = {};
 
     Vulkan_Geometry_Data *internal_data = nullptr;
 
@@ -1662,15 +1995,12 @@ vulkan_create_geometry(Geometry        *geometry,
     }
     else
     {
-        for (u32 i = 0; i < VULKAN_MAX_GEOMETRY_COUNT; ++i)
+        u32 slot;
+        if (state_ptr->geometry_slot_freelist.allocate(1, &slot))
         {
-            if (state_ptr->registered_geometries[i].id == INVALID_ID)
-            {
-                geometry->internal_id                  = i;
-                state_ptr->registered_geometries[i].id = i;
-                internal_data = &state_ptr->registered_geometries[i];
-                break;
-            }
+            geometry->internal_id                     = slot;
+            state_ptr->registered_geometries[slot].id = slot;
+            internal_data = &state_ptr->registered_geometries[slot];
         }
     }
 
@@ -1685,9 +2015,21 @@ vulkan_create_geometry(Geometry        *geometry,
     VkCommandPool pool  = state_ptr->device.graphics_command_pool;
     VkQueue       queue = state_ptr->device.graphics_queue;
 
-    internal_data->vertex_buffer_offset = state_ptr->geometry_vertex_offset;
-    internal_data->vertex_count         = vertex_count;
-    internal_data->vertex_size          = sizeof(Vertex_3d) * vertex_count;
+    internal_data->vertex_count = vertex_count;
+    internal_data->vertex_size  = sizeof(Vertex_3d) * vertex_count;
+
+    if (!allocate_data_range(state_ptr,
+                             pool,
+                             queue,
+                             &state_ptr->object_vertex_buffer,
+                             &state_ptr->object_vertex_freelist,
+                             internal_data->vertex_size,
+                             &internal_data->vertex_buffer_offset))
+    {
+        CORE_ERROR("vulkan_create_geometry - Failed to allocate vertex data");
+        discard_geometry_upload(internal_data, is_reupload, &old_range);
+        return false;
+    }
 
     upload_data_range(state_ptr,
                       pool,
@@ -1698,14 +2040,27 @@ vulkan_create_geometry(Geometry        *geometry,
                       internal_data->vertex_size,
                       vertices);
 
-    state_ptr->geometry_vertex_offset += internal_data->vertex_size;
-
     // It is possible to handle a geometry that does not have index data
     if (index_count && indices)
     {
-        internal_data->index_buffer_offset = state_ptr->geometry_index_offset;
-        internal_data->index_count         = index_count;
-        internal_data->index_size          = sizeof(u32) * index_count;
+        internal_data->index_count = index_count;
+        internal_data->index_size  = sizeof(u32) * index_count;
+
+        if (!allocate_data_range(state_ptr,
+                                 pool,
+                                 queue,
+                                 &state_ptr->object_index_buffer,
+                                 &state_ptr->object_index_freelist,
+                                 internal_data->index_size,
+                                 &internal_data->index_buffer_offset))
+        {
+            CORE_ERROR("vulkan_create_geometry - Failed to allocate index data");
+            free_data_range(&state_ptr->object_vertex_freelist,
+                            internal_data->vertex_buffer_offset,
+                            internal_data->vertex_size);
+            discard_geometry_upload(internal_data, is_reupload, &old_range);
+            return false;
+        }
 
         upload_data_range(state_ptr,
                           pool,
@@ -1715,8 +2070,11 @@ vulkan_create_geometry(Geometry        *geometry,
                           internal_data->index_buffer_offset,
                           internal_data->index_size,
                           indices);
-
-        state_ptr->geometry_index_offset += internal_data->index_size;
+    }
+    else
+    {
+        internal_data->index_count = 0;
+        internal_data->index_size  = 0;
     }
 
     if (internal_data->generation == INVALID_ID)
@@ -1730,13 +2088,13 @@ vulkan_create_geometry(Geometry        *geometry,
 
     if (is_reupload)
     {
-        free_data_range(&state_ptr->object_vertex_buffer,
+        free_data_range(&state_ptr->object_vertex_freelist,
                         old_range.vertex_buffer_offset,
                         old_range.vertex_size);
 
         if (old_range.index_size > 0)
         {
-            free_data_range(&state_ptr->object_index_buffer,
+            free_data_range(&state_ptr->object_index_freelist,
                             old_range.index_buffer_offset,
                             old_range.index_size);
         }
@@ -1750,92 +2108,327 @@ vulkan_destroy_geometry(Geometry *geometry)
 {
     if (geometry && geometry->internal_id != INVALID_ID)
     {
+        vulkan_staging_ring_flush(state_ptr, &state_ptr->staging_ring);
         vkDeviceWaitIdle(state_ptr->device.logical_device);
 
         Vulkan_Geometry_Data *internal_data =
             &state_ptr->registered_geometries[geometry->internal_id];
 
-        free_data_range(&state_ptr->object_vertex_buffer,
+        free_data_range(&state_ptr->object_vertex_freelist,
                         internal_data->vertex_buffer_offset,
                         internal_data->vertex_size);
 
         if (internal_data->index_size > 0)
         {
-            free_data_range(&state_ptr->object_index_buffer,
+            free_data_range(&state_ptr->object_index_freelist,
                             internal_data->index_buffer_offset,
                             internal_data->index_size);
         }
 
+        state_ptr->geometry_slot_freelist.free(geometry->internal_id, 1);
+
         memory_zero(internal_data, sizeof(Vulkan_Geometry_Data));
         internal_data->id         = INVALID_ID;
         internal_data->generation = INVALID_ID;
     }
 }
 
+void
+vulkan_get_geometry_buffer_stats(Geometry_Buffer_Stats *out_stats)
+{
+    out_stats->vertex = state_ptr->object_vertex_freelist.get_stats();
+    out_stats->index  = state_ptr->object_index_freelist.get_stats();
+}
+
 void
 vulkan_draw_geometry(Geometry_Render_Data data)
 {
-    if (!data.geometry || data.geometry->internal_id == INVALID_ID)
+    vulkan_draw_geometry_instanced(data.geometry, 1, &data.model);
+}
+
+void
+vulkan_draw_geometry_instanced(Geometry   *geometry,
+                               u32         instance_count,
+                               const mat4 *transforms)
+{
+    if (!geometry || geometry->internal_id == INVALID_ID || !instance_count)
     {
         return;
     }
 
-    Vulkan_Geometry_Data *buffer_data =
-        &state_ptr->registered_geometries[data.geometry->internal_id];
+    // Instances past the capacity of the region are dropped for this frame
+    u32 first_instance = state_ptr->frame_instance_count;
+    u32 available      = VULKAN_MAX_INSTANCE_COUNT - first_instance;
 
-    Vulkan_Command_Buffer *cmd_buffer =
-        &state_ptr->command_buffers[state_ptr->image_index];
+    if (instance_count > available)
+    {
+        if (!state_ptr->instance_overflow_reported)
+        {
+            CORE_WARN("vulkan_draw_geometry_instanced - More than %u "
+                      "instances in a frame, the rest are dropped",
+                      VULKAN_MAX_INSTANCE_COUNT);
+            state_ptr->instance_overflow_reported = true;
+        }
+
+        instance_count = available;
+        if (!instance_count)
+            return;
+    }
+
+    u64 region_offset = (u64)VULKAN_MAX_INSTANCE_COUNT * state_ptr->image_index;
 
-    // TODO: Check if this is needed
-    vulkan_material_shader_pipeline_use(state_ptr, &state_ptr->material_shader);
+    memory_copy(state_ptr->instance_memory + region_offset + first_instance,
+                transforms,
+                sizeof(mat4) * instance_count);
 
-    vulkan_material_shader_pipeline_set_model(state_ptr,
-                                              &state_ptr->material_shader,
-                                              data.model);
+    state_ptr->frame_instance_count += instance_count;
 
-    if (data.geometry->material)
+    Material *material = geometry->material ? geometry->material
+                                            : material_system_get_default();
+
+    // Descriptor sets cannot be written while the slices record, so the
+    // uniforms of the material are uploaded here. The draws come sorted by
+    // material, so comparing with the previous draw updates each once
+    u32                   draw_index = state_ptr->deferred_draw_count;
+    Vulkan_Deferred_Draw *previous =
+        draw_index > 0 ? &state_ptr->deferred_draws[draw_index - 1] : nullptr;
+
+    if (!previous || previous->material != material)
     {
-        vulkan_material_shader_pipeline_apply_material(
+        vulkan_material_shader_pipeline_update_material(
             state_ptr,
             &state_ptr->material_shader,
-            data.geometry->material);
+            material);
+    }
+
+    Vulkan_Deferred_Draw *draw = &state_ptr->deferred_draws[draw_index];
+    draw->geometry             = geometry;
+    draw->material             = material;
+    draw->first_instance       = first_instance;
+    draw->instance_count       = instance_count;
+
+    state_ptr->deferred_draw_count++;
+}
+
+INTERNAL_FUNC void
+record_deferred_draw(Vulkan_Command_Buffer      *cmd_buffer,
+                     Vulkan_Bind_State          *binds,
+                     const Vulkan_Deferred_Draw *draw)
+{
+    Vulkan_Geometry_Data *buffer_data =
+        &state_ptr->registered_geometries[draw->geometry->internal_id];
+
+    Vulkan_Material_Shader_Pipeline *shader = &state_ptr->material_shader;
+    if (binds->pipeline != shader->pipeline.handle)
+    {
+        vulkan_material_shader_pipeline_use(state_ptr, cmd_buffer, shader);
+        vulkan_material_shader_pipeline_bind_global_state(state_ptr,
+                                                          cmd_buffer,
+                                                          shader);
+        binds->pipeline    = shader->pipeline.handle;
+        binds->material_id = INVALID_ID;
+        binds->stats.change_count++;
     }
     else
     {
-        vulkan_material_shader_pipeline_apply_material(
-            state_ptr,
-            &state_ptr->material_shader,
-            material_system_get_default());
+        binds->stats.saved_count++;
     }
 
-    // Bind vertex and index buffers
-    VkDeviceSize offsets[1] = {buffer_data->vertex_buffer_offset};
-    vkCmdBindVertexBuffers(cmd_buffer->handle,
-                           0,
-                           1,
-                           &state_ptr->object_vertex_buffer.handle,
-                           offsets);
+    if (binds->material_id != draw->material->internal_id)
+    {
+        vulkan_material_shader_pipeline_bind_material(state_ptr,
+                                                      cmd_buffer,
+                                                      shader,
+                                                      draw->material);
+        binds->material_id = draw->material->internal_id;
+        binds->stats.change_count++;
+    }
+    else
+    {
+        binds->stats.saved_count++;
+    }
 
-    if (buffer_data->index_count > 0)
+    // All the geometries live in the same vertex and index buffers, so they
+    // are bound once and each draw offsets into them. Every range is a whole
+    // number of elements since the freelists only hand out whole elements
+    if (!binds->buffers_bound)
     {
+        u64 region_offset =
+            (u64)VULKAN_MAX_INSTANCE_COUNT * state_ptr->image_index;
+
+        VkBuffer     buffers[2] = {state_ptr->object_vertex_buffer.handle,
+                                   state_ptr->instance_buffer.handle};
+        VkDeviceSize offsets[2] = {0, region_offset * sizeof(mat4)};
+        vkCmdBindVertexBuffers(cmd_buffer->handle, 0, 2, buffers, offsets);
 
         vkCmdBindIndexBuffer(cmd_buffer->handle,
                              state_ptr->object_index_buffer.handle,
-                             buffer_data->index_buffer_offset,
+                             0,
                              VK_INDEX_TYPE_UINT32);
 
+        binds->buffers_bound = true;
+        binds->stats.change_count++;
+    }
+    else
+    {
+        binds->stats.saved_count++;
+    }
+
+    u32 first_vertex =
+        (u32)(buffer_data->vertex_buffer_offset / sizeof(Vertex_3d));
+
+    if (buffer_data->index_count > 0)
+    {
+        u32 first_index = (u32)(buffer_data->index_buffer_offset / sizeof(u32));
+
         // Issue the draw
         vkCmdDrawIndexed(cmd_buffer->handle,
                          buffer_data->index_count,
-                         1,
-                         0,
-                         0,
-                         0);
+                         draw->instance_count,
+                         first_index,
+                         (s32)first_vertex,
+                         draw->first_instance);
     }
     else
     {
-        vkCmdDraw(cmd_buffer->handle, buffer_data->vertex_count, 1, 0, 0);
+        vkCmdDraw(cmd_buffer->handle,
+                  buffer_data->vertex_count,
+                  draw->instance_count,
+                  first_vertex,
+                  draw->first_instance);
+    }
+}
+
+// Job entry, records the draws of a slice into its command buffer of the
+// current image. Only reads the context, which is not written before the jobs
+// are waited on
+INTERNAL_FUNC void
+record_viewport_slice(void *data)
+{
+    Vulkan_Recording_Slice *slice       = (Vulkan_Recording_Slice *)data;
+    u32                     image_index = state_ptr->image_index;
+
+    // The fence of the image was waited on in begin_frame, so the buffers
+    // allocated from the pool are no longer in use
+    VK_CHECK(vkResetCommandPool(state_ptr->device.logical_device,
+                                slice->pools[image_index],
+                                0));
+
+    Vulkan_Command_Buffer *cmd_buffer = &slice->command_buffers[image_index];
+
+    vulkan_command_buffer_begin_secondary(
+        cmd_buffer,
+        state_ptr->viewport_renderpass.handle,
+        state_ptr->viewport.framebuffers[image_index]);
+
+    vkCmdSetViewport(cmd_buffer->handle,
+                     0,
+                     1,
+                     &state_ptr->viewport_pass_viewport);
+    vkCmdSetScissor(cmd_buffer->handle,
+                    0,
+                    1,
+                    &state_ptr->viewport_pass_scissor);
+
+    Vulkan_Bind_State *binds = &slice->bind_state;
+
+    // The grid is the background, so it goes first in the first slice
+    if (slice->records_grid)
+    {
+        Vulkan_Grid_Shader_Pipeline *grid = &state_ptr->grid_shader;
+
+        vulkan_grid_shader_pipeline_use(state_ptr, cmd_buffer, grid);
+        vulkan_grid_shader_pipeline_bind_global_state(state_ptr,
+                                                      cmd_buffer,
+                                                      grid);
+        vulkan_grid_shader_pipeline_draw(state_ptr, cmd_buffer, grid);
+
+        binds->pipeline = grid->pipeline.handle;
+    }
+
+    for (u32 i = 0; i < slice->draw_count; ++i)
+    {
+        record_deferred_draw(cmd_buffer,
+                             binds,
+                             &state_ptr->deferred_draws[slice->first_draw + i]);
     }
+
+    vulkan_command_buffer_end(cmd_buffer);
+}
+
+INTERNAL_FUNC void
+record_viewport_pass(Vulkan_Command_Buffer *cmd_buffer)
+{
+    u32 draw_count = state_ptr->deferred_draw_count;
+
+    // Jobs are only worth it when each gets enough draws to record
+    u32 slice_count = (draw_count + VULKAN_MIN_DRAWS_PER_SLICE - 1) /
+                      VULKAN_MIN_DRAWS_PER_SLICE;
+    slice_count     = CLAMP(slice_count, 1u, state_ptr->recording_slice_count);
+
+    u32 draws_per_slice = (draw_count + slice_count - 1) / slice_count;
+
+    Job_Declaration jobs[VULKAN_MAX_RECORDING_SLICE_COUNT] = {};
+    VkCommandBuffer secondary_buffers[VULKAN_MAX_RECORDING_SLICE_COUNT];
+
+    for (u32 i = 0; i < slice_count; ++i)
+    {
+        Vulkan_Recording_Slice *slice = &state_ptr->recording_slices[i];
+
+        slice->first_draw   = MIN(i * draws_per_slice, draw_count);
+        slice->draw_count =
+            MIN(draws_per_slice, draw_count - slice->first_draw);
+        slice->records_grid = i == 0 && state_ptr->grid_pending;
+
+        slice->bind_state             = {};
+        slice->bind_state.material_id = INVALID_ID;
+
+        jobs[i].entry = record_viewport_slice;
+        jobs[i].data  = slice;
+
+        secondary_buffers[i] =
+            slice->command_buffers[state_ptr->image_index].handle;
+    }
+
+    if (slice_count == 1)
+    {
+        record_viewport_slice(&state_ptr->recording_slices[0]);
+    }
+    else
+    {
+        Job_Counter counter = {};
+        job_system_run(jobs, slice_count, &counter);
+        job_system_wait(&counter);
+    }
+
+    vkCmdExecuteCommands(cmd_buffer->handle, slice_count, secondary_buffers);
+
+    state_ptr->recorded_slice_count = slice_count;
+    state_ptr->deferred_draw_count  = 0;
+    state_ptr->grid_pending         = false;
+}
+
+void
+vulkan_get_bind_stats(Renderer_Bind_Stats *out_stats)
+{
+    *out_stats = {};
+
+    for (u32 i = 0; i < state_ptr->recorded_slice_count; ++i)
+    {
+        Renderer_Bind_Stats *stats =
+            &state_ptr->recording_slices[i].bind_state.stats;
+
+        out_stats->change_count += stats->change_count;
+        out_stats->saved_count += stats->saved_count;
+    }
+}
+
+b8
+vulkan_is_present_paced()
+{
+    VkPresentModeKHR mode = state_ptr->swapchain.present_mode;
+    return mode == VK_PRESENT_MODE_FIFO_KHR ||
+           mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
 }
 
 void
@@ -1869,9 +2462,9 @@ vulkan_draw_grid(mat4 projection, mat4 view, vec4 grid_color, f32 grid_spacing)
     shader->global_ubo.point_size_px      = point_size_px;
     shader->global_ubo.zoom_px_per_world  = zoom;
 
-    vulkan_grid_shader_pipeline_use(state_ptr, shader);
+    // Recorded by the first slice of the viewport pass
     vulkan_grid_shader_pipeline_update_global_state(state_ptr, shader);
-    vulkan_grid_shader_pipeline_draw(state_ptr, shader);
+    state_ptr->grid_pending = true;
 }
 
 void
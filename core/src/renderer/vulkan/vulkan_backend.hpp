@@ -24,13 +24,20 @@ b8 vulkan_renderpass_finish(struct Frame_Context *frame_ctx,
                             Renderpass_Type       renderpass_type);
 
 void vulkan_draw_geometry(Geometry_Render_Data data);
+void vulkan_draw_geometry_instanced(Geometry   *geometry,
+                                    u32         instance_count,
+                                    const mat4 *transforms);
+void vulkan_get_bind_stats(Renderer_Bind_Stats *out_stats);
+b8   vulkan_is_present_paced();
 void
 vulkan_draw_grid(mat4 projection, mat4 view, vec4 grid_color, f32 grid_spacing);
 void vulkan_set_viewport_clear_color(vec4 color);
 void vulkan_draw_ui(UI_Render_Data data);
 
-void
-vulkan_create_texture(const u8 *pixels, Texture *texture, b8 is_ui_texture);
+b8   vulkan_supports_texture_format(Texture_Format format);
+void vulkan_create_texture(const Texture_Mip *mips,
+                           Texture           *texture,
+                           b8                 is_ui_texture);
 void vulkan_destroy_texture(Texture *texture);
 
 b8   vulkan_create_material(struct Material *material);
@@ -42,6 +49,7 @@ b8   vulkan_create_geometry(Geometry        *geometry,
                             u32              index_count,
                             const u32       *indices);
 void vulkan_destroy_geometry(Geometry *geometry);
+void vulkan_get_geometry_buffer_stats(Geometry_Buffer_Stats *out_stats);
 
 // Viewport management
 void  vulkan_render_viewport();
@@ -77,6 +77,30 @@ void vulkan_command_buffer_begin(Vulkan_Command_Buffer *command_buffer,
     command_buffer->state = Command_Buffer_State::RECORDING;
 }
 
+void vulkan_command_buffer_begin_secondary(
+    Vulkan_Command_Buffer *command_buffer,
+    VkRenderPass renderpass,
+    VkFramebuffer framebuffer) {
+
+    // Secondary command buffers continuing a renderpass have to know which
+    // one, the framebuffer is optional but lets the driver optimize for it
+    VkCommandBufferInheritanceInfo inheritance_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance_info.renderPass = renderpass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                       VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    VK_CHECK(vkBeginCommandBuffer(command_buffer->handle, &begin_info));
+
+    command_buffer->state = Command_Buffer_State::IN_RENDER_PASS;
+}
+
 void vulkan_command_buffer_end(Vulkan_Command_Buffer *command_buffer) {
 
     VK_CHECK(vkEndCommandBuffer(command_buffer->handle));
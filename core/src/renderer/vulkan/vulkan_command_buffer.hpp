@@ -16,6 +16,13 @@ void vulkan_command_buffer_begin(Vulkan_Command_Buffer *command_buffer,
     b8 is_renderpass_continue,
     b8 is_simultaneous_use);
 
+// Begins a secondary command buffer recorded inside the first subpass of the
+// renderpass, to be executed by the primary buffer that begins it
+void vulkan_command_buffer_begin_secondary(
+    Vulkan_Command_Buffer *command_buffer,
+    VkRenderPass renderpass,
+    VkFramebuffer framebuffer);
+
 void vulkan_command_buffer_end(Vulkan_Command_Buffer *command_buffer);
 
 void vulkan_command_buffer_update_submitted(
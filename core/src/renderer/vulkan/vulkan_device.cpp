@@ -314,6 +314,12 @@ b8 create_logical_device(Vulkan_Context *context) {
     VkPhysicalDeviceFeatures device_features_to_request = {};
     device_features_to_request.samplerAnisotropy = VK_TRUE;
 
+    // Optional, the textures are cooked uncompressed without it
+    context->device.supports_block_compression =
+        context->device.physical_device_features.textureCompressionBC;
+    device_features_to_request.textureCompressionBC =
+        context->device.physical_device_features.textureCompressionBC;
+
     VkDeviceCreateInfo logical_device_create_info = {
         VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
 
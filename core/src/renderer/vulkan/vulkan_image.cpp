@@ -14,6 +14,7 @@ void vulkan_image_create(Vulkan_Context *context,
     VkImageType image_type,
     u32 width,
     u32 height,
+    u32 mip_levels,
     VkFormat format, // the format of the image
     VkImageTiling tiling,
     VkImageUsageFlags usage, // how will the image be used
@@ -30,6 +31,7 @@ void vulkan_image_create(Vulkan_Context *context,
 
     out_image->width = width;
     out_image->height = height;
+    out_image->mip_levels = mip_levels;
 
     VkImageCreateInfo image_create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
 
@@ -51,7 +53,7 @@ void vulkan_image_create(Vulkan_Context *context,
     // 			...
     // Level N: 1x1
     // If level is set to 1, no mipmapping will be used.
-    image_create_info.mipLevels = 1; // Single mip level for textures
+    image_create_info.mipLevels = mip_levels;
 
     // Used if we want an array of 2D images, not a 3D volume. Obviously without
     // specifying this, Vulkan cannot know how to interpret the other dimension.
@@ -159,7 +161,7 @@ void vulkan_image_view_create(Vulkan_Context *context,
 
     // TODO: Make config.
     view_create_info.subresourceRange.baseMipLevel = 0;
-    view_create_info.subresourceRange.levelCount = 1;
+    view_create_info.subresourceRange.levelCount = image->mip_levels;
     view_create_info.subresourceRange.baseArrayLayer = 0;
     view_create_info.subresourceRange.layerCount = 1;
 
@@ -222,7 +224,7 @@ void vulkan_image_transition_layout(Vulkan_Context *context,
     barrier.image = image->handle;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = image->mip_levels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -286,22 +288,26 @@ void vulkan_image_transition_layout(Vulkan_Context *context,
 void vulkan_image_copy_from_buffer(Vulkan_Context *context,
     Vulkan_Image *image,
     VkBuffer buffer,
+    u64 buffer_offset,
+    u32 mip_level,
     Vulkan_Command_Buffer *command_buffer) {
 
     VkBufferImageCopy region;
     memory_zero(&region, sizeof(VkBufferImageCopy));
-    region.bufferOffset = 0;
+    region.bufferOffset = buffer_offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     // Specify that this is a color image
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0; // Not using mipMapping
+    region.imageSubresource.mipLevel = mip_level;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
 
-    region.imageExtent.width = image->width;
-    region.imageExtent.height = image->height;
+    // Block compressed mips smaller than a block are copied whole, the extent
+    // is allowed to stop at the edge of the mip
+    region.imageExtent.width = MAX(1u, image->width >> mip_level);
+    region.imageExtent.height = MAX(1u, image->height >> mip_level);
     region.imageExtent.depth = 1; // Currently support only 2D images
 
     vkCmdCopyBufferToImage(command_buffer->handle,
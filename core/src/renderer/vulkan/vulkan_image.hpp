@@ -8,6 +8,7 @@ void vulkan_image_create(Vulkan_Context *context,
     VkImageType image_type,
     u32 width,
     u32 height,
+    u32 mip_levels,
     VkFormat format, // the format of the image
     VkImageTiling tiling,
     VkImageUsageFlags usage, // how will the image be used
@@ -25,7 +26,7 @@ void vulkan_image_destroy(Vulkan_Context *context, Vulkan_Image *image);
 
 // Takes the different image layouts into a new layout. It allows to optimize
 // the image layout from the layout that it uses in disk to a layout that is
-// optimized for the renderer
+// optimized for the renderer. All the mip levels are transitioned
 void vulkan_image_transition_layout(Vulkan_Context *context,
     Vulkan_Command_Buffer *command_buffer,
     Vulkan_Image *image,
@@ -33,8 +34,11 @@ void vulkan_image_transition_layout(Vulkan_Context *context,
     VkImageLayout old_layout,
     VkImageLayout new_layout);
 
-// Takes the data from the buffer and copies it over to the actual image
+// Takes the data from the buffer (starting at buffer_offset) and copies it over
+// to one mip level of the actual image
 void vulkan_image_copy_from_buffer(Vulkan_Context *context,
     Vulkan_Image *image,
     VkBuffer buffer,
+    u64 buffer_offset,
+    u32 mip_level,
     Vulkan_Command_Buffer *command_buffer);
@@ -7,7 +7,8 @@
 b8
 vulkan_graphics_pipeline_create(Vulkan_Context    *context,
                                 Vulkan_Renderpass *renderpass,
-                                u32                stride,
+                                u32                binding_count,
+                                VkVertexInputBindingDescription *bindings,
                                 u32                attribute_count,
                                 VkVertexInputAttributeDescription *attributes,
                                 u32 descriptor_set_layout_count,
@@ -126,15 +127,10 @@ vulkan_graphics_pipeline_create(Vulkan_Context    *context,
     dynamic_state_create_info.dynamicStateCount = dynamic_state_count;
     dynamic_state_create_info.pDynamicStates    = dynamic_states;
 
-    VkVertexInputBindingDescription binding_description;
-    binding_description.binding   = 0;
-    binding_description.stride    = stride;
-    binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
     VkPipelineVertexInputStateCreateInfo vertex_input_info = {
         VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertex_input_info.vertexBindingDescriptionCount   = 1;
-    vertex_input_info.pVertexBindingDescriptions      = &binding_description;
+    vertex_input_info.vertexBindingDescriptionCount   = binding_count;
+    vertex_input_info.pVertexBindingDescriptions      = bindings;
     vertex_input_info.vertexAttributeDescriptionCount = attribute_count;
     vertex_input_info.pVertexAttributeDescriptions    = attributes;
 
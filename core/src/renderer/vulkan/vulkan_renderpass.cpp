@@ -184,7 +184,8 @@ vulkan_renderpass_destroy(Vulkan_Context    *context,
 void
 vulkan_renderpass_begin(Vulkan_Command_Buffer *command_buffer,
                         Vulkan_Renderpass     *renderpass,
-                        VkFramebuffer          frame_buffer)
+                        VkFramebuffer          frame_buffer,
+                        VkSubpassContents      contents)
 {
 
     VkRenderPassBeginInfo begin_info = {
@@ -238,9 +239,7 @@ vulkan_renderpass_begin(Vulkan_Command_Buffer *command_buffer,
 
     begin_info.pClearValues = begin_info.clearValueCount > 0 ? clear_values : 0;
 
-    vkCmdBeginRenderPass(command_buffer->handle,
-                         &begin_info,
-                         VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(command_buffer->handle, &begin_info, contents);
 
     command_buffer->state = Command_Buffer_State::IN_RENDER_PASS;
 }
@@ -38,9 +38,12 @@ void vulkan_renderpass_create(Vulkan_Context *context,
 void vulkan_renderpass_destroy(Vulkan_Context *context,
     Vulkan_Renderpass *renderpass);
 
+// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the commands of the pass
+// can only come from secondary command buffers executed by the primary one
 void vulkan_renderpass_begin(Vulkan_Command_Buffer *command_buffer,
     Vulkan_Renderpass *renderpass,
-    VkFramebuffer frame_buffer);
+    VkFramebuffer frame_buffer,
+    VkSubpassContents contents);
 
 void vulkan_renderpass_end(Vulkan_Command_Buffer *command_buffer,
     Vulkan_Renderpass *renderpass);
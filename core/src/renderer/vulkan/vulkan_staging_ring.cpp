@@ -0,0 +1,404 @@
+#include "vulkan_staging_ring.hpp"
+#include "core/logger.hpp"
+#include "memory/memory.hpp"
+#include "vulkan_buffer.hpp"
+#include "vulkan_command_buffer.hpp"
+#include "vulkan_image.hpp"
+#include "vulkan_utils.hpp"
+
+INTERNAL_FUNC Vulkan_Staging_Batch *recording_batch(Vulkan_Staging_Ring *ring) {
+    u32 index = (ring->oldest_batch + ring->in_flight_count) %
+                VULKAN_STAGING_BATCH_COUNT;
+
+    return &ring->batches[index];
+}
+
+INTERNAL_FUNC void retire_oldest_batch(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    Vulkan_Staging_Batch *batch = &ring->batches[ring->oldest_batch];
+
+    VK_CHECK(vkResetFences(context->device.logical_device, 1, &batch->fence));
+
+    // Everything up to the end of the batch has been consumed by the GPU
+    ring->tail = batch->ring_end;
+    batch->copy_count = 0;
+
+    ring->oldest_batch = (ring->oldest_batch + 1) % VULKAN_STAGING_BATCH_COUNT;
+    ring->in_flight_count--;
+}
+
+// Non blocking. Batches complete in submission order, so we stop at the first
+// one that is still pending
+INTERNAL_FUNC void reclaim_completed_batches(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    while (ring->in_flight_count > 0) {
+        Vulkan_Staging_Batch *batch = &ring->batches[ring->oldest_batch];
+
+        if (vkGetFenceStatus(context->device.logical_device, batch->fence) !=
+            VK_SUCCESS) {
+            break;
+        }
+
+        retire_oldest_batch(context, ring);
+    }
+}
+
+INTERNAL_FUNC void wait_oldest_batch(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    Vulkan_Staging_Batch *batch = &ring->batches[ring->oldest_batch];
+
+    VK_CHECK(vkWaitForFences(context->device.logical_device,
+        1,
+        &batch->fence,
+        VK_TRUE,
+        UINT64_MAX));
+
+    retire_oldest_batch(context, ring);
+}
+
+// Reserves a contiguous range of the ring. Regions never wrap around the end of
+// the buffer, the leftover bytes at the end are skipped instead. When the ring
+// is full we only block on the oldest batch, not on the whole queue
+INTERNAL_FUNC b8 reserve_ring_range(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring,
+    u64 size,
+    u64 *out_offset) {
+
+    u64 aligned_size = ALIGN_UP_POW2(size, ring->alignment);
+
+    if (aligned_size > ring->capacity) {
+        return false;
+    }
+
+    while (true) {
+        reclaim_completed_batches(context, ring);
+
+        // Nothing is pending, start again from the beginning of the buffer so
+        // that the largest possible range is available
+        if (ring->head == ring->tail) {
+            ring->head = 0;
+            ring->tail = 0;
+        }
+
+        u64 start = ring->head;
+        u64 offset = start % ring->capacity;
+
+        if (offset + aligned_size > ring->capacity) {
+            start += ring->capacity - offset;
+        }
+
+        u64 end = start + aligned_size;
+
+        if (end - ring->tail <= ring->capacity) {
+            ring->head = end;
+            *out_offset = start % ring->capacity;
+            return true;
+        }
+
+        // Ring is full. Submit what was recorded so far so that there is
+        // something to wait on
+        if (recording_batch(ring)->copy_count > 0 &&
+            !vulkan_staging_ring_flush(context, ring)) {
+            return false;
+        }
+
+        if (ring->in_flight_count == 0) {
+            CORE_ERROR("reserve_ring_range - Ring is full without any batch in "
+                       "flight");
+            return false;
+        }
+
+        wait_oldest_batch(context, ring);
+    }
+}
+
+// Returns the batch that records the next copy. The first copy of a batch
+// begins the command buffer
+INTERNAL_FUNC Vulkan_Staging_Batch *begin_batch_copy(
+    Vulkan_Staging_Ring *ring) {
+
+    Vulkan_Staging_Batch *batch = recording_batch(ring);
+
+    if (batch->copy_count == 0) {
+        vulkan_command_buffer_reset(&batch->command_buffer);
+        vulkan_command_buffer_begin(&batch->command_buffer, true, false, false);
+
+        // Buffer ranges may be released and handed out again while an earlier
+        // frame is still reading them. Make the copies wait for all previously
+        // submitted work (write-after-read only needs an execution dependency)
+        vkCmdPipelineBarrier(batch->command_buffer.handle,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            nullptr);
+    }
+
+    return batch;
+}
+
+INTERNAL_FUNC void end_batch_copy(Vulkan_Staging_Ring *ring,
+    Vulkan_Staging_Batch *batch,
+    u64 size) {
+
+    batch->copy_count++;
+    batch->ring_end = ring->head;
+    ring->uploaded_bytes += size;
+}
+
+b8 vulkan_staging_ring_create(Vulkan_Context *context,
+    u64 capacity,
+    Vulkan_Staging_Ring *out_ring) {
+
+    memory_zero(out_ring, sizeof(Vulkan_Staging_Ring));
+
+    if (!vulkan_buffer_create(context,
+            capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            true,
+            &out_ring->buffer)) {
+        CORE_ERROR("vulkan_staging_ring_create - Failed to create the buffer");
+        return false;
+    }
+
+    // The memory is coherent, so it stays mapped and no flush is needed after
+    // writing into it
+    out_ring->mapped_memory = static_cast<u8 *>(
+        vulkan_buffer_lock_memory(context, &out_ring->buffer, 0, capacity, 0));
+    out_ring->buffer.is_locked = true;
+
+    out_ring->capacity = capacity;
+    out_ring->alignment = MAX(VULKAN_STAGING_MIN_ALIGNMENT,
+        context->device.physical_device_properties.limits
+            .optimalBufferCopyOffsetAlignment);
+
+    RUNTIME_ASSERT_MSG(capacity % out_ring->alignment == 0,
+        "vulkan_staging_ring_create - Capacity must be a multiple of the copy "
+        "alignment");
+
+    VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+
+    for (u32 i = 0; i < VULKAN_STAGING_BATCH_COUNT; ++i) {
+        vulkan_command_buffer_allocate(context,
+            context->device.graphics_command_pool,
+            true,
+            &out_ring->batches[i].command_buffer);
+
+        VK_CHECK(vkCreateFence(context->device.logical_device,
+            &fence_create_info,
+            context->allocator,
+            &out_ring->batches[i].fence));
+    }
+
+    CORE_INFO("Staging ring created (%llu bytes)", capacity);
+
+    return true;
+}
+
+void vulkan_staging_ring_destroy(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    CORE_DEBUG("Staging ring uploaded %llu bytes in %llu batches",
+        ring->uploaded_bytes,
+        ring->submitted_batches);
+
+    for (u32 i = 0; i < VULKAN_STAGING_BATCH_COUNT; ++i) {
+        Vulkan_Staging_Batch *batch = &ring->batches[i];
+
+        if (batch->fence) {
+            vkDestroyFence(context->device.logical_device,
+                batch->fence,
+                context->allocator);
+        }
+
+        if (batch->command_buffer.handle) {
+            vulkan_command_buffer_free(context,
+                context->device.graphics_command_pool,
+                &batch->command_buffer);
+        }
+    }
+
+    if (ring->mapped_memory) {
+        vulkan_buffer_unlock_memory(context, &ring->buffer);
+    }
+
+    vulkan_buffer_destroy(context, &ring->buffer);
+
+    memory_zero(ring, sizeof(Vulkan_Staging_Ring));
+}
+
+b8 vulkan_staging_ring_upload_buffer(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring,
+    Vulkan_Buffer *dest,
+    u64 dest_offset,
+    u64 size,
+    const void *data) {
+
+    if (size == 0) {
+        return true;
+    }
+
+    u64 ring_offset;
+    if (!reserve_ring_range(context, ring, size, &ring_offset)) {
+        return false;
+    }
+
+    memory_copy(ring->mapped_memory + ring_offset, data, size);
+
+    Vulkan_Staging_Batch *batch = begin_batch_copy(ring);
+
+    VkBufferCopy copy_region;
+    copy_region.srcOffset = ring_offset;
+    copy_region.dstOffset = dest_offset;
+    copy_region.size = size;
+
+    vkCmdCopyBuffer(batch->command_buffer.handle,
+        ring->buffer.handle,
+        dest->handle,
+        1,
+        &copy_region);
+
+    end_batch_copy(ring, batch, size);
+
+    return true;
+}
+
+b8 vulkan_staging_ring_upload_image(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring,
+    Vulkan_Image *image,
+    VkFormat format,
+    const Texture_Mip *mips,
+    u32 mip_count) {
+
+    // Each mip starts on the minimum alignment, which covers the texel and
+    // block size of every format
+    u64 size = 0;
+    for (u32 i = 0; i < mip_count; ++i) {
+        size = ALIGN_UP_POW2(size, VULKAN_STAGING_MIN_ALIGNMENT);
+        size += mips[i].size;
+    }
+
+    u64 ring_offset;
+    if (!reserve_ring_range(context, ring, size, &ring_offset)) {
+        return false;
+    }
+
+    Vulkan_Staging_Batch *batch = begin_batch_copy(ring);
+
+    vulkan_image_transition_layout(context,
+        &batch->command_buffer,
+        image,
+        format,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    u64 mip_offset = ring_offset;
+
+    for (u32 i = 0; i < mip_count; ++i) {
+        mip_offset = ALIGN_UP_POW2(mip_offset, VULKAN_STAGING_MIN_ALIGNMENT);
+
+        memory_copy(ring->mapped_memory + mip_offset,
+            mips[i].data,
+            mips[i].size);
+
+        vulkan_image_copy_from_buffer(context,
+            image,
+            ring->buffer.handle,
+            mip_offset,
+            i,
+            &batch->command_buffer);
+
+        mip_offset += mips[i].size;
+    }
+
+    vulkan_image_transition_layout(context,
+        &batch->command_buffer,
+        image,
+        format,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    end_batch_copy(ring, batch, size);
+
+    return true;
+}
+
+b8 vulkan_staging_ring_flush(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    Vulkan_Staging_Batch *batch = recording_batch(ring);
+
+    if (batch->copy_count == 0) {
+        return true;
+    }
+
+    // Make the buffer writes visible to everything submitted after the batch:
+    // vertex fetch, shader reads and buffer to buffer copies of resizes. The
+    // image copies carry their own layout transition barrier
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(batch->command_buffer.handle,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    vulkan_command_buffer_end(&batch->command_buffer);
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch->command_buffer.handle;
+
+    VkResult result = vkQueueSubmit(context->device.graphics_queue,
+        1,
+        &submit_info,
+        batch->fence);
+
+    if (result != VK_SUCCESS) {
+        CORE_ERROR("vulkan_staging_ring_flush - vkQueueSubmit failed: '%s'",
+            vulkan_result_string(result, true));
+        return false;
+    }
+
+    vulkan_command_buffer_update_submitted(&batch->command_buffer);
+
+    ring->submitted_batches++;
+    ring->in_flight_count++;
+
+    // The next recording batch must not be one that is still in flight
+    if (ring->in_flight_count == VULKAN_STAGING_BATCH_COUNT) {
+        wait_oldest_batch(context, ring);
+    }
+
+    return true;
+}
+
+void vulkan_staging_ring_wait_idle(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring) {
+
+    vulkan_staging_ring_flush(context, ring);
+
+    while (ring->in_flight_count > 0) {
+        wait_oldest_batch(context, ring);
+    }
+}
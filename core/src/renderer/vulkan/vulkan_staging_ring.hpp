@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vulkan_types.hpp"
+
+// The copies need an offset that is a multiple of the texel or block size for
+// image uploads, 16 covers every format we use
+constexpr const u64 VULKAN_STAGING_MIN_ALIGNMENT = 16;
+
+// Creates the staging buffer, maps it for the whole lifetime of the ring and
+// allocates the command buffers/fences of the batches
+b8 vulkan_staging_ring_create(Vulkan_Context *context,
+    u64 capacity,
+    Vulkan_Staging_Ring *out_ring);
+
+void vulkan_staging_ring_destroy(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring);
+
+// Copies the data into the ring and records a copy into the dest buffer. The
+// copy is executed when the batch is flushed. Returns false if the data does
+// not fit in the ring, in which case the caller has to upload it by other means
+b8 vulkan_staging_ring_upload_buffer(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring,
+    Vulkan_Buffer *dest,
+    u64 dest_offset,
+    u64 size,
+    const void *data);
+
+// Same as above for every mip of a 2D image, packed in one range of the ring.
+// The image is left in the SHADER_READ_ONLY_OPTIMAL layout
+b8 vulkan_staging_ring_upload_image(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring,
+    Vulkan_Image *image,
+    VkFormat format,
+    const Texture_Mip *mips,
+    u32 mip_count);
+
+// Submits the copies recorded since the last flush in a single command buffer.
+// Work submitted to the graphics queue afterwards sees the uploaded data
+b8 vulkan_staging_ring_flush(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring);
+
+// Flushes and blocks until every submitted batch has completed
+void vulkan_staging_ring_wait_idle(Vulkan_Context *context,
+    Vulkan_Staging_Ring *ring);
@@ -97,6 +97,8 @@ void create_swapchain(Vulkan_Context *context,
     }
     CORE_INFO("Vulkan presentation mode: %s", present_mode_name);
 
+    out_swapchain->present_mode = selected_present_mode;
+
     // The swap extent is the resolution of the swap chain images and it is
     // almost always equal to the resolution of the windows (with the exception)
     // of Apple's Retina Displas (TODO).
@@ -188,8 +190,9 @@ void create_swapchain(Vulkan_Context *context,
         &out_swapchain->image_count,
         nullptr);
 
-    RUNTIME_ASSERT_MSG(out_swapchain->image_count <= 4,
-        "Swapchain image count exceeds fixed array size of 4");
+    RUNTIME_ASSERT_MSG(
+        out_swapchain->image_count <= VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT,
+        "Swapchain image count exceeds VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT");
 
     vkGetSwapchainImagesKHR(context->device.logical_device,
         out_swapchain->handle,
@@ -4,6 +4,7 @@
 #include "defines.hpp"
 
 #include "data_structures/dynamic_array.hpp"
+#include "data_structures/freelist.hpp"
 #include "data_structures/memory_pool.hpp"
 #include "renderer/renderer_types.hpp"
 #include <vulkan/vulkan.h>
@@ -45,6 +46,7 @@ struct Vulkan_Device
     u32 present_queue_index;
 
     b8 supports_device_local_host_visible;
+    b8 supports_block_compression; // BC formats can be sampled
 
     // Physical device informations
     VkPhysicalDeviceProperties       physical_device_properties;
@@ -70,6 +72,7 @@ struct Vulkan_Image
     VkDeviceMemory memory; // Handle to the memory allocated by the image
     u32            width;
     u32            height;
+    u32            mip_levels;
 };
 
 // Finite state machine of the renderpass
@@ -120,6 +123,7 @@ struct Vulkan_Swapchain
     u64 framebuffer_size_last_generation;
 
     VkSurfaceFormatKHR image_format;
+    VkPresentModeKHR   present_mode;
     VkExtent2D         extent;
 };
 
@@ -158,6 +162,45 @@ struct Vulkan_Command_Buffer
     Command_Buffer_State state;
 };
 
+constexpr const u32 VULKAN_STAGING_BATCH_COUNT = 4;
+constexpr const u64 VULKAN_STAGING_RING_SIZE   = 64 * MiB;
+
+// A batch groups all the copies recorded between two flushes into a single
+// command buffer. The fence tells when the ring range used by the batch can be
+// overwritten
+struct Vulkan_Staging_Batch
+{
+    Vulkan_Command_Buffer command_buffer;
+    VkFence               fence;
+
+    u64 ring_end; // Ring position right after the last region of the batch
+    u32 copy_count;
+};
+
+// Persistently mapped host-visible buffer used as the source of all the
+// buffer and image uploads. Positions are monotonic byte counters, the offset
+// inside the buffer is position % capacity. [tail, head) is the range still
+// owned by recorded or in-flight batches
+struct Vulkan_Staging_Ring
+{
+    Vulkan_Buffer buffer;
+    u8           *mapped_memory;
+    u64           capacity;
+    u64           alignment;
+
+    u64 head;
+    u64 tail;
+
+    // Batches are used in order. The recording batch is the one right after
+    // the in-flight ones
+    Vulkan_Staging_Batch batches[VULKAN_STAGING_BATCH_COUNT];
+    u32                  oldest_batch;
+    u32                  in_flight_count;
+
+    u64 uploaded_bytes;
+    u64 submitted_batches;
+};
+
 struct Vulkan_Shader_Stage
 {
     VkShaderModuleCreateInfo        create_info;
@@ -182,16 +225,32 @@ constexpr const u32 VULKAN_MAX_MATERIAL_COUNT = 1024;
 constexpr const u32 VULKAN_MAX_GEOMETRY_COUNT     = 4096;
 constexpr const u32 VULKAN_MAX_TEXTURE_DATA_COUNT = 1024;
 
+// NOTE: Most images a swapchain is created with. The minimum image count is
+// only a lower bound, the driver can hand out more
+constexpr const u32 VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT = 4;
+
+// NOTE: Max number of instance transforms drawn in a frame. The instance buffer
+// holds one region of this size per swapchain image, indexed by image index
+constexpr const u32 VULKAN_MAX_INSTANCE_COUNT = 128 * 1024;
+constexpr const u32 VULKAN_INSTANCE_BUFFER_REGION_COUNT =
+    VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT;
+
+// NOTE: Max number of secondary command buffers the viewport pass is recorded
+// into, one per job. Passes with fewer draws per slice than the minimum are
+// split in fewer slices, since each job costs more than it saves
+constexpr const u32 VULKAN_MAX_RECORDING_SLICE_COUNT = 16;
+constexpr const u32 VULKAN_MIN_DRAWS_PER_SLICE       = 256;
+
 struct Vulkan_Geometry_Data
 {
     Geometry_ID id;
     u32         generation;
     u32         vertex_count;
     u32         vertex_size;
-    u32         vertex_buffer_offset;
+    u64         vertex_buffer_offset;
     u32         index_count;
     u32         index_size;
-    u32         index_buffer_offset;
+    u64         index_buffer_offset;
 };
 
 // TODO: I am assuming there will be for sure 3 swapchain images available
@@ -310,6 +369,42 @@ struct Vulkan_Texture_Data
     VkDescriptorSet ui_descriptor_set;
 };
 
+// State bound by the draws recorded into a command buffer. A draw that finds
+// its state already bound skips the bind
+struct Vulkan_Bind_State
+{
+    VkPipeline pipeline;
+    u32        material_id;
+    b8         buffers_bound;
+
+    Renderer_Bind_Stats stats;
+};
+
+// A draw of the viewport pass. Its transforms are already in the instance
+// buffer, the commands are recorded when the pass is finished
+struct Vulkan_Deferred_Draw
+{
+    Geometry *geometry;
+    Material *material;
+    u32       first_instance;
+    u32       instance_count;
+};
+
+// Draws of the viewport pass recorded by one job. Command pools cannot be used
+// by two threads at once, so every slice owns a pool per swapchain image which
+// is reset once the fence of the image has been waited on
+struct Vulkan_Recording_Slice
+{
+    VkCommandPool         pools[VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT];
+    Vulkan_Command_Buffer command_buffers[VULKAN_MAX_SWAPCHAIN_IMAGE_COUNT];
+
+    u32 first_draw;
+    u32 draw_count;
+    b8  records_grid;
+
+    Vulkan_Bind_State bind_state;
+};
+
 struct Vulkan_Context
 {
     f32 frame_delta_time;
@@ -349,6 +444,25 @@ struct Vulkan_Context
     Vulkan_Buffer object_vertex_buffer;
     Vulkan_Buffer object_index_buffer;
 
+    // Per-instance model matrices read by the material shader as a vertex
+    // attribute. Persistently mapped, the region of the current image is
+    // refilled every frame
+    Vulkan_Buffer instance_buffer;
+    mat4         *instance_memory;
+    u32           frame_instance_count;
+    b8            instance_overflow_reported;
+
+    // The viewport pass is recorded into secondary command buffers by the job
+    // system once it is finished, the primary buffer only executes them
+    Vulkan_Deferred_Draw  *deferred_draws; // VULKAN_MAX_INSTANCE_COUNT
+    u32                    deferred_draw_count;
+    b8                     grid_pending;
+    VkViewport             viewport_pass_viewport;
+    VkRect2D               viewport_pass_scissor;
+    Vulkan_Recording_Slice recording_slices[VULKAN_MAX_RECORDING_SLICE_COUNT];
+    u32                    recording_slice_count; // Created ones
+    u32                    recorded_slice_count;  // Used by the last pass
+
     // Command buffers for rendering ui components
     Dynamic_Array<Vulkan_Command_Buffer> command_buffers;
 
@@ -362,11 +476,18 @@ struct Vulkan_Context
     // The fences are not owned by this array
     VkFence *images_in_flight[3];
 
-    u64 geometry_vertex_offset;
-    u64 geometry_index_offset;
+    // Sub-allocators for the ranges of the object vertex/index buffers. The
+    // buffers are grown when the freelists cannot serve an upload
+    Freelist<u64> object_vertex_freelist;
+    Freelist<u64> object_index_freelist;
+
+    // Source of all the vertex/index/texture uploads. Copies are batched and
+    // submitted once per frame before the frame command buffer
+    Vulkan_Staging_Ring staging_ring;
 
     // TODO: Make dynamic
     Vulkan_Geometry_Data registered_geometries[VULKAN_MAX_GEOMETRY_COUNT];
+    Freelist<u32>        geometry_slot_freelist;
 
     Arena                           *texture_data_arena;
     Memory_Pool<Vulkan_Texture_Data> texture_data_pool;
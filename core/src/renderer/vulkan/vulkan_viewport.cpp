@@ -59,6 +59,7 @@ void vulkan_viewport_create(Vulkan_Context *context,
             VK_IMAGE_TYPE_2D,
             width,
             height,
+            1,
             out_viewport->image_format.format,
             VK_IMAGE_TILING_OPTIMAL,
             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -99,6 +100,7 @@ void vulkan_viewport_create(Vulkan_Context *context,
         VK_IMAGE_TYPE_2D,
         width,
         height,
+        1,
         context->device.depth_format,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
@@ -2,91 +2,297 @@
 #include "core/asserts.hpp"
 #include "core/logger.hpp"
 #include "memory/memory.hpp"
+#include "platform/filesystem.hpp"
 #include "resources/resource_types.hpp"
 #include "systems/resource_system.hpp"
 #include "utils/string.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+// The transparency scan tests the alpha of a whole register of pixels at once.
+// It can be disabled with VOLTRUM_IMAGE_SCALAR_SCAN
+#if !defined(VOLTRUM_IMAGE_SCALAR_SCAN) && defined(__AVX2__)
+#    define IMAGE_SCAN_AVX2 1
+#    include <immintrin.h>
+#elif !defined(VOLTRUM_IMAGE_SCALAR_SCAN) &&                                   \
+    (defined(__SSE2__) || defined(_M_X64))
+#    define IMAGE_SCAN_SSE2 1
+#    include <emmintrin.h>
+#endif
 
-b8
-image_loader_load(Arena      *arena,
-                  const char *name,
-                  Resource   *out_resource)
+// Bytes scanned between two checks of the accumulated alpha
+constexpr u64 IMAGE_SCAN_BLOCK_SIZE = 256;
+
+// Decode allocations are prefixed with their size. The prefix keeps the
+// pixels aligned for the scan
+constexpr u64 IMAGE_DECODE_HEADER_SIZE = 16;
+
+// Arena the decode in progress on this thread allocates from. The images are
+// also decoded by the texture streaming jobs
+internal_var THREAD_STATIC Arena *decode_arena = nullptr;
+
+INTERNAL_FUNC b8
+is_top_allocation(const u8 *pointer, u64 size)
 {
-    if (!arena || !name || !out_resource)
+    Arena *current = decode_arena->current;
+
+    return pointer + size ==
+           static_cast<u8 *>(current->memory) + current->offset;
+}
+
+INTERNAL_FUNC void *
+decode_allocate(u64 size)
+{
+    RUNTIME_ASSERT_MSG(decode_arena,
+                       "decode_allocate - stb_image used outside of "
+                       "image_loader_decode");
+
+    u8 *block = (u8 *)_arena_push(decode_arena,
+                                  IMAGE_DECODE_HEADER_SIZE + size,
+                                  IMAGE_DECODE_HEADER_SIZE,
+                                  false,
+                                  __FILE__,
+                                  __LINE__);
+
+    *(u64 *)block = size;
+
+    return block + IMAGE_DECODE_HEADER_SIZE;
+}
+
+// Only the allocation on top of the arena is given back. Decoding allocates
+// few buffers and grows the last one, so little is left behind
+INTERNAL_FUNC void
+decode_free(void *pointer)
+{
+    if (!pointer)
+        return;
+
+    u8 *data  = (u8 *)pointer;
+    u8 *block = data - IMAGE_DECODE_HEADER_SIZE;
+
+    if (is_top_allocation(data, *(u64 *)block))
     {
-        CORE_ERROR("image_loader_load - Ensure all pointers are not nullptr");
-        return false;
+        Arena *current = decode_arena->current;
+        arena_pop_to(decode_arena,
+                     current->base_position +
+                         (block - static_cast<u8 *>(current->memory)));
+    }
+}
+
+INTERNAL_FUNC void *
+decode_reallocate(void *pointer, u64 new_size)
+{
+    if (!pointer)
+        return decode_allocate(new_size);
+
+    u8 *data     = (u8 *)pointer;
+    u64 old_size = *(u64 *)(data - IMAGE_DECODE_HEADER_SIZE);
+
+    // Grows in place unless the growth would chain another block
+    Arena *current = decode_arena->current;
+    u64    growth  = new_size > old_size ? new_size - old_size : 0;
+    b8     fits    = current->offset + growth <= current->reserved_memory;
+
+    if (fits && is_top_allocation(data, old_size))
+    {
+        if (new_size > old_size)
+        {
+            _arena_push(decode_arena,
+                        new_size - old_size,
+                        1,
+                        false,
+                        __FILE__,
+                        __LINE__);
+        }
+        else
+        {
+            arena_pop(decode_arena, old_size - new_size);
+        }
+
+        *(u64 *)(data - IMAGE_DECODE_HEADER_SIZE) = new_size;
+        return data;
     }
 
+    void *result = decode_allocate(new_size);
+    memory_copy(result, data, MIN(old_size, new_size));
+
+    return result;
+}
+
+#define STBI_MALLOC(size)                      decode_allocate(size)
+#define STBI_REALLOC_SIZED(pointer, old, size) decode_reallocate(pointer, size)
+#define STBI_FREE(pointer)                     decode_free(pointer)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+b8
+image_loader_decode(Arena               *arena,
+                    const u8            *data,
+                    u64                  size,
+                    b8                   flip_vertically,
+                    Image_Resource_Data *out_image)
+{
     const s32 required_channel_count = 4; // RGBA
 
+    u64 position = arena_position(arena);
+
     // NOTE: Most images are stored in a format where the data is actually
     // stored upside-down, so if we load the data from the bottom -> up we
-    // should technically retrieve the original orientation
-    stbi_set_flip_vertically_on_load(true);
-
-    String full_path = string_fmt(arena,
-                               "%s/%s/%s%s",
-                               resource_system_base_path(),
-                               "textures",
-                               name,
-                               ".png");
+    // should technically retrieve the original orientation. The flag is set
+    // per thread since images are also decoded by the texture streaming jobs
+    stbi_set_flip_vertically_on_load_thread(flip_vertically);
 
     s32 width;
     s32 height;
     s32 channel_count;
 
-    u8 *data = stbi_load((const char *)full_path.buff,
-                         &width,
-                         &height,
-                         &channel_count,
-                         required_channel_count);
+    decode_arena = arena;
+
+    u8 *pixels = stbi_load_from_memory(data,
+                                       (s32)size,
+                                       &width,
+                                       &height,
+                                       &channel_count,
+                                       required_channel_count);
+
+    decode_arena = nullptr;
 
-    const char *fail_reason = stbi_failure_reason();
-    if (fail_reason)
+    if (!pixels)
     {
-        CORE_ERROR("Image resource loader failed to load file '%s': '%s'",
-                   (const char *)full_path.buff,
-                   fail_reason);
+        const char *fail_reason = stbi_failure_reason();
+        CORE_ERROR("image_loader_decode - Failed to decode image: '%s'",
+                   fail_reason ? fail_reason : "unknown error");
 
-        stbi__err(0, 0);
+        arena_pop_to(arena, position);
+        return false;
+    }
+
+    out_image->pixels        = pixels;
+    out_image->width         = width;
+    out_image->height        = height;
+    out_image->channel_count = required_channel_count;
+
+    return true;
+}
+
+b8
+image_loader_decode_file(Arena               *arena,
+                         const char          *path,
+                         b8                   flip_vertically,
+                         Image_Resource_Data *out_image)
+{
+    File_Mapping mapping;
+    if (!filesystem_map(path, &mapping))
+    {
+        CORE_ERROR("image_loader_decode_file - Unable to open file '%s'",
+                   path);
+        return false;
+    }
+
+    b8 result = image_loader_decode(arena,
+                                    mapping.data,
+                                    mapping.size,
+                                    flip_vertically,
+                                    out_image);
+
+    filesystem_unmap(&mapping);
 
-        if (data)
+    if (!result)
+    {
+        CORE_ERROR("image_loader_decode_file - Failed to load file '%s'",
+                   path);
+    }
+
+    return result;
+}
+
+b8
+image_has_transparency(const Image_Resource_Data *image)
+{
+    RUNTIME_ASSERT_MSG(image->channel_count == 4,
+                       "image_has_transparency - Expected an RGBA8 image");
+
+    const u8 *pixels = image->pixels;
+    u64       size   = (u64)image->width * image->height * 4;
+    u64       i      = 0;
+
+    // Alpha is the top byte of every pixel. The pixels of a block are ANDed
+    // together, which keeps it at 0xFF only if the whole block is opaque
+#if IMAGE_SCAN_AVX2
+    const __m256i alpha_mask = _mm256_set1_epi32((s32)0xFF000000);
+
+    for (; i + IMAGE_SCAN_BLOCK_SIZE <= size; i += IMAGE_SCAN_BLOCK_SIZE)
+    {
+        __m256i accumulated = alpha_mask;
+
+        for (u64 j = 0; j < IMAGE_SCAN_BLOCK_SIZE; j += sizeof(__m256i))
         {
-            stbi_image_free(data);
+            __m256i block =
+                _mm256_loadu_si256((const __m256i *)(pixels + i + j));
+            accumulated = _mm256_and_si256(accumulated, block);
         }
 
-        return false;
+        __m256i opaque = _mm256_cmpeq_epi32(accumulated, alpha_mask);
+        if (_mm256_movemask_epi8(opaque) != -1)
+            return true;
     }
+#elif IMAGE_SCAN_SSE2
+    const __m128i alpha_mask = _mm_set1_epi32((s32)0xFF000000);
 
-    if (!data)
+    for (; i + IMAGE_SCAN_BLOCK_SIZE <= size; i += IMAGE_SCAN_BLOCK_SIZE)
     {
-        CORE_ERROR("Image resource loader failed to load file '%s'",
-                   (const char *)full_path.buff);
-        return false;
+        __m128i accumulated = alpha_mask;
+
+        for (u64 j = 0; j < IMAGE_SCAN_BLOCK_SIZE; j += sizeof(__m128i))
+        {
+            __m128i block = _mm_loadu_si128((const __m128i *)(pixels + i + j));
+            accumulated   = _mm_and_si128(accumulated, block);
+        }
+
+        __m128i opaque = _mm_cmpeq_epi32(accumulated, alpha_mask);
+        if (_mm_movemask_epi8(opaque) != 0xFFFF)
+            return true;
     }
+#endif
 
-    u32 pixel_data_size = width * height * required_channel_count;
+    for (; i < size; i += 4)
+    {
+        if (pixels[i + 3] < 255)
+            return true;
+    }
 
-    // Copy stbi data into arena
-    u8 *pixels = push_array(arena, u8, pixel_data_size);
-    memory_copy(pixels, data, pixel_data_size);
+    return false;
+}
 
-    // Free stbi allocated memory immediately
-    stbi_image_free(data);
+b8
+image_loader_load(Arena      *arena,
+                  const char *name,
+                  Resource   *out_resource)
+{
+    if (!arena || !name || !out_resource)
+    {
+        CORE_ERROR("image_loader_load - Ensure all pointers are not nullptr");
+        return false;
+    }
 
-    out_resource->full_path = (char *)full_path.buff;
+    String full_path = string_fmt(arena,
+                               "%s/%s/%s%s",
+                               resource_system_base_path(),
+                               "textures",
+                               name,
+                               ".png");
 
     Image_Resource_Data *resource_data =
         push_struct(arena, Image_Resource_Data);
 
-    resource_data->pixels        = pixels;
-    resource_data->width         = width;
-    resource_data->height        = height;
-    resource_data->channel_count = required_channel_count;
+    if (!image_loader_decode_file(arena,
+                                  (const char *)full_path.buff,
+                                  true,
+                                  resource_data))
+    {
+        return false;
+    }
 
+    out_resource->full_path = (char *)full_path.buff;
     out_resource->data      = resource_data;
     out_resource->data_size = sizeof(Image_Resource_Data);
     out_resource->name      = name;
@@ -6,3 +6,21 @@
 b8 image_loader_load(Arena      *arena,
                      const char *name,
                      Resource   *out_resource);
+
+// Decodes an encoded image to RGBA8 straight into the arena: stb_image
+// allocates from it while decoding, so the pixels are not copied out of a
+// heap buffer. The arena goes back to its position on failure
+b8 image_loader_decode(Arena               *arena,
+                       const u8            *data,
+                       u64                  size,
+                       b8                   flip_vertically,
+                       Image_Resource_Data *out_image);
+
+// Maps the file and decodes it with image_loader_decode
+b8 image_loader_decode_file(Arena               *arena,
+                            const char          *path,
+                            b8                   flip_vertically,
+                            Image_Resource_Data *out_image);
+
+// Whether any pixel of an RGBA8 image has an alpha below 255
+b8 image_has_transparency(const Image_Resource_Data *image);
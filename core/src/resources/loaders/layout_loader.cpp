@@ -0,0 +1,65 @@
+#include "layout_loader.hpp"
+#include "core/logger.hpp"
+#include "layout/gdsii_reader.hpp"
+#include "platform/filesystem.hpp"
+#include "systems/resource_system.hpp"
+#include "utils/string.hpp"
+
+b8
+layout_loader_load(Arena      *arena,
+                   const char *name,
+                   Resource   *out_resource)
+{
+    if (!arena || !name || !out_resource)
+    {
+        CORE_ERROR(
+            "layout_loader_load - Ensure all pointers are not nullptr");
+        return false;
+    }
+
+    String full_path = string_fmt(arena,
+                               "%s/%s/%s%s",
+                               resource_system_base_path(),
+                               "layouts",
+                               name,
+                               ".gds");
+
+    out_resource->full_path = (char *)full_path.buff;
+
+    // The stream is parsed straight from the mapping, tapeout files can be
+    // several gigabytes and are never copied into memory
+    File_Mapping mapping;
+    if (!filesystem_map((const char *)full_path.buff, &mapping))
+    {
+        CORE_ERROR("layout_loader_load - Unable to map layout file: '%s'",
+                   (const char *)full_path.buff);
+        return false;
+    }
+
+    GDSII_Read_Stats stats;
+    Layout          *layout = gdsii_read(mapping.data, mapping.size, &stats);
+
+    filesystem_unmap(&mapping);
+
+    if (!layout)
+    {
+        CORE_ERROR("layout_loader_load - Unable to parse GDSII file: '%s'",
+                   (const char *)full_path.buff);
+        return false;
+    }
+
+    CORE_INFO("Layout '%s' loaded: %.1f MiB, %u structures, %llu elements in "
+              "%.3f s (%.1f MB/s)",
+              name,
+              stats.byte_count / (1024.0 * 1024.0),
+              stats.structure_count,
+              stats.element_count,
+              stats.index_time + stats.parse_time + stats.finalize_time,
+              stats.megabytes_per_second);
+
+    out_resource->data      = layout;
+    out_resource->data_size = sizeof(Layout);
+    out_resource->name      = name;
+
+    return true;
+}
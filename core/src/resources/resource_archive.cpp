@@ -0,0 +1,210 @@
+#include "resource_archive.hpp"
+#include "core/logger.hpp"
+#include "memory/memory.hpp"
+#include "utils/radix_sort.hpp"
+#include "utils/string.hpp"
+
+u64
+resource_archive_hash(Resource_Type type, const char *name)
+{
+    // FNV-1a of the name, followed by the type so the same name can be packed
+    // once per type
+    u64 hash = string_hash(STR(name));
+    hash     = (hash ^ (u64)type) * 1099511628211ULL;
+
+    return hash;
+}
+
+b8
+resource_archive_write(Arena                       *arena,
+                       const char                  *path,
+                       const Resource_Archive_Blob *blobs,
+                       u32                          blob_count)
+{
+    const u8 padding[RESOURCE_ARCHIVE_DATA_ALIGNMENT] = {};
+
+    u64 position = arena_position(arena);
+
+    u64 *hashes  = push_array(arena, u64, blob_count);
+    u32 *indices = push_array(arena, u32, blob_count);
+
+    for (u32 i = 0; i < blob_count; ++i)
+    {
+        hashes[i]  = resource_archive_hash(blobs[i].type, blobs[i].name);
+        indices[i] = i;
+    }
+
+    radix_sort_u64(arena, hashes, indices, blob_count);
+
+    for (u32 i = 1; i < blob_count; ++i)
+    {
+        if (hashes[i] == hashes[i - 1])
+        {
+            CORE_ERROR("resource_archive_write - '%s' and '%s' have the same "
+                       "hash",
+                       blobs[indices[i - 1]].name,
+                       blobs[indices[i]].name);
+            arena_pop_to(arena, position);
+            return false;
+        }
+    }
+
+    auto *entries = push_array(arena, Resource_Archive_Entry, blob_count);
+
+    u64 table_end = sizeof(Resource_Archive_Header) +
+                    sizeof(Resource_Archive_Entry) * blob_count;
+    u64 data_start = ALIGN_UP_POW2(table_end, RESOURCE_ARCHIVE_DATA_ALIGNMENT);
+    u64 offset     = data_start;
+
+    // The blobs are stored in the order of the table
+    for (u32 i = 0; i < blob_count; ++i)
+    {
+        const Resource_Archive_Blob *blob = &blobs[indices[i]];
+
+        entries[i].hash     = hashes[i];
+        entries[i].offset   = offset;
+        entries[i].size     = blob->size;
+        entries[i].type     = blob->type;
+        entries[i].reserved = 0;
+
+        offset = ALIGN_UP_POW2(offset + blob->size + 1,
+                               RESOURCE_ARCHIVE_DATA_ALIGNMENT);
+    }
+
+    Resource_Archive_Header header = {};
+    header.magic                   = RESOURCE_ARCHIVE_MAGIC;
+    header.version                 = RESOURCE_ARCHIVE_VERSION;
+    header.entry_count             = blob_count;
+    header.data_size               = offset - data_start;
+
+    File_Handle file;
+    if (!filesystem_open(path, File_Modes::WRITE, true, &file))
+    {
+        CORE_ERROR("resource_archive_write - Unable to open file '%s'", path);
+        arena_pop_to(arena, position);
+        return false;
+    }
+
+    u64 written = 0;
+    b8  result  = filesystem_write(&file, sizeof(header), &header, &written);
+
+    result = result && filesystem_write(&file,
+                                        table_end - sizeof(header),
+                                        entries,
+                                        &written);
+    result = result &&
+             filesystem_write(&file, data_start - table_end, padding, &written);
+
+    for (u32 i = 0; result && i < blob_count; ++i)
+    {
+        const Resource_Archive_Blob *blob = &blobs[indices[i]];
+
+        // The padding holds at least the terminator
+        u64 size     = blob->size;
+        u64 aligned  = ALIGN_UP_POW2(size + 1, RESOURCE_ARCHIVE_DATA_ALIGNMENT);
+        u64 pad_size = aligned - size;
+
+        result = filesystem_write(&file, size, blob->data, &written);
+        result = result &&
+                 filesystem_write(&file, pad_size, padding, &written);
+    }
+
+    filesystem_close(&file);
+    arena_pop_to(arena, position);
+
+    if (!result)
+    {
+        CORE_ERROR("resource_archive_write - Failed to write file '%s'", path);
+    }
+
+    return result;
+}
+
+b8
+resource_archive_open(const char *path, Resource_Archive *out_archive)
+{
+    memory_zero(out_archive, sizeof(Resource_Archive));
+
+    if (!filesystem_exists(path))
+        return false;
+
+    File_Mapping mapping;
+    if (!filesystem_map(path, &mapping))
+        return false;
+
+    const auto *header = (const Resource_Archive_Header *)mapping.data;
+
+    b8 is_valid = mapping.size >= sizeof(Resource_Archive_Header) &&
+                  header->magic == RESOURCE_ARCHIVE_MAGIC &&
+                  header->version == RESOURCE_ARCHIVE_VERSION &&
+                  (mapping.size - sizeof(Resource_Archive_Header)) /
+                          sizeof(Resource_Archive_Entry) >=
+                      header->entry_count;
+
+    const auto *entries =
+        (const Resource_Archive_Entry *)(mapping.data +
+                                         sizeof(Resource_Archive_Header));
+
+    // A partially written archive fails here. The blob and its terminator
+    // have to be inside the mapping, the lookup relies on the order
+    for (u32 i = 0; is_valid && i < header->entry_count; ++i)
+    {
+        const Resource_Archive_Entry *entry = &entries[i];
+
+        is_valid = entry->offset % RESOURCE_ARCHIVE_DATA_ALIGNMENT == 0 &&
+                   entry->offset <= mapping.size &&
+                   entry->size < mapping.size - entry->offset &&
+                   (i == 0 || entries[i - 1].hash < entry->hash);
+    }
+
+    if (!is_valid)
+    {
+        CORE_ERROR("resource_archive_open - Malformed archive '%s'", path);
+        filesystem_unmap(&mapping);
+        return false;
+    }
+
+    out_archive->mapping     = mapping;
+    out_archive->entries     = entries;
+    out_archive->entry_count = header->entry_count;
+
+    return true;
+}
+
+void
+resource_archive_close(Resource_Archive *archive)
+{
+    if (archive->mapping.data)
+        filesystem_unmap(&archive->mapping);
+
+    memory_zero(archive, sizeof(Resource_Archive));
+}
+
+const Resource_Archive_Entry *
+resource_archive_find(const Resource_Archive *archive,
+                      Resource_Type           type,
+                      const char             *name)
+{
+    u64 hash = resource_archive_hash(type, name);
+
+    u32 low  = 0;
+    u32 high = archive->entry_count;
+
+    while (low < high)
+    {
+        u32 middle = low + (high - low) / 2;
+
+        if (archive->entries[middle].hash < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < archive->entry_count && archive->entries[low].hash == hash &&
+        archive->entries[low].type == type)
+    {
+        return &archive->entries[low];
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "memory/arena.hpp"
+#include "platform/filesystem.hpp"
+#include "resources/resource_types.hpp"
+
+// Resources packed into a single file. The table of contents is sorted by the
+// hash of the type and name of each resource, the blobs are aligned so the
+// data can be used straight out of a mapping of the archive
+constexpr u32 RESOURCE_ARCHIVE_MAGIC   = 0x4B415056; // "VPAK"
+constexpr u32 RESOURCE_ARCHIVE_VERSION = 1;
+
+#define RESOURCE_ARCHIVE_EXTENSION ".vpak"
+
+// Offset alignment of the blobs, enough for the SPIR-V words of the shaders
+// and for the SIMD loads of the image pixels
+constexpr u64 RESOURCE_ARCHIVE_DATA_ALIGNMENT = 16;
+
+struct Resource_Archive_Header
+{
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 reserved;
+    u64 data_size; // Bytes following the table of contents
+};
+
+// Follows the header, sorted by hash
+struct Resource_Archive_Entry
+{
+    u64           hash;
+    u64           offset; // From the start of the file
+    u64           size;   // Without the '\0' that follows every blob
+    Resource_Type type;
+    u32           reserved;
+};
+
+// Prefixes the pixels of IMAGE and ICON blobs, which are stored decoded
+struct Resource_Archive_Image
+{
+    u32 width;
+    u32 height;
+    u32 channel_count;
+    u32 reserved;
+};
+
+// A resource to write into the archive
+struct Resource_Archive_Blob
+{
+    Resource_Type type;
+    const char   *name;
+    const void   *data;
+    u64           size;
+};
+
+struct Resource_Archive
+{
+    File_Mapping                  mapping;
+    const Resource_Archive_Entry *entries;
+    u32                           entry_count;
+};
+
+u64 resource_archive_hash(Resource_Type type, const char *name);
+
+// Every blob is followed by a '\0', so TEXT resources can be used as strings.
+// Fails when two blobs have the same hash
+b8 resource_archive_write(Arena                       *arena,
+                          const char                  *path,
+                          const Resource_Archive_Blob *blobs,
+                          u32                          blob_count);
+
+// Maps the archive, false when it is missing or malformed
+b8 resource_archive_open(const char *path, Resource_Archive *out_archive);
+
+void resource_archive_close(Resource_Archive *archive);
+
+// nullptr when the resource is not in the archive
+const Resource_Archive_Entry *
+resource_archive_find(const Resource_Archive *archive,
+                      Resource_Type           type,
+                      const char             *name);
+
+FORCE_INLINE const u8 *
+resource_archive_data(const Resource_Archive       *archive,
+                      const Resource_Archive_Entry *entry)
+{
+    return archive->mapping.data + entry->offset;
+}
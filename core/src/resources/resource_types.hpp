@@ -13,6 +13,7 @@ enum class Resource_Type : u32
     MATERIAL,    // the data  will be Material_Config
     STATIC_MESH, // the data will be TBD
     FONT,        // the data will be u8* array
+    LAYOUT,      // the data will be Layout, released with layout_destroy
     CUSTOM
 };
 
@@ -36,19 +37,42 @@ using Texture_ID = u32;
 
 constexpr u32 TEXTURE_NAME_MAX_LENGTH = 256;
 
+// Enough levels for a 32768x32768 texture
+constexpr u32 TEXTURE_MAX_MIP_COUNT = 16;
+
+// Layout of the texels in memory. The BC formats store blocks of 4x4 texels
+enum class Texture_Format : u8
+{
+    RGBA8,
+    BC1, // Opaque, 8 bytes per block
+    BC3, // BC1 color and an interpolated alpha, 16 bytes per block
+};
+
+// One level of the mip chain, the data is tightly packed rows of texels or
+// blocks
+struct Texture_Mip
+{
+    const u8 *data;
+    u64       size;
+    u32       width;
+    u32       height;
+};
+
 struct Texture
 {
     char name[TEXTURE_NAME_MAX_LENGTH];
 
-    Texture_ID id;
-    u32        width;
-    u32        height;
-    u8         channel_count;
-    b8         has_transparency;
-    b8         is_writeable;
-    b8         is_ui_texture;
-    u32        generation;
-    void      *internal_data; // Backend specific texture data
+    Texture_ID     id;
+    u32            width;
+    u32            height;
+    u8             channel_count;
+    Texture_Format format;
+    u8             mip_count;
+    b8             has_transparency;
+    b8             is_writeable;
+    b8             is_ui_texture;
+    u32            generation;
+    void          *internal_data; // Backend specific texture data
 };
 
 // Bitmask
@@ -128,10 +152,3 @@ struct Geometry
     u32         generation;
     Material   *material;
 };
-
-struct Cell
-{
-    u16        geometry_count;
-    Geometry **geometry;
-    mat4       model;
-};
@@ -0,0 +1,727 @@
+#include "texture_cache.hpp"
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "math/math.hpp"
+#include "memory/memory.hpp"
+#include "platform/platform.hpp"
+#include "resources/loaders/image_loader.hpp"
+#include "utils/string.hpp"
+
+// The box filter averages a row of four output pixels at once. It can be
+// disabled with VOLTRUM_TEXTURE_SCALAR_DOWNSAMPLE
+#if !defined(VOLTRUM_TEXTURE_SCALAR_DOWNSAMPLE) &&                             \
+    (defined(__SSE2__) || defined(_M_X64))
+#    define TEXTURE_DOWNSAMPLE_SSE2 1
+#    include <emmintrin.h>
+#endif
+
+constexpr u32 BC1_BLOCK_SIZE = 8;
+constexpr u32 BC3_BLOCK_SIZE = 16;
+
+// Power iterations that turn the covariance of a block into its main axis
+constexpr u32 BC_AXIS_ITERATION_COUNT = 4;
+
+u32
+texture_mip_count(u32 width, u32 height)
+{
+    u32 size  = MAX(width, height);
+    u32 count = 1;
+
+    while (size > 1 && count < TEXTURE_MAX_MIP_COUNT)
+    {
+        size /= 2;
+        count++;
+    }
+
+    return count;
+}
+
+u64
+texture_format_size(Texture_Format format, u32 width, u32 height)
+{
+    u64 block_count = (u64)((width + 3) / 4) * ((height + 3) / 4);
+
+    switch (format)
+    {
+        case Texture_Format::RGBA8:
+            return (u64)width * height * 4;
+        case Texture_Format::BC1:
+            return block_count * BC1_BLOCK_SIZE;
+        case Texture_Format::BC3:
+            return block_count * BC3_BLOCK_SIZE;
+    }
+
+    return 0;
+}
+
+void
+texture_downsample(const u8 *pixels, u32 width, u32 height, u8 *out)
+{
+    u32 out_width  = MAX(1u, width / 2);
+    u32 out_height = MAX(1u, height / 2);
+    u64 pitch      = (u64)width * 4;
+
+    for (u32 y = 0; y < out_height; ++y)
+    {
+        const u8 *row_0 = pixels + (u64)MIN(y * 2, height - 1) * pitch;
+        const u8 *row_1 = pixels + (u64)MIN(y * 2 + 1, height - 1) * pitch;
+        u8       *dest  = out + (u64)y * out_width * 4;
+        u32       x     = 0;
+
+#if TEXTURE_DOWNSAMPLE_SSE2
+        // Eight source pixels of each row make four output pixels. The sums
+        // are widened to 16 bits so the rounding matches the scalar path
+        const __m128i zero     = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+
+        for (; x * 2 + 8 <= width; x += 4)
+        {
+            __m128i a_0 = _mm_loadu_si128((const __m128i *)(row_0 + x * 8));
+            __m128i b_0 =
+                _mm_loadu_si128((const __m128i *)(row_0 + x * 8 + 16));
+            __m128i a_1 = _mm_loadu_si128((const __m128i *)(row_1 + x * 8));
+            __m128i b_1 =
+                _mm_loadu_si128((const __m128i *)(row_1 + x * 8 + 16));
+
+            // Vertical sums of the source pixels 0-1, 2-3, 4-5 and 6-7
+            __m128i sum_01 = _mm_add_epi16(_mm_unpacklo_epi8(a_0, zero),
+                                           _mm_unpacklo_epi8(a_1, zero));
+            __m128i sum_23 = _mm_add_epi16(_mm_unpackhi_epi8(a_0, zero),
+                                           _mm_unpackhi_epi8(a_1, zero));
+            __m128i sum_45 = _mm_add_epi16(_mm_unpacklo_epi8(b_0, zero),
+                                           _mm_unpacklo_epi8(b_1, zero));
+            __m128i sum_67 = _mm_add_epi16(_mm_unpackhi_epi8(b_0, zero),
+                                           _mm_unpackhi_epi8(b_1, zero));
+
+            // Adding the two pixels of each pair gives the output pixels 0-1
+            // and 2-3
+            __m128i out_01 = _mm_add_epi16(_mm_unpacklo_epi64(sum_01, sum_23),
+                                           _mm_unpackhi_epi64(sum_01, sum_23));
+            __m128i out_23 = _mm_add_epi16(_mm_unpacklo_epi64(sum_45, sum_67),
+                                           _mm_unpackhi_epi64(sum_45, sum_67));
+
+            out_01 = _mm_srli_epi16(_mm_add_epi16(out_01, rounding), 2);
+            out_23 = _mm_srli_epi16(_mm_add_epi16(out_23, rounding), 2);
+
+            _mm_storeu_si128((__m128i *)(dest + x * 4),
+                             _mm_packus_epi16(out_01, out_23));
+        }
+#endif
+
+        for (; x < out_width; ++x)
+        {
+            u64 column_0 = (u64)MIN(x * 2, width - 1) * 4;
+            u64 column_1 = (u64)MIN(x * 2 + 1, width - 1) * 4;
+
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                u32 sum =
+                    row_0[column_0 + channel] + row_0[column_1 + channel] +
+                    row_1[column_0 + channel] + row_1[column_1 + channel];
+
+                dest[x * 4 + channel] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Copies the 4x4 texels of a block, repeating the last column/row of the
+// image for the blocks on its edge
+INTERNAL_FUNC void
+load_block(const u8 *pixels,
+           u32       width,
+           u32       height,
+           u32       block_x,
+           u32       block_y,
+           u8       *out_texels)
+{
+    for (u32 y = 0; y < 4; ++y)
+    {
+        u32 source_y = MIN(block_y * 4 + y, height - 1);
+
+        for (u32 x = 0; x < 4; ++x)
+        {
+            u32 source_x = MIN(block_x * 4 + x, width - 1);
+
+            memory_copy(out_texels + (y * 4 + x) * 4,
+                        pixels + ((u64)source_y * width + source_x) * 4,
+                        4);
+        }
+    }
+}
+
+INTERNAL_FUNC u16
+pack_565(const u8 *color)
+{
+    u32 r = (color[0] * 31 + 127) / 255;
+    u32 g = (color[1] * 63 + 127) / 255;
+    u32 b = (color[2] * 31 + 127) / 255;
+
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+INTERNAL_FUNC void
+unpack_565(u16 packed, s32 *out_color)
+{
+    s32 r = (packed >> 11) & 31;
+    s32 g = (packed >> 5) & 63;
+    s32 b = packed & 31;
+
+    out_color[0] = (r << 3) | (r >> 2);
+    out_color[1] = (g << 2) | (g >> 4);
+    out_color[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the two texels at the ends of the main axis of the colors, found by
+// power iteration on their covariance
+INTERNAL_FUNC void
+find_color_endpoints(const u8 *texels, u32 *out_max, u32 *out_min)
+{
+    f32 mean[3] = {};
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        for (u32 c = 0; c < 3; ++c)
+            mean[c] += texels[i * 4 + c];
+    }
+
+    for (u32 c = 0; c < 3; ++c)
+        mean[c] /= 16.0f;
+
+    // rr, rg, rb, gg, gb, bb
+    f32 covariance[6] = {};
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        f32 r = texels[i * 4 + 0] - mean[0];
+        f32 g = texels[i * 4 + 1] - mean[1];
+        f32 b = texels[i * 4 + 2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // Start from the row of the channel that varies the most, it is never
+    // orthogonal to the main axis
+    f32 axis[3] = {covariance[0], covariance[1], covariance[2]};
+
+    if (covariance[3] > covariance[0] && covariance[3] >= covariance[5])
+    {
+        axis[0] = covariance[1];
+        axis[1] = covariance[3];
+        axis[2] = covariance[4];
+    }
+    else if (covariance[5] > covariance[0])
+    {
+        axis[0] = covariance[2];
+        axis[1] = covariance[4];
+        axis[2] = covariance[5];
+    }
+
+    for (u32 i = 0; i < BC_AXIS_ITERATION_COUNT; ++i)
+    {
+        f32 r = covariance[0] * axis[0] + covariance[1] * axis[1] +
+                covariance[2] * axis[2];
+        f32 g = covariance[1] * axis[0] + covariance[3] * axis[1] +
+                covariance[4] * axis[2];
+        f32 b = covariance[2] * axis[0] + covariance[4] * axis[1] +
+                covariance[5] * axis[2];
+
+        f32 length = MAX(math_abs_value(r),
+                         MAX(math_abs_value(g), math_abs_value(b)));
+        if (length < 1e-6f)
+            break;
+
+        axis[0] = r / length;
+        axis[1] = g / length;
+        axis[2] = b / length;
+    }
+
+    f32 min_projection = 1e30f;
+    f32 max_projection = -1e30f;
+
+    *out_max = 0;
+    *out_min = 0;
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        f32 projection = texels[i * 4 + 0] * axis[0] +
+                         texels[i * 4 + 1] * axis[1] +
+                         texels[i * 4 + 2] * axis[2];
+
+        if (projection < min_projection)
+        {
+            min_projection = projection;
+            *out_min       = i;
+        }
+
+        if (projection > max_projection)
+        {
+            max_projection = projection;
+            *out_max       = i;
+        }
+    }
+}
+
+// Always in the four color mode, which BC3 requires for its color block
+INTERNAL_FUNC void
+encode_color_block(const u8 *texels, u8 *out)
+{
+    u32 max_index;
+    u32 min_index;
+    find_color_endpoints(texels, &max_index, &min_index);
+
+    u16 color_0 = pack_565(texels + max_index * 4);
+    u16 color_1 = pack_565(texels + min_index * 4);
+
+    if (color_0 < color_1)
+    {
+        u16 temp = color_0;
+        color_0  = color_1;
+        color_1  = temp;
+    }
+
+    u32 indices = 0;
+
+    // Equal endpoints select the three color mode, index 0 is still right
+    if (color_0 != color_1)
+    {
+        s32 palette[4][3];
+        unpack_565(color_0, palette[0]);
+        unpack_565(color_1, palette[1]);
+
+        for (u32 c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 best_index    = 0;
+            s32 best_distance = 4 * 256 * 256;
+
+            for (u32 p = 0; p < 4; ++p)
+            {
+                s32 r = texels[i * 4 + 0] - palette[p][0];
+                s32 g = texels[i * 4 + 1] - palette[p][1];
+                s32 b = texels[i * 4 + 2] - palette[p][2];
+
+                s32 distance = r * r + g * g + b * b;
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index    = p;
+                }
+            }
+
+            indices |= best_index << (i * 2);
+        }
+    }
+
+    memory_copy(out, &color_0, sizeof(u16));
+    memory_copy(out + 2, &color_1, sizeof(u16));
+    memory_copy(out + 4, &indices, sizeof(u32));
+}
+
+// Eight alpha mode: the endpoints and six values interpolated between them
+INTERNAL_FUNC void
+encode_alpha_block(const u8 *texels, u8 *out)
+{
+    s32 alpha_0 = 0;
+    s32 alpha_1 = 255;
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        alpha_0 = MAX(alpha_0, (s32)texels[i * 4 + 3]);
+        alpha_1 = MIN(alpha_1, (s32)texels[i * 4 + 3]);
+    }
+
+    u64 indices = 0;
+
+    if (alpha_0 != alpha_1)
+    {
+        s32 palette[8];
+        palette[0] = alpha_0;
+        palette[1] = alpha_1;
+
+        for (s32 p = 2; p < 8; ++p)
+            palette[p] = ((8 - p) * alpha_0 + (p - 1) * alpha_1) / 7;
+
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u64 best_index    = 0;
+            s32 best_distance = 256;
+
+            for (u32 p = 0; p < 8; ++p)
+            {
+                s32 distance = (s32)texels[i * 4 + 3] - palette[p];
+                distance     = distance < 0 ? -distance : distance;
+
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index    = p;
+                }
+            }
+
+            indices |= best_index << (i * 3);
+        }
+    }
+
+    out[0] = (u8)alpha_0;
+    out[1] = (u8)alpha_1;
+
+    // 48 bits of 3 bit indices
+    for (u32 i = 0; i < 6; ++i)
+        out[2 + i] = (u8)(indices >> (i * 8));
+}
+
+void
+texture_encode_bc1(const u8 *pixels, u32 width, u32 height, u8 *out)
+{
+    u32 block_width  = (width + 3) / 4;
+    u32 block_height = (height + 3) / 4;
+    u8  texels[16 * 4];
+
+    for (u32 block_y = 0; block_y < block_height; ++block_y)
+    {
+        for (u32 block_x = 0; block_x < block_width; ++block_x)
+        {
+            load_block(pixels, width, height, block_x, block_y, texels);
+            encode_color_block(texels, out);
+
+            out += BC1_BLOCK_SIZE;
+        }
+    }
+}
+
+void
+texture_encode_bc3(const u8 *pixels, u32 width, u32 height, u8 *out)
+{
+    u32 block_width  = (width + 3) / 4;
+    u32 block_height = (height + 3) / 4;
+    u8  texels[16 * 4];
+
+    for (u32 block_y = 0; block_y < block_height; ++block_y)
+    {
+        for (u32 block_x = 0; block_x < block_width; ++block_x)
+        {
+            load_block(pixels, width, height, block_x, block_y, texels);
+            encode_alpha_block(texels, out);
+            encode_color_block(texels, out + 8);
+
+            out += BC3_BLOCK_SIZE;
+        }
+    }
+}
+
+void
+texture_cook(Arena                     *arena,
+             const Image_Resource_Data *image,
+             b8                         allow_block_compression,
+             Cooked_Texture            *out_texture)
+{
+    RUNTIME_ASSERT_MSG(image->channel_count == 4,
+                       "texture_cook - Expected an RGBA8 image");
+
+    Cooked_Texture *texture = out_texture;
+    memory_zero(texture, sizeof(Cooked_Texture));
+
+    texture->width            = image->width;
+    texture->height           = image->height;
+    texture->mip_count        = texture_mip_count(image->width, image->height);
+    texture->has_transparency = image_has_transparency(image);
+
+    if (!allow_block_compression)
+        texture->format = Texture_Format::RGBA8;
+    else if (texture->has_transparency)
+        texture->format = Texture_Format::BC3;
+    else
+        texture->format = Texture_Format::BC1;
+
+    const u8 *pixels = image->pixels;
+    u32       width  = image->width;
+    u32       height = image->height;
+
+    for (u32 i = 0; i < texture->mip_count; ++i)
+    {
+        // Each level is filtered from the RGBA8 one above it, never from the
+        // encoded blocks
+        if (i > 0)
+        {
+            u32 mip_width  = MAX(1u, width / 2);
+            u32 mip_height = MAX(1u, height / 2);
+            u8 *mip_pixels = push_array_aligned(arena,
+                                                u8,
+                                                (u64)mip_width * mip_height * 4,
+                                                TEXTURE_CACHE_DATA_ALIGNMENT);
+
+            texture_downsample(pixels, width, height, mip_pixels);
+
+            pixels = mip_pixels;
+            width  = mip_width;
+            height = mip_height;
+        }
+
+        Texture_Mip *mip = &texture->mips[i];
+        mip->width       = width;
+        mip->height      = height;
+        mip->size        = texture_format_size(texture->format, width, height);
+
+        if (texture->format == Texture_Format::RGBA8)
+        {
+            mip->data = pixels;
+            continue;
+        }
+
+        u8 *blocks = push_array_aligned(arena,
+                                        u8,
+                                        mip->size,
+                                        TEXTURE_CACHE_DATA_ALIGNMENT);
+
+        if (texture->format == Texture_Format::BC3)
+            texture_encode_bc3(pixels, width, height, blocks);
+        else
+            texture_encode_bc1(pixels, width, height, blocks);
+
+        mip->data = blocks;
+    }
+}
+
+b8
+texture_cache_write(const char           *path,
+                    u64                   source_hash,
+                    const Cooked_Texture *texture)
+{
+    const u8 padding[TEXTURE_CACHE_DATA_ALIGNMENT] = {};
+
+    Texture_Cache_Header    header = {};
+    Texture_Cache_Mip_Entry entries[TEXTURE_MAX_MIP_COUNT];
+
+    u64 table_end = sizeof(Texture_Cache_Header) +
+                    sizeof(Texture_Cache_Mip_Entry) * texture->mip_count;
+    u64 data_start = ALIGN_UP_POW2(table_end, TEXTURE_CACHE_DATA_ALIGNMENT);
+    u64 offset     = data_start;
+
+    for (u32 i = 0; i < texture->mip_count; ++i)
+    {
+        entries[i].offset = offset;
+        entries[i].size   = texture->mips[i].size;
+        entries[i].width  = texture->mips[i].width;
+        entries[i].height = texture->mips[i].height;
+
+        offset = ALIGN_UP_POW2(offset + entries[i].size,
+                               TEXTURE_CACHE_DATA_ALIGNMENT);
+    }
+
+    header.magic            = TEXTURE_CACHE_MAGIC;
+    header.version          = TEXTURE_CACHE_VERSION;
+    header.source_hash      = source_hash;
+    header.width            = texture->width;
+    header.height           = texture->height;
+    header.format           = texture->format;
+    header.mip_count        = (u8)texture->mip_count;
+    header.has_transparency = texture->has_transparency;
+    header.data_size        = (u32)(offset - data_start);
+
+    File_Handle file;
+    if (!filesystem_open(path, File_Modes::WRITE, true, &file))
+    {
+        CORE_ERROR("texture_cache_write - Unable to open file '%s'", path);
+        return false;
+    }
+
+    u64 written = 0;
+    b8  result  = filesystem_write(&file, sizeof(header), &header, &written);
+
+    result = result && filesystem_write(&file,
+                                        table_end - sizeof(header),
+                                        entries,
+                                        &written);
+    result = result &&
+             filesystem_write(&file, data_start - table_end, padding, &written);
+
+    for (u32 i = 0; result && i < texture->mip_count; ++i)
+    {
+        u64 size     = entries[i].size;
+        u64 aligned  = ALIGN_UP_POW2(size, TEXTURE_CACHE_DATA_ALIGNMENT);
+        u64 pad_size = aligned - size;
+
+        result = filesystem_write(&file, size, texture->mips[i].data, &written);
+        result = result &&
+                 filesystem_write(&file, pad_size, padding, &written);
+    }
+
+    filesystem_close(&file);
+
+    if (!result)
+    {
+        CORE_ERROR("texture_cache_write - Failed to write file '%s'", path);
+    }
+
+    return result;
+}
+
+b8
+texture_cache_open(const char     *path,
+                   u64             source_hash,
+                   b8              allow_block_compression,
+                   Cooked_Texture *out_texture)
+{
+    memory_zero(out_texture, sizeof(Cooked_Texture));
+
+    if (!filesystem_exists(path))
+        return false;
+
+    File_Mapping mapping;
+    if (!filesystem_map(path, &mapping))
+        return false;
+
+    const auto *header = (const Texture_Cache_Header *)mapping.data;
+
+    // Cooked for the same source, in the format texture_cook would pick
+    b8 is_valid =
+        mapping.size >= sizeof(Texture_Cache_Header) &&
+        header->magic == TEXTURE_CACHE_MAGIC &&
+        header->version == TEXTURE_CACHE_VERSION &&
+        header->source_hash == source_hash &&
+        header->format <= Texture_Format::BC3 &&
+        (header->format != Texture_Format::RGBA8) == allow_block_compression &&
+        header->mip_count > 0 && header->mip_count <= TEXTURE_MAX_MIP_COUNT &&
+        mapping.size >= sizeof(Texture_Cache_Header) +
+                            sizeof(Texture_Cache_Mip_Entry) * header->mip_count;
+
+    const auto *entries =
+        (const Texture_Cache_Mip_Entry *)(mapping.data +
+                                          sizeof(Texture_Cache_Header));
+
+    // A partially written container fails here
+    for (u32 i = 0; is_valid && i < header->mip_count; ++i)
+    {
+        const Texture_Cache_Mip_Entry *entry = &entries[i];
+
+        // The renderer sizes each mip of the image from the mip 0
+        is_valid =
+            entry->width == MAX(1u, header->width >> i) &&
+            entry->height == MAX(1u, header->height >> i) &&
+            entry->offset % TEXTURE_CACHE_DATA_ALIGNMENT == 0 &&
+            entry->offset <= mapping.size &&
+            entry->size <= mapping.size - entry->offset &&
+            entry->size == texture_format_size(header->format,
+                                               entry->width,
+                                               entry->height);
+
+        Texture_Mip *mip = &out_texture->mips[i];
+        mip->data        = mapping.data + entry->offset;
+        mip->size        = entry->size;
+        mip->width       = entry->width;
+        mip->height      = entry->height;
+    }
+
+    if (!is_valid)
+    {
+        filesystem_unmap(&mapping);
+        memory_zero(out_texture, sizeof(Cooked_Texture));
+        return false;
+    }
+
+    out_texture->format           = header->format;
+    out_texture->width            = header->width;
+    out_texture->height           = header->height;
+    out_texture->mip_count        = header->mip_count;
+    out_texture->has_transparency = header->has_transparency;
+    out_texture->mapping          = mapping;
+
+    return true;
+}
+
+void
+texture_cache_close(Cooked_Texture *texture)
+{
+    if (texture->mapping.data)
+        filesystem_unmap(&texture->mapping);
+
+    memory_zero(&texture->mapping, sizeof(File_Mapping));
+}
+
+b8
+texture_cache_load(Arena          *arena,
+                   const char     *image_path,
+                   b8              allow_block_compression,
+                   Cooked_Texture *out_texture)
+{
+    File_Mapping source;
+    if (!filesystem_map(image_path, &source))
+    {
+        CORE_ERROR("texture_cache_load - Unable to open file '%s'", image_path);
+        return false;
+    }
+
+    u64 source_hash = string_hash({(char *)source.data, source.size});
+
+    // The container replaces the extension of the image. The path is not
+    // chopped in place, it belongs to the caller
+    u64 stem_size = STR(image_path).size;
+
+    for (u64 i = stem_size; i > 0 && image_path[i - 1] != '/'; --i)
+    {
+        if (image_path[i - 1] == '.')
+        {
+            stem_size = i - 1;
+            break;
+        }
+    }
+
+    String cache_path = string_fmt(arena,
+                                   "%.*s%s",
+                                   (int)stem_size,
+                                   image_path,
+                                   TEXTURE_CACHE_EXTENSION);
+
+    if (texture_cache_open(cache_path.buff,
+                           source_hash,
+                           allow_block_compression,
+                           out_texture))
+    {
+        filesystem_unmap(&source);
+        return true;
+    }
+
+    f64 start_time = platform_get_absolute_time();
+
+    Image_Resource_Data image;
+    b8                  result = image_loader_decode(arena,
+                                    source.data,
+                                    source.size,
+                                    true,
+                                    &image);
+
+    filesystem_unmap(&source);
+
+    if (!result)
+    {
+        CORE_ERROR("texture_cache_load - Failed to load file '%s'",
+                   image_path);
+        return false;
+    }
+
+    texture_cook(arena, &image, allow_block_compression, out_texture);
+
+    // The texture is still usable when the container cannot be written, it
+    // is cooked again next time
+    texture_cache_write(cache_path.buff, source_hash, out_texture);
+
+    CORE_DEBUG("texture_cache_load - Cooked '%s' (%ux%u, %u mips) in %.2f ms",
+               image_path,
+               out_texture->width,
+               out_texture->height,
+               out_texture->mip_count,
+               (platform_get_absolute_time() - start_time) * 1000.0);
+
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "memory/arena.hpp"
+#include "platform/filesystem.hpp"
+#include "resources/resource_types.hpp"
+
+// Textures are cooked once into a container next to their source image: the
+// whole mip chain, block compressed when the renderer can sample BC formats.
+// Later launches map the container and upload the mips straight out of it
+constexpr u32 TEXTURE_CACHE_MAGIC   = 0x58455456; // "VTEX"
+constexpr u32 TEXTURE_CACHE_VERSION = 1;
+
+#define TEXTURE_CACHE_EXTENSION ".vtex"
+
+// Offset alignment of the mips in the container, which also satisfies the
+// buffer to image copy alignment of the block compressed formats
+constexpr u64 TEXTURE_CACHE_DATA_ALIGNMENT = 16;
+
+struct Texture_Cache_Header
+{
+    u32            magic;
+    u32            version;
+    u64            source_hash; // FNV-1a of the encoded source image
+    u32            width;
+    u32            height;
+    Texture_Format format;
+    u8             mip_count;
+    b8             has_transparency;
+    u8             reserved;
+    u32            data_size; // Bytes following the mip table
+};
+
+// Follows the header, one per mip from the largest to the smallest
+struct Texture_Cache_Mip_Entry
+{
+    u64 offset; // From the start of the file
+    u64 size;
+    u32 width;
+    u32 height;
+};
+
+// A texture ready for the upload. The mips either point into the arena it was
+// cooked in or into the mapping of the container it was loaded from
+struct Cooked_Texture
+{
+    Texture_Format format;
+    u32            width;
+    u32            height;
+    u32            mip_count;
+    b8             has_transparency;
+    Texture_Mip    mips[TEXTURE_MAX_MIP_COUNT];
+
+    File_Mapping mapping; // Empty unless loaded from the container
+};
+
+// Levels of the full chain down to 1x1
+u32 texture_mip_count(u32 width, u32 height);
+
+// Bytes of one mip, block compressed formats round up to whole 4x4 blocks
+u64 texture_format_size(Texture_Format format, u32 width, u32 height);
+
+// Halves an RGBA8 image with a 2x2 box filter. Odd sizes repeat the last
+// column/row, the result is MAX(1, size / 2) on each axis
+void texture_downsample(const u8 *pixels, u32 width, u32 height, u8 *out);
+
+// Encodes an RGBA8 image into 4x4 blocks. Texels past the edge of the image
+// repeat the last column/row
+void texture_encode_bc1(const u8 *pixels, u32 width, u32 height, u8 *out);
+void texture_encode_bc3(const u8 *pixels, u32 width, u32 height, u8 *out);
+
+// Generates the mip chain of a decoded RGBA8 image. It is encoded as BC1, or
+// BC3 when the image has transparency, if block compression is allowed.
+// Mip 0 of an RGBA8 texture points at the pixels of the image
+void texture_cook(Arena                     *arena,
+                  const Image_Resource_Data *image,
+                  b8                         allow_block_compression,
+                  Cooked_Texture            *out_texture);
+
+b8 texture_cache_write(const char           *path,
+                       u64                   source_hash,
+                       const Cooked_Texture *texture);
+
+// Maps the container, false when it is missing, malformed, cooked from
+// another source or in a format the renderer cannot sample
+b8 texture_cache_open(const char     *path,
+                      u64             source_hash,
+                      b8              allow_block_compression,
+                      Cooked_Texture *out_texture);
+
+// Unmaps the container the texture was loaded from, if any
+void texture_cache_close(Cooked_Texture *texture);
+
+// Loads the texture of an image from the container next to it, cooking and
+// writing the container first when it is out of date. Images are flipped
+// vertically like the textures of image_loader_load
+b8 texture_cache_load(Arena          *arena,
+                      const char     *image_path,
+                      b8              allow_block_compression,
+                      Cooked_Texture *out_texture);
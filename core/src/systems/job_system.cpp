@@ -0,0 +1,388 @@
+#include "systems/job_system.hpp"
+
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "core/thread_context.hpp"
+#include "math/math.hpp"
+#include "utils/string.hpp"
+
+internal_var Job_System_State *state_ptr;
+
+// Worker of the calling thread, nullptr for threads outside the job system
+THREAD_STATIC Job_Worker *current_worker;
+
+struct Parallel_For_Batch
+{
+    PFN_parallel_for_body body;
+    void                 *data;
+    u64                   start;
+    u64                   end;
+};
+
+// The deque operations follow "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (Le et al.). The indices use sequentially consistent
+// operations instead of standalone fences, which gives the same ordering
+INTERNAL_FUNC b8
+deque_push(Job_Deque *deque, Job_Declaration *job)
+{
+    s64 bottom = deque->bottom.load(std::memory_order_relaxed);
+    s64 top    = deque->top.load(std::memory_order_acquire);
+
+    if (bottom - top >= deque->capacity)
+        return false;
+
+    deque->jobs[bottom & deque->mask].store(job, std::memory_order_relaxed);
+    deque->bottom.store(bottom + 1, std::memory_order_seq_cst);
+
+    return true;
+}
+
+// Owner only
+INTERNAL_FUNC Job_Declaration *
+deque_pop(Job_Deque *deque)
+{
+    s64 bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+    deque->bottom.store(bottom, std::memory_order_seq_cst);
+
+    s64 top = deque->top.load(std::memory_order_seq_cst);
+
+    if (top > bottom)
+    {
+        // Empty, restore the bottom
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job_Declaration *job =
+        deque->jobs[bottom & deque->mask].load(std::memory_order_relaxed);
+
+    if (top == bottom)
+    {
+        // Last job, race the thieves for it through the top
+        if (!deque->top.compare_exchange_strong(top,
+                top + 1,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed))
+            job = nullptr;
+
+        deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+INTERNAL_FUNC Job_Declaration *
+deque_steal(Job_Deque *deque)
+{
+    s64 top    = deque->top.load(std::memory_order_seq_cst);
+    s64 bottom = deque->bottom.load(std::memory_order_seq_cst);
+
+    if (top >= bottom)
+        return nullptr;
+
+    Job_Declaration *job =
+        deque->jobs[top & deque->mask].load(std::memory_order_relaxed);
+
+    // Another thief or the owner took it first
+    if (!deque->top.compare_exchange_strong(top,
+            top + 1,
+            std::memory_order_seq_cst,
+            std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+INTERNAL_FUNC Job_Declaration *
+find_job(Job_Worker *worker)
+{
+    Job_Declaration *job = deque_pop(&worker->deque);
+    if (job)
+        return job;
+
+    u32 thread_count = state_ptr->thread_count;
+    if (thread_count == 1)
+        return nullptr;
+
+    // Start from a random victim so that idle workers do not all hammer the
+    // same deque
+    u32 x = worker->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->random_state = x;
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        u32 victim = (x + i) % thread_count;
+        if (victim == worker->index)
+            continue;
+
+        job = deque_steal(&state_ptr->workers[victim].deque);
+        if (job)
+            return job;
+    }
+
+    return nullptr;
+}
+
+INTERNAL_FUNC void
+execute_job(Job_Declaration *job)
+{
+    if (job->dependency)
+        job_system_wait(job->dependency);
+
+    job->entry(job->data);
+
+    // The declaration may be released by the waiter as soon as the counter
+    // drops, it must not be touched afterwards
+    job->counter->value.fetch_sub(1, std::memory_order_release);
+}
+
+INTERNAL_FUNC u32
+job_worker_main(void *data)
+{
+    auto *worker = (Job_Worker *)data;
+
+    Thread_Context *context = thread_context_allocate();
+    context->thread_name =
+        string_fmt(context->arenas[0], "Job worker %u", worker->index).buff;
+    thread_context_select(context);
+    platform_thread_set_name(context->thread_name);
+
+    current_worker = worker;
+
+    u32 idle_spins = 0;
+
+    while (state_ptr->is_running.load(std::memory_order_acquire))
+    {
+        Job_Declaration *job = find_job(worker);
+        if (job)
+        {
+            execute_job(job);
+            idle_spins = 0;
+            continue;
+        }
+
+        if (++idle_spins < JOB_WORKER_SPIN_COUNT)
+        {
+            platform_thread_yield();
+            continue;
+        }
+
+        idle_spins = 0;
+
+        // Announce the sleep before checking the deques one last time. A
+        // submitter either sees the sleeping worker and signals it, or its
+        // job is found here
+        state_ptr->sleeping_workers.fetch_add(1, std::memory_order_seq_cst);
+
+        job = find_job(worker);
+        if (job)
+        {
+            state_ptr->sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+            execute_job(job);
+            continue;
+        }
+
+        platform_semaphore_wait(&state_ptr->wake_semaphore);
+        state_ptr->sleeping_workers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    current_worker = nullptr;
+    thread_context_release(context);
+
+    return 0;
+}
+
+Job_System_State *
+job_system_init(Arena *allocator, Job_System_Config config)
+{
+    RUNTIME_ASSERT_MSG(state_ptr == nullptr,
+        "job_system_init - The job system is already initialized");
+
+    RUNTIME_ASSERT_MSG(thread_context_selected() != nullptr,
+        "job_system_init - The calling thread must have a selected context");
+
+    if (config.thread_count == 0)
+    {
+        Platform_System_Info info = platform_query_system_info();
+        config.thread_count       = MAX(info.logical_processor_count, 1);
+    }
+
+    if (config.deque_capacity == 0)
+        config.deque_capacity = DEFAULT_JOB_DEQUE_CAPACITY;
+
+    auto *state = push_struct(allocator, Job_System_State);
+
+    state->config       = config;
+    state->thread_count = config.thread_count;
+    state->workers      = push_array(allocator, Job_Worker, state->thread_count);
+
+    s64 capacity = (s64)math_next_power_of_2(config.deque_capacity);
+
+    for (u32 i = 0; i < state->thread_count; ++i)
+    {
+        Job_Worker *worker   = &state->workers[i];
+        worker->index        = i;
+        worker->random_state = i * 2654435761u + 1;
+
+        worker->deque.capacity = capacity;
+        worker->deque.mask     = capacity - 1;
+        worker->deque.jobs =
+            push_array(allocator, std::atomic<Job_Declaration *>, capacity);
+    }
+
+    if (!platform_semaphore_create(0, &state->wake_semaphore))
+    {
+        CORE_ERROR("job_system_init - Failed to create the wake semaphore");
+        return nullptr;
+    }
+
+    state->is_running.store(true, std::memory_order_relaxed);
+
+    // Published before spawning, the workers read it as soon as they start
+    state_ptr      = state;
+    current_worker = &state->workers[0];
+
+    for (u32 i = 1; i < state->thread_count; ++i)
+    {
+        Job_Worker *worker = &state->workers[i];
+
+        b8 created =
+            platform_thread_create(job_worker_main, worker, &worker->thread);
+
+        RUNTIME_ASSERT_MSG(created,
+            "job_system_init - Failed to spawn a worker thread");
+    }
+
+    CORE_INFO("Job system initialized with %u worker threads",
+        state->thread_count - 1);
+
+    return state;
+}
+
+void
+job_system_shutdown()
+{
+    ENSURE(state_ptr);
+
+    state_ptr->is_running.store(false, std::memory_order_release);
+
+    // Every worker is either spinning and sees the flag, or sleeping and needs
+    // a wake up
+    platform_semaphore_signal(&state_ptr->wake_semaphore,
+        state_ptr->thread_count - 1);
+
+    for (u32 i = 1; i < state_ptr->thread_count; ++i)
+        platform_thread_join(&state_ptr->workers[i].thread);
+
+    platform_semaphore_destroy(&state_ptr->wake_semaphore);
+
+    current_worker = nullptr;
+    state_ptr      = nullptr;
+}
+
+u32
+job_system_thread_count()
+{
+    return state_ptr ? state_ptr->thread_count : 1;
+}
+
+void
+job_system_run(Job_Declaration *jobs, u32 count, Job_Counter *counter)
+{
+    RUNTIME_ASSERT(counter != nullptr);
+
+    counter->value.fetch_add(count, std::memory_order_relaxed);
+
+    Job_Worker *worker = current_worker;
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        jobs[i].counter = counter;
+
+        // Threads outside the job system, or before it is initialized, and
+        // full deques run the job right away
+        if (!worker || !deque_push(&worker->deque, &jobs[i]))
+            execute_job(&jobs[i]);
+    }
+
+    if (!worker)
+        return;
+
+    u32 sleeping =
+        state_ptr->sleeping_workers.load(std::memory_order_seq_cst);
+
+    if (sleeping > 0)
+    {
+        platform_semaphore_signal(&state_ptr->wake_semaphore,
+            MIN(sleeping, count));
+    }
+}
+
+void
+job_system_wait(Job_Counter *counter)
+{
+    Job_Worker *worker = current_worker;
+
+    while (counter->value.load(std::memory_order_acquire) > 0)
+    {
+        // Help instead of blocking, which also makes waiting from inside a
+        // job safe
+        Job_Declaration *job = worker ? find_job(worker) : nullptr;
+
+        if (job)
+            execute_job(job);
+        else
+            platform_thread_yield();
+    }
+}
+
+INTERNAL_FUNC void
+parallel_for_job(void *data)
+{
+    auto *batch = (Parallel_For_Batch *)data;
+    batch->body(batch->start, batch->end, batch->data);
+}
+
+void
+job_system_parallel_for(u64                   count,
+                        u64                   batch_size,
+                        PFN_parallel_for_body body,
+                        void                 *data)
+{
+    if (count == 0)
+        return;
+
+    // A few batches per thread absorb uneven batch costs through stealing
+    if (batch_size == 0)
+        batch_size = MAX(count / (job_system_thread_count() * 4), 1);
+
+    u64 batch_count = (count + batch_size - 1) / batch_size;
+
+    RUNTIME_ASSERT_MSG(batch_count <= 0xFFFFFFFFull,
+        "job_system_parallel_for - Too many batches");
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    auto *batches = push_array(scratch.arena, Parallel_For_Batch, batch_count);
+    auto *jobs    = push_array(scratch.arena, Job_Declaration, batch_count);
+
+    for (u64 i = 0; i < batch_count; ++i)
+    {
+        batches[i].body  = body;
+        batches[i].data  = data;
+        batches[i].start = i * batch_size;
+        batches[i].end   = MIN(count, (i + 1) * batch_size);
+
+        jobs[i].entry = parallel_for_job;
+        jobs[i].data  = &batches[i];
+    }
+
+    Job_Counter counter = {};
+    job_system_run(jobs, (u32)batch_count, &counter);
+    job_system_wait(&counter);
+
+    scratch_end(scratch);
+}
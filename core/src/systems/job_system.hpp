@@ -0,0 +1,112 @@
+#pragma once
+
+#include "defines.hpp"
+#include "memory/arena.hpp"
+#include "platform/platform.hpp"
+
+#include <atomic>
+
+// Jobs per worker deque. When a deque is full the job is run inline by the
+// thread that submitted it
+constexpr u32 DEFAULT_JOB_DEQUE_CAPACITY = 4096;
+
+// Workers that found no work spin this many times before going to sleep
+constexpr u32 JOB_WORKER_SPIN_COUNT = 64;
+
+typedef void (*PFN_job_entry)(void *data);
+
+// Called with a [start, end) range of the indices given to parallel_for
+typedef void (*PFN_parallel_for_body)(u64 start, u64 end, void *data);
+
+// Counts the jobs of a batch that have not finished yet. A counter can be
+// waited on and used as the dependency of other jobs
+struct Job_Counter
+{
+    std::atomic<s64> value;
+};
+
+// The declaration is not copied when submitted, the deques point to it, so it
+// has to outlive the job. Waiting on its counter before leaving the scope that
+// owns it is enough
+//
+// A job whose dependency is not done yet waits for it the way
+// job_system_wait does, running other jobs on top of its own stack frame.
+// Dependents are not deferred, so a chain of N jobs can nest N deep on one
+// thread, each level holding the frames of the job and of the wait. Workers
+// get the default thread stack, which is 512 KiB on macOS: with small job
+// bodies that is several thousand levels, job bodies with large locals lower
+// that. Longer chains should be split in stages waited on from the submitter
+struct Job_Declaration
+{
+    PFN_job_entry entry;
+    void         *data;
+
+    // Optional, the job is not started before this counter reaches zero
+    Job_Counter *dependency;
+
+    Job_Counter *counter; // Set by job_system_run
+};
+
+// Chase-Lev work-stealing deque. The owner pushes and pops at the bottom while
+// the other threads steal from the top
+struct Job_Deque
+{
+    alignas(64) std::atomic<s64> top;
+    alignas(64) std::atomic<s64> bottom;
+
+    alignas(64) s64 capacity;
+    s64 mask;
+    std::atomic<Job_Declaration *> *jobs;
+};
+
+struct Job_Worker
+{
+    Job_Deque       deque;
+    Platform_Thread thread;
+    u32             index;
+    u32             random_state; // Victim selection when stealing
+};
+
+struct Job_System_Config
+{
+    // Threads executing jobs, including the calling one which runs jobs while
+    // it waits. Zero picks one per logical processor
+    u32 thread_count;
+    u32 deque_capacity;
+};
+
+struct Job_System_State
+{
+    Job_System_Config config;
+
+    // Index 0 belongs to the thread that initialized the system
+    Job_Worker *workers;
+    u32         thread_count;
+
+    Platform_Semaphore wake_semaphore;
+    std::atomic<u32>   sleeping_workers;
+    std::atomic<b8>    is_running;
+};
+
+Job_System_State *job_system_init(Arena *allocator, Job_System_Config config);
+
+// Joins the workers. Submitted jobs must have been waited on before
+void job_system_shutdown();
+
+// Threads that can execute jobs, including the one that initialized the system
+u32 job_system_thread_count();
+
+// Adds count to the counter and queues the jobs on the deque of the calling
+// thread, where idle workers can steal them
+void job_system_run(Job_Declaration *jobs, u32 count, Job_Counter *counter);
+
+// Executes queued jobs until the counter reaches zero
+void job_system_wait(Job_Counter *counter);
+
+// Splits [0, count) in batches of batch_size indices and runs body on every
+// batch in parallel. Returns once all batches are done. A batch_size of zero
+// picks one that gives every thread a few batches
+void job_system_parallel_for(u64                   count,
+                             u64                   batch_size,
+                             PFN_parallel_for_body body,
+                             void                 *data);
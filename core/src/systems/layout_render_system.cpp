@@ -0,0 +1,234 @@
+#include "systems/layout_render_system.hpp"
+
+#include "core/absolute_clock.hpp"
+#include "core/asserts.hpp"
+#include "core/logger.hpp"
+#include "math/math.hpp"
+#include "renderer/renderer_frontend.hpp"
+#include "systems/geometry_system.hpp"
+#include "systems/material_system.hpp"
+#include "systems/texture_system.hpp"
+#include "utils/string.hpp"
+
+constexpr u64 LAYOUT_RENDER_ARENA_COMMIT_SIZE = 1 * MiB;
+constexpr u64 LAYOUT_RENDER_RECT_CHUNK_SIZE   = 64 * 1024;
+
+internal_var const vec4 LAYOUT_RENDER_PALETTE[LAYOUT_RENDER_PALETTE_SIZE] = {
+    {0.20f, 0.45f, 0.95f, 1.0f},
+    {0.90f, 0.25f, 0.25f, 1.0f},
+    {0.25f, 0.80f, 0.35f, 1.0f},
+    {0.95f, 0.75f, 0.20f, 1.0f},
+    {0.65f, 0.35f, 0.90f, 1.0f},
+    {0.20f, 0.80f, 0.85f, 1.0f},
+    {0.95f, 0.50f, 0.15f, 1.0f},
+    {0.75f, 0.75f, 0.75f, 1.0f},
+};
+
+internal_var Layout_Render_System_State *state_ptr = nullptr;
+
+INTERNAL_FUNC u32
+palette_slot(const Layout_LOD_Rect *rect)
+{
+    return (rect->layer + rect->datatype * 3) % LAYOUT_RENDER_PALETTE_SIZE;
+}
+
+INTERNAL_FUNC b8
+create_layer_geometries(Arena *allocator)
+{
+    for (u32 i = 0; i < LAYOUT_RENDER_PALETTE_SIZE; ++i)
+    {
+        String name = string_fmt(allocator, "layout_layer_%u", i);
+
+        Material_Config material_config = {};
+        string_set(material_config.name, name);
+        string_set(material_config.diffuse_map_name, WHITE_TEXTURE_NAME);
+        material_config.auto_release  = true;
+        material_config.diffuse_color = LAYOUT_RENDER_PALETTE[i];
+
+        Material *material =
+            material_system_acquire_from_config(material_config);
+
+        // A unit quad centered on the origin, scaled to each rect
+        Geometry_Config geometry_config =
+            geometry_system_generate_plane_config(allocator,
+                                                  1.0f,
+                                                  1.0f,
+                                                  1,
+                                                  1,
+                                                  1.0f,
+                                                  1.0f,
+                                                  (const char *)name.buff,
+                                                  DEFAULT_MATERIAL_NAME);
+
+        Geometry *geometry =
+            geometry_system_acquire_by_config(geometry_config, true);
+
+        if (!material || !geometry)
+        {
+            CORE_ERROR("create_layer_geometries - Failed to create the "
+                       "geometry of layer slot %u",
+                       i);
+            return false;
+        }
+
+        geometry->material             = material;
+        state_ptr->layer_geometries[i] = geometry;
+    }
+
+    return true;
+}
+
+Layout_Render_System_State *
+layout_render_system_init(Arena *allocator, Layout_Render_System_Config config)
+{
+    RUNTIME_ASSERT_MSG(
+        config.max_draw_count > 0,
+        "layout_render_system_init - config.max_draw_count must be > 0");
+
+    auto *state   = push_struct(allocator, Layout_Render_System_State);
+    state->config = config;
+    state->arena  = arena_create(LAYOUT_RENDER_ARENA_RESERVE,
+                                LAYOUT_RENDER_ARENA_COMMIT_SIZE);
+    state->draws =
+        push_array(allocator, Geometry_Render_Data, config.max_draw_count);
+    state->view_region = layout_box_empty();
+
+    state->rects.init(state->arena, LAYOUT_RENDER_RECT_CHUNK_SIZE);
+
+    state_ptr = state;
+
+    if (!create_layer_geometries(allocator))
+    {
+        state_ptr = nullptr;
+        return nullptr;
+    }
+
+    return state;
+}
+
+void
+layout_render_system_shutdown()
+{
+    if (!state_ptr)
+        return;
+
+    // Releasing the geometries also releases their layer material
+    for (u32 i = 0; i < LAYOUT_RENDER_PALETTE_SIZE; ++i)
+        geometry_release(state_ptr->layer_geometries[i]);
+
+    arena_release(state_ptr->arena);
+
+    state_ptr = nullptr;
+}
+
+VOLTRUM_API void
+layout_render_system_set_layout(Layout *layout, Layout_LOD *lod)
+{
+    RUNTIME_ASSERT_MSG(!lod || lod->layout == layout,
+        "layout_render_system_set_layout - The LOD was built for another "
+        "layout");
+
+    state_ptr->layout      = layout;
+    state_ptr->lod         = lod;
+    state_ptr->mm_per_unit = layout ? layout->database_unit * 1e3 : 0.0;
+    state_ptr->is_dirty    = true;
+
+    renderer_mark_scene_changed();
+}
+
+VOLTRUM_API void
+layout_render_system_set_view(Layout_Box region, f64 units_per_pixel)
+{
+    Layout_Box current = state_ptr->view_region;
+
+    if (current.min_x == region.min_x && current.min_y == region.min_y &&
+        current.max_x == region.max_x && current.max_y == region.max_y &&
+        state_ptr->units_per_pixel == units_per_pixel)
+        return;
+
+    state_ptr->view_region     = region;
+    state_ptr->units_per_pixel = units_per_pixel;
+    state_ptr->is_dirty        = true;
+
+    renderer_mark_scene_changed();
+}
+
+INTERNAL_FUNC void
+rebuild_draws()
+{
+    Layout_Render_System_State *state = state_ptr;
+
+    state->is_dirty   = false;
+    state->draw_count = 0;
+
+    arena_clear(state->arena);
+    state->rects.init(state->arena, LAYOUT_RENDER_RECT_CHUNK_SIZE);
+
+    state->stats                 = {};
+    state->stats.units_per_pixel = state->units_per_pixel;
+
+    if (!state->layout || !state->lod ||
+        layout_box_is_empty(state->view_region))
+        return;
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    layout_lod_collect(state->lod,
+                       state->layout->top_cell,
+                       state->view_region,
+                       state->units_per_pixel,
+                       &state->rects,
+                       &state->stats.lod);
+
+    u64 draw_count = MIN(state->rects.size, (u64)state->config.max_draw_count);
+    f64 scale      = state->mm_per_unit;
+
+    for (u64 i = 0; i < draw_count; ++i)
+    {
+        Layout_LOD_Rect *rect = &state->rects[i];
+        u32              slot = palette_slot(rect);
+
+        f64 center_x = ((f64)rect->box.min_x + rect->box.max_x) * 0.5;
+        f64 center_y = ((f64)rect->box.min_y + rect->box.max_y) * 0.5;
+        f64 width    = (f64)rect->box.max_x - rect->box.min_x;
+        f64 height   = (f64)rect->box.max_y - rect->box.min_y;
+
+        Geometry_Render_Data *draw = &state->draws[i];
+        draw->geometry             = state->layer_geometries[slot];
+        draw->model =
+            mat4_scale({(f32)(width * scale), (f32)(height * scale), 1.0f}) *
+            mat4_translation({(f32)(center_x * scale),
+                              (f32)(center_y * scale),
+                              slot * LAYOUT_RENDER_LAYER_SPACING_Z});
+    }
+
+    absolute_clock_update(&clock);
+
+    state->draw_count          = (u32)draw_count;
+    state->stats.draw_count    = (u32)draw_count;
+    state->stats.dropped_count = state->rects.size - draw_count;
+    state->stats.collect_time  = clock.elapsed_time;
+}
+
+u32
+layout_render_system_get_draws(Geometry_Render_Data **out_draws)
+{
+    if (!state_ptr)
+    {
+        *out_draws = nullptr;
+        return 0;
+    }
+
+    if (state_ptr->is_dirty)
+        rebuild_draws();
+
+    *out_draws = state_ptr->draws;
+    return state_ptr->draw_count;
+}
+
+VOLTRUM_API void
+layout_render_system_get_stats(Layout_Render_Stats *out_stats)
+{
+    *out_stats = state_ptr ? state_ptr->stats : Layout_Render_Stats{};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "defines.hpp"
+#include "layout/layout_lod.hpp"
+#include "memory/arena.hpp"
+#include "renderer/renderer_types.hpp"
+
+// Layers are colored by cycling through the palette
+constexpr u32 LAYOUT_RENDER_PALETTE_SIZE = 8;
+
+// Layers are stacked along z so that overlapping shapes of different layers do
+// not fight over the depth buffer
+constexpr f32 LAYOUT_RENDER_LAYER_SPACING_Z = 0.01f;
+
+constexpr u64 LAYOUT_RENDER_ARENA_RESERVE = 1 * GiB;
+
+struct Layout_Render_System_Config
+{
+    u32 max_draw_count; // Rects past it are dropped from the view
+};
+
+struct Layout_Render_Stats
+{
+    Layout_LOD_Stats lod;
+    u32              draw_count;
+    u64              dropped_count;
+    f64              units_per_pixel;
+    f64              collect_time; // Seconds, for the last view change
+};
+
+// Draws the open layout as one unit quad per rect. The rects are collected
+// through the LOD of the layout when the view changes, so the draw count
+// follows the pixels of the viewport rather than the size of the layout
+struct Layout_Render_System_State
+{
+    Layout_Render_System_Config config;
+    Arena                      *arena; // Rects of the view, cleared on change
+
+    Layout     *layout;
+    Layout_LOD *lod;
+    f64         mm_per_unit; // World units are millimeters
+
+    Layout_Box view_region;
+    f64        units_per_pixel;
+    b8         is_dirty;
+
+    Geometry *layer_geometries[LAYOUT_RENDER_PALETTE_SIZE];
+
+    Dynamic_Array<Layout_LOD_Rect> rects;
+    Geometry_Render_Data          *draws;
+    u32                            draw_count;
+
+    Layout_Render_Stats stats;
+};
+
+Layout_Render_System_State *
+layout_render_system_init(Arena *allocator, Layout_Render_System_Config config);
+
+void layout_render_system_shutdown();
+
+// Both stay owned by the caller and have to outlive their use here, nullptr
+// stops drawing
+VOLTRUM_API void layout_render_system_set_layout(Layout     *layout,
+                                                 Layout_LOD *lod);
+
+// Region in database units, and database units covered by a pixel
+VOLTRUM_API void layout_render_system_set_view(Layout_Box region,
+                                               f64        units_per_pixel);
+
+// Draws of the current view, valid until the next call
+u32 layout_render_system_get_draws(Geometry_Render_Data **out_draws);
+
+VOLTRUM_API void layout_render_system_get_stats(Layout_Render_Stats *out_stats);
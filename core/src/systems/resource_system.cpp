@@ -1,12 +1,15 @@
 #include "resource_system.hpp"
 #include "core/asserts.hpp"
 #include "core/logger.hpp"
+#include "memory/memory.hpp"
+#include "utils/string.hpp"
 
 // List of system resource loaders that are known to the core library
 #include "resources/loaders/binary_loader.hpp"
 #include "resources/loaders/font_loader.hpp"
 #include "resources/loaders/icon_loader.hpp"
 #include "resources/loaders/image_loader.hpp"
+#include "resources/loaders/layout_loader.hpp"
 #include "resources/loaders/material_loader.hpp"
 #include "resources/loaders/text_loader.hpp"
 
@@ -19,6 +22,16 @@ resource_system_init(Arena *arena, Resource_System_Config config)
 
     state->config = config;
 
+    // During development there is usually no archive, everything is read
+    // from the loose files
+    if (config.archive_path &&
+        resource_archive_open(config.archive_path, &state->archive))
+    {
+        CORE_TRACE("Resource archive '%s' opened with %u resources",
+                   config.archive_path,
+                   state->archive.entry_count);
+    }
+
     CORE_TRACE("Resource system initialized with base path '%s'",
                config.asset_base_path);
 
@@ -27,27 +40,22 @@ resource_system_init(Arena *arena, Resource_System_Config config)
     return state;
 }
 
-VOLTRUM_API b8
-resource_system_load(Arena         *arena,
-                     const char    *name,
-                     Resource_Type  type,
-                     Resource      *out_resource)
+void
+resource_system_shutdown()
 {
     ENSURE(state_ptr);
 
-    if (!name)
-    {
-        CORE_ERROR("resource_system_load - Invalid name provided. Returning.");
-        return false;
-    }
+    resource_archive_close(&state_ptr->archive);
 
-    if (!out_resource)
-    {
-        CORE_ERROR(
-            "resource_system_load - Out resource object is nullptr. Returning");
-        return false;
-    }
+    state_ptr = nullptr;
+}
 
+INTERNAL_FUNC b8
+load_loose(Arena         *arena,
+           const char    *name,
+           Resource_Type  type,
+           Resource      *out_resource)
+{
     switch (type)
     {
         case Resource_Type::TEXT:
@@ -62,6 +70,8 @@ resource_system_load(Arena         *arena,
             return material_loader_load(arena, name, out_resource);
         case Resource_Type::FONT:
             return font_loader_load(arena, name, out_resource);
+        case Resource_Type::LAYOUT:
+            return layout_loader_load(arena, name, out_resource);
         default:
             CORE_ERROR(
                 "resource_system_load - Unknown resource type %d", type);
@@ -69,6 +79,101 @@ resource_system_load(Arena         *arena,
     }
 }
 
+INTERNAL_FUNC b8
+is_packable(Resource_Type type)
+{
+    return type == Resource_Type::TEXT || type == Resource_Type::BINARY ||
+           type == Resource_Type::FONT || type == Resource_Type::IMAGE ||
+           type == Resource_Type::ICON;
+}
+
+// Nothing is copied, the data points into the mapping of the archive
+INTERNAL_FUNC b8
+load_archived(Arena         *arena,
+              const char    *name,
+              Resource_Type  type,
+              Resource      *out_resource)
+{
+    const Resource_Archive *archive = &state_ptr->archive;
+
+    const Resource_Archive_Entry *entry =
+        resource_archive_find(archive, type, name);
+
+    if (!entry)
+        return false;
+
+    const u8 *data = resource_archive_data(archive, entry);
+
+    String full_path =
+        string_fmt(arena, "%s/%s", state_ptr->config.archive_path, name);
+
+    out_resource->full_path = (char *)full_path.buff;
+    out_resource->name      = name;
+
+    if (type == Resource_Type::IMAGE || type == Resource_Type::ICON)
+    {
+        const auto *header = (const Resource_Archive_Image *)data;
+
+        if (entry->size < sizeof(Resource_Archive_Image) +
+                              (u64)header->width * header->height *
+                                  header->channel_count)
+        {
+            CORE_ERROR("resource_system_load - Malformed image '%s' in the "
+                       "archive",
+                       name);
+            return false;
+        }
+
+        Image_Resource_Data *resource_data =
+            push_struct(arena, Image_Resource_Data);
+
+        resource_data->channel_count = (u8)header->channel_count;
+        resource_data->width         = header->width;
+        resource_data->height        = header->height;
+        resource_data->pixels = (u8 *)(data + sizeof(Resource_Archive_Image));
+
+        out_resource->data      = resource_data;
+        out_resource->data_size = sizeof(Image_Resource_Data);
+
+        return true;
+    }
+
+    out_resource->data      = (void *)data;
+    out_resource->data_size = entry->size;
+
+    return true;
+}
+
+VOLTRUM_API b8
+resource_system_load(Arena         *arena,
+                     const char    *name,
+                     Resource_Type  type,
+                     Resource      *out_resource)
+{
+    ENSURE(state_ptr);
+
+    if (!name)
+    {
+        CORE_ERROR("resource_system_load - Invalid name provided. Returning.");
+        return false;
+    }
+
+    if (!out_resource)
+    {
+        CORE_ERROR(
+            "resource_system_load - Out resource object is nullptr. Returning");
+        return false;
+    }
+
+    if (state_ptr->archive.mapping.data && is_packable(type) &&
+        load_archived(arena, name, type, out_resource))
+    {
+        return true;
+    }
+
+    return load_loose(arena, name, type, out_resource);
+}
+
 VOLTRUM_API const char *
 resource_system_base_path()
 {
@@ -76,3 +181,82 @@ resource_system_base_path()
 
     return state_ptr->config.asset_base_path;
 }
+
+VOLTRUM_API b8
+resource_system_pack(Arena                    *arena,
+                     const char               *archive_path,
+                     const Resource_Pack_Item *items,
+                     u32                       item_count)
+{
+    ENSURE(state_ptr);
+
+    u64 position = arena_position(arena);
+
+    auto *blobs = push_array(arena, Resource_Archive_Blob, item_count);
+
+    for (u32 i = 0; i < item_count; ++i)
+    {
+        const Resource_Pack_Item *item = &items[i];
+
+        Resource resource = {};
+
+        if (!is_packable(item->type))
+        {
+            CORE_ERROR("resource_system_pack - '%s' has a type that can not "
+                       "be packed",
+                       item->name);
+            arena_pop_to(arena, position);
+            return false;
+        }
+
+        if (!load_loose(arena, item->name, item->type, &resource))
+        {
+            CORE_ERROR("resource_system_pack - Unable to load '%s'",
+                       item->name);
+            arena_pop_to(arena, position);
+            return false;
+        }
+
+        Resource_Archive_Blob *blob = &blobs[i];
+        blob->type                  = item->type;
+        blob->name                  = item->name;
+        blob->data                  = resource.data;
+        blob->size                  = resource.data_size;
+
+        // Images are stored decoded, prefixed with their size
+        if (item->type == Resource_Type::IMAGE ||
+            item->type == Resource_Type::ICON)
+        {
+            auto *image = static_cast<Image_Resource_Data *>(resource.data);
+
+            u64 pixels_size =
+                (u64)image->width * image->height * image->channel_count;
+            u64 size = sizeof(Resource_Archive_Image) + pixels_size;
+            u8 *data = push_array(arena, u8, size);
+
+            auto *header          = (Resource_Archive_Image *)data;
+            header->width         = image->width;
+            header->height        = image->height;
+            header->channel_count = image->channel_count;
+            header->reserved      = 0;
+
+            memory_copy(data + sizeof(Resource_Archive_Image),
+                        image->pixels,
+                        pixels_size);
+
+            blob->data = data;
+            blob->size = size;
+        }
+    }
+
+    b8 result = resource_archive_write(arena, archive_path, blobs, item_count);
+
+    if (result)
+    {
+        CORE_INFO("Packed %u resources into '%s'", item_count, archive_path);
+    }
+
+    arena_pop_to(arena, position);
+
+    return result;
+}
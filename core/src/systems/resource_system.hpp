@@ -1,24 +1,49 @@
 #pragma once
 
 #include "memory/arena.hpp"
+#include "resources/resource_archive.hpp"
 #include "resources/resource_types.hpp"
 
 struct Resource_System_Config
 {
     const char *asset_base_path;
+
+    // Optional. Resources that are not in the archive, or every resource when
+    // the archive is missing, are loaded from the loose files
+    const char *archive_path;
 };
 
 struct Resource_System_State
 {
     Resource_System_Config config;
+    Resource_Archive       archive; // Empty unless the archive was opened
+};
+
+// A resource resource_system_pack loads from the loose files
+struct Resource_Pack_Item
+{
+    const char   *name;
+    Resource_Type type;
 };
 
 Resource_System_State *resource_system_init(Arena      *arena,
                                             Resource_System_Config config);
 
+void resource_system_shutdown();
+
+// TEXT, BINARY and FONT resources loaded from the archive point straight into
+// its mapping and are read-only. IMAGE and ICON pixels are stored decoded and
+// also point into the mapping, without the decode
 VOLTRUM_API b8 resource_system_load(Arena         *arena,
                                     const char    *name,
                                     Resource_Type  type,
                                     Resource      *out_resource);
 
 VOLTRUM_API const char *resource_system_base_path();
+
+// Writes the loose files of the items into an archive. Only the TEXT, BINARY,
+// FONT, IMAGE and ICON types can be packed
+VOLTRUM_API b8 resource_system_pack(Arena                    *arena,
+                                    const char               *archive_path,
+                                    const Resource_Pack_Item *items,
+                                    u32                       item_count);
@@ -7,7 +7,10 @@
 #include "memory/memory.hpp"
 #include "utils/string.hpp"
 
+#include "platform/platform.hpp"
 #include "renderer/renderer_frontend.hpp"
+#include "resources/loaders/image_loader.hpp"
+#include "systems/job_system.hpp"
 #include "systems/resource_system.hpp"
 
 internal_var Texture_System_State *state_ptr;
@@ -24,61 +27,58 @@ create_texture(Texture *texture)
 
 INTERNAL_FUNC void destroy_texture(Texture *texture);
 
-INTERNAL_FUNC b8
-load_texture(const char *texture_name, Texture *texture, b8 is_ui_texture)
+INTERNAL_FUNC u64
+texture_memory_size(const Texture *texture)
 {
-    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+    u64 size = 0;
 
-    Resource img_resource;
-    if (!resource_system_load(scratch.arena,
-                              texture_name,
-                              Resource_Type::IMAGE,
-                              &img_resource))
+    for (u32 i = 0; i < texture->mip_count; ++i)
     {
-        CORE_ERROR("Failed to load image resource for texture '%s'",
-                   texture_name);
-        scratch_end(scratch);
-        return false;
+        size += texture_format_size(texture->format,
+                                    MAX(1u, texture->width >> i),
+                                    MAX(1u, texture->height >> i));
     }
 
-    Image_Resource_Data *resource_data =
-        static_cast<Image_Resource_Data *>(img_resource.data);
+    return size;
+}
 
+// Creates the renderer texture from its mips and swaps it in place of the
+// current contents of the slot
+INTERNAL_FUNC void
+upload_texture(const char           *texture_name,
+               Texture              *texture,
+               const Cooked_Texture *cooked,
+               b8                    is_ui_texture)
+{
     Texture temp_texture;
-    temp_texture.width         = resource_data->width;
-    temp_texture.height        = resource_data->height;
-    temp_texture.channel_count = resource_data->channel_count;
+    temp_texture.width         = cooked->width;
+    temp_texture.height        = cooked->height;
+    temp_texture.channel_count = 4;
+    temp_texture.format        = cooked->format;
+    temp_texture.mip_count     = (u8)cooked->mip_count;
 
     u32 current_generation = texture->generation;
     texture->generation    = INVALID_ID;
 
-    u64 total_texture_size =
-        temp_texture.width * temp_texture.height * temp_texture.channel_count;
-
-    b8 has_transparency = false;
-
-    for (u64 i = 0; i < total_texture_size; i += temp_texture.channel_count)
-    {
-        u8 alpha = resource_data->pixels[i + 3];
-        if (alpha < 255)
-        {
-            has_transparency = true;
-            break;
-        }
-    }
-
     string_set(temp_texture.name, texture_name);
     temp_texture.generation       = INVALID_ID;
-    temp_texture.has_transparency = has_transparency;
+    temp_texture.has_transparency = cooked->has_transparency;
 
-    renderer_create_texture(resource_data->pixels,
-                            &temp_texture,
-                            is_ui_texture);
+    renderer_create_texture_mips(cooked->mips, &temp_texture, is_ui_texture);
 
     // Copy old texture
     Texture old_texture = *texture;
     *texture            = temp_texture;
 
+    Texture_Streaming_Stats *stats = &state_ptr->streaming_stats;
+    stats->memory_size += texture_memory_size(texture);
+    stats->memory_size -= texture_memory_size(&old_texture);
+
+    if (!is_ui_texture && cooked->mapping.data)
+        stats->cache_hit_count++;
+    else if (!is_ui_texture)
+        stats->cooked_count++;
+
     renderer_destroy_texture(&old_texture);
 
     if (current_generation == INVALID_ID)
@@ -89,12 +89,120 @@ load_texture(const char *texture_name, Texture *texture, b8 is_ui_texture)
     {
         texture->generation = current_generation + 1;
     }
+}
+
+// Textures of the scene come from the texture cache with their mip chain. UI
+// textures are drawn at their size, they stay a single RGBA8 mip
+INTERNAL_FUNC b8
+read_texture(Arena          *arena,
+             const char     *texture_name,
+             b8              is_ui_texture,
+             Cooked_Texture *out_cooked)
+{
+    if (!is_ui_texture)
+    {
+        String path = string_fmt(arena,
+                                 "%s/%s/%s%s",
+                                 resource_system_base_path(),
+                                 "textures",
+                                 texture_name,
+                                 ".png");
+
+        return texture_cache_load(arena,
+                                  path.buff,
+                                  state_ptr->allow_block_compression,
+                                  out_cooked);
+    }
+
+    Resource img_resource;
+    if (!resource_system_load(arena,
+                              texture_name,
+                              Resource_Type::IMAGE,
+                              &img_resource))
+    {
+        return false;
+    }
+
+    auto *image = static_cast<Image_Resource_Data *>(img_resource.data);
+
+    memory_zero(out_cooked, sizeof(Cooked_Texture));
+    out_cooked->format           = Texture_Format::RGBA8;
+    out_cooked->width            = image->width;
+    out_cooked->height           = image->height;
+    out_cooked->mip_count        = 1;
+    out_cooked->has_transparency = image_has_transparency(image);
+
+    out_cooked->mips[0].data   = image->pixels;
+    out_cooked->mips[0].size   = (u64)image->width * image->height * 4;
+    out_cooked->mips[0].width  = image->width;
+    out_cooked->mips[0].height = image->height;
+
+    return true;
+}
+
+// Gives back the arena and the mapped container of a request
+INTERNAL_FUNC void
+release_stream_request(Texture_Stream_Request *request)
+{
+    texture_cache_close(&request->cooked);
+    arena_release(request->arena);
+    state_ptr->stream_requests.release(request);
+}
+
+INTERNAL_FUNC b8
+load_texture(const char *texture_name, Texture *texture, b8 is_ui_texture)
+{
+    f64 start_time = platform_get_absolute_time();
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    Cooked_Texture cooked;
+    if (!read_texture(scratch.arena, texture_name, is_ui_texture, &cooked))
+    {
+        CORE_ERROR("Failed to load image resource for texture '%s'",
+                   texture_name);
+        scratch_end(scratch);
+        return false;
+    }
+
+    upload_texture(texture_name, texture, &cooked, is_ui_texture);
 
+    texture_cache_close(&cooked);
     scratch_end(scratch);
 
+    state_ptr->main_thread_time += platform_get_absolute_time() - start_time;
+
     return true;
 }
 
+// Runs on a worker, loads the texture into the arena of the request
+INTERNAL_FUNC void
+decode_texture_job(void *data)
+{
+    auto *request = (Texture_Stream_Request *)data;
+
+    request->arena = arena_create(TEXTURE_STREAMING_ARENA_RESERVE);
+
+    request->succeeded = read_texture(request->arena,
+                                      request->name,
+                                      request->is_ui_texture,
+                                      &request->cooked);
+}
+
+// Decodes the image and hands it back to the main thread for the upload
+INTERNAL_FUNC void
+stream_texture_job(void *data)
+{
+    auto *request = (Texture_Stream_Request *)data;
+
+    decode_texture_job(request);
+
+    // Only full when every texture slot has a decode in flight and the main
+    // thread has not updated yet
+    while (!state_ptr->completed_requests.enqueue(request))
+        platform_thread_yield();
+}
+
 Texture_System_State *
 texture_system_init(Arena *allocator, Texture_System_Config config)
 {
@@ -111,6 +219,11 @@ texture_system_init(Arena *allocator, Texture_System_Config config)
     state->texture_registry.init(allocator, count);
 
     state->registered_textures = push_array(allocator, Texture, count);
+    state->slot_request_ids    = push_array(allocator, u64, count);
+
+    state->stream_requests.init(allocator, count);
+    state->completed_requests.init(allocator, count);
+    state->next_request_id = 1;
 
     // Invalidate all ids present in the texture array
     for (u32 i = 0; i < count; ++i)
@@ -119,6 +232,12 @@ texture_system_init(Arena *allocator, Texture_System_Config config)
         state->registered_textures[i].generation = INVALID_ID;
     }
 
+    // Cooked textures are block compressed only when both formats can be
+    // sampled, they are cooked as RGBA8 otherwise
+    state->allow_block_compression =
+        renderer_supports_texture_format(Texture_Format::BC1) &&
+        renderer_supports_texture_format(Texture_Format::BC3);
+
     create_default_textures(state);
 
     state_ptr = state;
@@ -133,6 +252,13 @@ texture_system_shutdown()
 
     u32 max_count = state_ptr->config.max_texture_count;
 
+    // Let the decodes in flight finish, their results are dropped
+    job_system_wait(&state_ptr->stream_counter);
+
+    Texture_Stream_Request *request;
+    while (state_ptr->completed_requests.dequeue(&request))
+        release_stream_request(request);
+
     CORE_INFO("Destroying registered textures...");
     // Destroy all internal renderer-specific resources for texture that are
     // still valid in the registry
@@ -153,6 +279,28 @@ texture_system_shutdown()
     destroy_default_textures(state_ptr);
 }
 
+INTERNAL_FUNC Texture *
+find_free_slot(u32 *out_index)
+{
+    // Find the index for the texture to be stored
+    for (u32 i = 0; i < state_ptr->config.max_texture_count; ++i)
+    {
+        // If we find a slot in the memory that has a valid id means that
+        // slot is empty and we can use it
+        if (state_ptr->registered_textures[i].id == INVALID_ID)
+        {
+            *out_index = i;
+            return &state_ptr->registered_textures[i];
+        }
+    }
+
+    // Handle the case when we loop over and do not find an empty slot
+    CORE_FATAL(
+        "Texture registry is full and cannot store any additional textures");
+
+    return nullptr;
+}
+
 Texture *
 texture_system_acquire(const char *name, b8 auto_release, b8 is_ui_texture)
 {
@@ -166,6 +314,13 @@ texture_system_acquire(const char *name, b8 auto_release, b8 is_ui_texture)
         return &state_ptr->default_texture;
     }
 
+    if (string_match(STR(name),
+                  STR(WHITE_TEXTURE_NAME),
+                  String_Match_Flags::CASE_INSENSITIVE))
+    {
+        return &state_ptr->white_texture;
+    }
+
     Texture_Reference ref;
     Texture          *texture = nullptr;
 
@@ -181,26 +336,11 @@ texture_system_acquire(const char *name, b8 auto_release, b8 is_ui_texture)
         CORE_DEBUG("Texture '%s' not present in the registry. Loading...",
                    name);
 
-        // Find the index for the texture to be stored
         u32 index = 0;
-        for (u32 i = 0; i < state_ptr->config.max_texture_count; ++i)
-        {
-            // If we find a slot in the memory that has a valid id means that
-            // slot is empty and we can use it
-            if (state_ptr->registered_textures[i].id == INVALID_ID)
-            {
-                texture = &state_ptr->registered_textures[i];
-                index   = i;
-                break;
-            }
-        }
+        texture   = find_free_slot(&index);
 
-        // Handle the case when we loop over and do not find an empty slot
         if (!texture)
         {
-            CORE_FATAL(
-                "Texture registry is full and cannot store any additional "
-                "textures");
             return nullptr;
         }
 
@@ -225,6 +365,279 @@ texture_system_acquire(const char *name, b8 auto_release, b8 is_ui_texture)
     return texture;
 }
 
+// Claims a free slot for the texture and registers it, the generation stays
+// invalid until the upload so the renderer falls back to the default texture.
+// The request is returned without a job
+INTERNAL_FUNC Texture_Stream_Request *
+begin_decode_request(const char *name, b8 auto_release, b8 is_ui_texture)
+{
+    u64 name_length = STR(name).size;
+    if (name_length >= TEXTURE_NAME_MAX_LENGTH)
+    {
+        CORE_ERROR("begin_decode_request - Name '%s' is too long", name);
+        return nullptr;
+    }
+
+    u32      index   = 0;
+    Texture *texture = find_free_slot(&index);
+
+    if (!texture)
+    {
+        return nullptr;
+    }
+
+    create_texture(texture);
+    string_set(texture->name, name);
+    texture->id            = index;
+    texture->is_ui_texture = is_ui_texture;
+
+    Texture_Stream_Request *request = state_ptr->stream_requests.acquire();
+
+    memory_copy(request->name, name, name_length);
+    request->name[name_length] = '\0';
+    request->texture_index     = index;
+    request->request_id        = state_ptr->next_request_id++;
+    request->is_ui_texture     = is_ui_texture;
+    request->request_time      = platform_get_absolute_time();
+
+    Texture_Reference ref;
+    ref.handle          = index;
+    ref.auto_release    = auto_release;
+    ref.reference_count = 1;
+
+    state_ptr->texture_registry.add(STR(name), &ref, true);
+
+    return request;
+}
+
+Texture *
+texture_system_acquire_async(const char *name,
+                             b8          auto_release,
+                             b8          is_ui_texture)
+{
+    if (string_match(STR(name),
+                  STR(DEFAULT_TEXTURE_NAME),
+                  String_Match_Flags::CASE_INSENSITIVE))
+    {
+        CORE_WARN(
+            "texture_system_acquire_async - Called for default texture. Use "
+            "get_default_texture_method for this");
+        return &state_ptr->default_texture;
+    }
+
+    Texture_Reference ref;
+
+    // Already loaded or streaming, the caller shares the slot either way
+    if (state_ptr->texture_registry.find(STR(name), &ref))
+    {
+        ref.reference_count++;
+        state_ptr->texture_registry.add(STR(name), &ref, true);
+
+        return &state_ptr->registered_textures[ref.handle];
+    }
+
+    Texture_Stream_Request *request =
+        begin_decode_request(name, auto_release, is_ui_texture);
+
+    if (!request)
+    {
+        return nullptr;
+    }
+
+    request->job.entry = stream_texture_job;
+    request->job.data  = request;
+
+    state_ptr->slot_request_ids[request->texture_index] = request->request_id;
+    state_ptr->streaming_stats.pending_count++;
+
+    job_system_run(&request->job, 1, &state_ptr->stream_counter);
+
+    return &state_ptr->registered_textures[request->texture_index];
+}
+
+b8
+texture_system_acquire_batch(const char **names,
+                             u32          count,
+                             b8           auto_release,
+                             b8           is_ui_texture,
+                             Texture    **out_textures)
+{
+    ENSURE(state_ptr);
+
+    f64 start_time = platform_get_absolute_time();
+
+    Scratch_Arena scratch = scratch_begin(nullptr, 0);
+
+    auto **requests =
+        push_array(scratch.arena, Texture_Stream_Request *, count);
+    u32 *request_slots = push_array(scratch.arena, u32, count);
+    u32  request_count = 0;
+
+    Job_Counter counter = {};
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        Texture_Reference ref;
+
+        // Registered textures, and repeated names, are shared like in
+        // texture_system_acquire
+        if (state_ptr->texture_registry.find(STR(names[i]), &ref) ||
+            string_match(STR(names[i]),
+                         STR(DEFAULT_TEXTURE_NAME),
+                         String_Match_Flags::CASE_INSENSITIVE) ||
+            string_match(STR(names[i]),
+                         STR(WHITE_TEXTURE_NAME),
+                         String_Match_Flags::CASE_INSENSITIVE))
+        {
+            out_textures[i] =
+                texture_system_acquire(names[i], auto_release, is_ui_texture);
+            continue;
+        }
+
+        Texture_Stream_Request *request =
+            begin_decode_request(names[i], auto_release, is_ui_texture);
+
+        out_textures[i] = nullptr;
+
+        if (!request)
+            continue;
+
+        request->job.entry = decode_texture_job;
+        request->job.data  = request;
+
+        requests[request_count]      = request;
+        request_slots[request_count] = i;
+        request_count++;
+
+        job_system_run(&request->job, 1, &counter);
+    }
+
+    // The calling thread decodes too while it waits
+    job_system_wait(&counter);
+
+    for (u32 i = 0; i < request_count; ++i)
+    {
+        Texture_Stream_Request *request = requests[i];
+        Texture                *texture =
+            &state_ptr->registered_textures[request->texture_index];
+
+        if (request->succeeded)
+        {
+            upload_texture(request->name,
+                           texture,
+                           &request->cooked,
+                           request->is_ui_texture);
+
+            // The swap in upload_texture brings an invalid id with it
+            texture->id                    = request->texture_index;
+            out_textures[request_slots[i]] = texture;
+        }
+        else
+        {
+            // Like a failed texture_system_acquire, nothing is registered
+            CORE_ERROR("Failed to load texture '%s'", request->name);
+
+            create_texture(texture);
+            texture->id = INVALID_ID;
+            state_ptr->texture_registry.remove(STR(request->name));
+        }
+
+        release_stream_request(request);
+    }
+
+    scratch_end(scratch);
+
+    state_ptr->main_thread_time += platform_get_absolute_time() - start_time;
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (!out_textures[i])
+            return false;
+    }
+
+    return true;
+}
+
+void
+texture_system_update()
+{
+    ENSURE(state_ptr);
+
+    f64                      start_time = platform_get_absolute_time();
+    Texture_Streaming_Stats *stats      = &state_ptr->streaming_stats;
+
+    Texture_Stream_Request *request;
+
+    for (u32 i = 0; i < TEXTURE_STREAMING_UPLOADS_PER_UPDATE &&
+                    state_ptr->completed_requests.dequeue(&request);
+         ++i)
+    {
+        u32 index = request->texture_index;
+
+        stats->pending_count--;
+
+        // The slot was released, and maybe reused, while the image was decoded
+        u64 *slot_request_id = &state_ptr->slot_request_ids[index];
+
+        if (*slot_request_id != request->request_id)
+        {
+            CORE_DEBUG("Streamed texture '%s' is no longer needed. Dropping...",
+                       request->name);
+        }
+        else if (!request->succeeded)
+        {
+            // Keep the slot with an invalid generation, so it keeps showing the
+            // default texture like a failed synchronous load would
+            CORE_ERROR("Failed to stream texture '%s'", request->name);
+            stats->failed_count++;
+
+            *slot_request_id = 0;
+        }
+        else
+        {
+            Texture *texture = &state_ptr->registered_textures[index];
+
+            upload_texture(request->name,
+                           texture,
+                           &request->cooked,
+                           request->is_ui_texture);
+
+            *slot_request_id = 0;
+
+            // The swap in upload_texture brings an invalid id with it
+            texture->id = index;
+
+            f64 latency = platform_get_absolute_time() - request->request_time;
+
+            stats->completed_count++;
+            stats->last_latency = latency;
+            stats->max_latency  = MAX(stats->max_latency, latency);
+
+            state_ptr->total_latency += latency;
+            stats->average_latency =
+                state_ptr->total_latency / stats->completed_count;
+        }
+
+        release_stream_request(request);
+    }
+
+    state_ptr->main_thread_time += platform_get_absolute_time() - start_time;
+
+    stats->last_main_thread_time = state_ptr->main_thread_time;
+    stats->max_main_thread_time =
+        MAX(stats->max_main_thread_time, state_ptr->main_thread_time);
+
+    state_ptr->main_thread_time = 0;
+}
+
+VOLTRUM_API void
+texture_system_get_streaming_stats(Texture_Streaming_Stats *out_stats)
+{
+    ENSURE(state_ptr);
+
+    *out_stats = state_ptr->streaming_stats;
+}
+
 void
 texture_system_release(const char *name)
 {
@@ -238,6 +651,13 @@ texture_system_release(const char *name)
         return;
     }
 
+    if (string_match(STR(name),
+                  STR(WHITE_TEXTURE_NAME),
+                  String_Match_Flags::CASE_INSENSITIVE))
+    {
+        return;
+    }
+
     Texture_Reference ref;
 
     if (state_ptr->texture_registry.find(STR(name), &ref))
@@ -263,9 +683,17 @@ texture_system_release(const char *name)
                 "registry...",
                 name_copy);
 
-            destroy_texture(&state_ptr->registered_textures[ref.handle]);
+            Texture *texture = &state_ptr->registered_textures[ref.handle];
+
+            state_ptr->streaming_stats.memory_size -=
+                texture_memory_size(texture);
+
+            destroy_texture(texture);
             CORE_DEBUG("Resources of texture destroyed from renderer");
 
+            // A decode still in flight for this slot is dropped on arrival
+            state_ptr->slot_request_ids[ref.handle] = 0;
+
             if (!state_ptr->texture_registry.remove(STR(name_copy)))
             {
                 CORE_FATAL("Error while removing texture from registry");
@@ -337,6 +765,23 @@ create_default_textures(Texture_System_State *state)
     // texture
     state->default_texture.generation = INVALID_ID;
 
+    // Unlike the default texture the white one keeps its generation, it is
+    // meant to be drawn. Its id is past the registered slots so that it never
+    // matches the descriptor of another texture
+    CORE_TRACE("Creating white texture...");
+    memory_set(pixels, 255, sizeof(u8) * pixel_count * bpp);
+
+    string_set(state->white_texture.name, WHITE_TEXTURE_NAME);
+
+    state->white_texture.id               = state->config.max_texture_count;
+    state->white_texture.width            = tex_dimension;
+    state->white_texture.height           = tex_dimension;
+    state->white_texture.channel_count    = 4;
+    state->white_texture.generation       = INVALID_ID;
+    state->white_texture.has_transparency = false;
+
+    renderer_create_texture(pixels, &state->white_texture);
+
     return true;
 }
 
@@ -346,10 +791,17 @@ texture_system_get_default_texture()
     return &state_ptr->default_texture;
 }
 
+Texture *
+texture_system_get_white_texture()
+{
+    return &state_ptr->white_texture;
+}
+
 INTERNAL_FUNC void
 destroy_default_textures(Texture_System_State *state)
 {
     destroy_texture(&state->default_texture);
+    destroy_texture(&state->white_texture);
 }
 
 INTERNAL_FUNC void
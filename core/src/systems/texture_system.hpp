@@ -1,8 +1,19 @@
 #pragma once
 
 #include "data_structures/hashmap.hpp"
+#include "data_structures/memory_pool.hpp"
+#include "data_structures/ring_queue.hpp"
 #include "defines.hpp"
 #include "resources/resource_types.hpp"
+#include "resources/texture_cache.hpp"
+#include "systems/job_system.hpp"
+
+// Completed streaming requests uploaded per texture_system_update, so that a
+// burst of finished decodes does not land in a single frame
+constexpr u32 TEXTURE_STREAMING_UPLOADS_PER_UPDATE = 2;
+
+// Virtual reservation of the arena each streamed image is decoded into
+constexpr u64 TEXTURE_STREAMING_ARENA_RESERVE = 256 * MiB;
 
 struct Texture_System_Config
 {
@@ -16,17 +27,74 @@ struct Texture_Reference
     b8         auto_release;
 };
 
+// A texture decoded by a job and waiting for the main thread to upload it
+struct Texture_Stream_Request
+{
+    Job_Declaration job;
+
+    char name[TEXTURE_NAME_MAX_LENGTH];
+    u32  texture_index;
+    u64  request_id; // Matched against the slot, a released slot drops it
+    b8   is_ui_texture;
+    f64  request_time;
+
+    // Written by the job
+    Arena         *arena; // Owns the decoded pixels
+    Cooked_Texture cooked;
+    b8             succeeded;
+};
+
+struct Texture_Streaming_Stats
+{
+    u32 pending_count; // Acquired asynchronously, not uploaded yet
+    u64 completed_count;
+    u64 failed_count;
+
+    // Seconds from the async acquire to the upload
+    f64 last_latency;
+    f64 average_latency;
+    f64 max_latency;
+
+    // Main thread seconds spent loading and uploading textures over the last
+    // frame, which is the spike the texture system adds to the frame time
+    f64 last_main_thread_time;
+    f64 max_main_thread_time;
+
+    // Textures loaded from their cooked container or cooked from the image
+    u64 cache_hit_count;
+    u64 cooked_count;
+
+    // Bytes of the mips of the loaded textures, the GPU memory they take
+    // before the padding of the driver
+    u64 memory_size;
+};
+
 struct Texture_System_State
 {
     Arena                *arena;
     Texture_System_Config config;
+    b8                    allow_block_compression; // BC1 and BC3 supported
     Texture               default_texture;
+    Texture               white_texture; // Lets materials be a flat color
 
     Hashmap<Texture_Reference> texture_registry;
     Texture                   *registered_textures;
+
+    // Streaming, the requests are only acquired and released by the main
+    // thread, the jobs hand them back through the completed queue
+    Memory_Pool<Texture_Stream_Request>      stream_requests;
+    MPSC_Ring_Queue<Texture_Stream_Request *> completed_requests;
+    Job_Counter                              stream_counter;
+    u64                                     *slot_request_ids;
+    u64                                      next_request_id;
+
+    f64                     main_thread_time; // Accumulated since last update
+    f64                     total_latency;
+    Texture_Streaming_Stats streaming_stats;
 };
 
 #define DEFAULT_TEXTURE_NAME "default_"
+#define WHITE_TEXTURE_NAME   "white_"
 
 Texture_System_State *texture_system_init(Arena                *allocator,
                                           Texture_System_Config config);
@@ -35,5 +103,29 @@ void     texture_system_shutdown();
 Texture *texture_system_acquire(const char *name,
                                 b8          auto_release  = true,
                                 b8          is_ui_texture = false);
+
+// Returns the texture slot right away and decodes the image on a job. Until
+// texture_system_update uploads it the generation stays INVALID_ID, so the
+// renderer draws the default texture in its place
+Texture *texture_system_acquire_async(const char *name,
+                                      b8          auto_release  = true,
+                                      b8          is_ui_texture = false);
+
+// Loads a batch of textures at once: the images are decoded in parallel on
+// the jobs, then uploaded here. Missing textures are loaded like with
+// texture_system_acquire, false when any failed and was left nullptr
+b8 texture_system_acquire_batch(const char **names,
+                                u32          count,
+                                b8           auto_release,
+                                b8           is_ui_texture,
+                                Texture    **out_textures);
+
+// Uploads the textures decoded since the last call. Main thread, once per
+// frame before rendering
+void texture_system_update();
+
+VOLTRUM_API void texture_system_get_streaming_stats(
+    Texture_Streaming_Stats *out_stats);
 void     texture_system_release(const char *name);
 Texture *texture_system_get_default_texture();
+Texture *texture_system_get_white_texture();
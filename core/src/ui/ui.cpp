@@ -399,6 +399,8 @@ ui_draw_layers(UI_State *state, Frame_Context *ctx)
 {
     ENSURE(state->global_client_state);
 
+    state->moving_animation_count = 0;
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplSDL3_NewFrame();
     ImGui::NewFrame();
@@ -418,6 +420,19 @@ ui_draw_layers(UI_State *state, Frame_Context *ctx)
     return ImGui::GetDrawData();
 }
 
+b8
+ui_is_animating(UI_State *state)
+{
+    return state->moving_animation_count > 0;
+}
+
+void
+ui_animation_mark_moving()
+{
+    if (state_ptr)
+        state_ptr->moving_animation_count++;
+}
+
 void
 ui_set_theme_state(const UI_Theme *theme, const UI_Theme_Palette *palette)
 {
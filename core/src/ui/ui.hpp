@@ -24,6 +24,9 @@ VOLTRUM_API void ui_update_layers(UI_State             *state,
 VOLTRUM_API struct ImDrawData *ui_draw_layers(UI_State             *state,
                                               struct Frame_Context *frame_ctx);
 
+// Whether an animation track was still moving in the last drawn frame
+VOLTRUM_API b8 ui_is_animating(UI_State *state);
+
 // Consolidated theme API. Pass either pointer, or both, depending on the
 // operation.
 VOLTRUM_API void ui_set_theme_state(const UI_Theme         *theme,
@@ -5,6 +5,10 @@
 #include <imgui.h>
 #include <math.h>
 
+// Called by the tracks that have not reached their target yet, so that the
+// application keeps redrawing until every animation has settled
+VOLTRUM_API void ui_animation_mark_moving();
+
 namespace ui
 {
 namespace anim
@@ -48,6 +52,12 @@ namespace anim
         const f32 target = active ? max_value : min_value;
         const f32 sharpness = active ? rise_sharpness : fall_sharpness;
         *value = exp_decay_to(*value, target, sharpness, delta_time);
+
+        if (fabsf(*value - target) > 0.001f * (max_value - min_value))
+        {
+            ui_animation_mark_moving();
+        }
+
         return *value;
     }
 
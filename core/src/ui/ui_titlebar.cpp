@@ -31,36 +31,30 @@ ui_titlebar_setup(
     Scratch_Arena      scratch = scratch_begin(nullptr, 0);
     String             logo_name_copy = string_copy(scratch.arena, logo_asset_name);
 
-    state->app_icon_texture = texture_system_acquire(
+    // Decoded together on the jobs rather than one after the other
+    const char *icon_names[] = {
         logo_name_copy.buff ? logo_name_copy.buff : "",
-        false,
-        true
-    );
-
-    state->minimize_icon_texture = texture_system_acquire(
         "window_minimize_icon",
-        false,
-        true
-    );
-
-    state->maximize_icon_texture = texture_system_acquire(
         "window_maximize_icon",
-        false,
-        true
-    );
-
-    state->restore_icon_texture = texture_system_acquire(
         "window_restore_icon",
-        false,
-        true
-    );
-
-    state->close_icon_texture = texture_system_acquire(
         "window_close_icon",
+    };
+
+    Texture *icon_textures[ARRAY_COUNT(icon_names)];
+    texture_system_acquire_batch(
+        icon_names,
+        ARRAY_COUNT(icon_names),
         false,
-        true
+        true,
+        icon_textures
     );
 
+    state->app_icon_texture      = icon_textures[0];
+    state->minimize_icon_texture = icon_textures[1];
+    state->maximize_icon_texture = icon_textures[2];
+    state->restore_icon_texture  = icon_textures[3];
+    state->close_icon_texture    = icon_textures[4];
+
     RUNTIME_ASSERT_MSG(state->app_icon_texture, "Failed to load logo icon");
     RUNTIME_ASSERT_MSG(state->minimize_icon_texture, "Failed to load minimize icon");
     RUNTIME_ASSERT_MSG(state->maximize_icon_texture, "Failed to load maximize icon");
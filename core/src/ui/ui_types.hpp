@@ -126,4 +126,7 @@ struct UI_State
     struct Arena            *allocator;
 
     void *global_client_state;
+
+    // Animation tracks still moving during the last ui_draw_layers
+    u32 moving_animation_count;
 };
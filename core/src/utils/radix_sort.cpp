@@ -0,0 +1,78 @@
+#include "utils/radix_sort.hpp"
+
+#include "memory/arena.hpp"
+#include "memory/memory.hpp"
+
+constexpr u32 RADIX_SORT_DIGIT_BITS  = 8;
+constexpr u32 RADIX_SORT_DIGIT_COUNT = 1 << RADIX_SORT_DIGIT_BITS;
+constexpr u32 RADIX_SORT_PASS_COUNT  = 64 / RADIX_SORT_DIGIT_BITS;
+
+VOLTRUM_API void
+radix_sort_u64(Arena *arena, u64 *keys, u32 *values, u64 count)
+{
+    if (count < 2)
+        return;
+
+    // The histograms of every pass are counted in a single read of the keys
+    u64(*histograms)[RADIX_SORT_DIGIT_COUNT] =
+        (u64(*)[RADIX_SORT_DIGIT_COUNT])push_array(
+            arena,
+            u64,
+            RADIX_SORT_PASS_COUNT * RADIX_SORT_DIGIT_COUNT);
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        u64 key = keys[i];
+        for (u32 pass = 0; pass < RADIX_SORT_PASS_COUNT; ++pass)
+        {
+            histograms[pass][key & (RADIX_SORT_DIGIT_COUNT - 1)]++;
+            key >>= RADIX_SORT_DIGIT_BITS;
+        }
+    }
+
+    u64 *key_buffers[2]   = {keys, push_array(arena, u64, count)};
+    u32 *value_buffers[2] = {values, push_array(arena, u32, count)};
+    u32  source           = 0;
+
+    for (u32 pass = 0; pass < RADIX_SORT_PASS_COUNT; ++pass)
+    {
+        u64 *histogram = histograms[pass];
+        u32  shift     = pass * RADIX_SORT_DIGIT_BITS;
+
+        // A digit shared by every key leaves the order as it is
+        if (histogram[(keys[0] >> shift) & (RADIX_SORT_DIGIT_COUNT - 1)] ==
+            count)
+            continue;
+
+        u64 offset = 0;
+        for (u32 digit = 0; digit < RADIX_SORT_DIGIT_COUNT; ++digit)
+        {
+            u64 digit_count  = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        u64 *source_keys   = key_buffers[source];
+        u32 *source_values = value_buffers[source];
+        u64 *dest_keys     = key_buffers[source ^ 1];
+        u32 *dest_values   = value_buffers[source ^ 1];
+
+        for (u64 i = 0; i < count; ++i)
+        {
+            u64 key   = source_keys[i];
+            u32 digit = (key >> shift) & (RADIX_SORT_DIGIT_COUNT - 1);
+            u64 dest  = histogram[digit]++;
+
+            dest_keys[dest]   = key;
+            dest_values[dest] = source_values[i];
+        }
+
+        source ^= 1;
+    }
+
+    if (source != 0)
+    {
+        memory_copy(keys, key_buffers[1], sizeof(u64) * count);
+        memory_copy(values, value_buffers[1], sizeof(u32) * count);
+    }
+}
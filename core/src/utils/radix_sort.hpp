@@ -0,0 +1,12 @@
+#pragma once
+
+#include "defines.hpp"
+
+struct Arena;
+
+// Sorts the keys in ascending order and moves the values along with them. The
+// sort is stable and goes through the keys one byte at a time, skipping the
+// bytes that are the same in every key. The temporary buffers are pushed on
+// the arena
+VOLTRUM_API void
+radix_sort_u64(Arena *arena, u64 *keys, u32 *values, u64 count);
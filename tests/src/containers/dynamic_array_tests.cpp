@@ -0,0 +1,396 @@
+#include "dynamic_array_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <data_structures/dynamic_array.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+
+static Arena *test_arena = nullptr;
+
+INTERNAL_FUNC u8
+test_init()
+{
+    Dynamic_Array<u32> array;
+    array.init(test_arena, 10);
+
+    // The chunk size is rounded up to a power of two
+    expect_should_be(16, array.granularity);
+    expect_should_be(16, array.capacity);
+    expect_should_be(0, array.size);
+    expect_should_be(1, array.chunk_count);
+    expect_should_be(true, array.is_contiguous);
+    expect_should_not_be(nullptr, array.data());
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_add_and_index_across_chunks()
+{
+    Dynamic_Array<u32> array;
+    array.init(test_arena, 4);
+
+    // More chunks than the initial directory holds
+    for (u32 i = 0; i < 100; ++i)
+        array.add(i * 3);
+
+    expect_should_be(100, array.size);
+    expect_should_be(25, array.chunk_count);
+
+    for (u32 i = 0; i < 100; ++i)
+        expect_should_be(i * 3, array[i]);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_contiguous_view()
+{
+    Arena *arena = arena_create();
+
+    Dynamic_Array<u32> array;
+    array.init(arena, 4);
+
+    // Nothing else is pushed on the arena, so the chunks are adjacent
+    for (u32 i = 0; i < 16; ++i)
+        array.add(i);
+
+    expect_should_be(true, array.is_contiguous);
+
+    u32 *elements = array.data();
+    expect_should_not_be(nullptr, elements);
+    for (u32 i = 0; i < 16; ++i)
+        expect_should_be(i, elements[i]);
+
+    // An unrelated allocation separates the next chunk from the previous ones
+    push_array(arena, u8, 1);
+    array.add(16);
+
+    expect_should_be(false, array.is_contiguous);
+    expect_should_be(nullptr, array.data());
+    expect_should_be(16, array[16]);
+
+    arena_release(arena);
+
+    return true;
+}
+
+// The directory is not pushed between the chunks past its initial capacity,
+// and is filled in for all of them once the array is fragmented
+INTERNAL_FUNC u8
+test_contiguous_past_directory()
+{
+    Arena *arena = arena_create();
+
+    Dynamic_Array<u32> array;
+    array.init(arena, 4);
+
+    for (u32 i = 0; i < 100; ++i)
+        array.add(i);
+
+    expect_should_be(25, array.chunk_count);
+    expect_should_be(true,
+                     array.chunk_count > DEFAULT_DYNAMIC_ARRAY_DIRECTORY_SIZE);
+    expect_should_be(true, array.is_contiguous);
+
+    u32 *elements = array.data();
+    expect_should_not_be(nullptr, elements);
+    for (u32 i = 0; i < 100; ++i)
+        expect_should_be(i, elements[i]);
+
+    push_array(arena, u8, 1);
+    for (u32 i = 100; i < 140; ++i)
+    {
+        array.add(i);
+        push_array(arena, u8, 1);
+    }
+
+    expect_should_be(false, array.is_contiguous);
+    expect_should_be(true, array.directory_capacity >= array.chunk_count);
+
+    for (u32 i = 0; i < 140; ++i)
+        expect_should_be(i, array[i]);
+
+    u32 expected = 0;
+    for (u32 value : array)
+    {
+        expect_should_be(expected, value);
+        expected++;
+    }
+    expect_should_be(140, expected);
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Inserting at the front, middle and back of both a contiguous and a
+// fragmented array must produce the same sequence
+INTERNAL_FUNC u8
+test_insert_at()
+{
+    Arena *arena = arena_create();
+
+    Dynamic_Array<u32> contiguous;
+    Dynamic_Array<u32> fragmented;
+    contiguous.init(test_arena, 4);
+    fragmented.init(arena, 4);
+
+    for (u32 i = 0; i < 20; ++i)
+    {
+        contiguous.add(i);
+        fragmented.add(i);
+
+        // Keep the chunks of the second array apart
+        push_array(arena, u8, 1);
+    }
+
+    expect_should_be(false, fragmented.is_contiguous);
+
+    Dynamic_Array<u32> *arrays[2] = {&contiguous, &fragmented};
+    for (Dynamic_Array<u32> *array : arrays)
+    {
+        array->insert_at(0, 100);  // Front
+        array->insert_at(10, 200); // Middle, crosses chunk boundaries
+        array->insert_at(array->size, 300); // Back
+        array->insert_at(4, 400);  // Exactly at a chunk boundary
+
+        expect_should_be(24, array->size);
+
+        // Expected: 100, 0, 1, 2, 400, 3..8, 200, 9..19, 300
+        expect_should_be(100, (*array)[0]);
+        expect_should_be(0, (*array)[1]);
+        expect_should_be(2, (*array)[3]);
+        expect_should_be(400, (*array)[4]);
+        expect_should_be(3, (*array)[5]);
+        expect_should_be(8, (*array)[10]);
+        expect_should_be(200, (*array)[11]);
+        expect_should_be(9, (*array)[12]);
+        expect_should_be(19, (*array)[22]);
+        expect_should_be(300, (*array)[23]);
+    }
+
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_iterator()
+{
+    Dynamic_Array<u32> array;
+    array.init(test_arena, 4);
+
+    u32 count = 0;
+    for (u32 value : array)
+        count += value + 1;
+    expect_should_be(0, count);
+
+    // Exactly two full chunks, end() lands on the start of the third
+    for (u32 i = 0; i < 8; ++i)
+        array.add(i);
+
+    u32 expected = 0;
+    for (u32 value : array)
+    {
+        expect_should_be(expected, value);
+        expected++;
+    }
+    expect_should_be(8, expected);
+
+    array.add(8);
+
+    expected = 0;
+    for (u32 value : array)
+    {
+        expect_should_be(expected, value);
+        expected++;
+    }
+    expect_should_be(9, expected);
+
+    return true;
+}
+
+// Replica of the previous layout, where indexing walks the chunk list from the
+// first chunk. Only used as the baseline of the benchmark
+struct Linked_Chunk_Array
+{
+    struct Chunk
+    {
+        Chunk *next;
+        u64   *elements;
+    };
+
+    Chunk *first;
+    Chunk *last;
+    u64    granularity;
+    u64    size;
+
+    void
+    init(Arena *arena, u64 chunk_size)
+    {
+        granularity     = chunk_size;
+        size            = 0;
+        first           = push_struct(arena, Chunk);
+        first->elements = push_array(arena, u64, granularity);
+        last            = first;
+    }
+
+    u64 &
+    operator[](u64 index)
+    {
+        Chunk *chunk = first;
+        for (u64 i = 0; i < index / granularity; ++i)
+            chunk = chunk->next;
+
+        return chunk->elements[index % granularity];
+    }
+
+    void
+    add(Arena *arena, u64 value)
+    {
+        if (size > 0 && size % granularity == 0)
+        {
+            last->next           = push_struct(arena, Chunk);
+            last                 = last->next;
+            last->elements       = push_array(arena, u64, granularity);
+        }
+
+        (*this)[size] = value;
+        size++;
+    }
+};
+
+INTERNAL_FUNC u8
+test_indexing_benchmark()
+{
+    constexpr u64 element_count = 32768;
+
+    Arena *arena = arena_create();
+
+    Linked_Chunk_Array linked;
+    linked.init(arena, DEFAULT_DYNAMIC_ARRAY_CAPACITY);
+
+    Dynamic_Array<u64> array;
+    array.init(arena, DEFAULT_DYNAMIC_ARRAY_CAPACITY);
+
+    // Interleaved growth, so the directory array is not contiguous either and
+    // the indexing path is the one being measured
+    for (u64 i = 0; i < element_count; ++i)
+    {
+        linked.add(arena, i);
+        array.add(i);
+    }
+
+    Absolute_Clock clock;
+
+    absolute_clock_start(&clock);
+    u64 linked_sum = 0;
+    for (u64 i = 0; i < element_count; ++i)
+        linked_sum += linked[i];
+    absolute_clock_update(&clock);
+    f64 linked_index_time = clock.elapsed_time;
+
+    absolute_clock_start(&clock);
+    u64 array_sum = 0;
+    for (u64 i = 0; i < element_count; ++i)
+        array_sum += array[i];
+    absolute_clock_update(&clock);
+    f64 array_index_time = clock.elapsed_time;
+
+    expect_should_be(linked_sum, array_sum);
+    expect_should_be(false, array.is_contiguous);
+
+    CORE_INFO("Dynamic_Array indexing %llu elements: linked chunks %.3f ms, "
+              "chunk directory %.3f ms",
+              element_count,
+              linked_index_time * 1000.0,
+              array_index_time * 1000.0);
+
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_insert_benchmark()
+{
+    // The linked baseline shifts element-wise through the walking operator,
+    // which is quadratic in the chunk count, so this stays small
+    constexpr u64 element_count = 4096;
+    constexpr u64 insert_count  = 128;
+
+    Arena *arena = arena_create();
+
+    Linked_Chunk_Array linked;
+    linked.init(arena, DEFAULT_DYNAMIC_ARRAY_CAPACITY);
+
+    Dynamic_Array<u64> array;
+    array.init(arena, DEFAULT_DYNAMIC_ARRAY_CAPACITY);
+
+    for (u64 i = 0; i < element_count; ++i)
+    {
+        linked.add(arena, i);
+        array.add(i);
+    }
+
+    for (u64 i = 0; i < insert_count; ++i)
+        linked.add(arena, 0);
+
+    Absolute_Clock clock;
+
+    // Front insertion: element-wise shift through the walking operator (the
+    // previous insert_at) against the per-chunk memmove
+    absolute_clock_start(&clock);
+    for (u64 n = 0; n < insert_count; ++n)
+    {
+        u64 last = element_count + n;
+        for (u64 i = last; i > 0; --i)
+            linked[i] = linked[i - 1];
+        linked[0] = n;
+    }
+    absolute_clock_update(&clock);
+    f64 linked_insert_time = clock.elapsed_time;
+
+    absolute_clock_start(&clock);
+    for (u64 n = 0; n < insert_count; ++n)
+        array.insert_at(0, n);
+    absolute_clock_update(&clock);
+    f64 array_insert_time = clock.elapsed_time;
+
+    for (u64 i = 0; i < element_count + insert_count; i += 7)
+        expect_should_be(linked[i], array[i]);
+
+    CORE_INFO("Dynamic_Array %llu front inserts: linked chunks %.3f ms, "
+              "chunk directory %.3f ms",
+              insert_count,
+              linked_insert_time * 1000.0,
+              array_insert_time * 1000.0);
+
+    arena_release(arena);
+
+    return true;
+}
+
+void
+dynamic_array_register_tests()
+{
+    test_arena = arena_create();
+
+    test_manager_register_test(test_init, "Dynamic_Array: initialization");
+    test_manager_register_test(test_add_and_index_across_chunks,
+                               "Dynamic_Array: add and index across chunks");
+    test_manager_register_test(test_contiguous_view,
+                               "Dynamic_Array: contiguous view");
+    test_manager_register_test(test_contiguous_past_directory,
+                               "Dynamic_Array: contiguous past the directory");
+    test_manager_register_test(test_insert_at, "Dynamic_Array: insert at");
+    test_manager_register_test(test_iterator, "Dynamic_Array: iterator");
+    test_manager_register_test(test_indexing_benchmark,
+                               "Dynamic_Array: indexing benchmark");
+    test_manager_register_test(test_insert_benchmark,
+                               "Dynamic_Array: insert benchmark");
+}
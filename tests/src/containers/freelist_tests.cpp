@@ -0,0 +1,453 @@
+#include "freelist_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <data_structures/freelist.hpp>
+#include <defines.hpp>
+#include <math/math.hpp>
+#include <memory/arena.hpp>
+
+static Arena *test_arena = nullptr;
+
+INTERNAL_FUNC u8
+test_init()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 1024);
+
+    Freelist_Stats stats = freelist.get_stats();
+
+    expect_should_be(1024, stats.total_size);
+    expect_should_be(1024, stats.free_space);
+    expect_should_be(1024, stats.largest_free_block);
+    expect_should_be(1, stats.free_block_count);
+    expect_float_to_be(0.0f, stats.fragmentation);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_allocate_sequential()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 1024);
+
+    u64 offset = INVALID_ID;
+
+    expect_should_be(true, freelist.allocate(64, &offset));
+    expect_should_be(0, offset);
+
+    expect_should_be(true, freelist.allocate(128, &offset));
+    expect_should_be(64, offset);
+
+    expect_should_be(true, freelist.allocate(832, &offset));
+    expect_should_be(192, offset);
+
+    // The whole range is consumed
+    expect_should_be(0, freelist.free_space);
+    expect_should_be(0, freelist.free_block_count);
+    expect_should_be(false, freelist.allocate(1, &offset));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_free_coalesces_neighbours()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 400);
+
+    u64 a, b, c, d;
+    expect_should_be(true, freelist.allocate(100, &a));
+    expect_should_be(true, freelist.allocate(100, &b));
+    expect_should_be(true, freelist.allocate(100, &c));
+    expect_should_be(true, freelist.allocate(100, &d));
+
+    // Two separate holes
+    expect_should_be(true, freelist.free(a, 100));
+    expect_should_be(true, freelist.free(c, 100));
+    expect_should_be(2, freelist.free_block_count);
+
+    // Freeing b bridges both holes into one
+    expect_should_be(true, freelist.free(b, 100));
+    expect_should_be(1, freelist.free_block_count);
+    expect_should_be(300, freelist.get_stats().largest_free_block);
+
+    // Freeing d merges with the tail of the previous range
+    expect_should_be(true, freelist.free(d, 100));
+    expect_should_be(1, freelist.free_block_count);
+    expect_should_be(400, freelist.free_space);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_reuses_freed_ranges()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 300);
+
+    u64 a, b, c;
+    expect_should_be(true, freelist.allocate(100, &a));
+    expect_should_be(true, freelist.allocate(100, &b));
+    expect_should_be(true, freelist.allocate(100, &c));
+
+    expect_should_be(true, freelist.free(b, 100));
+
+    u64 reused = INVALID_ID;
+    expect_should_be(true, freelist.allocate(60, &reused));
+    expect_should_be(b, reused);
+
+    expect_should_be(true, freelist.allocate(40, &reused));
+    expect_should_be(b + 60, reused);
+    expect_should_be(0, freelist.free_space);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_invalid_free()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 256);
+
+    u64 offset;
+    expect_should_be(true, freelist.allocate(128, &offset));
+
+    CORE_DEBUG("The next 3 errors about invalid ranges are expected.");
+    expect_should_be(false, freelist.free(200, 100)); // Out of bounds
+    expect_should_be(false, freelist.free(128, 64));  // Already free
+    expect_should_be(true, freelist.free(offset, 128));
+    expect_should_be(false, freelist.free(offset, 128)); // Double free
+
+    expect_should_be(256, freelist.free_space);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_grow()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 256);
+
+    u64 a, b;
+    expect_should_be(true, freelist.allocate(200, &a));
+    expect_should_be(false, freelist.allocate(100, &b));
+
+    freelist.grow(512);
+
+    // The 56 byte tail merges with the new range
+    expect_should_be(1, freelist.free_block_count);
+    expect_should_be(312, freelist.free_space);
+
+    expect_should_be(true, freelist.allocate(100, &b));
+    expect_should_be(200, b);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_fragmentation_stats()
+{
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 1000);
+
+    u64 offsets[10];
+    for (u32 i = 0; i < 10; ++i)
+        expect_should_be(true, freelist.allocate(100, &offsets[i]));
+
+    // Free every other block: 5 holes of 100 bytes
+    for (u32 i = 0; i < 10; i += 2)
+        expect_should_be(true, freelist.free(offsets[i], 100));
+
+    Freelist_Stats stats = freelist.get_stats();
+    expect_should_be(500, stats.free_space);
+    expect_should_be(100, stats.largest_free_block);
+    expect_should_be(5, stats.free_block_count);
+    expect_float_to_be(0.8f, stats.fragmentation);
+
+    // A request larger than any hole fails even though enough space is free
+    u64 offset;
+    expect_should_be(false, freelist.allocate(200, &offset));
+
+    freelist.reset();
+    expect_should_be(1000, freelist.free_space);
+    expect_should_be(1, freelist.free_block_count);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_best_fit_policy()
+{
+    Freelist<u64> first_fit;
+    Freelist<u64> best_fit;
+    first_fit.init(test_arena, 1000, Freelist_Policy::FIRST_FIT);
+    best_fit.init(test_arena, 1000, Freelist_Policy::BEST_FIT);
+
+    // Same layout in both: a 300 byte hole at 0, a 100 byte hole at 400 and
+    // the 300 byte tail at 700
+    Freelist<u64> *freelists[2] = {&first_fit, &best_fit};
+    for (Freelist<u64> *freelist : freelists)
+    {
+        u64 offset;
+        expect_should_be(true, freelist->allocate(300, &offset));
+        expect_should_be(true, freelist->allocate(100, &offset));
+        expect_should_be(true, freelist->allocate(100, &offset));
+        expect_should_be(true, freelist->allocate(200, &offset));
+        expect_should_be(true, freelist->free(0, 300));
+        expect_should_be(true, freelist->free(400, 100));
+        expect_should_be(3, freelist->free_block_count);
+    }
+
+    u64 offset = INVALID_ID;
+    expect_should_be(true, first_fit.allocate(80, &offset));
+    expect_should_be(0, offset);
+
+    // The smallest hole that fits is picked
+    expect_should_be(true, best_fit.allocate(80, &offset));
+    expect_should_be(400, offset);
+
+    // Between equal holes the lowest offset wins
+    expect_should_be(true, best_fit.allocate(300, &offset));
+    expect_should_be(0, offset);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_slot_ranges()
+{
+    Freelist<u32> slots;
+    slots.init(test_arena, 8);
+
+    u32 slot = INVALID_ID;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        expect_should_be(true, slots.allocate(1, &slot));
+        expect_should_be(i, slot);
+    }
+
+    expect_should_be(false, slots.allocate(1, &slot));
+
+    expect_should_be(true, slots.free(5, 1));
+    expect_should_be(true, slots.free(2, 1));
+
+    // Released slots are handed out again starting from the lowest one
+    expect_should_be(true, slots.allocate(1, &slot));
+    expect_should_be(2, slot);
+    expect_should_be(true, slots.allocate(1, &slot));
+    expect_should_be(5, slot);
+
+    // Ranges of slots
+    expect_should_be(true, slots.free(0, 2));
+    expect_should_be(true, slots.allocate(2, &slot));
+    expect_should_be(0, slot);
+
+    return true;
+}
+
+// Compares the freelist against a byte map of the range after random
+// allocations and frees, for both policies
+INTERNAL_FUNC u8
+test_matches_reference_model()
+{
+    constexpr u32 total_size = 4096;
+    constexpr u32 live_count = 64;
+    constexpr u32 iterations = 20000;
+
+    Freelist_Policy policies[2] = {Freelist_Policy::FIRST_FIT,
+                                   Freelist_Policy::BEST_FIT};
+
+    for (Freelist_Policy policy : policies)
+    {
+        Freelist<u32> freelist;
+        freelist.init(test_arena, total_size, policy);
+
+        u8  *used    = push_array(test_arena, u8, total_size);
+        u32 *offsets = push_array(test_arena, u32, live_count);
+        u32 *sizes   = push_array(test_arena, u32, live_count);
+
+        for (u32 i = 0; i < iterations; ++i)
+        {
+            u32 slot = (u32)math_random_signed_in_range(0, live_count - 1);
+
+            if (sizes[slot] > 0)
+            {
+                expect_should_be(true,
+                                 freelist.free(offsets[slot], sizes[slot]));
+
+                for (u32 j = 0; j < sizes[slot]; ++j)
+                    used[offsets[slot] + j] = 0;
+
+                sizes[slot] = 0;
+                continue;
+            }
+
+            u32 size = (u32)math_random_signed_in_range(1, 256);
+            u32 offset;
+
+            if (!freelist.allocate(size, &offset))
+            {
+                // Only allowed to fail if there is really no hole large enough
+                expect_should_be(
+                    true,
+                    freelist.get_stats().largest_free_block < (u64)size);
+                continue;
+            }
+
+            for (u32 j = 0; j < size; ++j)
+            {
+                expect_should_be(0, used[offset + j]);
+                used[offset + j] = 1;
+            }
+
+            offsets[slot] = offset;
+            sizes[slot]   = size;
+        }
+
+        // Rebuild the holes from the byte map and compare
+        u32 free_space = 0;
+        u32 holes      = 0;
+        u32 largest    = 0;
+        u32 run        = 0;
+
+        for (u32 i = 0; i <= total_size; ++i)
+        {
+            if (i < total_size && !used[i])
+            {
+                run++;
+                free_space++;
+                continue;
+            }
+
+            if (run > 0)
+            {
+                holes++;
+                largest = MAX(largest, run);
+            }
+
+            run = 0;
+        }
+
+        Freelist_Stats stats = freelist.get_stats();
+        expect_should_be(free_space, stats.free_space);
+        expect_should_be(holes, stats.free_block_count);
+        expect_should_be(largest, stats.largest_free_block);
+    }
+
+    return true;
+}
+
+// Simulates an editing session on the geometry buffers: thousands of
+// geometries of varying size are uploaded, destroyed and re-uploaded while the
+// buffer grows on demand
+INTERNAL_FUNC u8
+run_geometry_churn(Freelist_Policy policy, const char *policy_name)
+{
+    constexpr u32 geometry_count = 16384;
+    constexpr u32 iterations     = 1000000;
+    constexpr u64 vertex_size    = 20; // sizeof(Vertex_3d)
+
+    Freelist<u64> freelist;
+    freelist.init(test_arena, 1 * MiB, policy);
+
+    u64 *offsets = push_array(test_arena, u64, geometry_count);
+    u64 *sizes   = push_array(test_arena, u64, geometry_count);
+
+    u32 grow_count = 0;
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        u32 slot = (u32)math_random_signed_in_range(0, geometry_count - 1);
+
+        if (sizes[slot] > 0)
+        {
+            expect_should_be(true, freelist.free(offsets[slot], sizes[slot]));
+            sizes[slot] = 0;
+            continue;
+        }
+
+        u64 size = vertex_size * (u64)math_random_signed_in_range(4, 1024);
+
+        if (!freelist.allocate(size, &offsets[slot]))
+        {
+            freelist.grow(MAX(freelist.total_size * 2,
+                              freelist.total_size + size));
+            grow_count++;
+
+            expect_should_be(true, freelist.allocate(size, &offsets[slot]));
+        }
+
+        sizes[slot] = size;
+    }
+
+    absolute_clock_update(&clock);
+
+    u64 live_bytes = 0;
+    for (u32 i = 0; i < geometry_count; ++i)
+        live_bytes += sizes[i];
+
+    Freelist_Stats stats = freelist.get_stats();
+    expect_should_be(stats.total_size - live_bytes, stats.free_space);
+
+    CORE_INFO("Freelist churn (%s): %u ops in %.2f ms (%.2f Mops/s)",
+              policy_name,
+              iterations,
+              clock.elapsed_time * 1000.0,
+              iterations / clock.elapsed_time / 1000000.0);
+    CORE_INFO("Freelist churn (%s): %llu live bytes in %llu, %u holes, %u "
+              "grows, fragmentation %.2f",
+              policy_name,
+              live_bytes,
+              stats.total_size,
+              stats.free_block_count,
+              grow_count,
+              stats.fragmentation);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_geometry_churn_benchmark()
+{
+    expect_should_be(true,
+                     run_geometry_churn(Freelist_Policy::FIRST_FIT,
+                                        "first-fit"));
+    expect_should_be(true,
+                     run_geometry_churn(Freelist_Policy::BEST_FIT, "best-fit"));
+
+    return true;
+}
+
+void
+freelist_register_tests()
+{
+    test_arena = arena_create();
+
+    test_manager_register_test(test_init, "Freelist: initialization");
+    test_manager_register_test(test_allocate_sequential,
+                               "Freelist: sequential allocation");
+    test_manager_register_test(test_free_coalesces_neighbours,
+                               "Freelist: free coalesces neighbours");
+    test_manager_register_test(test_reuses_freed_ranges,
+                               "Freelist: freed ranges are reused");
+    test_manager_register_test(test_invalid_free,
+                               "Freelist: invalid and double free");
+    test_manager_register_test(test_grow, "Freelist: grow");
+    test_manager_register_test(test_fragmentation_stats,
+                               "Freelist: fragmentation stats");
+    test_manager_register_test(test_best_fit_policy,
+                               "Freelist: best-fit policy");
+    test_manager_register_test(test_slot_ranges, "Freelist: slot ranges");
+    test_manager_register_test(test_matches_reference_model,
+                               "Freelist: matches reference model");
+    test_manager_register_test(test_geometry_churn_benchmark,
+                               "Freelist: geometry churn benchmark");
+}
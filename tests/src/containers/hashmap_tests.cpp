@@ -2,9 +2,11 @@
 #include "expect.hpp"
 #include "test_manager.hpp"
 
+#include <core/absolute_clock.hpp>
 #include <core/logger.hpp>
 #include <data_structures/hashmap.hpp>
 #include <defines.hpp>
+#include <math/math.hpp>
 #include <memory/arena.hpp>
 #include <memory/memory.hpp>
 #include <utils/string.hpp>
@@ -94,7 +96,7 @@ test_expected_warnings()
 }
 
 INTERNAL_FUNC u8
-test_full_hashmap_does_not_change_size()
+test_full_hashmap_grows()
 {
     Hashmap<int> map;
     map.init(test_arena, 4); // Should resolve to capacity 4
@@ -104,13 +106,19 @@ test_full_hashmap_does_not_change_size()
     expect_should_be(true, map.add(STR_LIT("one"), &values[0]));
     expect_should_be(true, map.add(STR_LIT("two"), &values[1]));
     expect_should_be(true, map.add(STR_LIT("three"), &values[2]));
-    expect_should_be(true, map.add(STR_LIT("four"), &values[3]));
+    expect_should_be(4, map.capacity);
 
-    expect_should_be(map.capacity, map.count);
+    // The fourth element would take the load factor above 7/8
+    expect_should_be(true, map.add(STR_LIT("four"), &values[3]));
+    expect_should_be(true, map.add(STR_LIT("five"), &values[4]));
+    expect_should_be(8, map.capacity);
+    expect_should_be(5, map.count);
 
-    CORE_DEBUG("The next warning about a full hashmap is expected.");
-    expect_should_be(false, map.add(STR_LIT("overflow"), &values[4]));
-    expect_should_be(map.capacity, map.count);
+    int out = 0;
+    expect_should_be(true, map.find(STR_LIT("one"), &out));
+    expect_should_be(10, out);
+    expect_should_be(true, map.find(STR_LIT("five"), &out));
+    expect_should_be(50, out);
 
     return true;
 }
@@ -309,6 +317,336 @@ test_add_with_overwrite()
     return true;
 }
 
+// Every item has to sit at distance slots from its home and the control byte
+// has to mirror its occupancy
+INTERNAL_FUNC b8
+table_is_consistent(Hashmap<u64> *map)
+{
+    u64 occupied = 0;
+    for (u64 i = 0; i < map->capacity; ++i)
+    {
+        Hashmap_Item<u64> *item = &map->items[i];
+        if (!item->is_occupied)
+        {
+            if (map->control[i] != HASHMAP_CONTROL_EMPTY)
+                return false;
+            continue;
+        }
+
+        u64 home = item->hash & (map->capacity - 1);
+        if (((home + item->distance) & (map->capacity - 1)) != i)
+            return false;
+
+        if (map->control[i] != (u8)(item->hash >> 57))
+            return false;
+
+        occupied++;
+    }
+
+    return occupied == map->count;
+}
+
+INTERNAL_FUNC u8
+test_incremental_growth()
+{
+    constexpr u64 key_count = 10000;
+
+    Arena *arena = arena_create();
+
+    Hashmap<u64> map;
+    map.init(arena);
+
+    String *keys = push_array(arena, String, key_count);
+    b8      saw_migration = false;
+
+    for (u64 i = 0; i < key_count; ++i)
+    {
+        keys[i] = string_fmt(arena, "cell_%llu", i);
+        expect_should_be(true, map.add(keys[i], &i));
+
+        saw_migration = saw_migration || map.old_items != nullptr;
+
+        // Keys added before the growth have to stay reachable while the old
+        // table is being drained
+        if (i % 97 == 0)
+        {
+            u64 out = 0;
+            expect_should_be(true, map.find(keys[i / 2], &out));
+            expect_should_be(i / 2, out);
+        }
+    }
+
+    expect_should_be(true, saw_migration);
+    expect_should_be(key_count, map.count);
+
+    u64 out = 0;
+    for (u64 i = 0; i < key_count; ++i)
+    {
+        expect_should_be(true, map.find(keys[i], &out));
+        expect_should_be(i, out);
+    }
+
+    // Overwriting a key that is still in the old table updates it in place
+    u64 value = 12345;
+    expect_should_be(true, map.add(keys[0], &value, true));
+    expect_should_be(true, map.find(keys[0], &out));
+    expect_should_be(12345, out);
+    expect_should_be(key_count, map.count);
+
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_backward_shift_delete()
+{
+    constexpr u64 key_count = 2048;
+
+    Arena *arena = arena_create();
+
+    Hashmap<u64> map;
+    map.init(arena, 16);
+
+    String *keys = push_array(arena, String, key_count);
+    for (u64 i = 0; i < key_count; ++i)
+    {
+        keys[i] = string_fmt(arena, "net_%llu", i);
+        expect_should_be(true, map.add(keys[i], &i));
+    }
+
+    for (u64 i = 0; i < key_count; i += 2)
+        expect_should_be(true, map.remove(keys[i]));
+
+    expect_should_be(key_count / 2, map.count);
+    expect_should_be(true, table_is_consistent(&map));
+
+    u64 out = 0;
+    for (u64 i = 1; i < key_count; i += 2)
+    {
+        expect_should_be(true, map.find(keys[i], &out));
+        expect_should_be(i, out);
+    }
+
+    CORE_DEBUG("The next 4 warnings about a missing key are expected.");
+    for (u64 i = 0; i < 8; i += 2)
+        expect_should_be(false, map.find(keys[i], &out));
+
+    // Random churn against a reference of which keys are present
+    b8 *present = push_array(arena, b8, key_count);
+    for (u64 i = 0; i < key_count; ++i)
+        present[i] = i % 2;
+
+    for (u32 op = 0; op < 20000; ++op)
+    {
+        u64 i = (u64)math_random_signed_in_range(0, key_count - 1);
+        if (present[i])
+        {
+            expect_should_be(true, map.remove(keys[i]));
+            present[i] = false;
+        }
+        else
+        {
+            expect_should_be(true, map.add(keys[i], &i));
+            present[i] = true;
+        }
+    }
+
+    u64 expected_count = 0;
+    for (u64 i = 0; i < key_count; ++i)
+    {
+        if (!present[i])
+            continue;
+
+        expected_count++;
+        expect_should_be(true, map.find(keys[i], &out));
+        expect_should_be(i, out);
+    }
+
+    expect_should_be(expected_count, map.count);
+    expect_should_be(true, table_is_consistent(&map));
+
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_removed_keys_are_recycled()
+{
+    Hashmap<int> map;
+    map.init(test_arena, 8);
+
+    int value = 1;
+    expect_should_be(true, map.add(STR_LIT("texture_a"), &value));
+
+    char *key_buffer = map.items[map.next_occupied_index(0)].key.buff;
+    expect_should_be(true, map.remove(STR_LIT("texture_a")));
+
+    // Same size class, so the block of the removed key is reused
+    expect_should_be(true, map.add(STR_LIT("material_b"), &value));
+    expect_should_be(key_buffer,
+                     map.items[map.next_occupied_index(0)].key.buff);
+
+    int out = 0;
+    expect_should_be(true, map.find(STR_LIT("material_b"), &out));
+    expect_should_be(1, out);
+
+    return true;
+}
+
+// Replica of the previous map, sized up front, which probes by comparing keys
+// without storing their hash
+struct Legacy_Hashmap
+{
+    struct Item
+    {
+        u64    value;
+        b8     is_occupied;
+        String key;
+        u32    distance;
+    };
+
+    u64   capacity;
+    Item *items;
+
+    void
+    init(Arena *arena, u64 requested_capacity)
+    {
+        capacity = math_next_power_of_2(requested_capacity);
+        items    = push_array(arena, Item, capacity);
+    }
+
+    void
+    add(String key, u64 value)
+    {
+        Item current        = {};
+        current.value       = value;
+        current.key         = key;
+        current.is_occupied = true;
+
+        u64 address = string_hash(key) & (capacity - 1);
+        while (items[address].is_occupied)
+        {
+            if (items[address].distance < current.distance)
+            {
+                Item temp      = items[address];
+                items[address] = current;
+                current        = temp;
+            }
+
+            address = (address + 1) & (capacity - 1);
+            current.distance++;
+        }
+
+        items[address] = current;
+    }
+
+    b8
+    find(String key, u64 *out)
+    {
+        u64 address = string_hash(key) & (capacity - 1);
+        for (u64 probe = 0; probe < capacity; ++probe)
+        {
+            if (!items[address].is_occupied)
+                return false;
+
+            if (string_match(items[address].key, key))
+            {
+                *out = items[address].value;
+                return true;
+            }
+
+            address = (address + 1) & (capacity - 1);
+        }
+
+        return false;
+    }
+};
+
+INTERNAL_FUNC u8
+test_lookup_benchmark()
+{
+    constexpr u64 key_count    = 1000000;
+    constexpr u64 lookup_count = 1000000;
+
+    Arena *arena = arena_create(2 * GiB);
+
+    // Names share a long prefix like hierarchical cell names do, which is
+    // what makes comparing keys expensive
+    String *keys = push_array(arena, String, key_count);
+    for (u64 i = 0; i < key_count; ++i)
+        keys[i] = string_fmt(arena, "top/core/alu/cell_%llu", i);
+
+    u32 *order = push_array(arena, u32, lookup_count);
+    for (u64 i = 0; i < lookup_count; ++i)
+        order[i] = (u32)math_random_signed_in_range(0, key_count - 1);
+
+    Absolute_Clock clock;
+
+    // The previous map cannot grow, so it is sized up front like the
+    // registries are
+    Legacy_Hashmap legacy;
+    legacy.init(arena, key_count);
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < key_count; ++i)
+        legacy.add(keys[i], i);
+    absolute_clock_update(&clock);
+    f64 legacy_insert_time = clock.elapsed_time;
+
+    Hashmap<u64> map;
+    map.init(arena);
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < key_count; ++i)
+        map.add(keys[i], &i);
+    absolute_clock_update(&clock);
+    f64 map_insert_time = clock.elapsed_time;
+
+    expect_should_be(key_count, map.count);
+
+    u64 legacy_sum = 0;
+    u64 map_sum    = 0;
+    u64 out        = 0;
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < lookup_count; ++i)
+    {
+        legacy.find(keys[order[i]], &out);
+        legacy_sum += out;
+    }
+    absolute_clock_update(&clock);
+    f64 legacy_lookup_time = clock.elapsed_time;
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < lookup_count; ++i)
+    {
+        map.find(keys[order[i]], &out);
+        map_sum += out;
+    }
+    absolute_clock_update(&clock);
+    f64 map_lookup_time = clock.elapsed_time;
+
+    expect_should_be(legacy_sum, map_sum);
+
+    CORE_INFO("Hashmap %llu inserts: fixed map %.1f ms, growing map %.1f ms",
+              key_count,
+              legacy_insert_time * 1000.0,
+              map_insert_time * 1000.0);
+    CORE_INFO("Hashmap %llu lookups: fixed map %.1f ms (load %.2f), growing "
+              "map %.1f ms (load %.2f)",
+              lookup_count,
+              legacy_lookup_time * 1000.0,
+              (f64)key_count / (f64)legacy.capacity,
+              map_lookup_time * 1000.0,
+              (f64)map.count / (f64)map.capacity);
+
+    arena_release(arena);
+
+    return true;
+}
+
 void
 hashmap_register_tests()
 {
@@ -322,8 +660,8 @@ hashmap_register_tests()
                                "Hash_Map: expected warning scenarios");
     test_manager_register_test(test_debug_log_showcase,
                                "Hash_Map: debug log showcase");
-    test_manager_register_test(test_full_hashmap_does_not_change_size,
-                               "Hash_Map: full hashmap does not change size");
+    test_manager_register_test(test_full_hashmap_grows,
+                               "Hash_Map: full hashmap grows");
     test_manager_register_test(test_init_and_shutdown,
                                "Hash_Map: init and shutdown behavior");
     test_manager_register_test(test_find_ptr_vs_find,
@@ -332,4 +670,12 @@ hashmap_register_tests()
                                "Hash_Map: operations before initialization");
     test_manager_register_test(test_add_with_overwrite,
                                "Hash_Map: add with overwrite flag");
+    test_manager_register_test(test_incremental_growth,
+                               "Hash_Map: incremental growth");
+    test_manager_register_test(test_backward_shift_delete,
+                               "Hash_Map: backward shift delete");
+    test_manager_register_test(test_removed_keys_are_recycled,
+                               "Hash_Map: removed keys are recycled");
+    test_manager_register_test(test_lookup_benchmark,
+                               "Hash_Map: 1M lookup benchmark");
 }
@@ -2,11 +2,14 @@
 #include "expect.hpp"
 #include "test_manager.hpp"
 
+#include <core/absolute_clock.hpp>
 #include <core/logger.hpp>
 #include <data_structures/ring_queue.hpp>
 #include <defines.hpp>
 #include <memory/arena.hpp>
 
+#include <thread>
+
 static Arena *test_arena = nullptr;
 
 INTERNAL_FUNC u8
@@ -182,6 +185,220 @@ test_reset()
     return true;
 }
 
+INTERNAL_FUNC u8
+test_spsc_single_thread()
+{
+    SPSC_Ring_Queue<int> queue;
+    queue.init(test_arena, 3); // Rounded up to 4
+
+    expect_should_be(4, queue.capacity);
+    expect_should_be(true, queue.is_empty());
+
+    int out = 0;
+    expect_should_be(false, queue.dequeue(&out));
+
+    // Several laps so head and tail wrap around the mask
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        for (int i = 0; i < 4; ++i)
+            expect_should_be(true, queue.enqueue(lap * 10 + i));
+
+        expect_should_be(false, queue.enqueue(-1));
+        expect_should_be(4, queue.count());
+
+        for (int i = 0; i < 4; ++i)
+        {
+            expect_should_be(true, queue.dequeue(&out));
+            expect_should_be(lap * 10 + i, out);
+        }
+
+        expect_should_be(true, queue.is_empty());
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_mpsc_single_thread()
+{
+    MPSC_Ring_Queue<int> queue;
+    queue.init(test_arena, 4);
+
+    expect_should_be(true, queue.is_empty());
+
+    int out = 0;
+    expect_should_be(false, queue.dequeue(&out));
+
+    for (int lap = 0; lap < 3; ++lap)
+    {
+        for (int i = 0; i < 4; ++i)
+            expect_should_be(true, queue.enqueue(lap * 10 + i));
+
+        expect_should_be(false, queue.enqueue(-1));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            expect_should_be(true, queue.dequeue(&out));
+            expect_should_be(lap * 10 + i, out);
+        }
+
+        expect_should_be(true, queue.is_empty());
+    }
+
+    queue.enqueue(7);
+    queue.reset();
+    expect_should_be(true, queue.is_empty());
+
+    return true;
+}
+
+// Producer index in the high bits, per-producer sequence number in the low
+// ones, so the consumer can check FIFO order per producer
+constexpr u64 PRODUCER_SHIFT = 40;
+
+INTERNAL_FUNC u8
+test_spsc_cross_thread()
+{
+    constexpr u64 item_count = 1000000;
+
+    Arena *arena = arena_create();
+
+    SPSC_Ring_Queue<u64> *queue = push_struct(arena, SPSC_Ring_Queue<u64>);
+    queue->init(arena, 1024);
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    std::thread producer([queue]() {
+        for (u64 i = 0; i < item_count; ++i)
+        {
+            while (!queue->enqueue(i))
+                std::this_thread::yield();
+        }
+    });
+
+    u64 expected = 0;
+    u64 out      = 0;
+    b8  in_order = true;
+
+    while (expected < item_count)
+    {
+        if (!queue->dequeue(&out))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        in_order = in_order && out == expected;
+        expected++;
+    }
+
+    producer.join();
+
+    absolute_clock_update(&clock);
+
+    expect_should_be(true, in_order);
+    expect_should_be(true, queue->is_empty());
+
+    CORE_INFO("SPSC_Ring_Queue 1 producer: %.2f Mitems/s",
+              item_count / clock.elapsed_time / 1e6);
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Runs producer_count producers against a single consumer and checks that
+// every item arrives exactly once and in order for its producer
+INTERNAL_FUNC b8
+run_mpsc(u32 producer_count, u64 items_per_producer, f64 *out_seconds)
+{
+    Arena *arena = arena_create();
+
+    MPSC_Ring_Queue<u64> *queue = push_struct(arena, MPSC_Ring_Queue<u64>);
+    queue->init(arena, 1024);
+
+    u64 *next_expected = push_array(arena, u64, producer_count);
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    std::thread *producers = push_array(arena, std::thread, producer_count);
+    for (u32 p = 0; p < producer_count; ++p)
+    {
+        new (&producers[p]) std::thread([queue, p, items_per_producer]() {
+            for (u64 i = 0; i < items_per_producer; ++i)
+            {
+                u64 item = ((u64)p << PRODUCER_SHIFT) | i;
+                while (!queue->enqueue(item))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    u64 total    = producer_count * items_per_producer;
+    u64 received = 0;
+    u64 out      = 0;
+    b8  in_order = true;
+
+    while (received < total)
+    {
+        if (!queue->dequeue(&out))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        u64 producer = out >> PRODUCER_SHIFT;
+        u64 sequence = out & ((1ull << PRODUCER_SHIFT) - 1);
+
+        in_order = in_order && producer < producer_count &&
+                   sequence == next_expected[producer];
+
+        if (producer < producer_count)
+            next_expected[producer]++;
+
+        received++;
+    }
+
+    for (u32 p = 0; p < producer_count; ++p)
+    {
+        producers[p].join();
+        producers[p].~thread();
+    }
+
+    absolute_clock_update(&clock);
+    *out_seconds = clock.elapsed_time;
+
+    in_order = in_order && queue->is_empty();
+
+    arena_release(arena);
+
+    return in_order;
+}
+
+INTERNAL_FUNC u8
+test_mpsc_producers_benchmark()
+{
+    constexpr u64 total_items = 1000000;
+
+    u32 hardware_threads = std::thread::hardware_concurrency();
+    u32 max_producers    = MAX(4, hardware_threads);
+
+    for (u32 producers = 1; producers <= max_producers; producers *= 2)
+    {
+        f64 seconds = 0.0;
+        expect_should_be(
+            true, run_mpsc(producers, total_items / producers, &seconds));
+
+        CORE_INFO("MPSC_Ring_Queue %u producer(s): %.2f Mitems/s",
+                  producers,
+                  (total_items / producers) * producers / seconds / 1e6);
+    }
+
+    return true;
+}
+
 void
 ring_queue_register_tests()
 {
@@ -201,4 +418,12 @@ ring_queue_register_tests()
                                "Ring_Queue: wraparound");
     test_manager_register_test(test_reset,
                                "Ring_Queue: reset clears state");
+    test_manager_register_test(test_spsc_single_thread,
+                               "Ring_Queue: SPSC single thread");
+    test_manager_register_test(test_mpsc_single_thread,
+                               "Ring_Queue: MPSC single thread");
+    test_manager_register_test(test_spsc_cross_thread,
+                               "Ring_Queue: SPSC cross thread throughput");
+    test_manager_register_test(test_mpsc_producers_benchmark,
+                               "Ring_Queue: MPSC 1-N producers throughput");
 }
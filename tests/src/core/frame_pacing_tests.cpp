@@ -0,0 +1,92 @@
+#include "frame_pacing_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/frame_pacing.hpp>
+#include <defines.hpp>
+#include <platform/platform.hpp>
+
+INTERNAL_FUNC u8
+test_idle_after_grace_frames()
+{
+    Frame_Pacer pacer;
+    frame_pacer_init(&pacer, {120, 4});
+
+    for (u32 i = 0; i < FRAME_PACING_IDLE_GRACE_FRAMES; ++i)
+    {
+        expect_should_be(false, frame_pacer_is_idle(&pacer));
+        frame_pacer_report_activity(&pacer, false);
+    }
+    expect_should_be(true, frame_pacer_is_idle(&pacer));
+
+    frame_pacer_report_activity(&pacer, true);
+    expect_should_be(false, frame_pacer_is_idle(&pacer));
+
+    // Without an idle rate the loop always draws at the target
+    frame_pacer_init(&pacer, {120, 0});
+    for (u32 i = 0; i < 2 * FRAME_PACING_IDLE_GRACE_FRAMES; ++i)
+        frame_pacer_report_activity(&pacer, false);
+
+    expect_should_be(false, frame_pacer_is_idle(&pacer));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_wait_reaches_deadlines()
+{
+    constexpr u32 target_fps  = 200;
+    constexpr u32 frame_count = 20;
+
+    Frame_Pacer pacer;
+    frame_pacer_init(&pacer, {target_fps, 0});
+
+    f64 start = pacer.deadline;
+
+    for (u32 i = 0; i < frame_count; ++i)
+    {
+        frame_pacer_wait(&pacer);
+
+        // Deadlines advance by whole periods, and are never returned early
+        f64 expected_deadline = start + (f64)(i + 1) / target_fps;
+        expect_should_be(true, pacer.deadline >= expected_deadline - 1e-9);
+        expect_should_be(true,
+                         platform_get_absolute_time() >= pacer.deadline);
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_present_paced_does_not_wait()
+{
+    Frame_Pacer pacer;
+    frame_pacer_init(&pacer, {120, 0});
+
+    // Presentation at 60Hz already holds the loop below a 120 FPS target
+    frame_pacer_set_present_pacing(&pacer, true, 60.0);
+    frame_pacer_wait(&pacer);
+
+    expect_should_be(true, pacer.stats.sleep_time == 0.0);
+    expect_should_be(true, pacer.stats.spin_time == 0.0);
+
+    // A target below the refresh rate is still paced
+    frame_pacer_set_target_fps(&pacer, 30);
+    frame_pacer_wait(&pacer);
+
+    expect_should_be(true,
+                     pacer.stats.sleep_time + pacer.stats.spin_time > 0.0);
+
+    return true;
+}
+
+void
+frame_pacing_register_tests()
+{
+    test_manager_register_test(test_idle_after_grace_frames,
+                               "Frame_Pacing: idle after grace frames");
+    test_manager_register_test(test_wait_reaches_deadlines,
+                               "Frame_Pacing: wait reaches deadlines");
+    test_manager_register_test(test_present_paced_does_not_wait,
+                               "Frame_Pacing: present paced does not wait");
+}
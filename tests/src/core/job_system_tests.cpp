@@ -0,0 +1,398 @@
+#include "job_system_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <core/thread_context.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <systems/job_system.hpp>
+
+#include <math.h>
+
+static Arena *test_arena = nullptr;
+
+INTERNAL_FUNC void
+start_job_system(u32 thread_count)
+{
+    arena_clear(test_arena);
+
+    Job_System_Config config = {};
+    config.thread_count      = thread_count;
+
+    job_system_init(test_arena, config);
+}
+
+INTERNAL_FUNC void
+increment_job(void *data)
+{
+    ((std::atomic<u32> *)data)->fetch_add(1, std::memory_order_relaxed);
+}
+
+INTERNAL_FUNC u8
+test_run_and_wait()
+{
+    constexpr u32 job_count = 1000;
+
+    start_job_system(4);
+
+    std::atomic<u32> executed = 0;
+
+    Job_Declaration *jobs = push_array(test_arena, Job_Declaration, job_count);
+    for (u32 i = 0; i < job_count; ++i)
+    {
+        jobs[i].entry = increment_job;
+        jobs[i].data  = &executed;
+    }
+
+    Job_Counter counter = {};
+    job_system_run(jobs, job_count, &counter);
+    job_system_wait(&counter);
+
+    expect_should_be(job_count, executed.load());
+    expect_should_be(0, counter.value.load());
+
+    job_system_shutdown();
+
+    return true;
+}
+
+struct Dependency_Data
+{
+    u64 *values;
+    u64  index;
+    u64  count;
+    u64  sum;
+};
+
+INTERNAL_FUNC void
+write_value_job(void *data)
+{
+    auto *job = (Dependency_Data *)data;
+    job->values[job->index] = job->index + 1;
+}
+
+INTERNAL_FUNC void
+sum_values_job(void *data)
+{
+    auto *job = (Dependency_Data *)data;
+    for (u64 i = 0; i < job->count; ++i)
+        job->sum += job->values[i];
+}
+
+INTERNAL_FUNC u8
+test_dependencies()
+{
+    constexpr u64 value_count = 256;
+
+    start_job_system(4);
+
+    u64 *values = push_array(test_arena, u64, value_count);
+
+    Dependency_Data *writes =
+        push_array(test_arena, Dependency_Data, value_count);
+    Job_Declaration *write_jobs =
+        push_array(test_arena, Job_Declaration, value_count);
+
+    for (u64 i = 0; i < value_count; ++i)
+    {
+        writes[i].values    = values;
+        writes[i].index     = i;
+        write_jobs[i].entry = write_value_job;
+        write_jobs[i].data  = &writes[i];
+    }
+
+    Dependency_Data sum      = {};
+    sum.values               = values;
+    sum.count                = value_count;
+    Job_Declaration sum_job  = {};
+    sum_job.entry            = sum_values_job;
+    sum_job.data             = &sum;
+
+    // Both batches are queued before anything is waited on, the sum must
+    // still only see completed writes
+    Job_Counter write_counter = {};
+    Job_Counter sum_counter   = {};
+    sum_job.dependency        = &write_counter;
+
+    job_system_run(&sum_job, 1, &sum_counter);
+    job_system_run(write_jobs, value_count, &write_counter);
+    job_system_wait(&sum_counter);
+
+    expect_should_be(value_count * (value_count + 1) / 2, sum.sum);
+
+    job_system_shutdown();
+
+    return true;
+}
+
+struct Chain_Data
+{
+    std::atomic<u64> next_link;
+    u64              wrong_order;
+    uintptr_t        lowest_stack;
+    uintptr_t        highest_stack;
+};
+
+struct Chain_Link
+{
+    Chain_Data *chain;
+    u64         index;
+};
+
+INTERNAL_FUNC void
+chain_link_job(void *data)
+{
+    auto *link  = (Chain_Link *)data;
+    auto *chain = link->chain;
+
+    u64 expected = chain->next_link.fetch_add(1, std::memory_order_relaxed);
+    chain->wrong_order += expected != link->index;
+
+    uintptr_t stack = (uintptr_t)&expected;
+    chain->lowest_stack  = MIN(chain->lowest_stack, stack);
+    chain->highest_stack = MAX(chain->highest_stack, stack);
+}
+
+INTERNAL_FUNC u8
+test_dependency_chain()
+{
+    constexpr u32 link_count = 1024;
+
+    // One thread, every link is waited on from the stack of the next one.
+    // Dependents are not deferred, see Job_Declaration
+    start_job_system(1);
+
+    Chain_Data chain   = {};
+    chain.lowest_stack = ~(uintptr_t)0;
+
+    Chain_Link      *links = push_array(test_arena, Chain_Link, link_count);
+    Job_Declaration *jobs = push_array(test_arena, Job_Declaration, link_count);
+    Job_Counter *counters = push_array(test_arena, Job_Counter, link_count);
+
+    for (u32 i = 0; i < link_count; ++i)
+    {
+        links[i].chain = &chain;
+        links[i].index = i;
+        jobs[i].entry  = chain_link_job;
+        jobs[i].data   = &links[i];
+        if (i > 0)
+            jobs[i].dependency = &counters[i - 1];
+
+        job_system_run(&jobs[i], 1, &counters[i]);
+    }
+
+    job_system_wait(&counters[link_count - 1]);
+
+    expect_should_be(link_count, chain.next_link.load());
+    expect_should_be(0, chain.wrong_order);
+
+    CORE_INFO("Job system: %u dependent jobs nested %llu bytes of stack",
+              link_count,
+              (u64)(chain.highest_stack - chain.lowest_stack));
+
+    job_system_shutdown();
+
+    return true;
+}
+
+INTERNAL_FUNC void
+count_indices(u64 start, u64 end, void *data)
+{
+    u32 *hits = (u32 *)data;
+    for (u64 i = start; i < end; ++i)
+        hits[i]++;
+}
+
+INTERNAL_FUNC u8
+test_parallel_for_covers_range()
+{
+    constexpr u64 index_count = 1000003;
+
+    start_job_system(4);
+
+    u32 *hits = push_array(test_arena, u32, index_count);
+
+    // Automatic and explicit batch sizes, the latter with a partial last batch
+    job_system_parallel_for(index_count, 0, count_indices, hits);
+    job_system_parallel_for(index_count, 4096, count_indices, hits);
+
+    u64 wrong = 0;
+    for (u64 i = 0; i < index_count; ++i)
+        wrong += hits[i] != 2;
+
+    expect_should_be(0, wrong);
+
+    job_system_shutdown();
+
+    return true;
+}
+
+struct Nested_Data
+{
+    std::atomic<u64> total;
+};
+
+INTERNAL_FUNC void
+nested_inner(u64 start, u64 end, void *data)
+{
+    auto *nested = (Nested_Data *)data;
+    nested->total.fetch_add(end - start, std::memory_order_relaxed);
+}
+
+INTERNAL_FUNC void
+nested_outer(u64 start, u64 end, void *data)
+{
+    // Waiting inside a job executes other jobs instead of blocking the worker
+    for (u64 row = start; row < end; ++row)
+        job_system_parallel_for(1024, 64, nested_inner, data);
+}
+
+INTERNAL_FUNC u8
+test_nested_parallel_for()
+{
+    start_job_system(4);
+
+    Nested_Data nested = {};
+    job_system_parallel_for(64, 1, nested_outer, &nested);
+
+    expect_should_be(64 * 1024, nested.total.load());
+
+    job_system_shutdown();
+
+    return true;
+}
+
+INTERNAL_FUNC void
+empty_job(void *data)
+{
+    (void)data;
+}
+
+INTERNAL_FUNC u8
+test_scheduling_overhead_benchmark()
+{
+    constexpr u32 job_count = 100000;
+
+    start_job_system(0);
+
+    Job_Declaration *jobs = push_array(test_arena, Job_Declaration, job_count);
+    for (u32 i = 0; i < job_count; ++i)
+        jobs[i].entry = empty_job;
+
+    // Batches of the size of a deque so that nothing runs inline on push
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    for (u32 i = 0; i < job_count; i += DEFAULT_JOB_DEQUE_CAPACITY)
+    {
+        Job_Counter counter = {};
+        job_system_run(&jobs[i],
+                       MIN(DEFAULT_JOB_DEQUE_CAPACITY, job_count - i),
+                       &counter);
+        job_system_wait(&counter);
+    }
+
+    absolute_clock_update(&clock);
+
+    CORE_INFO("Job system: %u empty jobs on %u threads, %.1f ns per job",
+              job_count,
+              job_system_thread_count(),
+              clock.elapsed_time * 1e9 / job_count);
+
+    job_system_shutdown();
+
+    return true;
+}
+
+struct Scaling_Data
+{
+    f32 *values;
+};
+
+INTERNAL_FUNC void
+scaling_body(u64 start, u64 end, void *data)
+{
+    f32 *values = ((Scaling_Data *)data)->values;
+    for (u64 i = start; i < end; ++i)
+        values[i] = sqrtf((f32)i) * sinf((f32)i);
+}
+
+INTERNAL_FUNC u8
+test_parallel_for_scaling_benchmark()
+{
+    constexpr u64 value_count = 4 * 1024 * 1024;
+
+    Arena *values_arena = arena_create(64 * MiB);
+
+    Scaling_Data data = {};
+    data.values       = push_array(values_arena, f32, value_count);
+
+    // Warm up run, so that page faults are not part of the serial time
+    scaling_body(0, value_count, &data);
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+    scaling_body(0, value_count, &data);
+    absolute_clock_update(&clock);
+    f64 serial_time = clock.elapsed_time;
+
+    // Thread count picked by the job system for this machine
+    start_job_system(0);
+    u32 hardware_threads = job_system_thread_count();
+    job_system_shutdown();
+
+    for (u32 threads = 1; threads <= MAX(hardware_threads, 4u); threads *= 2)
+    {
+        start_job_system(threads);
+
+        absolute_clock_start(&clock);
+        job_system_parallel_for(value_count, 0, scaling_body, &data);
+        absolute_clock_update(&clock);
+
+        CORE_INFO("Job system parallel_for %llu elements on %u threads: "
+                  "%.2f ms (serial %.2f ms, %.2fx)",
+                  value_count,
+                  threads,
+                  clock.elapsed_time * 1000.0,
+                  serial_time * 1000.0,
+                  serial_time / clock.elapsed_time);
+
+        job_system_shutdown();
+    }
+
+    expect_float_to_be(sqrtf(7.0f) * sinf(7.0f), data.values[7]);
+
+    arena_release(values_arena);
+
+    return true;
+}
+
+void
+job_system_register_tests()
+{
+    test_arena = arena_create();
+
+    // The job system hands scratch arenas to the thread that initializes it
+    if (!thread_context_selected())
+    {
+        Thread_Context *context = thread_context_allocate();
+        context->thread_name    = "Test main thread";
+        thread_context_select(context);
+    }
+
+    test_manager_register_test(test_run_and_wait, "Job_System: run and wait");
+    test_manager_register_test(test_dependencies,
+                               "Job_System: counter dependencies");
+    test_manager_register_test(test_dependency_chain,
+                               "Job_System: dependency chain");
+    test_manager_register_test(test_parallel_for_covers_range,
+                               "Job_System: parallel_for covers the range");
+    test_manager_register_test(test_nested_parallel_for,
+                               "Job_System: nested parallel_for");
+    test_manager_register_test(test_scheduling_overhead_benchmark,
+                               "Job_System: scheduling overhead benchmark");
+    test_manager_register_test(test_parallel_for_scaling_benchmark,
+                               "Job_System: parallel_for scaling benchmark");
+}
@@ -0,0 +1,566 @@
+#include "gdsii_reader_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/logger.hpp>
+#include <core/thread_context.hpp>
+#include <defines.hpp>
+#include <layout/gdsii_reader.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+#include <systems/job_system.hpp>
+
+#ifdef DEBUG_BUILD
+#    include <memory/arena_debug.hpp>
+#endif
+
+#include <math.h>
+#include <stdio.h>
+
+static Arena *test_arena = nullptr;
+
+// Builds a GDSII stream into a preallocated buffer
+struct GDSII_Writer
+{
+    u8 *data;
+    u64 size;
+    u64 capacity;
+};
+
+INTERNAL_FUNC void
+writer_init(GDSII_Writer *writer, u64 capacity)
+{
+    writer->data     = push_array(test_arena, u8, capacity);
+    writer->size     = 0;
+    writer->capacity = capacity;
+}
+
+INTERNAL_FUNC void
+write_bytes(GDSII_Writer *writer, const void *bytes, u64 count)
+{
+    RUNTIME_ASSERT(writer->size + count <= writer->capacity);
+
+    memory_copy(writer->data + writer->size, bytes, count);
+    writer->size += count;
+}
+
+INTERNAL_FUNC void
+write_header(GDSII_Writer *writer, GDSII_Record type, u8 data_type, u32 size)
+{
+    u8 header[] = {(u8)((size + 4) >> 8), (u8)(size + 4), (u8)type, data_type};
+    write_bytes(writer, header, 4);
+}
+
+INTERNAL_FUNC void
+write_empty(GDSII_Writer *writer, GDSII_Record type)
+{
+    write_header(writer, type, 0x00, 0);
+}
+
+INTERNAL_FUNC void
+write_u16(GDSII_Writer *writer,
+          GDSII_Record  type,
+          const u16    *values,
+          u32           count)
+{
+    write_header(writer, type, 0x02, count * 2);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u8 bytes[] = {(u8)(values[i] >> 8), (u8)values[i]};
+        write_bytes(writer, bytes, 2);
+    }
+}
+
+INTERNAL_FUNC void
+write_s32(GDSII_Writer *writer,
+          GDSII_Record  type,
+          const s32    *values,
+          u32           count)
+{
+    write_header(writer, type, 0x03, count * 4);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 value   = (u32)values[i];
+        u8  bytes[] = {
+            (u8)(value >> 24), (u8)(value >> 16), (u8)(value >> 8), (u8)value};
+        write_bytes(writer, bytes, 4);
+    }
+}
+
+INTERNAL_FUNC void
+write_real8(GDSII_Writer *writer,
+            GDSII_Record  type,
+            const f64    *values,
+            u32           count)
+{
+    write_header(writer, type, 0x05, count * 8);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u64 bits  = 0;
+        f64 value = fabs(values[i]);
+
+        if (value != 0.0)
+        {
+            s32 exponent = 64;
+            while (value >= 1.0)
+            {
+                value /= 16.0;
+                exponent++;
+            }
+            while (value < 1.0 / 16.0)
+            {
+                value *= 16.0;
+                exponent--;
+            }
+
+            u64 mantissa = (u64)llround(ldexp(value, 56));
+            bits = ((u64)(values[i] < 0) << 63) | ((u64)exponent << 56) |
+                   mantissa;
+        }
+
+        for (s32 b = 7; b >= 0; --b)
+        {
+            u8 byte = (u8)(bits >> (b * 8));
+            write_bytes(writer, &byte, 1);
+        }
+    }
+}
+
+INTERNAL_FUNC void
+write_string(GDSII_Writer *writer, GDSII_Record type, const char *text)
+{
+    u32 length = (u32)STR(text).size;
+    u32 padded = (length + 1) & ~1u;
+
+    write_header(writer, type, 0x06, padded);
+    write_bytes(writer, text, length);
+
+    if (padded != length)
+    {
+        u8 zero = 0;
+        write_bytes(writer, &zero, 1);
+    }
+}
+
+INTERNAL_FUNC void
+write_xy(GDSII_Writer *writer, const s32 *points, u32 point_count)
+{
+    write_s32(writer, GDSII_Record::XY, points, point_count * 2);
+}
+
+INTERNAL_FUNC void
+begin_library(GDSII_Writer *writer)
+{
+    u16 version   = 600;
+    u16 dates[12] = {};
+    f64 units[2]  = {0.001, 1e-9};
+
+    write_u16(writer, GDSII_Record::HEADER, &version, 1);
+    write_u16(writer, GDSII_Record::BGNLIB, dates, 12);
+    write_string(writer, GDSII_Record::LIBNAME, "TESTLIB");
+    write_real8(writer, GDSII_Record::UNITS, units, 2);
+}
+
+INTERNAL_FUNC void
+begin_structure(GDSII_Writer *writer, const char *name)
+{
+    u16 dates[12] = {};
+
+    write_u16(writer, GDSII_Record::BGNSTR, dates, 12);
+    write_string(writer, GDSII_Record::STRNAME, name);
+}
+
+INTERNAL_FUNC void
+write_layer(GDSII_Writer *writer, u16 layer, u16 datatype)
+{
+    write_u16(writer, GDSII_Record::LAYER, &layer, 1);
+    write_u16(writer, GDSII_Record::DATATYPE, &datatype, 1);
+}
+
+INTERNAL_FUNC void
+write_rect(GDSII_Writer *writer, u16 layer, s32 x0, s32 y0, s32 x1, s32 y1)
+{
+    s32 points[] = {x0, y0, x1, y0, x1, y1, x0, y1, x0, y0};
+
+    write_empty(writer, GDSII_Record::BOUNDARY);
+    write_layer(writer, layer, 0);
+    write_xy(writer, points, 5);
+    write_empty(writer, GDSII_Record::ENDEL);
+}
+
+INTERNAL_FUNC void
+write_sref(GDSII_Writer *writer,
+           const char   *name,
+           s32           x,
+           s32           y,
+           u16           strans = 0,
+           f64           angle  = 0.0)
+{
+    s32 point[] = {x, y};
+
+    write_empty(writer, GDSII_Record::SREF);
+    write_string(writer, GDSII_Record::SNAME, name);
+
+    if (strans || angle != 0.0)
+    {
+        write_u16(writer, GDSII_Record::STRANS, &strans, 1);
+        write_real8(writer, GDSII_Record::ANGLE, &angle, 1);
+    }
+
+    write_xy(writer, point, 1);
+    write_empty(writer, GDSII_Record::ENDEL);
+}
+
+INTERNAL_FUNC void
+write_aref(GDSII_Writer *writer,
+           const char   *name,
+           u16           columns,
+           u16           rows,
+           s32           x,
+           s32           y,
+           s32           column_step,
+           s32           row_step)
+{
+    u16 colrow[] = {columns, rows};
+    s32 points[] = {x,
+                    y,
+                    x + column_step * columns,
+                    y,
+                    x,
+                    y + row_step * rows};
+
+    write_empty(writer, GDSII_Record::AREF);
+    write_string(writer, GDSII_Record::SNAME, name);
+    write_u16(writer, GDSII_Record::COLROW, colrow, 2);
+    write_xy(writer, points, 3);
+    write_empty(writer, GDSII_Record::ENDEL);
+}
+
+INTERNAL_FUNC u8
+test_read_elements()
+{
+    arena_clear(test_arena);
+
+    GDSII_Writer writer;
+    writer_init(&writer, 64 * KiB);
+
+    begin_library(&writer);
+
+    // TOP comes first and refers to LEAF before its definition
+    begin_structure(&writer, "TOP");
+    write_sref(&writer, "LEAF", 1000, 2000, 0x8000, 90.0);
+    write_aref(&writer, "LEAF", 4, 3, 0, 0, 300, 200);
+    write_empty(&writer, GDSII_Record::ENDSTR);
+
+    begin_structure(&writer, "LEAF");
+    write_rect(&writer, 1, 0, 0, 100, 50);
+
+    s32 l_shape[] = {0, 0, 40, 0, 40, 10, 10, 10, 10, 60, 0, 60, 0, 0};
+    write_empty(&writer, GDSII_Record::BOUNDARY);
+    write_layer(&writer, 2, 7);
+    write_xy(&writer, l_shape, 7);
+    write_empty(&writer, GDSII_Record::ENDEL);
+
+    // Manhattan path with extended ends, one rect per segment
+    s32 path_points[] = {0, 0, 100, 0, 100, 50};
+    s32 width         = 10;
+    u16 path_type     = 2;
+    write_empty(&writer, GDSII_Record::PATH);
+    write_layer(&writer, 3, 0);
+    write_u16(&writer, GDSII_Record::PATHTYPE, &path_type, 1);
+    write_s32(&writer, GDSII_Record::WIDTH, &width, 1);
+    write_xy(&writer, path_points, 3);
+    write_empty(&writer, GDSII_Record::ENDEL);
+
+    s32 diagonal[] = {0, 0, 100, 100};
+    write_empty(&writer, GDSII_Record::PATH);
+    write_layer(&writer, 4, 0);
+    write_s32(&writer, GDSII_Record::WIDTH, &width, 1);
+    write_xy(&writer, diagonal, 2);
+    write_empty(&writer, GDSII_Record::ENDEL);
+
+    // Text has no geometry and is skipped
+    s32 text_point[] = {5, 5};
+    write_empty(&writer, GDSII_Record::TEXT);
+    write_layer(&writer, 1, 0);
+    write_xy(&writer, text_point, 1);
+    write_string(&writer, (GDSII_Record)0x19, "LABEL");
+    write_empty(&writer, GDSII_Record::ENDEL);
+
+    write_empty(&writer, GDSII_Record::ENDSTR);
+    write_empty(&writer, GDSII_Record::ENDLIB);
+
+    GDSII_Read_Stats stats;
+    Layout          *layout = gdsii_read(writer.data, writer.size, &stats);
+
+    expect_should_not_be(nullptr, layout);
+    expect_should_be(2, stats.structure_count);
+    expect_should_be(7, stats.element_count);
+    expect_should_be(true, fabs(layout->database_unit - 1e-9) < 1e-15);
+
+    u32 top  = layout_find_cell(layout, STR("TOP"));
+    u32 leaf = layout_find_cell(layout, STR("LEAF"));
+    expect_should_be(top, layout->top_cell);
+
+    Cell *leaf_cell = &layout->cells[leaf];
+    expect_should_be(4, leaf_cell->layer_count);
+
+    for (u32 i = 0; i < leaf_cell->layer_count; ++i)
+    {
+        Cell_Layer *layer = &leaf_cell->layers[i];
+
+        switch (layer->layer)
+        {
+            case 1:
+                expect_should_be(1, layer->rect_count);
+                expect_should_be(100, layer->rect_max_x[0]);
+                break;
+            case 2:
+                expect_should_be(7, layer->datatype);
+                expect_should_be(1, layer->polygon_count);
+                expect_should_be(6, layer->polygon_offsets[1]);
+                break;
+            case 3:
+                expect_should_be(2, layer->rect_count);
+                expect_should_be(-5, layer->bounds.min_x);
+                expect_should_be(-5, layer->bounds.min_y);
+                expect_should_be(105, layer->bounds.max_x);
+                expect_should_be(55, layer->bounds.max_y);
+                break;
+            case 4:
+                expect_should_be(1, layer->polygon_count);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    Cell *top_cell = &layout->cells[top];
+    expect_should_be(2, top_cell->instance_count);
+
+    Cell_Instance *sref = &top_cell->instances[0];
+    expect_should_be(leaf, sref->cell);
+    expect_should_be(1000, sref->transform.offset_x);
+    expect_should_be(2000, sref->transform.offset_y);
+    expect_should_be((u8)Layout_Orientation::MX_R90,
+                     (u8)sref->transform.orientation);
+
+    Cell_Instance *aref = &top_cell->instances[1];
+    expect_should_be(4, aref->columns);
+    expect_should_be(3, aref->rows);
+    expect_should_be(300, aref->column_step_x);
+    expect_should_be(0, aref->column_step_y);
+    expect_should_be(200, aref->row_step_y);
+
+    expect_should_be(13 * 5, top_cell->flat_shape_count);
+
+    layout_destroy(layout);
+
+    return true;
+}
+
+// Structures defined in reverse order, each placing a few of the ones below
+INTERNAL_FUNC void
+write_random_library(GDSII_Writer *writer, u32 structure_count, u32 shapes)
+{
+    begin_library(writer);
+
+    u32 seed       = 12345;
+    u32 level_size = MAX(structure_count / 8, 1u);
+
+    for (s32 s = (s32)structure_count - 1; s >= 0; --s)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "CELL_%d", s);
+        begin_structure(writer, name);
+
+        for (u32 i = 0; i < shapes; ++i)
+        {
+            seed  = seed * 1664525u + 1013904223u;
+            s32 x = (s32)(seed % 10000);
+            s32 y = (s32)((seed >> 8) % 10000);
+
+            write_rect(writer, (u16)(1 + i % 4), x, y, x + 50, y + 20);
+        }
+
+        // Eight levels, each cell places three cells of the level below
+        u32 level = (u32)s / level_size;
+
+        for (u32 k = 0; k < 3 && level + 1 < 8; ++k)
+        {
+            u32 child = (level + 1) * level_size +
+                        ((u32)s * 7 + k * 13) % level_size;
+            if (child >= structure_count)
+                continue;
+
+            snprintf(name, sizeof(name), "CELL_%u", child);
+            write_sref(writer, name, child * 100, s * 50, 0, 90.0 * child);
+        }
+
+        write_empty(writer, GDSII_Record::ENDSTR);
+    }
+
+    write_empty(writer, GDSII_Record::ENDLIB);
+}
+
+INTERNAL_FUNC u8
+test_parallel_read_matches_serial()
+{
+    constexpr u32 structure_count = 200;
+
+    arena_clear(test_arena);
+
+    GDSII_Writer writer;
+    writer_init(&writer, 4 * MiB);
+    write_random_library(&writer, structure_count, 20);
+
+    // Without the job system the structures are parsed inline
+    Layout *serial = gdsii_read(writer.data, writer.size);
+    expect_should_not_be(nullptr, serial);
+
+    // The cell builders of the batches are created and pushed to on the
+    // workers, in debug builds all of them are tracked by the registry
+#ifdef DEBUG_BUILD
+    b8 owns_registry = arena_debug_get_registry() == nullptr;
+    if (owns_registry)
+        arena_debug_init();
+
+    u32 active_count = arena_debug_get_registry()->active_count;
+#endif
+
+    Job_System_Config config = {};
+    config.thread_count      = 4;
+    job_system_init(test_arena, config);
+
+    Layout *parallel = gdsii_read(writer.data, writer.size);
+
+    job_system_shutdown();
+
+    expect_should_not_be(nullptr, parallel);
+    expect_should_be(structure_count, parallel->cells.size);
+
+    for (u32 i = 0; i < structure_count; ++i)
+    {
+        Cell *a = &serial->cells[i];
+        Cell *b = &parallel->cells[layout_find_cell(parallel, a->name)];
+
+        expect_should_be(a->flat_shape_count, b->flat_shape_count);
+        expect_should_be(a->flat_instance_count, b->flat_instance_count);
+        expect_should_be(a->bounds.min_x, b->bounds.min_x);
+        expect_should_be(a->bounds.max_y, b->bounds.max_y);
+    }
+
+    // Roots may tie, the commit order decides which one becomes the top cell
+    expect_should_be(serial->cells[serial->top_cell].flat_shape_count,
+                     parallel->cells[parallel->top_cell].flat_shape_count);
+
+    layout_destroy(serial);
+    layout_destroy(parallel);
+
+#ifdef DEBUG_BUILD
+    expect_should_be(active_count, arena_debug_get_registry()->active_count);
+
+    if (owns_registry)
+        arena_debug_shutdown();
+#endif
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_malformed_streams()
+{
+    arena_clear(test_arena);
+
+    GDSII_Writer writer;
+    writer_init(&writer, 64 * KiB);
+    write_random_library(&writer, 10, 5);
+
+    // Cut in the middle of a record
+    expect_should_be(nullptr, gdsii_read(writer.data, writer.size / 2 + 1));
+
+    // No ENDLIB
+    expect_should_be(nullptr, gdsii_read(writer.data, writer.size - 4));
+
+    // A structure placing itself
+    writer_init(&writer, 4 * KiB);
+    begin_library(&writer);
+    begin_structure(&writer, "LOOP");
+    write_rect(&writer, 1, 0, 0, 10, 10);
+    write_sref(&writer, "LOOP", 20, 0);
+    write_empty(&writer, GDSII_Record::ENDSTR);
+    write_empty(&writer, GDSII_Record::ENDLIB);
+
+    expect_should_be(nullptr, gdsii_read(writer.data, writer.size));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_read_throughput_benchmark()
+{
+    constexpr u32 structure_count = 400;
+    constexpr u32 shapes          = 600;
+
+    arena_clear(test_arena);
+
+    GDSII_Writer writer;
+    writer_init(&writer, 24 * MiB);
+    write_random_library(&writer, structure_count, shapes);
+
+    u32 thread_counts[] = {1, 4};
+
+    for (u32 i = 0; i < ARRAY_COUNT(thread_counts); ++i)
+    {
+        Job_System_Config config = {};
+        config.thread_count      = thread_counts[i];
+        job_system_init(test_arena, config);
+
+        GDSII_Read_Stats stats;
+        Layout          *layout = gdsii_read(writer.data, writer.size, &stats);
+
+        job_system_shutdown();
+
+        expect_should_not_be(nullptr, layout);
+        expect_should_be(structure_count, stats.structure_count);
+
+        CORE_INFO("GDSII read %.1f MiB with %u threads: index %.3f ms, parse "
+                  "%.3f ms, finalize %.3f ms, %.1f MB/s",
+                  writer.size / (1024.0 * 1024.0),
+                  thread_counts[i],
+                  stats.index_time * 1000.0,
+                  stats.parse_time * 1000.0,
+                  stats.finalize_time * 1000.0,
+                  stats.megabytes_per_second);
+
+        layout_destroy(layout);
+    }
+
+    return true;
+}
+
+void
+gdsii_reader_register_tests()
+{
+    test_arena = arena_create(256 * MiB);
+
+    // The reader and the job system use the scratch arenas of the caller
+    if (!thread_context_selected())
+    {
+        Thread_Context *context = thread_context_allocate();
+        context->thread_name    = "Test main thread";
+        thread_context_select(context);
+    }
+
+    test_manager_register_test(test_read_elements,
+                               "GDSII: read elements and instances");
+    test_manager_register_test(test_parallel_read_matches_serial,
+                               "GDSII: parallel read matches serial");
+    test_manager_register_test(test_malformed_streams,
+                               "GDSII: malformed streams are rejected");
+    test_manager_register_test(test_read_throughput_benchmark,
+                               "GDSII: read throughput benchmark");
+}
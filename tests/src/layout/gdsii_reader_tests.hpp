@@ -0,0 +1,3 @@
+#pragma once
+
+void gdsii_reader_register_tests();
@@ -0,0 +1,426 @@
+#include "layout_lod_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <layout/layout.hpp>
+#include <layout/layout_lod.hpp>
+#include <memory/arena.hpp>
+
+static Arena *test_arena = nullptr;
+
+constexpr Layout_Box EVERYTHING = {
+    -0x7FFFFFFF, -0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF};
+
+INTERNAL_FUNC Cell_Instance
+make_array(s32 x, s32 y, u16 columns, u16 rows, s32 column_step, s32 row_step)
+{
+    Cell_Instance instance      = {};
+    instance.columns            = columns;
+    instance.rows               = rows;
+    instance.transform          = layout_transform_identity();
+    instance.transform.offset_x = x;
+    instance.transform.offset_y = y;
+    instance.column_step_x      = column_step;
+    instance.row_step_y         = row_step;
+
+    return instance;
+}
+
+// Arrays of arrays, one of them turned, with a polygon in the leaf
+INTERNAL_FUNC Layout *
+build_memory_layout()
+{
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    cell_builder_begin(&builder, STR("BIT"));
+    cell_builder_add_rect(&builder, 1, 0, {0, 0, 80, 40});
+    cell_builder_add_rect(&builder, 1, 0, {20, 40, 40, 120});
+    cell_builder_add_rect(&builder, 2, 0, {0, 0, 80, 120});
+    s32 xs[] = {0, 60, 60, 30, 30, 0};
+    s32 ys[] = {0, 0, 20, 20, 100, 100};
+    cell_builder_add_polygon(&builder, 3, 0, xs, ys, 6);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("WORD"));
+    Cell_Instance bits = make_array(0, 0, 16, 1, 100, 0);
+    cell_builder_add_instance(&builder, STR("BIT"), &bits);
+    cell_builder_add_rect(&builder, 1, 0, {-50, -50, 1650, -20});
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("BANK"));
+    Cell_Instance words = make_array(0, 0, 4, 32, 2000, 400);
+    cell_builder_add_instance(&builder, STR("WORD"), &words);
+    Cell_Instance turned = make_array(10000, 0, 8, 3, 0, 0);
+    turned.column_step_y         = 2000;
+    turned.row_step_x            = 500;
+    turned.transform.orientation = Layout_Orientation::MX_R270;
+    cell_builder_add_instance(&builder, STR("WORD"), &turned);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_shutdown(&builder);
+
+    layout_finalize(layout);
+
+    return layout;
+}
+
+INTERNAL_FUNC b8
+point_covered(Layout_LOD_Rect *rects, u64 count, u16 layer, s32 x, s32 y)
+{
+    for (u64 i = 0; i < count; ++i)
+    {
+        Layout_Box box = rects[i].box;
+
+        if (rects[i].layer == layer && box.min_x <= x && x <= box.max_x &&
+            box.min_y <= y && y <= box.max_y)
+            return true;
+    }
+
+    return false;
+}
+
+// Corners and center of every flattened rect of the layer lie in the rects
+INTERNAL_FUNC b8
+covers_layer(Layout                         *layout,
+             Dynamic_Array<Layout_LOD_Rect> *rects,
+             u16                             layer,
+             Layout_Box                      region)
+{
+    Dynamic_Array<Layout_Box> flat;
+    flat.init(test_arena, 4096);
+    layout_flatten_rects(layout, layout->top_cell, layer, 0, region, &flat);
+
+    Layout_LOD_Rect *lod_rects = push_array(test_arena, Layout_LOD_Rect,
+                                            rects->size);
+    for (u64 i = 0; i < rects->size; ++i)
+        lod_rects[i] = (*rects)[i];
+
+    for (u64 i = 0; i < flat.size; ++i)
+    {
+        Layout_Box box = flat[i];
+
+        // Only the part inside the region has to be drawn
+        box.min_x = MAX(box.min_x, region.min_x);
+        box.min_y = MAX(box.min_y, region.min_y);
+        box.max_x = MIN(box.max_x, region.max_x);
+        box.max_y = MIN(box.max_y, region.max_y);
+
+        s32 points[][2] = {{box.min_x, box.min_y},
+                           {box.max_x, box.min_y},
+                           {box.min_x, box.max_y},
+                           {box.max_x, box.max_y},
+                           {(box.min_x + box.max_x) / 2,
+                            (box.min_y + box.max_y) / 2}};
+
+        for (u32 p = 0; p < ARRAY_COUNT(points); ++p)
+        {
+            if (!point_covered(lod_rects,
+                               rects->size,
+                               layer,
+                               points[p][0],
+                               points[p][1]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_level_selection()
+{
+    expect_should_be(4, layout_lod_level_resolution(0));
+    expect_should_be(LAYOUT_LOD_MAX_RESOLUTION,
+                     layout_lod_level_resolution(LAYOUT_LOD_LEVEL_COUNT - 1));
+
+    expect_should_be(0, layout_lod_select_level(0.5));
+    expect_should_be(0, layout_lod_select_level(4.0));
+    expect_should_be(1, layout_lod_select_level(4.5));
+    expect_should_be(2, layout_lod_select_level(64.0));
+    expect_should_be(3, layout_lod_select_level(256.0));
+    expect_should_be(INVALID_ID, layout_lod_select_level(256.5));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_levels_are_conservative()
+{
+    arena_clear(test_arena);
+
+    Layout     *layout = build_memory_layout();
+    Layout_LOD *lod    = layout_lod_build(layout);
+
+    u32       bit      = layout_find_cell(layout, STR("BIT"));
+    Cell_LOD *top      = &lod->cells[layout->top_cell];
+    Cell_LOD *leaf     = &lod->cells[bit];
+
+    // The leaf has fewer shapes than the pixels of the first level
+    expect_should_be(1, leaf->level_count);
+    expect_should_be(3, leaf->layer_count);
+    expect_should_be(LAYOUT_LOD_LEVEL_COUNT, top->level_count);
+
+    // Layers reached through the words only
+    expect_should_be(3, top->layer_count);
+    expect_should_be(1, top->layers[0].layer);
+    expect_should_be(3, top->layers[2].layer);
+
+    Dynamic_Array<Layout_LOD_Rect> rects;
+    rects.init(test_arena, 4096);
+
+    for (u32 level = 0; level < top->level_count; ++level)
+    {
+        u32 resolution = layout_lod_level_resolution(level);
+
+        rects.size = 0;
+        for (u32 l = 0; l < top->layer_count; ++l)
+        {
+            Layout_LOD_Level *range = &top->layers[l].levels[level];
+            expect_should_be(
+                true, range->rect_count <= resolution * resolution / 2 + 1);
+
+            for (u32 r = 0; r < range->rect_count; ++r)
+            {
+                rects.add({top->rects[range->rect_offset + r],
+                           top->layers[l].layer,
+                           top->layers[l].datatype});
+            }
+        }
+
+        expect_should_be(true, covers_layer(layout, &rects, 1, EVERYTHING));
+        expect_should_be(true, covers_layer(layout, &rects, 2, EVERYTHING));
+    }
+
+    layout_lod_destroy(lod);
+    layout_destroy(layout);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_collect_covers_every_zoom()
+{
+    arena_clear(test_arena);
+
+    Layout     *layout = build_memory_layout();
+    Layout_LOD *lod    = layout_lod_build(layout);
+    Cell       *top    = &layout->cells[layout->top_cell];
+
+    Dynamic_Array<Layout_LOD_Rect> rects;
+    rects.init(test_arena, 4096);
+
+    Layout_Box corner = {top->bounds.min_x,
+                         top->bounds.min_y,
+                         top->bounds.min_x + 3000,
+                         top->bounds.min_y + 3000};
+
+    // From the bank in a few pixels down to the bits in hundreds of pixels
+    f64 zooms[] = {1000.0, 100.0, 20.0, 4.0, 1.0, 0.25};
+
+    for (u32 z = 0; z < ARRAY_COUNT(zooms); ++z)
+    {
+        Layout_Box regions[] = {top->bounds, corner};
+
+        for (u32 r = 0; r < ARRAY_COUNT(regions); ++r)
+        {
+            rects.size = 0;
+
+            Layout_LOD_Stats stats;
+            u64              appended = layout_lod_collect(
+                lod, layout->top_cell, regions[r], zooms[z], &rects, &stats);
+
+            expect_should_be(rects.size, appended);
+            expect_should_be(appended, stats.rect_count);
+            expect_should_be(
+                true, covers_layer(layout, &rects, 1, regions[r]));
+            expect_should_be(
+                true, covers_layer(layout, &rects, 2, regions[r]));
+        }
+    }
+
+    // Zoomed in, nothing is coarse and every shape is drawn on its own
+    rects.size = 0;
+
+    Layout_LOD_Stats stats;
+    layout_lod_collect(lod, layout->top_cell, corner, 0.25, &rects, &stats);
+
+    u64 expected = 0;
+
+    Layout_Flattener flattener;
+    Layout_Placement placement;
+    layout_flatten_begin(&flattener, layout, layout->top_cell, corner);
+    while (layout_flatten_next(&flattener, &placement))
+        expected++;
+
+    expect_should_be(expected, stats.detailed_placements);
+    expect_should_be(0, stats.bounds_placements);
+
+    layout_lod_destroy(lod);
+    layout_destroy(layout);
+
+    return true;
+}
+
+// Rows of standard cells arrayed into blocks, then blocks into a die
+INTERNAL_FUNC Layout *
+build_die(u16 block_columns, u16 block_rows)
+{
+    constexpr u32 std_cell_count = 8;
+    constexpr u32 row_length     = 200;
+    constexpr u16 rows_per_block = 200;
+    constexpr s32 cell_height    = 2000;
+
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    s32 widths[std_cell_count];
+
+    for (u32 i = 0; i < std_cell_count; ++i)
+    {
+        widths[i] = 200 * (i + 2);
+
+        cell_builder_begin(&builder, string_fmt(test_arena, "STD_%u", i));
+        for (u16 layer = 1; layer <= 4; ++layer)
+        {
+            for (s32 r = 0; r < 4; ++r)
+            {
+                s32 y = r * 450 + layer * 20;
+                cell_builder_add_rect(
+                    &builder, layer, 0, {20, y, widths[i] - 20, y + 100});
+            }
+        }
+        layout_commit_cell(layout, &builder);
+    }
+
+    cell_builder_begin(&builder, STR("ROW"));
+
+    s32 x = 0;
+    for (u32 i = 0; i < row_length; ++i)
+    {
+        u32           std      = (i * 5) % std_cell_count;
+        Cell_Instance instance = make_array(x, 0, 1, 1, 0, 0);
+
+        cell_builder_add_instance(
+            &builder, string_fmt(test_arena, "STD_%u", std), &instance);
+        x += widths[std];
+    }
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("BLOCK"));
+    Cell_Instance rows = make_array(0, 0, 1, rows_per_block, 0, cell_height);
+    cell_builder_add_instance(&builder, STR("ROW"), &rows);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("DIE"));
+    Cell_Instance blocks = make_array(0,
+                                      0,
+                                      block_columns,
+                                      block_rows,
+                                      x + 20000,
+                                      rows_per_block * cell_height + 20000);
+    cell_builder_add_instance(&builder, STR("BLOCK"), &blocks);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_shutdown(&builder);
+
+    layout_finalize(layout);
+
+    return layout;
+}
+
+INTERNAL_FUNC u8
+test_draws_bounded_across_zoom()
+{
+    constexpr f64 viewport_width  = 1920.0;
+    constexpr f64 viewport_height = 1080.0;
+
+    arena_clear(test_arena);
+
+    Layout *layout = build_die(8, 8);
+    Cell   *die    = &layout->cells[layout->top_cell];
+
+    Layout_LOD *lod = layout_lod_build(layout);
+
+    CORE_INFO("Layout LOD %llu shapes: build %.3f ms, %llu rects, %.1f KiB",
+              die->flat_shape_count,
+              lod->build_time * 1000.0,
+              lod->rect_count,
+              layout_lod_memory_usage(lod) / 1024.0);
+
+    Dynamic_Array<Layout_LOD_Rect> rects;
+    rects.init(test_arena, 64 * 1024);
+
+    // Zooms in on the middle of the first block
+    Cell *block    = &layout->cells[layout_find_cell(layout, STR("BLOCK"))];
+    f64   center_x = ((f64)block->bounds.min_x + block->bounds.max_x) / 2.0;
+    f64   center_y = ((f64)block->bounds.min_y + block->bounds.max_y) / 2.0;
+
+    f64 fit = layout_box_extent(die->bounds) / viewport_width;
+
+    Absolute_Clock clock;
+
+    // Every halving of the zoom from the whole die down to single shapes
+    for (f64 units_per_pixel = fit * 2.0; units_per_pixel >= 1.0;
+         units_per_pixel /= 4.0)
+    {
+        f64 half_width  = viewport_width * units_per_pixel / 2.0;
+        f64 half_height = viewport_height * units_per_pixel / 2.0;
+
+        Layout_Box region = {(s32)(center_x - half_width),
+                             (s32)(center_y - half_height),
+                             (s32)(center_x + half_width),
+                             (s32)(center_y + half_height)};
+
+        rects.size = 0;
+
+        Layout_LOD_Stats stats;
+
+        absolute_clock_start(&clock);
+        layout_lod_collect(
+            lod, layout->top_cell, region, units_per_pixel, &rects, &stats);
+        absolute_clock_update(&clock);
+
+        CORE_INFO("Layout LOD %.1f units/px: %llu rects in %.3f ms, levels "
+                  "%llu/%llu/%llu/%llu, %llu bounds, %llu detailed",
+                  units_per_pixel,
+                  rects.size,
+                  clock.elapsed_time * 1000.0,
+                  stats.level_placements[0],
+                  stats.level_placements[1],
+                  stats.level_placements[2],
+                  stats.level_placements[3],
+                  stats.bounds_placements,
+                  stats.detailed_placements);
+
+        // However far out, no more than a few rects per layer and pixel
+        expect_should_be(
+            true, rects.size <= (u64)(viewport_width * viewport_height));
+        expect_should_be(true, rects.size < die->flat_shape_count / 10);
+    }
+
+    layout_lod_destroy(lod);
+    layout_destroy(layout);
+
+    return true;
+}
+
+void
+layout_lod_register_tests()
+{
+    test_arena = arena_create(1 * GiB);
+
+    test_manager_register_test(test_level_selection,
+                               "Layout LOD: level selection");
+    test_manager_register_test(test_levels_are_conservative,
+                               "Layout LOD: levels are conservative");
+    test_manager_register_test(test_collect_covers_every_zoom,
+                               "Layout LOD: collect covers every zoom");
+    test_manager_register_test(test_draws_bounded_across_zoom,
+                               "Layout LOD: draws bounded across zoom");
+}
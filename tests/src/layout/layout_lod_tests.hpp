@@ -0,0 +1,3 @@
+#pragma once
+
+void layout_lod_register_tests();
@@ -0,0 +1,588 @@
+#include "layout_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <core/thread_context.hpp>
+#include <defines.hpp>
+#include <layout/layout.hpp>
+#include <memory/arena.hpp>
+
+static Arena *test_arena = nullptr;
+
+constexpr Layout_Box EVERYTHING = {
+    -0x7FFFFFFF, -0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF};
+
+INTERNAL_FUNC Cell_Instance
+make_instance(s32                x,
+              s32                y,
+              Layout_Orientation orientation = Layout_Orientation::R0)
+{
+    Cell_Instance instance         = {};
+    instance.columns               = 1;
+    instance.rows                  = 1;
+    instance.transform             = layout_transform_identity();
+    instance.transform.offset_x    = x;
+    instance.transform.offset_y    = y;
+    instance.transform.orientation = orientation;
+
+    return instance;
+}
+
+INTERNAL_FUNC Cell_Instance
+make_array(s32 x, s32 y, u16 columns, u16 rows, s32 column_step, s32 row_step)
+{
+    Cell_Instance instance = make_instance(x, y);
+    instance.columns       = columns;
+    instance.rows          = rows;
+    instance.column_step_x = column_step;
+    instance.row_step_y    = row_step;
+
+    return instance;
+}
+
+// Reference flattening that expands every element of every array
+INTERNAL_FUNC void
+brute_force_rects(Layout                 *layout,
+                  u32                     cell_index,
+                  const Layout_Transform *transform,
+                  u16                     layer,
+                  Layout_Box              region,
+                  u64                    *out_count,
+                  s64                    *out_checksum)
+{
+    Cell *cell = &layout->cells[cell_index];
+
+    for (u32 i = 0; i < cell->layer_count; ++i)
+    {
+        Cell_Layer *shapes = &cell->layers[i];
+        if (shapes->layer != layer)
+            continue;
+
+        for (u32 r = 0; r < shapes->rect_count; ++r)
+        {
+            Layout_Box local = {shapes->rect_min_x[r],
+                                shapes->rect_min_y[r],
+                                shapes->rect_max_x[r],
+                                shapes->rect_max_y[r]};
+
+            Layout_Box rect = layout_transform_box(transform, local);
+
+            if (layout_box_overlaps(rect, region))
+            {
+                (*out_count)++;
+                *out_checksum += rect.min_x * 3 + rect.max_y;
+            }
+        }
+    }
+
+    for (u32 i = 0; i < cell->instance_count; ++i)
+    {
+        Cell_Instance *instance = &cell->instances[i];
+
+        for (u32 row = 0; row < instance->rows; ++row)
+        {
+            for (u32 column = 0; column < instance->columns; ++column)
+            {
+                Layout_Transform element = instance->transform;
+                element.offset_x += instance->column_step_x * (s32)column +
+                                    instance->row_step_x * (s32)row;
+                element.offset_y += instance->column_step_y * (s32)column +
+                                    instance->row_step_y * (s32)row;
+
+                Layout_Transform combined =
+                    layout_transform_combine(transform, &element);
+
+                brute_force_rects(layout,
+                                  instance->cell,
+                                  &combined,
+                                  layer,
+                                  region,
+                                  out_count,
+                                  out_checksum);
+            }
+        }
+    }
+}
+
+INTERNAL_FUNC u8
+test_transform_combine()
+{
+    s32 points[][2] = {{0, 0}, {7, -3}, {-120, 45}, {1000, 1000}};
+
+    for (u8 p = 0; p < 8; ++p)
+    {
+        for (u8 c = 0; c < 8; ++c)
+        {
+            Layout_Transform parent = {15, -40, 1.0f, (Layout_Orientation)p};
+            Layout_Transform child  = {-3, 22, 1.0f, (Layout_Orientation)c};
+
+            Layout_Transform combined =
+                layout_transform_combine(&parent, &child);
+
+            for (u32 i = 0; i < ARRAY_COUNT(points); ++i)
+            {
+                s32 cx, cy, px, py, x, y;
+                layout_transform_point(
+                    &child, points[i][0], points[i][1], &cx, &cy);
+                layout_transform_point(&parent, cx, cy, &px, &py);
+                layout_transform_point(
+                    &combined, points[i][0], points[i][1], &x, &y);
+
+                expect_should_be(px, x);
+                expect_should_be(py, y);
+            }
+        }
+    }
+
+    // Mirror about x, then a quarter turn
+    Layout_Transform transform = {100, 0, 2.0f, Layout_Orientation::MX_R90};
+
+    s32 x, y;
+    layout_transform_point(&transform, 10, 5, &x, &y);
+    expect_should_be(110, x);
+    expect_should_be(20, y);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_builder_packs_layers()
+{
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    cell_builder_begin(&builder, STR("SHAPES"));
+
+    cell_builder_add_rect(&builder, 1, 0, {0, 0, 10, 20});
+
+    // Closed rectangle boundary, stored as a rect
+    s32 rect_x[] = {30, 30, 50, 50, 30};
+    s32 rect_y[] = {0, 5, 5, 0, 0};
+    cell_builder_add_polygon(&builder, 1, 0, rect_x, rect_y, 5);
+
+    s32 l_x[] = {0, 40, 40, 10, 10, 0};
+    s32 l_y[] = {0, 0, 10, 10, 60, 60};
+    cell_builder_add_polygon(&builder, 2, 5, l_x, l_y, 6);
+
+    u32 index = layout_commit_cell(layout, &builder);
+    expect_should_be(0, index);
+
+    Cell *cell = &layout->cells[index];
+    expect_should_be(true, cell->is_defined);
+    expect_should_be(2, cell->layer_count);
+
+    Cell_Layer *metal = &cell->layers[0];
+    expect_should_be(1, metal->layer);
+    expect_should_be(2, metal->rect_count);
+    expect_should_be(0, metal->polygon_count);
+    expect_should_be(30, metal->rect_min_x[1]);
+    expect_should_be(5, metal->rect_max_y[1]);
+    expect_should_be(50, metal->bounds.max_x);
+
+    Cell_Layer *poly = &cell->layers[1];
+    expect_should_be(5, poly->datatype);
+    expect_should_be(0, poly->rect_count);
+    expect_should_be(1, poly->polygon_count);
+    expect_should_be(6, poly->polygon_offsets[1]);
+    expect_should_be(60, poly->bounds.max_y);
+
+    // A second definition with the same name is rejected
+    cell_builder_begin(&builder, STR("SHAPES"));
+    expect_should_be(INVALID_ID, layout_commit_cell(layout, &builder));
+
+    cell_builder_shutdown(&builder);
+    layout_destroy(layout);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_forward_references_and_finalize()
+{
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    // TOP instantiates LEAF before LEAF is defined, like GDSII allows
+    cell_builder_begin(&builder, STR("TOP"));
+    Cell_Instance array = make_array(0, 0, 3, 2, 100, 50);
+    cell_builder_add_instance(&builder, STR("LEAF"), &array);
+    Cell_Instance rotated = make_instance(1000, 0, Layout_Orientation::R90);
+    cell_builder_add_instance(&builder, STR("LEAF"), &rotated);
+    u32 top = layout_commit_cell(layout, &builder);
+
+    u32 leaf = layout_find_cell(layout, STR("LEAF"));
+    expect_should_not_be(INVALID_ID, leaf);
+    expect_should_be(false, layout->cells[leaf].is_defined);
+
+    cell_builder_begin(&builder, STR("LEAF"));
+    cell_builder_add_rect(&builder, 1, 0, {0, 0, 20, 10});
+    cell_builder_add_rect(&builder, 2, 0, {5, 5, 15, 8});
+    expect_should_be(leaf, layout_commit_cell(layout, &builder));
+
+    expect_should_be(true, layout_finalize(layout));
+    expect_should_be(top, layout->top_cell);
+
+    Cell *top_cell = &layout->cells[top];
+    expect_should_be(2, top_cell->depth);
+    expect_should_be(7, top_cell->flat_instance_count);
+    expect_should_be(14, top_cell->flat_shape_count);
+    expect_should_be(2, layout->cells[leaf].parent_count);
+
+    // The array covers [0, 220] x [0, 60], the rotated leaf [990, 1000] x
+    // [0, 20]
+    expect_should_be(0, top_cell->bounds.min_x);
+    expect_should_be(0, top_cell->bounds.min_y);
+    expect_should_be(1000, top_cell->bounds.max_x);
+    expect_should_be(60, top_cell->bounds.max_y);
+
+    cell_builder_shutdown(&builder);
+    layout_destroy(layout);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_recursive_hierarchy_fails()
+{
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    Cell_Instance instance = make_instance(0, 0);
+
+    cell_builder_begin(&builder, STR("A"));
+    cell_builder_add_instance(&builder, STR("B"), &instance);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("B"));
+    cell_builder_add_rect(&builder, 1, 0, {0, 0, 1, 1});
+    cell_builder_add_instance(&builder, STR("A"), &instance);
+    layout_commit_cell(layout, &builder);
+
+    expect_should_be(false, layout_finalize(layout));
+
+    cell_builder_shutdown(&builder);
+    layout_destroy(layout);
+
+    return true;
+}
+
+// Two levels of arrays in several orientations, shared by the flatten tests
+INTERNAL_FUNC Layout *
+build_test_hierarchy()
+{
+    Layout      *layout = layout_create();
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    cell_builder_begin(&builder, STR("BIT"));
+    cell_builder_add_rect(&builder, 1, 0, {0, 0, 8, 4});
+    cell_builder_add_rect(&builder, 1, 0, {2, 4, 4, 12});
+    cell_builder_add_rect(&builder, 2, 0, {0, 0, 8, 12});
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("WORD"));
+    Cell_Instance bits = make_array(0, 0, 16, 1, 10, 0);
+    cell_builder_add_instance(&builder, STR("BIT"), &bits);
+    Cell_Instance flipped = make_instance(0, 30, Layout_Orientation::MIRROR_X);
+    cell_builder_add_instance(&builder, STR("BIT"), &flipped);
+    cell_builder_add_rect(&builder, 1, 0, {-5, -5, 165, -2});
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_begin(&builder, STR("BANK"));
+    Cell_Instance words = make_array(0, 0, 4, 32, 200, 40);
+    cell_builder_add_instance(&builder, STR("WORD"), &words);
+    Cell_Instance turned = make_array(1000, 0, 8, 3, 0, 0);
+    turned.column_step_y         = 200;
+    turned.row_step_x            = 50;
+    turned.transform.orientation = Layout_Orientation::MX_R270;
+    cell_builder_add_instance(&builder, STR("WORD"), &turned);
+    layout_commit_cell(layout, &builder);
+
+    cell_builder_shutdown(&builder);
+
+    layout_finalize(layout);
+
+    return layout;
+}
+
+INTERNAL_FUNC u8
+test_lazy_flatten_matches_brute_force()
+{
+    Layout *layout = build_test_hierarchy();
+    u32     bank   = layout->top_cell;
+
+    expect_should_be(layout_find_cell(layout, STR("BANK")), bank);
+
+    Layout_Box regions[] = {
+        EVERYTHING,
+        {0, 0, 100, 100},
+        {350, 600, 420, 900},
+        {900, 50, 1200, 700},
+        {-100, -100, -50, -50},
+    };
+
+    Dynamic_Array<Layout_Box> rects;
+
+    for (u32 i = 0; i < ARRAY_COUNT(regions); ++i)
+    {
+        arena_clear(test_arena);
+        rects.init(test_arena, 1024);
+
+        u64 count =
+            layout_flatten_rects(layout, bank, 1, 0, regions[i], &rects);
+
+        s64 checksum = 0;
+        for (u64 r = 0; r < rects.size; ++r)
+            checksum += rects[r].min_x * 3 + rects[r].max_y;
+
+        u64              expected_count    = 0;
+        s64              expected_checksum = 0;
+        Layout_Transform identity          = layout_transform_identity();
+        brute_force_rects(layout,
+                          bank,
+                          &identity,
+                          1,
+                          regions[i],
+                          &expected_count,
+                          &expected_checksum);
+
+        expect_should_be(expected_count, count);
+        expect_should_be(expected_checksum, checksum);
+    }
+
+    // The last region misses the bank entirely
+    expect_should_be(0, rects.size);
+
+    layout_destroy(layout);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_flatten_depth_limit()
+{
+    Layout *layout = build_test_hierarchy();
+
+    Layout_Flattener flattener;
+    Layout_Placement placement;
+
+    // Only the words are visited, the bank itself has no shapes
+    layout_flatten_begin(&flattener, layout, layout->top_cell, EVERYTHING, 1);
+
+    u64 placements = 0;
+    while (layout_flatten_next(&flattener, &placement))
+    {
+        expect_should_be(1, placement.depth);
+        placements++;
+    }
+    expect_should_be(4 * 32 + 8 * 3, placements);
+
+    layout_flatten_begin(&flattener, layout, layout->top_cell, EVERYTHING);
+
+    placements = 0;
+    while (layout_flatten_next(&flattener, &placement))
+        placements++;
+
+    expect_should_be(layout->cells[layout->top_cell].flat_instance_count,
+                     placements);
+
+    layout_destroy(layout);
+
+    return true;
+}
+
+// Standard cells placed one by one in a row, rows stacked by an array into a
+// block and blocks arrayed at the top. Builds roughly target_instances
+// placements out of a fixed number of unique cells
+INTERNAL_FUNC Layout *
+build_synthetic_layout(Cell_Builder *builder, u64 target_instances)
+{
+    constexpr u32 std_cell_count = 8;
+    constexpr u32 row_length     = 100;
+    constexpr u32 block_rows     = 100;
+    constexpr s32 cell_height    = 2000;
+
+    Layout *layout = layout_create();
+
+    s32 widths[std_cell_count];
+
+    for (u32 i = 0; i < std_cell_count; ++i)
+    {
+        widths[i] = 200 * (i + 2);
+
+        cell_builder_begin(builder, string_fmt(test_arena, "STD_%u", i));
+
+        for (u16 layer = 1; layer <= 3; ++layer)
+        {
+            for (s32 r = 0; r < 4; ++r)
+            {
+                s32 y = r * 400 + layer * 20;
+                cell_builder_add_rect(
+                    builder, layer, 0, {20, y, widths[i] - 20, y + 100});
+            }
+        }
+
+        s32 xs[] = {0, widths[i], widths[i], 100, 100, 0};
+        s32 ys[] = {0, 0, 150, 150, cell_height, cell_height};
+        cell_builder_add_polygon(builder, 4, 0, xs, ys, 6);
+
+        layout_commit_cell(layout, builder);
+    }
+
+    cell_builder_begin(builder, STR("ROW"));
+
+    s32 x = 0;
+    for (u32 i = 0; i < row_length; ++i)
+    {
+        u32 std = (i * 5) % std_cell_count;
+
+        // Every other cell flipped, as in a placed row
+        Cell_Instance instance = make_instance(x, 0);
+        if (i % 2)
+        {
+            instance.transform.orientation = Layout_Orientation::MX_R180;
+            instance.transform.offset_x    = x + widths[std];
+        }
+
+        cell_builder_add_instance(
+            builder, string_fmt(test_arena, "STD_%u", std), &instance);
+        x += widths[std];
+    }
+    layout_commit_cell(layout, builder);
+
+    s32 row_width = x;
+
+    cell_builder_begin(builder, STR("BLOCK"));
+    Cell_Instance rows = make_array(0, 0, 1, block_rows, 0, cell_height);
+    cell_builder_add_instance(builder, STR("ROW"), &rows);
+    layout_commit_cell(layout, builder);
+
+    u64 per_block   = 1 + block_rows * (1 + row_length);
+    u64 block_count = MAX(target_instances / per_block, 1);
+
+    u32 columns = 1;
+    while ((u64)columns * columns < block_count)
+        columns++;
+
+    cell_builder_begin(builder, STR("TOP"));
+    Cell_Instance blocks = make_array(0,
+                                      0,
+                                      (u16)columns,
+                                      (u16)(block_count / columns),
+                                      row_width + 5000,
+                                      block_rows * cell_height + 5000);
+    cell_builder_add_instance(builder, STR("BLOCK"), &blocks);
+    layout_commit_cell(layout, builder);
+
+    return layout;
+}
+
+INTERNAL_FUNC u8
+test_synthetic_layout_benchmark()
+{
+    u64 targets[] = {1000000, 10000000, 100000000};
+    u64 memory[ARRAY_COUNT(targets)];
+
+    Cell_Builder builder;
+    cell_builder_init(&builder);
+
+    Absolute_Clock clock;
+
+    for (u32 i = 0; i < ARRAY_COUNT(targets); ++i)
+    {
+        arena_clear(test_arena);
+
+        absolute_clock_start(&clock);
+        Layout *layout = build_synthetic_layout(&builder, targets[i]);
+        absolute_clock_update(&clock);
+        f64 build_time = clock.elapsed_time;
+
+        absolute_clock_start(&clock);
+        b8 finalized = layout_finalize(layout);
+        absolute_clock_update(&clock);
+        f64 finalize_time = clock.elapsed_time;
+
+        expect_should_be(true, finalized);
+
+        Cell *top = &layout->cells[layout->top_cell];
+
+        // A viewport over a corner of the die, flattened on demand
+        Layout_Box viewport = {top->bounds.min_x,
+                               top->bounds.min_y,
+                               top->bounds.min_x + 50000,
+                               top->bounds.min_y + 50000};
+
+        Layout_Flattener flattener;
+        Layout_Placement placement;
+        u64              visible = 0;
+
+        absolute_clock_start(&clock);
+        layout_flatten_begin(&flattener, layout, layout->top_cell, viewport);
+        while (layout_flatten_next(&flattener, &placement))
+            visible++;
+        absolute_clock_update(&clock);
+        f64 flatten_time = clock.elapsed_time;
+
+        memory[i] = layout_memory_usage(layout);
+
+        CORE_INFO("Layout %llu instances, %llu shapes, %llu cells: build "
+                  "%.3f ms, finalize %.3f ms, %.1f KiB. Viewport flatten: "
+                  "%llu placements in %.3f ms",
+                  top->flat_instance_count,
+                  top->flat_shape_count,
+                  layout->cells.size,
+                  build_time * 1000.0,
+                  finalize_time * 1000.0,
+                  memory[i] / 1024.0,
+                  visible,
+                  flatten_time * 1000.0);
+
+        expect_should_be(true,
+                         top->flat_instance_count >= targets[i] * 9 / 10);
+        expect_should_be(true, visible > 0);
+        expect_should_be(true, visible < top->flat_instance_count / 100);
+
+        layout_destroy(layout);
+    }
+
+    // Same unique cells, same memory, whatever the instance count
+    expect_should_be(memory[0], memory[ARRAY_COUNT(targets) - 1]);
+
+    cell_builder_shutdown(&builder);
+
+    return true;
+}
+
+void
+layout_register_tests()
+{
+    test_arena = arena_create();
+
+    // layout_finalize uses the scratch arenas of the calling thread
+    if (!thread_context_selected())
+    {
+        Thread_Context *context = thread_context_allocate();
+        context->thread_name    = "Test main thread";
+        thread_context_select(context);
+    }
+
+    test_manager_register_test(test_transform_combine,
+                               "Layout: transform composition");
+    test_manager_register_test(test_builder_packs_layers,
+                               "Layout: builder packs layers");
+    test_manager_register_test(test_forward_references_and_finalize,
+                               "Layout: forward references and finalize");
+    test_manager_register_test(test_recursive_hierarchy_fails,
+                               "Layout: recursive hierarchy fails");
+    test_manager_register_test(test_lazy_flatten_matches_brute_force,
+                               "Layout: lazy flatten matches brute force");
+    test_manager_register_test(test_flatten_depth_limit,
+                               "Layout: flatten depth limit");
+    test_manager_register_test(test_synthetic_layout_benchmark,
+                               "Layout: synthetic layout benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void layout_register_tests();
@@ -0,0 +1,325 @@
+#include "spatial_index_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <layout/spatial_index.hpp>
+#include <memory/arena.hpp>
+
+static Arena *test_arena = nullptr;
+
+// Xorshift, the seed must not be zero
+INTERNAL_FUNC u32
+next_random(u32 *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    return *seed;
+}
+
+// Boxes of up to size x size scattered over a square of the given extent
+INTERNAL_FUNC Spatial_Entry *
+make_random_entries(u64 count, s32 extent, s32 size, u32 seed)
+{
+    auto *entries = push_array(test_arena, Spatial_Entry, count);
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        s32 x = (s32)(next_random(&seed) % (u32)extent);
+        s32 y = (s32)(next_random(&seed) % (u32)extent);
+        s32 w = (s32)(next_random(&seed) % (u32)size);
+        s32 h = (s32)(next_random(&seed) % (u32)size);
+
+        entries[i] = {{x, y, x + w, y + h}, (u32)i};
+    }
+
+    return entries;
+}
+
+INTERNAL_FUNC Layout_Box
+make_random_region(u32 *seed, s32 extent, s32 size)
+{
+    s32 x = (s32)(next_random(seed) % (u32)extent) - size / 2;
+    s32 y = (s32)(next_random(seed) % (u32)extent) - size / 2;
+
+    return {x, y, x + size, y + size};
+}
+
+// Id checksum of the live entries overlapping the region
+INTERNAL_FUNC u64
+brute_force_query(const Spatial_Entry *entries,
+                  const b8            *alive,
+                  u64                  count,
+                  Layout_Box           region,
+                  u64                 *out_checksum)
+{
+    u64 found    = 0;
+    u64 checksum = 0;
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        if ((!alive || alive[i]) && layout_box_overlaps(entries[i].box, region))
+        {
+            found++;
+            checksum += (u64)entries[i].id * 2654435761u;
+        }
+    }
+
+    *out_checksum = checksum;
+    return found;
+}
+
+INTERNAL_FUNC u64
+ids_checksum(Dynamic_Array<u32> *ids)
+{
+    u64 checksum = 0;
+    for (u64 i = 0; i < ids->size; ++i)
+        checksum += (u64)(*ids)[i] * 2654435761u;
+
+    return checksum;
+}
+
+INTERNAL_FUNC u8
+test_bulk_load_matches_brute_force()
+{
+    constexpr u64 count  = 20000;
+    constexpr s32 extent = 100000;
+
+    arena_clear(test_arena);
+
+    Spatial_Entry *entries = make_random_entries(count, extent, 2000, 7);
+
+    Spatial_Index *index = spatial_index_create();
+    spatial_index_build(index, entries, count);
+
+    expect_should_be(count, index->entry_count);
+    expect_should_be(true, index->height > 1);
+
+    Dynamic_Array<u32> ids;
+    ids.init(test_arena, 1024);
+
+    u32 seed = 99;
+
+    for (u32 q = 0; q < 200; ++q)
+    {
+        Layout_Box region = make_random_region(&seed, extent, 1 + q * 100);
+
+        u64 expected_checksum;
+        u64 expected = brute_force_query(
+            entries, nullptr, count, region, &expected_checksum);
+
+        ids.size  = 0;
+        u64 found = spatial_index_query(index, region, &ids);
+
+        expect_should_be(expected, found);
+        expect_should_be(expected, ids.size);
+        expect_should_be(expected_checksum, ids_checksum(&ids));
+        expect_should_be(expected, spatial_index_query(index, region, nullptr));
+    }
+
+    spatial_index_destroy(index);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_insert_and_remove()
+{
+    constexpr u64 count  = 5000;
+    constexpr s32 extent = 50000;
+
+    arena_clear(test_arena);
+
+    Spatial_Entry *entries = make_random_entries(count, extent, 1000, 3);
+    b8            *alive   = push_array(test_arena, b8, count);
+
+    Spatial_Index *index = spatial_index_create({0, 0, extent, extent});
+
+    for (u64 i = 0; i < count; ++i)
+    {
+        spatial_index_insert(index, entries[i].box, entries[i].id);
+        alive[i] = true;
+    }
+
+    expect_should_be(count, index->entry_count);
+
+    // Remove every other entry, then a second time which has to fail
+    for (u64 i = 0; i < count; i += 2)
+    {
+        expect_should_be(
+            true, spatial_index_remove(index, entries[i].box, entries[i].id));
+        alive[i] = false;
+    }
+
+    expect_should_be(
+        false, spatial_index_remove(index, entries[0].box, entries[0].id));
+    expect_should_be(count / 2, index->entry_count);
+
+    Dynamic_Array<u32> ids;
+    ids.init(test_arena, 1024);
+
+    u32 seed = 17;
+
+    for (u32 q = 0; q < 200; ++q)
+    {
+        Layout_Box region = make_random_region(&seed, extent, 1 + q * 50);
+
+        u64 expected_checksum;
+        u64 expected = brute_force_query(
+            entries, alive, count, region, &expected_checksum);
+
+        ids.size = 0;
+        expect_should_be(expected, spatial_index_query(index, region, &ids));
+        expect_should_be(expected_checksum, ids_checksum(&ids));
+    }
+
+    // Removing everything collapses the tree back to an empty leaf
+    for (u64 i = 1; i < count; i += 2)
+    {
+        expect_should_be(
+            true, spatial_index_remove(index, entries[i].box, entries[i].id));
+    }
+
+    expect_should_be(0, index->entry_count);
+    expect_should_be(1, index->height);
+    expect_should_be(
+        0, spatial_index_query(index, {0, 0, extent, extent}, nullptr));
+
+    // Nodes released by the removals are reused
+    u32 node_count = index->node_count;
+
+    for (u64 i = 0; i < count; ++i)
+        spatial_index_insert(index, entries[i].box, entries[i].id);
+
+    expect_should_be(node_count, index->node_count);
+    expect_should_be(count,
+                     spatial_index_query(index, index->bounds, nullptr));
+
+    spatial_index_destroy(index);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_pick()
+{
+    arena_clear(test_arena);
+
+    Spatial_Entry entries[] = {
+        {{0, 0, 100, 100}, 10},
+        {{50, 50, 150, 150}, 20},
+        {{200, 0, 300, 100}, 30},
+    };
+
+    Spatial_Index *index = spatial_index_create();
+    spatial_index_build(index, entries, ARRAY_COUNT(entries));
+
+    Dynamic_Array<u32> ids;
+    ids.init(test_arena, 16);
+
+    expect_should_be(2, spatial_index_pick(index, 75, 75, &ids));
+    expect_should_be(1, spatial_index_pick(index, 250, 50, nullptr));
+    expect_should_be(0, spatial_index_pick(index, 175, 50, nullptr));
+
+    // Borders are part of the boxes
+    ids.size = 0;
+    expect_should_be(1, spatial_index_pick(index, 300, 100, &ids));
+    expect_should_be(30, ids[0]);
+
+    spatial_index_destroy(index);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_spatial_index_benchmark()
+{
+    constexpr u64 count       = 10000000;
+    constexpr s32 extent      = 1000000000; // 1 m at 1 nm database units
+    constexpr u32 query_count = 10000;
+
+    arena_clear(test_arena);
+
+    // Standard cell sized shapes, a few micrometers wide
+    Spatial_Entry *entries = make_random_entries(count, extent, 5000, 11);
+
+    Absolute_Clock clock;
+
+    Spatial_Index *index = spatial_index_create();
+
+    absolute_clock_start(&clock);
+    spatial_index_build(index, entries, count);
+    absolute_clock_update(&clock);
+    f64 build_time = clock.elapsed_time;
+
+    expect_should_be(count, index->entry_count);
+
+    Dynamic_Array<u32> ids;
+    ids.init(test_arena, 64 * 1024);
+
+    // Viewports from fully zoomed in to a hundredth of the die
+    s32 sizes[] = {100000, 1000000, 10000000};
+
+    for (u32 s = 0; s < ARRAY_COUNT(sizes); ++s)
+    {
+        u32 seed  = 5 + s;
+        u64 found = 0;
+
+        absolute_clock_start(&clock);
+        for (u32 q = 0; q < query_count; ++q)
+        {
+            ids.size = 0;
+            found += spatial_index_query(
+                index, make_random_region(&seed, extent, sizes[s]), &ids);
+        }
+        absolute_clock_update(&clock);
+
+        CORE_INFO("Spatial index viewport %d nm: %.0f queries/s, %.1f boxes "
+                  "per query",
+                  sizes[s],
+                  query_count / clock.elapsed_time,
+                  (f64)found / query_count);
+    }
+
+    // Incremental updates on the packed tree
+    constexpr u32 update_count = 100000;
+
+    absolute_clock_start(&clock);
+    for (u32 i = 0; i < update_count; ++i)
+        spatial_index_remove(index, entries[i].box, entries[i].id);
+    for (u32 i = 0; i < update_count; ++i)
+        spatial_index_insert(index, entries[i].box, entries[i].id);
+    absolute_clock_update(&clock);
+
+    expect_should_be(count, index->entry_count);
+
+    CORE_INFO("Spatial index %llu boxes: build %.3f ms, %.1f MiB, height %u, "
+              "%.0f removes+inserts/s",
+              count,
+              build_time * 1000.0,
+              spatial_index_memory_usage(index) / (1024.0 * 1024.0),
+              index->height,
+              update_count / clock.elapsed_time);
+
+    spatial_index_destroy(index);
+
+    return true;
+}
+
+void
+spatial_index_register_tests()
+{
+    test_arena = arena_create(1 * GiB);
+
+    test_manager_register_test(test_bulk_load_matches_brute_force,
+                               "Spatial index: bulk load matches brute force");
+    test_manager_register_test(test_insert_and_remove,
+                               "Spatial index: insert and remove");
+    test_manager_register_test(test_pick, "Spatial index: pick");
+    test_manager_register_test(test_spatial_index_benchmark,
+                               "Spatial index: 10M boxes benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void spatial_index_register_tests();
@@ -1,8 +1,23 @@
 #include "test_manager.hpp"
 
+#include <containers/dynamic_array_tests.hpp>
+#include <containers/freelist_tests.hpp>
 #include <containers/hashmap_tests.hpp>
 #include <containers/ring_queue_tests.hpp>
+#include <core/frame_pacing_tests.hpp>
+#include <core/job_system_tests.hpp>
 #include <core/string_tests.hpp>
+#include <layout/gdsii_reader_tests.hpp>
+#include <layout/layout_lod_tests.hpp>
+#include <layout/layout_tests.hpp>
+#include <layout/spatial_index_tests.hpp>
+#include <memory/allocation_profiler_tests.hpp>
+#include <memory/arena_tests.hpp>
+#include <memory/memory_tests.hpp>
+#include <renderer/render_queue_tests.hpp>
+#include <resources/image_loader_tests.hpp>
+#include <resources/resource_archive_tests.hpp>
+#include <resources/texture_cache_tests.hpp>
 #include <core/logger.hpp>
 
 int main() {
@@ -10,6 +25,21 @@ int main() {
 
     CORE_DEBUG("Starting tests...");
 
+    test_manager_begin_module("Arena");
+    arena_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Memory");
+    memory_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Allocation_Profiler");
+    allocation_profiler_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
     test_manager_begin_module("Hashmap");
     hashmap_register_tests();
     test_manager_run_tests();
@@ -20,6 +50,66 @@ int main() {
     test_manager_run_tests();
     test_manager_end_module();
 
+    test_manager_begin_module("Dynamic_Array");
+    dynamic_array_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Freelist");
+    freelist_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Job_System");
+    job_system_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Frame_Pacing");
+    frame_pacing_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Layout");
+    layout_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("GDSII");
+    gdsii_reader_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Spatial_Index");
+    spatial_index_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Layout_LOD");
+    layout_lod_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Render_Queue");
+    render_queue_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Image_Loader");
+    image_loader_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Texture_Cache");
+    texture_cache_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
+    test_manager_begin_module("Resource_Archive");
+    resource_archive_register_tests();
+    test_manager_run_tests();
+    test_manager_end_module();
+
     test_manager_begin_module("String");
     string_register_tests();
     test_manager_run_tests();
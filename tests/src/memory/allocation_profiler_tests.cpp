@@ -0,0 +1,272 @@
+#include "allocation_profiler_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <memory/allocation_profiler.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+#include <platform/filesystem.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr u64 TEST_SAMPLE_INTERVAL = 4 * KiB;
+
+INTERNAL_FUNC const Allocation_Site *
+find_site(const Allocation_Profile *profile, s32 line)
+{
+    for (u32 i = 0; i < profile->site_count; ++i)
+    {
+        if (profile->sites[i].line == line)
+            return &profile->sites[i];
+    }
+
+    return nullptr;
+}
+
+// Two sites pushing one and three times the bytes. The estimates follow the
+// ratio and the sizes land in their bucket
+INTERNAL_FUNC u8
+test_sampled_estimates()
+{
+    allocation_profiler_init(TEST_SAMPLE_INTERVAL);
+
+    constexpr u64 push_size  = 64;
+    constexpr u64 push_count = 64 * 1024;
+
+    Arena *arena = arena_create();
+
+    s32 small_line = 0;
+    s32 large_line = 0;
+
+    for (u64 i = 0; i < push_count; ++i)
+    {
+        push_array(arena, u8, push_size);
+        small_line = __LINE__ - 1;
+
+        for (u32 j = 0; j < 3; ++j)
+        {
+            push_array(arena, u8, push_size);
+            large_line = __LINE__ - 1;
+        }
+
+        // Only the samples are of interest
+        arena_clear(arena);
+    }
+
+    Allocation_Profile profile;
+    allocation_profiler_snapshot(arena, &profile);
+
+    const Allocation_Site *small_site = find_site(&profile, small_line);
+    const Allocation_Site *large_site = find_site(&profile, large_line);
+
+    expect_should_not_be(nullptr, small_site);
+    expect_should_not_be(nullptr, large_site);
+    expect_should_be((u32)Allocation_Source::ARENA, (u32)small_site->source);
+    expect_should_be(true, small_site->stack_depth > 0);
+
+    // The largest site comes first
+    expect_should_be(large_line, profile.sites[0].line);
+
+    // 4 MiB and 12 MiB, about a thousand samples for the small site
+    u64 small_bytes = push_size * push_count;
+    u64 large_bytes = small_bytes * 3;
+
+    expect_should_be(true,
+                     small_site->estimated_bytes > small_bytes * 8 / 10 &&
+                         small_site->estimated_bytes < small_bytes * 12 / 10);
+    expect_should_be(true,
+                     large_site->estimated_bytes > large_bytes * 9 / 10 &&
+                         large_site->estimated_bytes < large_bytes * 11 / 10);
+
+    // 64 bytes is bucket 6, [64, 128)
+    expect_should_be(small_site->sample_count, small_site->size_histogram[6]);
+
+    arena_release(arena);
+    allocation_profiler_shutdown();
+
+    return true;
+}
+
+// Paused sampling keeps the sites and takes no new samples
+INTERNAL_FUNC u8
+test_disabled_sampling()
+{
+    allocation_profiler_init(TEST_SAMPLE_INTERVAL);
+
+    Arena *arena = arena_create();
+
+    for (u32 i = 0; i < 64; ++i)
+        push_array(arena, u8, TEST_SAMPLE_INTERVAL);
+
+    Allocation_Profile profile;
+    allocation_profiler_snapshot(arena, &profile);
+
+    u64 sample_count = profile.sample_count;
+    expect_should_be(true, sample_count > 0);
+
+    allocation_profiler_set_enabled(false);
+    expect_should_be(false, allocation_profiler_is_enabled());
+
+    for (u32 i = 0; i < 64; ++i)
+        push_array(arena, u8, TEST_SAMPLE_INTERVAL);
+
+    allocation_profiler_snapshot(arena, &profile);
+    expect_should_be(sample_count, profile.sample_count);
+
+    allocation_profiler_reset();
+    allocation_profiler_snapshot(arena, &profile);
+    expect_should_be(0, profile.sample_count);
+    expect_should_be(0, profile.site_count);
+
+    arena_release(arena);
+    allocation_profiler_shutdown();
+
+    return true;
+}
+
+// Heap allocations are sampled with the call site of memory_allocate
+INTERNAL_FUNC u8
+test_heap_sampling()
+{
+    allocation_profiler_init(TEST_SAMPLE_INTERVAL);
+
+    // The countdown of this thread may still be the one of a disabled
+    // profiler, crossing it takes a countdown of the interval
+    u64   drain_size = ALLOCATION_PROFILER_DISABLED_COUNTDOWN;
+    void *drain      = memory_allocate(drain_size, Memory_Tag::ARRAY);
+
+    // Larger than any countdown, so always sampled
+    void *block = memory_allocate(TEST_SAMPLE_INTERVAL * 4, Memory_Tag::ARRAY);
+    s32   line  = __LINE__ - 1;
+
+    Arena *arena = arena_create();
+
+    Allocation_Profile profile;
+    allocation_profiler_snapshot(arena, &profile);
+
+    const Allocation_Site *site = find_site(&profile, line);
+
+    expect_should_not_be(nullptr, site);
+    expect_should_be((u32)Allocation_Source::HEAP, (u32)site->source);
+    expect_should_be(TEST_SAMPLE_INTERVAL * 4, site->estimated_bytes);
+
+    memory_deallocate(block, TEST_SAMPLE_INTERVAL * 4, Memory_Tag::ARRAY);
+    memory_deallocate(drain, drain_size, Memory_Tag::ARRAY);
+    arena_release(arena);
+    allocation_profiler_shutdown();
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_dump()
+{
+    const char *path = "allocation_profile_test.txt";
+
+    allocation_profiler_init(TEST_SAMPLE_INTERVAL);
+
+    Arena *arena = arena_create();
+
+    for (u32 i = 0; i < 16; ++i)
+        push_array(arena, u8, TEST_SAMPLE_INTERVAL);
+
+    expect_should_be(true, allocation_profiler_dump(path));
+
+    File_Handle file;
+    expect_should_be(true,
+                     filesystem_open(path, File_Modes::READ, false, &file));
+
+    u64 size = 0;
+    expect_should_be(true, filesystem_size(&file, &size));
+
+    char *text = push_array(arena, char, size + 1);
+    u64   read = 0;
+    expect_should_be(true, filesystem_read_all_text(&file, text, &read));
+    filesystem_close(&file);
+
+    expect_should_not_be(nullptr, strstr(text, "# Allocation profile"));
+    expect_should_not_be(nullptr, strstr(text, "allocation_profiler_tests"));
+    expect_should_not_be(nullptr, strstr(text, "(arena)"));
+
+    remove(path);
+
+    arena_release(arena);
+    allocation_profiler_shutdown();
+
+    return true;
+}
+
+INTERNAL_FUNC f64
+measure_pushes(u64 push_count, u64 push_size)
+{
+    Arena *arena = arena_create(push_count * push_size * 2);
+
+    // Commit everything up front, only the pushes are measured
+    push_array(arena, u8, push_count * push_size);
+    arena_clear(arena);
+
+    Absolute_Clock clock;
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < push_count; ++i)
+        push_array(arena, u8, push_size);
+    absolute_clock_update(&clock);
+
+    arena_release(arena);
+
+    return clock.elapsed_time;
+}
+
+// Arena pushes with sampling on and off, the best of a few rounds of each
+INTERNAL_FUNC u8
+test_overhead_benchmark()
+{
+    constexpr u64 push_count = 2 * 1024 * 1024;
+    constexpr u64 push_size  = 16;
+
+    allocation_profiler_init();
+
+    f64 enabled_time  = 0.0;
+    f64 disabled_time = 0.0;
+
+    for (u32 round = 0; round < 10; ++round)
+    {
+        allocation_profiler_set_enabled(true);
+        f64 time     = measure_pushes(push_count, push_size);
+        enabled_time = round == 0 ? time : MIN(enabled_time, time);
+
+        allocation_profiler_set_enabled(false);
+        time          = measure_pushes(push_count, push_size);
+        disabled_time = round == 0 ? time : MIN(disabled_time, time);
+    }
+
+    CORE_INFO("Allocation profiler %llu pushes of %llu bytes: sampled "
+              "%.2f ns/push, off %.2f ns/push (%+.1f%%)",
+              push_count,
+              push_size,
+              enabled_time * 1e9 / push_count,
+              disabled_time * 1e9 / push_count,
+              (enabled_time / disabled_time - 1.0) * 100.0);
+
+    allocation_profiler_shutdown();
+
+    return true;
+}
+
+void
+allocation_profiler_register_tests()
+{
+    test_manager_register_test(test_sampled_estimates,
+                               "Allocation profiler: sampled estimates");
+    test_manager_register_test(test_disabled_sampling,
+                               "Allocation profiler: disabled sampling");
+    test_manager_register_test(test_heap_sampling,
+                               "Allocation profiler: heap sampling");
+    test_manager_register_test(test_dump, "Allocation profiler: dump");
+    test_manager_register_test(test_overhead_benchmark,
+                               "Allocation profiler: overhead benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void allocation_profiler_register_tests();
@@ -0,0 +1,628 @@
+#include "arena_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+
+#ifdef DEBUG_BUILD
+#    include <memory/arena_debug.hpp>
+#endif
+#include <platform/platform.hpp>
+
+#include <stdio.h>
+#include <thread>
+
+// Resident bytes of the process, 0 where it can not be queried
+INTERNAL_FUNC u64
+resident_memory()
+{
+#if PLATFORM_LINUX
+    unsigned long long total_pages    = 0;
+    unsigned long long resident_pages = 0;
+
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+
+    s32 read_count = fscanf(statm, "%llu %llu", &total_pages, &resident_pages);
+    fclose(statm);
+
+    if (read_count != 2)
+        return 0;
+
+    return (u64)resident_pages * platform_query_system_info().page_size;
+#else
+    return 0;
+#endif
+}
+
+INTERNAL_FUNC b8
+is_zeroed(const u8 *data, u64 size)
+{
+    for (u64 i = 0; i < size; ++i)
+    {
+        if (data[i] != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// A spike past the retain size is decommitted on clear, the retained part
+// stays committed
+INTERNAL_FUNC u8
+test_decommit_on_clear()
+{
+    constexpr u64 commit_size = 64 * KiB;
+    constexpr u64 retain_size = 1 * MiB;
+    constexpr u64 spike_size  = 48 * MiB;
+
+    Arena *arena = arena_create(64 * MiB, commit_size, retain_size);
+
+    u64 resident_before = resident_memory();
+
+    u8 *spike = push_array(arena, u8, spike_size);
+    memory_set(spike, 0xAB, spike_size);
+
+    u64 resident_spike = resident_memory();
+
+    expect_should_be(true, arena->committed_memory >= spike_size);
+    expect_should_be(arena->committed_memory, arena->peak_committed);
+    expect_should_be(arena->offset, arena->peak_offset);
+
+    u64 peak_committed = arena->committed_memory;
+
+    arena_clear(arena);
+
+    u64 retained_end = ALIGN_UP(ARENA_HEADER_SIZE + retain_size, commit_size);
+    expect_should_be(retained_end, arena->committed_memory);
+
+    // The high water marks survive the clear
+    expect_should_be(peak_committed, arena->peak_committed);
+    expect_should_be(ARENA_HEADER_SIZE + spike_size, arena->peak_offset);
+
+    u64 resident_after = resident_memory();
+
+    CORE_DEBUG("Arena resident memory: before %.2f MiB, spike %.2f MiB, "
+               "after clear %.2f MiB",
+               (f64)resident_before / MiB,
+               (f64)resident_spike / MiB,
+               (f64)resident_after / MiB);
+
+    if (resident_spike > 0)
+    {
+        u64 released_size = resident_spike - resident_after;
+
+        expect_should_be(true, resident_spike - resident_before >= spike_size);
+        expect_should_be(true, released_size >= spike_size / 2);
+    }
+
+    // The memory is committed again, zeroed both in the retained part and in
+    // the pages that were given back
+    u8 *again = push_array(arena, u8, spike_size);
+    expect_should_be(true, is_zeroed(again, spike_size));
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Pops that stay within the retain size do not decommit anything
+INTERNAL_FUNC u8
+test_pop_within_retain_size()
+{
+    constexpr u64 commit_size = 64 * KiB;
+    constexpr u64 retain_size = 2 * MiB;
+
+    Arena *arena = arena_create(64 * MiB, commit_size, retain_size);
+
+    push_array(arena, u8, 1 * MiB);
+    u64 position = arena->offset;
+
+    push_array(arena, u8, 1 * MiB);
+    u64 committed = arena->committed_memory;
+
+    arena_pop_to(arena, position);
+    expect_should_be(committed, arena->committed_memory);
+
+    arena_clear(arena);
+    expect_should_be(committed, arena->committed_memory);
+
+    // Popping part of a bigger allocation keeps the retain size past the new
+    // position
+    push_array(arena, u8, 16 * MiB);
+    arena_pop(arena, 4 * MiB);
+
+    expect_should_be(ALIGN_UP(arena->offset + retain_size, commit_size),
+                     arena->committed_memory);
+
+    // A retain size of 0 gives back everything past the position
+    Arena *trimmed = arena_create(64 * MiB, commit_size, 0);
+
+    push_array(trimmed, u8, 8 * MiB);
+    arena_clear(trimmed);
+
+    expect_should_be(commit_size, trimmed->committed_memory);
+
+    arena_release(trimmed);
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_large_pages()
+{
+    Platform_System_Info info = platform_query_system_info();
+
+    Arena *arena = arena_create(256 * MiB,
+                                ARENA_DEFAULT_COMMIT_SIZE,
+                                ARENA_DEFAULT_RETAIN_SIZE,
+                                Arena_Flags::LARGE_PAGES);
+
+    // No large pages on this platform, the arena uses small pages
+    if (!enum_has_any(arena->flags, Arena_Flags::LARGE_PAGES))
+    {
+        arena_release(arena);
+        return BYPASS;
+    }
+
+    expect_should_be(0, (u64)arena->memory % info.large_page_size);
+    expect_should_be(info.large_page_size, arena->commit_granularity);
+    expect_should_be(0, arena->reserved_memory % info.large_page_size);
+
+    u64 size = 64 * MiB;
+    u8 *data = push_array(arena, u8, size);
+    memory_set(data, 0xCD, size);
+
+    expect_should_be(0, arena->committed_memory % info.large_page_size);
+
+    arena_clear(arena);
+    expect_should_be(0, arena->committed_memory % info.large_page_size);
+
+    data = push_array(arena, u8, size);
+    expect_should_be(true, is_zeroed(data, size));
+
+    arena_release(arena);
+
+    return true;
+}
+
+INTERNAL_FUNC u32
+block_count(Arena *arena)
+{
+    u32 count = 0;
+    for (Arena *block = arena->current; block; block = block->prev)
+        ++count;
+
+    return count;
+}
+
+// Pushes past the reservation chain blocks, the positions keep growing and
+// popping to an earlier position releases the blocks chained after it
+INTERNAL_FUNC u8
+test_chain_on_overflow()
+{
+    constexpr u64 reserve_size = 1 * MiB;
+    constexpr u64 commit_size  = 64 * KiB;
+    constexpr u64 push_size    = 384 * KiB;
+
+    Arena *arena = arena_create(reserve_size, commit_size);
+
+    u8 *pushes[8]    = {};
+    u64 positions[8] = {};
+
+    for (u32 i = 0; i < 8; ++i)
+    {
+        positions[i] = arena_position(arena);
+        pushes[i]    = push_array(arena, u8, push_size);
+        memory_set(pushes[i], (u8)(i + 1), push_size);
+
+        expect_should_be(true, arena_position(arena) > positions[i]);
+    }
+
+    // Two pushes fit in a block
+    expect_should_be(4, block_count(arena));
+    expect_should_be(true, arena->current != arena);
+    expect_should_be(3 * reserve_size, arena->current->base_position);
+
+    // Earlier blocks are untouched by the chaining
+    for (u32 i = 0; i < 8; ++i)
+    {
+        expect_should_be((u8)(i + 1), pushes[i][0]);
+        expect_should_be((u8)(i + 1), pushes[i][push_size - 1]);
+    }
+
+    expect_should_be(arena_position(arena), arena->peak_offset);
+    expect_should_be(arena->total_committed, arena->peak_committed);
+
+    // Back into the second block, the last two blocks are released
+    arena_pop_to(arena, positions[3]);
+
+    expect_should_be(2, block_count(arena));
+    expect_should_be(positions[3], arena_position(arena));
+    expect_should_be(true, arena->total_committed < arena->peak_committed);
+
+    // A scratch taken in the second block spanning two more blocks
+    Scratch_Arena scratch = arena_scratch_begin(arena);
+
+    for (u32 i = 0; i < 4; ++i)
+        push_array(arena, u8, push_size);
+
+    expect_should_be(4, block_count(arena));
+
+    arena_scratch_end(scratch);
+
+    expect_should_be(2, block_count(arena));
+    expect_should_be(positions[3], arena_position(arena));
+
+    u8 *again = push_array(arena, u8, push_size);
+    expect_should_be(pushes[3], again);
+
+    arena_clear(arena);
+
+    expect_should_be(1, block_count(arena));
+    expect_should_be(ARENA_HEADER_SIZE, arena_position(arena));
+    expect_should_be(arena->committed_memory, arena->total_committed);
+
+    arena_release(arena);
+
+    return true;
+}
+
+// A push bigger than the reservation gets a block of its own
+INTERNAL_FUNC u8
+test_dedicated_block()
+{
+    constexpr u64 reserve_size = 1 * MiB;
+    constexpr u64 commit_size  = 64 * KiB;
+    constexpr u64 large_size   = 16 * MiB;
+
+    Arena *arena = arena_create(reserve_size, commit_size);
+
+    push_array(arena, u8, 1 * KiB);
+    u64 position = arena_position(arena);
+
+    u8 *large = push_array(arena, u8, large_size);
+    memory_set(large, 0xEF, large_size);
+
+    expect_should_be(2, block_count(arena));
+    expect_should_be(true, arena->current->reserved_memory >= large_size);
+    expect_should_be(true,
+                     arena->current->reserved_memory <
+                         large_size + ARENA_HEADER_SIZE + commit_size +
+                             platform_query_system_info().page_size);
+
+    // The block starts where the reservation of the first one ends
+    expect_should_be(reserve_size, arena->current->base_position);
+
+    arena_pop_to(arena, position);
+
+    expect_should_be(1, block_count(arena));
+    expect_should_be(position, arena_position(arena));
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Pushes that fit in the current block take the same path as before the
+// chaining, a chained block is as fast as the first one
+INTERNAL_FUNC u8
+test_push_fast_path_benchmark()
+{
+    constexpr u64 push_count   = 2 * 1024 * 1024;
+    constexpr u64 push_size    = 16;
+    constexpr u64 reserve_size = push_count * push_size * 2;
+
+    Absolute_Clock clock;
+
+    // Retains everything, the pops do not decommit
+    Arena *arena = arena_create(reserve_size, 1 * MiB, reserve_size);
+
+    // Commit everything up front, only the bump is measured
+    push_array(arena, u8, push_count * push_size);
+    arena_clear(arena);
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < push_count; ++i)
+        push_array(arena, u8, push_size);
+    absolute_clock_update(&clock);
+    f64 first_block_time = clock.elapsed_time;
+
+    // Same pushes in a block chained after a full one
+    arena_clear(arena);
+    push_array(arena, u8, arena->reserved_memory - ARENA_HEADER_SIZE);
+    push_array(arena, u8, push_count * push_size);
+    arena_pop(arena, push_count * push_size);
+
+    expect_should_be(2, block_count(arena));
+
+    absolute_clock_start(&clock);
+    for (u64 i = 0; i < push_count; ++i)
+        push_array(arena, u8, push_size);
+    absolute_clock_update(&clock);
+    f64 chained_block_time = clock.elapsed_time;
+
+    CORE_INFO("Arena %llu pushes of %llu bytes: first block %.2f ns/push, "
+              "chained block %.2f ns/push",
+              push_count,
+              push_size,
+              first_block_time * 1e9 / push_count,
+              chained_block_time * 1e9 / push_count);
+
+    arena_release(arena);
+
+    return true;
+}
+
+struct Concurrent_Push
+{
+    u8 *data;
+    u64 size;
+    u64 align;
+};
+
+// Threads push into one arena with a reservation small enough to chain many
+// blocks. Every push is zeroed, aligned and does not overlap the others
+INTERNAL_FUNC u8
+test_concurrent_pushes()
+{
+    constexpr u32 thread_count      = 8;
+    constexpr u64 pushes_per_thread = 20000;
+
+    Arena *arena = arena_create(256 * KiB,
+                                64 * KiB,
+                                ARENA_DEFAULT_RETAIN_SIZE,
+                                Arena_Flags::CONCURRENT);
+
+    Arena *records_arena = arena_create();
+
+    auto *records = push_array(
+        records_arena, Concurrent_Push, thread_count * pushes_per_thread);
+    auto *zeroed = push_array(records_arena, b8, thread_count);
+    auto *threads = push_array(records_arena, std::thread, thread_count);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        new (&threads[t]) std::thread([arena, records, zeroed, t]() {
+            Concurrent_Push *pushes = &records[t * pushes_per_thread];
+
+            zeroed[t]  = true;
+            u64 random = 0x9E3779B97F4A7C15ull * (t + 1);
+
+            for (u64 i = 0; i < pushes_per_thread; ++i)
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+
+                // Now and then a push bigger than a block
+                u64 size  = i % 4096 == 4095 ? 320 * KiB : 1 + random % 256;
+                u64 align = 8ull << (random >> 60) % 4;
+
+                u8 *data = (u8 *)_arena_push(
+                    arena, size, align, true, __FILE__, __LINE__);
+
+                zeroed[t] = zeroed[t] && is_zeroed(data, size);
+                memory_set(data, (u8)(t + 1), size);
+
+                pushes[i] = {data, size, align};
+            }
+        });
+    }
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        threads[t].join();
+        threads[t].~thread();
+    }
+
+    b8 is_aligned = true;
+    b8 is_intact  = true;
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        expect_should_be(true, zeroed[t]);
+
+        for (u64 i = 0; i < pushes_per_thread; ++i)
+        {
+            Concurrent_Push *push = &records[t * pushes_per_thread + i];
+
+            is_aligned = is_aligned && (u64)push->data % push->align == 0;
+            is_intact  = is_intact && push->data[0] == (u8)(t + 1) &&
+                        push->data[push->size - 1] == (u8)(t + 1);
+        }
+    }
+
+    expect_should_be(true, is_aligned);
+    expect_should_be(true, is_intact);
+    expect_should_be(true, block_count(arena) > thread_count);
+
+    // Back to the first block, memory written before is zeroed again
+    arena_clear(arena);
+
+    expect_should_be(1, block_count(arena));
+    expect_should_be(true, arena->peak_offset > 256 * KiB);
+
+    u8 *again = push_array(arena, u8, 64 * KiB);
+    expect_should_be(true, is_zeroed(again, 64 * KiB));
+
+    arena_release(records_arena);
+    arena_release(arena);
+
+    return true;
+}
+
+// Pushes per second of threads sharing a CONCURRENT arena, against a regular
+// arena behind a lock
+INTERNAL_FUNC f64
+run_shared_pushes(Arena              *arena,
+                  Platform_Semaphore *lock,
+                  u32                 thread_count,
+                  u64                 pushes_per_thread)
+{
+    Arena *threads_arena = arena_create();
+    auto  *threads = push_array(threads_arena, std::thread, thread_count);
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        new (&threads[t]) std::thread([arena, lock, pushes_per_thread]() {
+            for (u64 i = 0; i < pushes_per_thread; ++i)
+            {
+                if (lock)
+                    platform_semaphore_wait(lock);
+
+                u64 *data = push_array(arena, u64, 4);
+                data[0]   = i;
+
+                if (lock)
+                    platform_semaphore_signal(lock, 1);
+            }
+        });
+    }
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        threads[t].join();
+        threads[t].~thread();
+    }
+
+    absolute_clock_update(&clock);
+
+    arena_release(threads_arena);
+
+    return (f64)(pushes_per_thread * thread_count) / clock.elapsed_time;
+}
+
+INTERNAL_FUNC u8
+test_concurrent_contention_benchmark()
+{
+    constexpr u64 total_pushes = 1024 * 1024;
+    constexpr u64 reserve_size = 64 * MiB;
+
+    Platform_Semaphore lock;
+    expect_should_be(true, platform_semaphore_create(1, &lock));
+
+    Arena *concurrent = arena_create(
+        reserve_size, 1 * MiB, reserve_size, Arena_Flags::CONCURRENT);
+    Arena *locked = arena_create(reserve_size, 1 * MiB, reserve_size);
+
+    // Commit everything up front, only the pushes are measured
+    push_array(concurrent, u8, reserve_size / 2);
+    push_array(locked, u8, reserve_size / 2);
+
+    for (u32 threads = 1; threads <= 64; threads *= 2)
+    {
+        arena_clear(concurrent);
+        arena_clear(locked);
+
+        u64 pushes = total_pushes / threads;
+
+        f64 concurrent_rate =
+            run_shared_pushes(concurrent, nullptr, threads, pushes);
+        f64 locked_rate = run_shared_pushes(locked, &lock, threads, pushes);
+
+        expect_should_be(pushes * threads * 32,
+                         arena_position(concurrent) - ARENA_HEADER_SIZE);
+
+        CORE_INFO("Arena %2u thread(s): concurrent %.2f Mpushes/s, locked "
+                  "%.2f Mpushes/s",
+                  threads,
+                  concurrent_rate / 1e6,
+                  locked_rate / 1e6);
+    }
+
+    arena_release(locked);
+    arena_release(concurrent);
+    platform_semaphore_destroy(&lock);
+
+    return true;
+}
+
+// Workers create, push to and release their own arenas while the debug
+// registry records all of them
+INTERNAL_FUNC u8
+test_debug_registry_threads()
+{
+#ifdef DEBUG_BUILD
+    constexpr u32 thread_count      = 8;
+    constexpr u32 arenas_per_thread = 16;
+    constexpr u32 pushes_per_arena  = 4096;
+
+    b8 owns_registry = arena_debug_get_registry() == nullptr;
+    if (owns_registry)
+        arena_debug_init();
+
+    u32 active_count = arena_debug_get_registry()->active_count;
+
+    Arena *threads_arena = arena_create();
+    auto  *threads = push_array(threads_arena, std::thread, thread_count);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        new (&threads[t]) std::thread([]() {
+            for (u32 a = 0; a < arenas_per_thread; ++a)
+            {
+                Arena *arena = arena_create(1 * MiB, 64 * KiB);
+
+                for (u32 i = 0; i < pushes_per_arena; ++i)
+                    push_array(arena, u64, 4);
+
+                arena_pop_to(arena, ARENA_HEADER_SIZE);
+                arena_release(arena);
+            }
+        });
+    }
+
+    // The main thread keeps pushing to its own arena meanwhile
+    for (u32 i = 0; i < pushes_per_arena; ++i)
+        push_array(threads_arena, u64, 4);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        threads[t].join();
+        threads[t].~thread();
+    }
+
+    arena_release(threads_arena);
+
+    expect_should_be(active_count, arena_debug_get_registry()->active_count);
+
+    if (owns_registry)
+        arena_debug_shutdown();
+
+    return true;
+#else
+    return BYPASS;
+#endif
+}
+
+void
+arena_register_tests()
+{
+    test_manager_register_test(test_decommit_on_clear,
+                               "Arena: decommit past the retain size");
+    test_manager_register_test(test_pop_within_retain_size,
+                               "Arena: pops within the retain size");
+    test_manager_register_test(test_large_pages, "Arena: large pages");
+    test_manager_register_test(test_chain_on_overflow,
+                               "Arena: chain blocks on overflow");
+    test_manager_register_test(test_dedicated_block,
+                               "Arena: dedicated block for large pushes");
+    test_manager_register_test(test_push_fast_path_benchmark,
+                               "Arena: push fast path benchmark");
+    test_manager_register_test(test_concurrent_pushes,
+                               "Arena: concurrent pushes");
+    test_manager_register_test(test_concurrent_contention_benchmark,
+                               "Arena: concurrent contention benchmark");
+    test_manager_register_test(test_debug_registry_threads,
+                               "Arena: debug registry across threads");
+}
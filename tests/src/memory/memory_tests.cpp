@@ -0,0 +1,268 @@
+#include "memory_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+#include <memory/slab_allocator.hpp>
+
+#include <stdlib.h>
+#include <thread>
+
+INTERNAL_FUNC u64
+next_random(u64 *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+INTERNAL_FUNC u8
+test_size_classes()
+{
+    expect_should_be(0, slab_size_class(1));
+    expect_should_be(0, slab_size_class(16));
+    expect_should_be(1, slab_size_class(17));
+    expect_should_be(1, slab_size_class(32));
+    expect_should_be(2, slab_size_class(33));
+    expect_should_be(8, slab_size_class(4 * KiB));
+    expect_should_be(SLAB_SIZE_CLASS_COUNT - 1,
+                     slab_size_class(SLAB_MAX_BLOCK_SIZE));
+
+    return true;
+}
+
+// Blocks are zeroed and aligned, freed blocks come back first and the tag
+// usage follows the blocks
+INTERNAL_FUNC u8
+test_allocate_and_reuse()
+{
+    constexpr u32 block_count = 512;
+
+    u64 usage = memory_get_tag_usage(Memory_Tag::HASHMAP);
+
+    Arena *arena  = arena_create();
+    auto  *blocks = push_array(arena, u8 *, block_count);
+    auto  *sizes  = push_array(arena, u64, block_count);
+
+    u64 random = 0x9E3779B97F4A7C15ull;
+    b8  is_ok  = true;
+
+    for (u32 i = 0; i < block_count; ++i)
+    {
+        sizes[i]  = 1 + next_random(&random) % (2 * SLAB_MAX_BLOCK_SIZE);
+        blocks[i] = (u8 *)memory_allocate(sizes[i], Memory_Tag::HASHMAP);
+
+        is_ok = is_ok && (u64)blocks[i] % 16 == 0 && blocks[i][0] == 0 &&
+                blocks[i][sizes[i] - 1] == 0;
+
+        memory_set(blocks[i], 0xCD, sizes[i]);
+    }
+
+    expect_should_be(true, is_ok);
+
+    // Blocks of one class do not overlap
+    for (u32 i = 0; i < block_count; ++i)
+    {
+        is_ok = is_ok && blocks[i][0] == 0xCD &&
+                blocks[i][sizes[i] - 1] == 0xCD;
+        memory_deallocate(blocks[i], sizes[i], Memory_Tag::HASHMAP);
+    }
+
+    expect_should_be(true, is_ok);
+    expect_should_be(usage, memory_get_tag_usage(Memory_Tag::HASHMAP));
+
+    // The last freed block of the class is handed out again, zeroed
+    u8 *block = (u8 *)memory_allocate(48, Memory_Tag::HASHMAP);
+    memory_set(block, 0xCD, 48);
+    memory_deallocate(block, 48, Memory_Tag::HASHMAP);
+
+    u8 *again = (u8 *)memory_allocate(60, Memory_Tag::HASHMAP);
+    expect_should_be(block, again);
+    expect_should_be(0, again[0]);
+    expect_should_be(0, again[47]);
+
+    memory_deallocate(again, 60, Memory_Tag::HASHMAP);
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Blocks allocated by one thread and freed by another. The freed blocks go
+// through the depot back to the threads that allocate next
+INTERNAL_FUNC u8
+test_cross_thread_frees()
+{
+    constexpr u32 thread_count      = 8;
+    constexpr u32 blocks_per_thread = 20000;
+
+    u64 usage = memory_get_tag_usage(Memory_Tag::DARRAY);
+
+    Arena *arena   = arena_create();
+    auto  *blocks  = push_array(arena, u8 *, thread_count * blocks_per_thread);
+    auto  *intact  = push_array(arena, b8, thread_count);
+    auto  *threads = push_array(arena, std::thread, thread_count);
+
+    for (u32 round = 0; round < 2; ++round)
+    {
+        for (u32 t = 0; t < thread_count; ++t)
+        {
+            new (&threads[t]) std::thread([blocks, intact, round, t]() {
+                // The second round frees the blocks of the next thread
+                u32 owner  = round == 0 ? t : (t + 1) % thread_count;
+                u8 **owned = &blocks[owner * blocks_per_thread];
+                u64 random = 0x9E3779B97F4A7C15ull * (owner + 1);
+
+                intact[t] = true;
+
+                for (u32 i = 0; i < blocks_per_thread; ++i)
+                {
+                    u64 size = 1 + next_random(&random) % 512;
+
+                    if (round == 0)
+                    {
+                        owned[i] = (u8 *)memory_allocate_no_zero(
+                            size, Memory_Tag::DARRAY);
+                        memory_set(owned[i], (u8)(owner + 1), size);
+                        continue;
+                    }
+
+                    intact[t] = intact[t] && owned[i][0] == (u8)(owner + 1) &&
+                                owned[i][size - 1] == (u8)(owner + 1);
+
+                    memory_deallocate(owned[i], size, Memory_Tag::DARRAY);
+                }
+
+                slab_release_thread_cache();
+            });
+        }
+
+        for (u32 t = 0; t < thread_count; ++t)
+        {
+            threads[t].join();
+            threads[t].~thread();
+        }
+    }
+
+    for (u32 t = 0; t < thread_count; ++t)
+        expect_should_be(true, intact[t]);
+
+    expect_should_be(usage, memory_get_tag_usage(Memory_Tag::DARRAY));
+
+    arena_release(arena);
+
+    return true;
+}
+
+// Operations per second of threads keeping a window of live blocks of mixed
+// sizes, each step frees a random block of the window and allocates another
+INTERNAL_FUNC f64
+run_mixed_allocations(b8 use_malloc, u32 thread_count, u64 steps_per_thread)
+{
+    constexpr u32 window_size = 1024;
+
+    Arena *threads_arena = arena_create();
+    auto  *threads = push_array(threads_arena, std::thread, thread_count);
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        new (&threads[t]) std::thread([use_malloc, steps_per_thread, t]() {
+            u8 *window[window_size] = {};
+            u64 sizes[window_size]  = {};
+            u64 random              = 0x9E3779B97F4A7C15ull * (t + 1);
+
+            for (u64 i = 0; i < steps_per_thread + window_size; ++i)
+            {
+                u64 r    = next_random(&random);
+                u32 slot = (u32)(r % window_size);
+
+                // Mostly small blocks, some up to 8 KiB
+                u64 size = (r >> 32) % 8 == 0 ? 1 + (r >> 16) % (8 * KiB)
+                                              : 1 + (r >> 16) % 256;
+
+                if (use_malloc)
+                {
+                    free(window[slot]);
+                    window[slot] = (u8 *)malloc(size);
+                }
+                else
+                {
+                    if (window[slot])
+                        memory_deallocate(
+                            window[slot], sizes[slot], Memory_Tag::ARRAY);
+
+                    window[slot] = (u8 *)memory_allocate_no_zero(
+                        size, Memory_Tag::ARRAY);
+                }
+
+                window[slot][0] = (u8)i;
+                sizes[slot]     = size;
+            }
+
+            for (u32 i = 0; i < window_size; ++i)
+            {
+                if (use_malloc)
+                    free(window[i]);
+                else
+                    memory_deallocate(window[i], sizes[i], Memory_Tag::ARRAY);
+            }
+
+            slab_release_thread_cache();
+        });
+    }
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        threads[t].join();
+        threads[t].~thread();
+    }
+
+    absolute_clock_update(&clock);
+
+    arena_release(threads_arena);
+
+    return (f64)(steps_per_thread * thread_count) / clock.elapsed_time;
+}
+
+INTERNAL_FUNC u8
+test_mixed_sizes_benchmark()
+{
+    constexpr u64 total_steps = 2 * 1024 * 1024;
+
+    for (u32 threads = 1; threads <= 8; threads *= 2)
+    {
+        u64 steps = total_steps / threads;
+
+        f64 slab_rate   = run_mixed_allocations(false, threads, steps);
+        f64 malloc_rate = run_mixed_allocations(true, threads, steps);
+
+        CORE_INFO("Mixed allocations, %u threads: slab %.2f ns/op, malloc "
+                  "%.2f ns/op",
+                  threads,
+                  1e9 / slab_rate,
+                  1e9 / malloc_rate);
+    }
+
+    return true;
+}
+
+void
+memory_register_tests()
+{
+    test_manager_register_test(test_size_classes, "Memory: size classes");
+    test_manager_register_test(test_allocate_and_reuse,
+                               "Memory: allocate and reuse");
+    test_manager_register_test(test_cross_thread_frees,
+                               "Memory: cross thread frees");
+    test_manager_register_test(test_mixed_sizes_benchmark,
+                               "Memory: mixed sizes benchmark against malloc");
+}
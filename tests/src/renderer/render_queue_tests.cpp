@@ -0,0 +1,234 @@
+#include "render_queue_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/absolute_clock.hpp>
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <math/math.hpp>
+#include <memory/arena.hpp>
+#include <renderer/render_queue.hpp>
+#include <utils/radix_sort.hpp>
+
+static Arena *test_arena = nullptr;
+
+INTERNAL_FUNC u64
+next_random(u64 *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+INTERNAL_FUNC u8
+test_radix_sort_is_stable()
+{
+    arena_clear(test_arena);
+
+    constexpr u32 count = 100000;
+
+    u64 *keys   = push_array(test_arena, u64, count);
+    u32 *values = push_array(test_arena, u32, count);
+
+    // Few distinct keys spread over every byte, so that equal keys are common
+    u64 random = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < count; ++i)
+    {
+        keys[i]   = (next_random(&random) % 512) * 0x0101010101010101ull;
+        values[i] = i;
+    }
+
+    radix_sort_u64(test_arena, keys, values, count);
+
+    for (u32 i = 1; i < count; ++i)
+    {
+        expect_should_be(true, keys[i - 1] <= keys[i]);
+
+        if (keys[i - 1] == keys[i])
+            expect_should_be(true, values[i - 1] < values[i]);
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_radix_sort_keeps_pairs()
+{
+    arena_clear(test_arena);
+
+    constexpr u32 count = 4096;
+
+    u64 *keys   = push_array(test_arena, u64, count);
+    u32 *values = push_array(test_arena, u32, count);
+
+    // The value remembers its key so that moving them apart shows up
+    u64 random = 12345;
+    for (u32 i = 0; i < count; ++i)
+    {
+        keys[i]   = next_random(&random);
+        values[i] = (u32)(keys[i] >> 32);
+    }
+
+    radix_sort_u64(test_arena, keys, values, count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (i > 0)
+            expect_should_be(true, keys[i - 1] <= keys[i]);
+
+        expect_should_be((u32)(keys[i] >> 32), values[i]);
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_key_order()
+{
+    u64 near_key = render_queue_make_key(0, 1, 1, 5.0f);
+    u64 far_key  = render_queue_make_key(0, 1, 1, -5.0f);
+
+    // Closer to the camera is drawn first
+    expect_should_be(true, near_key < far_key);
+
+    // Depth only orders the draws of the same geometry
+    expect_should_be(true, far_key < render_queue_make_key(0, 1, 2, 100.0f));
+    expect_should_be(true,
+                     render_queue_make_key(0, 1, 4095, 0.0f) <
+                         render_queue_make_key(0, 2, 0, 0.0f));
+    expect_should_be(true,
+                     render_queue_make_key(0, 4094, 4095, 0.0f) <
+                         render_queue_make_key(1, 0, 0, 0.0f));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_build_batches()
+{
+    arena_clear(test_arena);
+
+    Material materials[2] = {};
+    materials[0].internal_id = 7;
+    materials[1].internal_id = 3;
+
+    // Geometry 2 is not uploaded and is left out
+    Geometry geometries[4] = {};
+    geometries[0].internal_id = 10;
+    geometries[0].material    = &materials[0];
+    geometries[1].internal_id = 11;
+    geometries[1].material    = &materials[1];
+    geometries[2].internal_id = INVALID_ID;
+    geometries[3].internal_id = 12;
+    geometries[3].material    = &materials[1];
+
+    constexpr u32        draw_count = 12;
+    Geometry_Render_Data draws[draw_count];
+
+    for (u32 i = 0; i < draw_count; ++i)
+    {
+        draws[i].geometry = &geometries[i % 4];
+        draws[i].model    = mat4_translation({(f32)i, 0.0f, (f32)i});
+    }
+
+    draws[draw_count - 1].geometry = nullptr;
+
+    Render_Queue queue;
+    render_queue_build(test_arena, draws, draw_count, mat4_identity(), &queue);
+
+    expect_should_be(8, queue.instance_count);
+    expect_should_be(3, queue.batch_count);
+
+    // Material 3 comes first with its two geometries, then material 7
+    expect_should_be(&geometries[1], queue.batches[0].geometry);
+    expect_should_be(&geometries[3], queue.batches[1].geometry);
+    expect_should_be(&geometries[0], queue.batches[2].geometry);
+
+    expect_should_be(3, queue.batches[0].instance_count);
+    expect_should_be(2, queue.batches[1].instance_count);
+    expect_should_be(3, queue.batches[2].instance_count);
+
+    // The highest z is the closest to the camera and comes first
+    Render_Batch *batch = &queue.batches[0];
+    for (u32 i = 1; i < batch->instance_count; ++i)
+    {
+        f32 previous_z =
+            queue.transforms[batch->first_instance + i - 1].elements[14];
+        f32 z = queue.transforms[batch->first_instance + i].elements[14];
+        expect_should_be(true, previous_z > z);
+    }
+
+    return true;
+}
+
+// Draws shaped like the layout renderer's: one unit quad per rect, with one
+// geometry and material per palette entry. Reports the draw calls issued
+// before and after batching
+INTERNAL_FUNC u8
+test_layout_draw_call_reduction()
+{
+    arena_clear(test_arena);
+
+    constexpr u32 palette_size = 8;
+    constexpr u32 draw_count   = 100000;
+
+    Material materials[palette_size]  = {};
+    Geometry geometries[palette_size] = {};
+
+    for (u32 i = 0; i < palette_size; ++i)
+    {
+        materials[i].internal_id  = i;
+        geometries[i].internal_id = i;
+        geometries[i].material    = &materials[i];
+    }
+
+    Geometry_Render_Data *draws =
+        push_array(test_arena, Geometry_Render_Data, draw_count);
+
+    u64 random = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < draw_count; ++i)
+    {
+        u32 layer = (u32)(next_random(&random) % palette_size);
+        f32 x     = (f32)(next_random(&random) % 10000);
+        f32 y     = (f32)(next_random(&random) % 10000);
+
+        draws[i].geometry = &geometries[layer];
+        draws[i].model    = mat4_translation({x, y, layer * 0.01f});
+    }
+
+    Absolute_Clock clock;
+    absolute_clock_start(&clock);
+
+    Render_Queue queue;
+    render_queue_build(test_arena, draws, draw_count, mat4_identity(), &queue);
+
+    absolute_clock_update(&clock);
+
+    expect_should_be(draw_count, queue.instance_count);
+    expect_should_be(palette_size, queue.batch_count);
+
+    CORE_INFO("Render queue: %u layout draws issued as %u instanced draws, "
+              "built in %.3f ms",
+              draw_count,
+              queue.batch_count,
+              clock.elapsed_time * 1000.0);
+
+    return true;
+}
+
+void
+render_queue_register_tests()
+{
+    test_arena = arena_create(256 * MiB);
+
+    test_manager_register_test(test_radix_sort_is_stable,
+                               "Render queue: radix sort is stable");
+    test_manager_register_test(test_radix_sort_keeps_pairs,
+                               "Render queue: radix sort keeps pairs");
+    test_manager_register_test(test_key_order, "Render queue: key order");
+    test_manager_register_test(test_build_batches,
+                               "Render queue: build batches");
+    test_manager_register_test(test_layout_draw_call_reduction,
+                               "Render queue: layout draw call reduction");
+}
@@ -0,0 +1,450 @@
+#include "image_loader_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/logger.hpp>
+#include <core/thread_context.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <platform/filesystem.hpp>
+
+#ifdef DEBUG_BUILD
+#    include <memory/arena_debug.hpp>
+#endif
+#include <platform/platform.hpp>
+#include <resources/loaders/image_loader.hpp>
+#include <systems/job_system.hpp>
+#include <utils/string.hpp>
+
+static Arena *test_arena = nullptr;
+
+// 2x2 RGBA, top row red and half transparent green, bottom row blue and white
+internal_var const u8 RGBA_PNG[] = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x08, 0x06, 0x00, 0x00, 0x00, 0x72, 0xB6, 0x0D, 0x24, 0x00, 0x00, 0x00,
+    0x14, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0xF8, 0xCF, 0xC0, 0xF0,
+    0x1F, 0x08, 0x1B, 0x18, 0x80, 0x34, 0x18, 0x00, 0x00, 0x44, 0xD2, 0x09,
+    0x78, 0x66, 0x53, 0xC4, 0x70, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E,
+    0x44, 0xAE, 0x42, 0x60, 0x82};
+
+// The same colors as RGB, all opaque
+internal_var const u8 RGB_PNG[] = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x08, 0x02, 0x00, 0x00, 0x00, 0xFD, 0xD4, 0x9A, 0x73, 0x00, 0x00, 0x00,
+    0x12, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0xF8, 0xCF, 0xC0, 0xC0,
+    0x00, 0xC2, 0x0C, 0xFF, 0x81, 0x00, 0x00, 0x1F, 0xEE, 0x05, 0xFB, 0xF1,
+    0xAB, 0xBA, 0x77, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE,
+    0x42, 0x60, 0x82};
+
+// The textures of the assets folder
+internal_var const char *ASSET_TEXTURES[] = {"metal",
+                                             "space_parallax",
+                                             "yellow_track",
+                                             "voltrum_icon",
+                                             "window_close_icon",
+                                             "window_maximize_icon",
+                                             "window_minimize_icon",
+                                             "window_restore_icon"};
+
+INTERNAL_FUNC u32
+pixel_at(const Image_Resource_Data *image, u32 x, u32 y)
+{
+    const u8 *pixel = image->pixels + (y * image->width + x) * 4;
+    return (u32)pixel[0] << 24 | (u32)pixel[1] << 16 | (u32)pixel[2] << 8 |
+           pixel[3];
+}
+
+INTERNAL_FUNC b8
+is_inside_arena(const Arena *arena, const void *pointer)
+{
+    const u8 *base = static_cast<const u8 *>(arena->memory);
+    return pointer >= base && pointer < base + arena->offset;
+}
+
+INTERNAL_FUNC u8
+test_decode_into_arena()
+{
+    arena_clear(test_arena);
+
+    Image_Resource_Data image  = {};
+    b8                  result = image_loader_decode(test_arena,
+                                                     RGBA_PNG,
+                                                     sizeof(RGBA_PNG),
+                                                     false,
+                                                     &image);
+
+    expect_should_be(true, result);
+    expect_should_be(2, image.width);
+    expect_should_be(2, image.height);
+    expect_should_be(4, image.channel_count);
+    expect_should_be(true, is_inside_arena(test_arena, image.pixels));
+    expect_should_be(0, (u64)image.pixels % 16);
+
+    expect_should_be(0xFF0000FFu, pixel_at(&image, 0, 0));
+    expect_should_be(0x00FF0080u, pixel_at(&image, 1, 0));
+    expect_should_be(0x0000FFFFu, pixel_at(&image, 0, 1));
+    expect_should_be(0xFFFFFFFFu, pixel_at(&image, 1, 1));
+    expect_should_be(true, image_has_transparency(&image));
+
+    // Textures are flipped, and RGB sources gain an opaque alpha
+    result =
+        image_loader_decode(test_arena, RGB_PNG, sizeof(RGB_PNG), true, &image);
+
+    expect_should_be(true, result);
+    expect_should_be(0x0000FFFFu, pixel_at(&image, 0, 0));
+    expect_should_be(0xFF0000FFu, pixel_at(&image, 0, 1));
+    expect_should_be(0x00FF00FFu, pixel_at(&image, 1, 1));
+    expect_should_be(false, image_has_transparency(&image));
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_failed_decode_restores_arena()
+{
+    arena_clear(test_arena);
+    push_array(test_arena, u8, 100);
+
+    u64 position = test_arena->offset;
+
+    // A valid header followed by a truncated stream
+    Image_Resource_Data image = {};
+    b8 result = image_loader_decode(test_arena, RGBA_PNG, 50, false, &image);
+
+    expect_should_be(false, result);
+    expect_should_be(position, test_arena->offset);
+
+    u8 garbage[64];
+    for (u32 i = 0; i < sizeof(garbage); ++i)
+        garbage[i] = (u8)(i * 37);
+
+    result = image_loader_decode(test_arena,
+                                 garbage,
+                                 sizeof(garbage),
+                                 false,
+                                 &image);
+
+    expect_should_be(false, result);
+    expect_should_be(position, test_arena->offset);
+
+    return true;
+}
+
+INTERNAL_FUNC b8
+scan_transparency_scalar(const Image_Resource_Data *image)
+{
+    u64 size = (u64)image->width * image->height * 4;
+
+    for (u64 i = 0; i < size; i += 4)
+    {
+        if (image->pixels[i + 3] < 255)
+            return true;
+    }
+
+    return false;
+}
+
+// The vector scan handles blocks, the pixels left over go through the
+// scalar loop, so one transparent pixel is moved across both
+INTERNAL_FUNC u8
+test_transparency_scan_matches_scalar()
+{
+    arena_clear(test_arena);
+
+    u32 widths[] = {1, 3, 63, 64, 65, 200, 1031};
+    u32 seed     = 12345;
+
+    for (u32 w = 0; w < ARRAY_COUNT(widths); ++w)
+    {
+        Image_Resource_Data image = {};
+        image.width               = widths[w];
+        image.height              = 3;
+        image.channel_count       = 4;
+
+        u64 pixel_count = (u64)image.width * image.height;
+        image.pixels    = push_array(test_arena, u8, pixel_count * 4);
+
+        for (u64 i = 0; i < pixel_count * 4; ++i)
+        {
+            seed            = seed * 1664525 + 1013904223;
+            image.pixels[i] = (i % 4 == 3) ? 255 : (u8)(seed >> 24);
+        }
+
+        expect_should_be(false, image_has_transparency(&image));
+
+        for (u64 p = 0; p < pixel_count; p += 1 + p / 3)
+        {
+            u8 alpha = (u8)(p % 255);
+
+            image.pixels[p * 4 + 3] = alpha;
+            expect_should_be(scan_transparency_scalar(&image),
+                             image_has_transparency(&image));
+            image.pixels[p * 4 + 3] = 255;
+        }
+    }
+
+    return true;
+}
+
+struct Decode_Benchmark_Job
+{
+    const File_Mapping *mapping;
+    Arena              *arena;
+    b8                  succeeded;
+};
+
+INTERNAL_FUNC void
+decode_benchmark_job(void *data)
+{
+    auto *job = (Decode_Benchmark_Job *)data;
+
+    Image_Resource_Data image;
+    job->succeeded = image_loader_decode(job->arena,
+                                         job->mapping->data,
+                                         job->mapping->size,
+                                         true,
+                                         &image);
+}
+
+// Like the texture streaming jobs, the arena is created on the worker and
+// released later by the main thread
+INTERNAL_FUNC void
+decode_into_worker_arena_job(void *data)
+{
+    auto *job = (Decode_Benchmark_Job *)data;
+
+    job->arena = arena_create(1 * MiB);
+
+    Image_Resource_Data image;
+    job->succeeded = image_loader_decode(
+        job->arena, RGBA_PNG, sizeof(RGBA_PNG), true, &image);
+}
+
+// Workers create and push to their arenas while the main thread releases the
+// finished ones. In debug builds all of them go through the debug registry
+INTERNAL_FUNC u8
+test_decode_into_worker_arenas()
+{
+    constexpr u32 job_count = 48;
+
+#ifdef DEBUG_BUILD
+    b8 owns_registry = arena_debug_get_registry() == nullptr;
+    if (owns_registry)
+        arena_debug_init();
+
+    u32 active_count = arena_debug_get_registry()->active_count;
+#endif
+
+    Job_System_Config config = {};
+    config.thread_count      = 4;
+    job_system_init(test_arena, config);
+
+    Decode_Benchmark_Job decode_jobs[job_count] = {};
+    Job_Declaration      jobs[job_count];
+
+    for (u32 i = 0; i < job_count; ++i)
+    {
+        jobs[i]       = {};
+        jobs[i].entry = decode_into_worker_arena_job;
+        jobs[i].data  = &decode_jobs[i];
+    }
+
+    // Two batches, the first one is released while the second one decodes
+    Job_Counter first = {};
+    job_system_run(jobs, job_count / 2, &first);
+    job_system_wait(&first);
+
+    Job_Counter second = {};
+    job_system_run(&jobs[job_count / 2], job_count / 2, &second);
+
+    for (u32 i = 0; i < job_count / 2; ++i)
+        arena_release(decode_jobs[i].arena);
+
+    job_system_wait(&second);
+    job_system_shutdown();
+
+    for (u32 i = job_count / 2; i < job_count; ++i)
+        arena_release(decode_jobs[i].arena);
+
+    b8 succeeded = true;
+    for (u32 i = 0; i < job_count; ++i)
+        succeeded = succeeded && decode_jobs[i].succeeded;
+
+    expect_should_be(true, succeeded);
+
+#ifdef DEBUG_BUILD
+    expect_should_be(active_count, arena_debug_get_registry()->active_count);
+
+    if (owns_registry)
+        arena_debug_shutdown();
+#endif
+
+    return true;
+}
+
+INTERNAL_FUNC f64
+megabytes_per_second(u64 bytes, f64 seconds)
+{
+    return seconds > 0.0 ? bytes / (1000.0 * 1000.0) / seconds : 0.0;
+}
+
+INTERNAL_FUNC u8
+test_decode_throughput_benchmark()
+{
+#ifndef VOLTRUM_TESTS_ASSETS_PATH
+    return BYPASS;
+#else
+    constexpr u32 repeat_count  = 8;
+    constexpr u32 texture_count = ARRAY_COUNT(ASSET_TEXTURES);
+
+    arena_clear(test_arena);
+
+    File_Mapping mappings[texture_count];
+
+    u64 encoded_size = 0;
+    u64 decoded_size = 0;
+    f64 map_time     = 0.0;
+    f64 decode_time  = 0.0;
+    f64 scan_time    = 0.0;
+
+    Arena *decode_arena = arena_create(256 * MiB);
+
+    for (u32 i = 0; i < texture_count; ++i)
+    {
+        String path = string_fmt(test_arena,
+                                 "%s/textures/%s.png",
+                                 VOLTRUM_TESTS_ASSETS_PATH,
+                                 ASSET_TEXTURES[i]);
+
+        f64 start = platform_get_absolute_time();
+
+        if (!filesystem_map((const char *)path.buff, &mappings[i]))
+        {
+            for (u32 j = 0; j < i; ++j)
+                filesystem_unmap(&mappings[j]);
+
+            arena_release(decode_arena);
+            return BYPASS;
+        }
+
+        // Touch every page, mapping alone does not read the file
+        volatile u8 touched = 0;
+        for (u64 b = 0; b < mappings[i].size; b += 4096)
+            touched = touched ^ mappings[i].data[b];
+
+        map_time     += platform_get_absolute_time() - start;
+        encoded_size += mappings[i].size;
+
+        for (u32 r = 0; r < repeat_count; ++r)
+        {
+            arena_clear(decode_arena);
+
+            Image_Resource_Data image;
+
+            start = platform_get_absolute_time();
+            expect_should_be(true,
+                             image_loader_decode(decode_arena,
+                                                 mappings[i].data,
+                                                 mappings[i].size,
+                                                 true,
+                                                 &image));
+            f64 decoded = platform_get_absolute_time();
+
+            volatile b8 has_transparency = image_has_transparency(&image);
+            (void)has_transparency;
+
+            scan_time   += platform_get_absolute_time() - decoded;
+            decode_time += decoded - start;
+
+            decoded_size += (u64)image.width * image.height * 4;
+        }
+    }
+
+    arena_release(decode_arena);
+
+    CORE_INFO("Image stages on %u textures, %.2f MB encoded: read %.1f MB/s, "
+              "decode %.1f MB/s, transparency scan %.1f MB/s",
+              texture_count,
+              encoded_size / (1000.0 * 1000.0),
+              megabytes_per_second(encoded_size, map_time),
+              megabytes_per_second(decoded_size, decode_time),
+              megabytes_per_second(decoded_size, scan_time));
+
+    // The same decodes as one batch, one job per image
+    constexpr u32 job_count       = texture_count * repeat_count;
+    u32           thread_counts[] = {1, 4};
+
+    for (u32 t = 0; t < ARRAY_COUNT(thread_counts); ++t)
+    {
+        Job_System_Config config = {};
+        config.thread_count      = thread_counts[t];
+        job_system_init(test_arena, config);
+
+        Decode_Benchmark_Job benchmark_jobs[job_count];
+        Job_Declaration      jobs[job_count];
+
+        for (u32 i = 0; i < job_count; ++i)
+        {
+            benchmark_jobs[i].mapping   = &mappings[i % texture_count];
+            benchmark_jobs[i].arena     = arena_create(64 * MiB);
+            benchmark_jobs[i].succeeded = false;
+
+            jobs[i]       = {};
+            jobs[i].entry = decode_benchmark_job;
+            jobs[i].data  = &benchmark_jobs[i];
+        }
+
+        Job_Counter counter = {};
+
+        f64 start = platform_get_absolute_time();
+        job_system_run(jobs, job_count, &counter);
+        job_system_wait(&counter);
+        f64 elapsed = platform_get_absolute_time() - start;
+
+        job_system_shutdown();
+
+        for (u32 i = 0; i < job_count; ++i)
+        {
+            arena_release(benchmark_jobs[i].arena);
+            expect_should_be(true, benchmark_jobs[i].succeeded);
+        }
+
+        CORE_INFO("Batch decode with %u threads: %.3f ms, %.1f MB/s",
+                  thread_counts[t],
+                  elapsed * 1000.0,
+                  megabytes_per_second(decoded_size, elapsed));
+    }
+
+    for (u32 i = 0; i < texture_count; ++i)
+        filesystem_unmap(&mappings[i]);
+
+    return true;
+#endif
+}
+
+void
+image_loader_register_tests()
+{
+    test_arena = arena_create(64 * MiB);
+
+    // The job system uses the scratch arenas of the caller
+    if (!thread_context_selected())
+    {
+        Thread_Context *context = thread_context_allocate();
+        context->thread_name    = "Test main thread";
+        thread_context_select(context);
+    }
+
+    test_manager_register_test(test_decode_into_arena,
+                               "Image loader: decodes into the arena");
+    test_manager_register_test(test_failed_decode_restores_arena,
+                               "Image loader: failed decode restores arena");
+    test_manager_register_test(test_transparency_scan_matches_scalar,
+                               "Image loader: SIMD transparency scan");
+    test_manager_register_test(test_decode_into_worker_arenas,
+                               "Image loader: decodes into worker arenas");
+    test_manager_register_test(test_decode_throughput_benchmark,
+                               "Image loader: decode throughput benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void image_loader_register_tests();
@@ -0,0 +1,429 @@
+#include "resource_archive_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+#include <platform/filesystem.hpp>
+#include <platform/platform.hpp>
+#include <resources/loaders/image_loader.hpp>
+#include <resources/resource_archive.hpp>
+#include <systems/resource_system.hpp>
+#include <utils/string.hpp>
+
+#include <stdio.h>
+
+static Arena *test_arena = nullptr;
+
+// Written to the working directory and removed by the tests
+#define TEST_ARCHIVE_PATH "resource_archive_test" RESOURCE_ARCHIVE_EXTENSION
+
+// Every asset the application loads through the resource system, the shaders
+// are packed as their sources since the SPIR-V is built by post-build.sh
+internal_var const Resource_Pack_Item ASSET_ITEMS[] = {
+    {"shaders/Builtin.MaterialShader.vert.glsl", Resource_Type::TEXT},
+    {"shaders/Builtin.MaterialShader.frag.glsl", Resource_Type::TEXT},
+    {"shaders/Builtin.GridShader.vert.glsl", Resource_Type::TEXT},
+    {"shaders/Builtin.GridShader.frag.glsl", Resource_Type::TEXT},
+    {"jetbrains/jetbrains_normal", Resource_Type::FONT},
+    {"jetbrains/jetbrains_italic", Resource_Type::FONT},
+    {"jetbrains/jetbrains_bold_normal", Resource_Type::FONT},
+    {"jetbrains/jetbrains_bold_italic", Resource_Type::FONT},
+    {"fontawesome/fontawesome_normal", Resource_Type::FONT},
+    {"metal", Resource_Type::IMAGE},
+    {"space_parallax", Resource_Type::IMAGE},
+    {"yellow_track", Resource_Type::IMAGE},
+    {"window_close_icon", Resource_Type::IMAGE},
+    {"window_maximize_icon", Resource_Type::IMAGE},
+    {"window_minimize_icon", Resource_Type::IMAGE},
+    {"window_restore_icon", Resource_Type::IMAGE},
+    {"voltrum", Resource_Type::ICON},
+};
+
+INTERNAL_FUNC b8
+bytes_match(const void *a, const void *b, u64 size)
+{
+    const u8 *x = (const u8 *)a;
+    const u8 *y = (const u8 *)b;
+
+    for (u64 i = 0; i < size; ++i)
+    {
+        if (x[i] != y[i])
+            return false;
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC b8
+is_in_mapping(const Resource_Archive *archive, const void *data, u64 size)
+{
+    const u8 *begin = archive->mapping.data;
+    const u8 *end   = begin + archive->mapping.size;
+
+    return (const u8 *)data >= begin && (const u8 *)data + size <= end;
+}
+
+INTERNAL_FUNC u8
+test_archive_round_trip()
+{
+    arena_clear(test_arena);
+
+    const char text[]   = "#version 450\nvoid main() {}\n";
+    u8         binary[] = {0x03, 0x02, 0x23, 0x07, 0x00, 0x00, 0x01, 0x00,
+                           0x0B, 0x00, 0x08, 0x00, 0x1F, 0x00, 0x00, 0x00,
+                           0x00, 0x00, 0x00, 0x00, 0xFF};
+
+    // The same name can be packed once per type
+    Resource_Archive_Blob blobs[] = {
+        {Resource_Type::TEXT, "shaders/a.glsl", text, sizeof(text) - 1},
+        {Resource_Type::BINARY, "shaders/a.spv", binary, sizeof(binary)},
+        {Resource_Type::FONT, "shaders/a.spv", binary, 7},
+        {Resource_Type::BINARY, "empty", binary, 0},
+    };
+
+    if (!resource_archive_write(test_arena,
+                                TEST_ARCHIVE_PATH,
+                                blobs,
+                                ARRAY_COUNT(blobs)))
+    {
+        return BYPASS;
+    }
+
+    Resource_Archive archive;
+    expect_should_be(true, resource_archive_open(TEST_ARCHIVE_PATH, &archive));
+    expect_should_be(ARRAY_COUNT(blobs), archive.entry_count);
+
+    for (u32 i = 0; i < ARRAY_COUNT(blobs); ++i)
+    {
+        const Resource_Archive_Entry *entry =
+            resource_archive_find(&archive, blobs[i].type, blobs[i].name);
+
+        expect_should_not_be(nullptr, entry);
+        expect_should_be((u8)blobs[i].type, (u8)entry->type);
+        expect_should_be(blobs[i].size, entry->size);
+
+        const u8 *data = resource_archive_data(&archive, entry);
+
+        // Aligned, in place and terminated
+        expect_should_be(0, (u64)data % RESOURCE_ARCHIVE_DATA_ALIGNMENT);
+        expect_should_be(true, is_in_mapping(&archive, data, entry->size + 1));
+        expect_should_be(true, bytes_match(blobs[i].data, data, entry->size));
+        expect_should_be(0, data[entry->size]);
+    }
+
+    expect_should_be(
+        nullptr,
+        resource_archive_find(&archive, Resource_Type::TEXT, "shaders/a.spv"));
+    expect_should_be(
+        nullptr,
+        resource_archive_find(&archive, Resource_Type::BINARY, "missing"));
+
+    resource_archive_close(&archive);
+    expect_should_be(nullptr, archive.mapping.data);
+
+    // Duplicates are refused
+    Resource_Archive_Blob duplicates[] = {
+        {Resource_Type::TEXT, "a", text, 4},
+        {Resource_Type::TEXT, "a", text, 8},
+    };
+
+    expect_should_be(false,
+                     resource_archive_write(test_arena,
+                                            TEST_ARCHIVE_PATH,
+                                            duplicates,
+                                            ARRAY_COUNT(duplicates)));
+
+    // An archive cut short is rejected
+    expect_should_be(true,
+                     resource_archive_write(test_arena,
+                                            TEST_ARCHIVE_PATH,
+                                            blobs,
+                                            ARRAY_COUNT(blobs)));
+
+    File_Mapping mapping;
+    expect_should_be(true, filesystem_map(TEST_ARCHIVE_PATH, &mapping));
+
+    u64 truncated_size = mapping.size - 24;
+    u8 *truncated      = push_array(test_arena, u8, truncated_size);
+    memory_copy(truncated, mapping.data, truncated_size);
+    filesystem_unmap(&mapping);
+
+    File_Handle file;
+    u64         written = 0;
+    expect_should_be(true,
+                     filesystem_open(TEST_ARCHIVE_PATH,
+                                     File_Modes::WRITE,
+                                     true,
+                                     &file));
+    filesystem_write(&file, truncated_size, truncated, &written);
+    filesystem_close(&file);
+
+    expect_should_be(false,
+                     resource_archive_open(TEST_ARCHIVE_PATH, &archive));
+
+    remove(TEST_ARCHIVE_PATH);
+
+    return true;
+}
+
+// Resources missing from the archive come from the loose files
+INTERNAL_FUNC u8
+test_archive_fallback()
+{
+#ifndef VOLTRUM_TESTS_ASSETS_PATH
+    return BYPASS;
+#else
+    arena_clear(test_arena);
+
+    Resource_System_Config config = {};
+    config.asset_base_path        = VOLTRUM_TESTS_ASSETS_PATH;
+    config.archive_path           = TEST_ARCHIVE_PATH;
+
+    remove(TEST_ARCHIVE_PATH);
+    resource_system_init(test_arena, config);
+
+    Resource_Pack_Item items[] = {
+        {"shaders/Builtin.GridShader.vert.glsl", Resource_Type::TEXT},
+        {"voltrum", Resource_Type::ICON},
+    };
+
+    b8 packed = resource_system_pack(test_arena,
+                                     TEST_ARCHIVE_PATH,
+                                     items,
+                                     ARRAY_COUNT(items));
+    resource_system_shutdown();
+
+    if (!packed)
+        return BYPASS;
+
+    Resource_System_State *state = resource_system_init(test_arena, config);
+    expect_should_not_be(nullptr, state->archive.mapping.data);
+
+    Resource packed_text;
+    Resource packed_icon;
+    Resource loose_text;
+    Resource loose_image;
+
+    expect_should_be(true,
+                     resource_system_load(test_arena,
+                                          items[0].name,
+                                          Resource_Type::TEXT,
+                                          &packed_text));
+    expect_should_be(true,
+                     resource_system_load(test_arena,
+                                          items[1].name,
+                                          Resource_Type::ICON,
+                                          &packed_icon));
+
+    // Not packed
+    const char *loose_name = "shaders/Builtin.GridShader.frag.glsl";
+
+    expect_should_be(true,
+                     resource_system_load(test_arena,
+                                          loose_name,
+                                          Resource_Type::TEXT,
+                                          &loose_text));
+    expect_should_be(true,
+                     resource_system_load(test_arena,
+                                          "metal",
+                                          Resource_Type::IMAGE,
+                                          &loose_image));
+
+    expect_should_be(true,
+                     is_in_mapping(&state->archive,
+                                   packed_text.data,
+                                   packed_text.data_size));
+    expect_should_be(false,
+                     is_in_mapping(&state->archive, loose_text.data, 1));
+
+    // The text is terminated like the text loader does
+    expect_should_be(packed_text.data_size,
+                     STR((const char *)packed_text.data).size);
+
+    auto *icon  = static_cast<Image_Resource_Data *>(packed_icon.data);
+    auto *image = static_cast<Image_Resource_Data *>(loose_image.data);
+
+    expect_should_be(false, is_in_mapping(&state->archive, image->pixels, 1));
+
+    // The icon is stored decoded, without the vertical flip
+    Image_Resource_Data decoded;
+    expect_should_be(true,
+                     image_loader_decode_file(test_arena,
+                                              VOLTRUM_TESTS_ASSETS_PATH
+                                              "/icons/voltrum.png",
+                                              false,
+                                              &decoded));
+
+    u64 pixels_size = (u64)decoded.width * decoded.height * 4;
+
+    expect_should_be(4, icon->channel_count);
+    expect_should_be(decoded.width, icon->width);
+    expect_should_be(decoded.height, icon->height);
+    expect_should_be(true,
+                     is_in_mapping(&state->archive, icon->pixels, pixels_size));
+    expect_should_be(true,
+                     bytes_match(decoded.pixels, icon->pixels, pixels_size));
+
+    resource_system_shutdown();
+    remove(TEST_ARCHIVE_PATH);
+
+    return true;
+#endif
+}
+
+enum Asset_Category : u8
+{
+    ASSET_SHADERS,
+    ASSET_FONTS,
+    ASSET_TEXTURES,
+    ASSET_CATEGORY_COUNT
+};
+
+INTERNAL_FUNC Asset_Category
+asset_category(Resource_Type type)
+{
+    switch (type)
+    {
+        case Resource_Type::TEXT:
+        case Resource_Type::BINARY:
+            return ASSET_SHADERS;
+        case Resource_Type::FONT:
+            return ASSET_FONTS;
+        default:
+            return ASSET_TEXTURES;
+    }
+}
+
+// Loads every asset and reads one byte of each page, like the uploads do.
+// The time is added to the category of each asset
+INTERNAL_FUNC b8
+load_assets(Arena *arena, f64 *times)
+{
+    for (u32 i = 0; i < ARRAY_COUNT(ASSET_ITEMS); ++i)
+    {
+        const Resource_Pack_Item *item = &ASSET_ITEMS[i];
+
+        f64 start = platform_get_absolute_time();
+
+        Resource resource;
+        if (!resource_system_load(arena, item->name, item->type, &resource))
+            return false;
+
+        const u8 *data = (const u8 *)resource.data;
+        u64       size = resource.data_size;
+
+        if (item->type == Resource_Type::IMAGE ||
+            item->type == Resource_Type::ICON)
+        {
+            auto *image = static_cast<Image_Resource_Data *>(resource.data);
+
+            data = image->pixels;
+            size = (u64)image->width * image->height * image->channel_count;
+        }
+
+        volatile u8 touched = 0;
+        for (u64 b = 0; b < size; b += 4096)
+            touched = touched ^ data[b];
+
+        f64 time = platform_get_absolute_time() - start;
+        times[asset_category(item->type)] += time;
+    }
+
+    return true;
+}
+
+// Loose loads open, read and decode every file. Cold archive loads map the
+// archive first, warm loads go through the mapping that is already open
+INTERNAL_FUNC u8
+test_archive_load_benchmark()
+{
+#ifndef VOLTRUM_TESTS_ASSETS_PATH
+    return BYPASS;
+#else
+    constexpr u32 repeat_count = 4;
+
+    arena_clear(test_arena);
+
+    Resource_System_Config loose_config = {};
+    loose_config.asset_base_path        = VOLTRUM_TESTS_ASSETS_PATH;
+
+    Resource_System_Config archive_config = loose_config;
+    archive_config.archive_path           = TEST_ARCHIVE_PATH;
+
+    resource_system_init(test_arena, loose_config);
+    b8 packed = resource_system_pack(test_arena,
+                                     TEST_ARCHIVE_PATH,
+                                     ASSET_ITEMS,
+                                     ARRAY_COUNT(ASSET_ITEMS));
+    resource_system_shutdown();
+
+    if (!packed)
+        return BYPASS;
+
+    f64 loose_times[ASSET_CATEGORY_COUNT] = {};
+    f64 cold_times[ASSET_CATEGORY_COUNT]  = {};
+    f64 warm_times[ASSET_CATEGORY_COUNT]  = {};
+    f64 open_time                         = 0.0;
+
+    for (u32 r = 0; r < repeat_count; ++r)
+    {
+        Arena *arena = arena_create(256 * MiB);
+
+        resource_system_init(arena, loose_config);
+        expect_should_be(true, load_assets(arena, loose_times));
+        resource_system_shutdown();
+
+        arena_clear(arena);
+
+        f64 start = platform_get_absolute_time();
+
+        Resource_System_State *state =
+            resource_system_init(arena, archive_config);
+        open_time += platform_get_absolute_time() - start;
+
+        expect_should_be(ARRAY_COUNT(ASSET_ITEMS), state->archive.entry_count);
+
+        expect_should_be(true, load_assets(arena, cold_times));
+        expect_should_be(true, load_assets(arena, warm_times));
+
+        resource_system_shutdown();
+        arena_release(arena);
+    }
+
+    remove(TEST_ARCHIVE_PATH);
+
+    const char *names[ASSET_CATEGORY_COUNT] = {"shaders", "fonts", "textures"};
+
+    CORE_INFO("Resource archive of %u assets opened in %.3f ms",
+              (u32)ARRAY_COUNT(ASSET_ITEMS),
+              open_time * 1000.0 / repeat_count);
+
+    for (u32 c = 0; c < ASSET_CATEGORY_COUNT; ++c)
+    {
+        CORE_INFO("Resource loads of the %s: loose %.3f ms, archive cold "
+                  "%.3f ms, archive warm %.3f ms",
+                  names[c],
+                  loose_times[c] * 1000.0 / repeat_count,
+                  cold_times[c] * 1000.0 / repeat_count,
+                  warm_times[c] * 1000.0 / repeat_count);
+    }
+
+    return true;
+#endif
+}
+
+void
+resource_archive_register_tests()
+{
+    test_arena = arena_create(64 * MiB);
+
+    test_manager_register_test(test_archive_round_trip,
+                               "Resource archive: write and open round trip");
+    test_manager_register_test(test_archive_fallback,
+                               "Resource archive: fallback to loose files");
+    test_manager_register_test(test_archive_load_benchmark,
+                               "Resource archive: cold/warm load benchmark");
+}
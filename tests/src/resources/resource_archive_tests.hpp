@@ -0,0 +1,3 @@
+#pragma once
+
+void resource_archive_register_tests();
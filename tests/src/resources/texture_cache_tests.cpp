@@ -0,0 +1,593 @@
+#include "texture_cache_tests.hpp"
+#include "expect.hpp"
+#include "test_manager.hpp"
+
+#include <core/logger.hpp>
+#include <defines.hpp>
+#include <memory/arena.hpp>
+#include <memory/memory.hpp>
+#include <platform/filesystem.hpp>
+#include <platform/platform.hpp>
+#include <resources/texture_cache.hpp>
+#include <utils/string.hpp>
+
+#include <stdio.h>
+
+static Arena *test_arena = nullptr;
+
+// Written to the working directory and removed by the test
+#define TEST_CACHE_PATH "texture_cache_test" TEXTURE_CACHE_EXTENSION
+
+// The textures of the scene in the assets folder, the icons are UI textures
+// that are not cooked
+internal_var const char *ASSET_TEXTURES[] = {"metal",
+                                             "space_parallax",
+                                             "yellow_track"};
+
+INTERNAL_FUNC u32
+next_random(u32 *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+// Smooth gradients with some noise, which is what the blocks of a texture
+// usually look like. They flatten out past 64 texels
+INTERNAL_FUNC Image_Resource_Data
+make_image(u32 width, u32 height, b8 has_transparency, u32 seed)
+{
+    Image_Resource_Data image = {};
+    image.width               = width;
+    image.height              = height;
+    image.channel_count       = 4;
+    image.pixels = push_array(test_arena, u8, (u64)width * height * 4);
+
+    for (u32 y = 0; y < height; ++y)
+    {
+        for (u32 x = 0; x < width; ++x)
+        {
+            u8 *pixel = image.pixels + ((u64)y * width + x) * 4;
+            u32 noise = next_random(&seed) % 9;
+
+            pixel[0] = (u8)MIN(255u, x * 4 + noise);
+            pixel[1] = (u8)MIN(255u, y * 4 + noise);
+            pixel[2] = (u8)MIN(255u, (x + y) * 2 + noise);
+            pixel[3] = has_transparency ? (u8)MIN(255u, x * 4) : 255;
+        }
+    }
+
+    return image;
+}
+
+INTERNAL_FUNC b8
+bytes_match(const u8 *a, const u8 *b, u64 size)
+{
+    for (u64 i = 0; i < size; ++i)
+    {
+        if (a[i] != b[i])
+            return false;
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC void
+downsample_scalar(const u8 *pixels, u32 width, u32 height, u8 *out)
+{
+    u32 out_width  = MAX(1u, width / 2);
+    u32 out_height = MAX(1u, height / 2);
+
+    for (u32 y = 0; y < out_height; ++y)
+    {
+        for (u32 x = 0; x < out_width; ++x)
+        {
+            u32 x_0 = MIN(x * 2, width - 1);
+            u32 x_1 = MIN(x * 2 + 1, width - 1);
+            u32 y_0 = MIN(y * 2, height - 1);
+            u32 y_1 = MIN(y * 2 + 1, height - 1);
+
+            for (u32 c = 0; c < 4; ++c)
+            {
+                u32 sum = pixels[((u64)y_0 * width + x_0) * 4 + c] +
+                          pixels[((u64)y_0 * width + x_1) * 4 + c] +
+                          pixels[((u64)y_1 * width + x_0) * 4 + c] +
+                          pixels[((u64)y_1 * width + x_1) * 4 + c];
+
+                out[((u64)y * out_width + x) * 4 + c] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+INTERNAL_FUNC u8
+test_mip_chain()
+{
+    arena_clear(test_arena);
+
+    expect_should_be(1, texture_mip_count(1, 1));
+    expect_should_be(9, texture_mip_count(256, 64));
+    expect_should_be(3, texture_mip_count(5, 3));
+    expect_should_be(11, texture_mip_count(1, 1024));
+
+    expect_should_be(64, texture_format_size(Texture_Format::RGBA8, 4, 4));
+    expect_should_be(8, texture_format_size(Texture_Format::BC1, 1, 1));
+    expect_should_be(16 * 6, texture_format_size(Texture_Format::BC3, 9, 5));
+
+    // Odd sizes and widths around the four pixels of the vector path
+    u32 sizes[][2] = {
+        {1, 1}, {1, 7}, {7, 1}, {8, 8}, {9, 3}, {37, 5}, {64, 64}};
+
+    for (u32 s = 0; s < ARRAY_COUNT(sizes); ++s)
+    {
+        u32 width  = sizes[s][0];
+        u32 height = sizes[s][1];
+        u64 size   = (u64)MAX(1u, width / 2) * MAX(1u, height / 2) * 4;
+
+        Image_Resource_Data image = make_image(width, height, true, s + 1);
+
+        u8 *result   = push_array(test_arena, u8, size);
+        u8 *expected = push_array(test_arena, u8, size);
+
+        texture_downsample(image.pixels, width, height, result);
+        downsample_scalar(image.pixels, width, height, expected);
+
+        expect_should_be(true, bytes_match(result, expected, size));
+    }
+
+    // Every level of the chain halves the one above it
+    Image_Resource_Data image = make_image(40, 12, false, 7);
+
+    Cooked_Texture texture;
+    texture_cook(test_arena, &image, false, &texture);
+
+    expect_should_be((u8)Texture_Format::RGBA8, (u8)texture.format);
+    expect_should_be(6, texture.mip_count);
+    expect_should_be(image.pixels, texture.mips[0].data);
+
+    u32 expected_sizes[][2] = {{40, 12}, {20, 6}, {10, 3}, {5, 1}, {2, 1}};
+
+    for (u32 i = 0; i < ARRAY_COUNT(expected_sizes); ++i)
+    {
+        expect_should_be(expected_sizes[i][0], texture.mips[i].width);
+        expect_should_be(expected_sizes[i][1], texture.mips[i].height);
+    }
+
+    expect_should_be(1, texture.mips[5].width);
+    expect_should_be(1, texture.mips[5].height);
+    expect_should_be(4, texture.mips[5].size);
+
+    return true;
+}
+
+INTERNAL_FUNC void
+unpack_565(u16 packed, s32 *out_color)
+{
+    s32 r = (packed >> 11) & 31;
+    s32 g = (packed >> 5) & 63;
+    s32 b = packed & 31;
+
+    out_color[0] = (r << 3) | (r >> 2);
+    out_color[1] = (g << 2) | (g >> 4);
+    out_color[2] = (b << 3) | (b >> 2);
+}
+
+// Reference decoders of the four color mode and the eight alpha mode
+INTERNAL_FUNC void
+decode_color_block(const u8 *block, u8 *out_texels)
+{
+    u16 color_0;
+    u16 color_1;
+    u32 indices;
+    memory_copy(&color_0, block, sizeof(u16));
+    memory_copy(&color_1, block + 2, sizeof(u16));
+    memory_copy(&indices, block + 4, sizeof(u32));
+
+    s32 palette[4][3];
+    unpack_565(color_0, palette[0]);
+    unpack_565(color_1, palette[1]);
+
+    for (u32 c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        u32 index = (indices >> (i * 2)) & 3;
+
+        for (u32 c = 0; c < 3; ++c)
+            out_texels[i * 4 + c] = (u8)palette[index][c];
+    }
+}
+
+INTERNAL_FUNC void
+decode_alpha_block(const u8 *block, u8 *out_texels)
+{
+    s32 palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+
+    for (s32 p = 2; p < 8; ++p)
+        palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7;
+
+    u64 indices = 0;
+    for (u32 i = 0; i < 6; ++i)
+        indices |= (u64)block[2 + i] << (i * 8);
+
+    for (u32 i = 0; i < 16; ++i)
+        out_texels[i * 4 + 3] = (u8)palette[(indices >> (i * 3)) & 7];
+}
+
+// Largest and average error of each channel against the source, over the
+// texels inside the image
+INTERNAL_FUNC void
+measure_block_error(const Image_Resource_Data *image,
+                    const u8                  *blocks,
+                    b8                         has_alpha,
+                    s32                       *out_max_error,
+                    f64                       *out_mean_error)
+{
+    u32 block_width  = (image->width + 3) / 4;
+    u32 block_height = (image->height + 3) / 4;
+    u32 block_size   = has_alpha ? 16 : 8;
+
+    s32 max_error   = 0;
+    u64 total_error = 0;
+    u64 count       = 0;
+
+    for (u32 by = 0; by < block_height; ++by)
+    {
+        for (u32 bx = 0; bx < block_width; ++bx)
+        {
+            const u8 *block =
+                blocks + ((u64)by * block_width + bx) * block_size;
+
+            u8 texels[16 * 4] = {};
+            if (has_alpha)
+            {
+                decode_alpha_block(block, texels);
+                decode_color_block(block + 8, texels);
+            }
+            else
+            {
+                decode_color_block(block, texels);
+            }
+
+            for (u32 i = 0; i < 16; ++i)
+            {
+                u32 x = bx * 4 + i % 4;
+                u32 y = by * 4 + i / 4;
+
+                if (x >= image->width || y >= image->height)
+                    continue;
+
+                const u8 *source =
+                    image->pixels + ((u64)y * image->width + x) * 4;
+
+                for (u32 c = 0; c < (has_alpha ? 4u : 3u); ++c)
+                {
+                    s32 error = (s32)texels[i * 4 + c] - source[c];
+                    error     = error < 0 ? -error : error;
+
+                    max_error = MAX(max_error, error);
+                    total_error += error;
+                    count++;
+                }
+            }
+        }
+    }
+
+    *out_max_error  = max_error;
+    *out_mean_error = (f64)total_error / count;
+}
+
+INTERNAL_FUNC u8
+test_block_encoding_error()
+{
+    arena_clear(test_arena);
+
+    // A flat color only loses the precision of 565
+    Image_Resource_Data flat = make_image(8, 8, false, 1);
+    for (u64 i = 0; i < 8 * 8; ++i)
+    {
+        flat.pixels[i * 4 + 0] = 200;
+        flat.pixels[i * 4 + 1] = 100;
+        flat.pixels[i * 4 + 2] = 50;
+    }
+
+    u8 blocks[4 * 16];
+    s32 max_error;
+    f64 mean_error;
+
+    texture_encode_bc1(flat.pixels, 8, 8, blocks);
+    measure_block_error(&flat, blocks, false, &max_error, &mean_error);
+    expect_should_be(true, max_error <= 4);
+
+    // Gradients with noise, including blocks past the edge of the image
+    u32 sizes[][2] = {{64, 64}, {30, 18}, {3, 2}};
+
+    for (u32 s = 0; s < ARRAY_COUNT(sizes); ++s)
+    {
+        u32 width  = sizes[s][0];
+        u32 height = sizes[s][1];
+
+        Image_Resource_Data opaque = make_image(width, height, false, s + 3);
+        Image_Resource_Data transparent =
+            make_image(width, height, true, s + 5);
+
+        u64 bc1_size =
+            texture_format_size(Texture_Format::BC1, width, height);
+        u64 bc3_size =
+            texture_format_size(Texture_Format::BC3, width, height);
+
+        u8 *bc1 = push_array(test_arena, u8, bc1_size);
+        u8 *bc3 = push_array(test_arena, u8, bc3_size);
+
+        texture_encode_bc1(opaque.pixels, width, height, bc1);
+        measure_block_error(&opaque, bc1, false, &max_error, &mean_error);
+
+        CORE_DEBUG("BC1 %ux%u: max error %d, mean error %.2f",
+                   width,
+                   height,
+                   max_error,
+                   mean_error);
+
+        expect_should_be(true, max_error <= 24);
+        expect_should_be(true, mean_error <= 4.0);
+
+        texture_encode_bc3(transparent.pixels, width, height, bc3);
+        measure_block_error(&transparent, bc3, true, &max_error, &mean_error);
+
+        CORE_DEBUG("BC3 %ux%u: max error %d, mean error %.2f",
+                   width,
+                   height,
+                   max_error,
+                   mean_error);
+
+        expect_should_be(true, max_error <= 24);
+        expect_should_be(true, mean_error <= 4.0);
+    }
+
+    return true;
+}
+
+INTERNAL_FUNC u8
+test_cache_round_trip()
+{
+    arena_clear(test_arena);
+
+    Image_Resource_Data image = make_image(45, 21, true, 11);
+
+    Cooked_Texture cooked;
+    texture_cook(test_arena, &image, true, &cooked);
+
+    expect_should_be((u8)Texture_Format::BC3, (u8)cooked.format);
+    expect_should_be(true, cooked.has_transparency);
+    expect_should_be(6, cooked.mip_count);
+
+    u64 source_hash = 0x1234;
+
+    if (!texture_cache_write(TEST_CACHE_PATH, source_hash, &cooked))
+        return BYPASS;
+
+    Cooked_Texture loaded;
+    expect_should_be(
+        true,
+        texture_cache_open(TEST_CACHE_PATH, source_hash, true, &loaded));
+
+    expect_should_be((u8)cooked.format, (u8)loaded.format);
+    expect_should_be(cooked.width, loaded.width);
+    expect_should_be(cooked.height, loaded.height);
+    expect_should_be(cooked.mip_count, loaded.mip_count);
+    expect_should_be(true, loaded.has_transparency);
+
+    for (u32 i = 0; i < cooked.mip_count; ++i)
+    {
+        const Texture_Mip *mip = &loaded.mips[i];
+
+        // The mips point straight into the mapping
+        expect_should_be(true,
+                         mip->data >= loaded.mapping.data &&
+                             mip->data + mip->size <=
+                                 loaded.mapping.data + loaded.mapping.size);
+        expect_should_be(0, (u64)mip->data % TEXTURE_CACHE_DATA_ALIGNMENT);
+
+        expect_should_be(cooked.mips[i].width, mip->width);
+        expect_should_be(cooked.mips[i].height, mip->height);
+        expect_should_be(cooked.mips[i].size, mip->size);
+        expect_should_be(
+            true,
+            bytes_match(cooked.mips[i].data, mip->data, mip->size));
+    }
+
+    texture_cache_close(&loaded);
+    expect_should_be(nullptr, loaded.mapping.data);
+
+    // Another source, or a renderer without block compression, cooks again
+    expect_should_be(
+        false,
+        texture_cache_open(TEST_CACHE_PATH, source_hash + 1, true, &loaded));
+    expect_should_be(
+        false,
+        texture_cache_open(TEST_CACHE_PATH, source_hash, false, &loaded));
+
+    // A container cut short is rejected
+    File_Mapping mapping;
+    expect_should_be(true, filesystem_map(TEST_CACHE_PATH, &mapping));
+
+    u64 truncated_size = mapping.size - 8;
+    u8 *truncated      = push_array(test_arena, u8, truncated_size);
+    memory_copy(truncated, mapping.data, truncated_size);
+    filesystem_unmap(&mapping);
+
+    File_Handle file;
+    u64         written = 0;
+    expect_should_be(true,
+                     filesystem_open(TEST_CACHE_PATH,
+                                     File_Modes::WRITE,
+                                     true,
+                                     &file));
+    filesystem_write(&file, truncated_size, truncated, &written);
+    filesystem_close(&file);
+
+    expect_should_be(
+        false,
+        texture_cache_open(TEST_CACHE_PATH, source_hash, true, &loaded));
+
+    remove(TEST_CACHE_PATH);
+
+    return true;
+}
+
+INTERNAL_FUNC u64
+cooked_size(const Cooked_Texture *texture)
+{
+    u64 size = 0;
+    for (u32 i = 0; i < texture->mip_count; ++i)
+        size += texture->mips[i].size;
+
+    return size;
+}
+
+// Cold loads decode, cook and write the container, warm loads map it. The
+// GPU size compares the cooked mips to the single RGBA8 mip uploaded before
+INTERNAL_FUNC u8
+test_cache_load_benchmark()
+{
+#ifndef VOLTRUM_TESTS_ASSETS_PATH
+    return BYPASS;
+#else
+    constexpr u32 repeat_count  = 4;
+    constexpr u32 texture_count = ARRAY_COUNT(ASSET_TEXTURES);
+
+    f64 cold_time     = 0.0;
+    f64 warm_time     = 0.0;
+    u64 rgba_size     = 0;
+    u64 rgba_mip_size = 0;
+    u64 bc_size       = 0;
+
+    for (u32 i = 0; i < texture_count; ++i)
+    {
+        arena_clear(test_arena);
+
+        String source = string_fmt(test_arena,
+                                   "%s/textures/%s.png",
+                                   VOLTRUM_TESTS_ASSETS_PATH,
+                                   ASSET_TEXTURES[i]);
+
+        // A copy in the working directory, the container is written next to
+        // it and the assets are left untouched
+        String image_path =
+            string_fmt(test_arena, "texture_cache_%s.png", ASSET_TEXTURES[i]);
+        String cache_path = string_fmt(test_arena,
+                                       "texture_cache_%s%s",
+                                       ASSET_TEXTURES[i],
+                                       TEXTURE_CACHE_EXTENSION);
+
+        File_Mapping mapping;
+        if (!filesystem_map(source.buff, &mapping))
+            return BYPASS;
+
+        File_Handle file;
+        u64         written = 0;
+        b8          copied =
+            filesystem_open(image_path.buff, File_Modes::WRITE, true, &file);
+
+        copied = copied &&
+                 filesystem_write(&file, mapping.size, mapping.data, &written);
+
+        if (copied)
+            filesystem_close(&file);
+
+        filesystem_unmap(&mapping);
+
+        if (!copied)
+            return BYPASS;
+
+        for (u32 r = 0; r < repeat_count; ++r)
+        {
+            remove(cache_path.buff);
+
+            Arena *arena = arena_create(256 * MiB);
+
+            Cooked_Texture cooked;
+            f64            start = platform_get_absolute_time();
+            expect_should_be(
+                true,
+                texture_cache_load(arena, image_path.buff, true, &cooked));
+            cold_time += platform_get_absolute_time() - start;
+
+            expect_should_be(nullptr, cooked.mapping.data);
+
+            if (r == 0)
+            {
+                rgba_size += (u64)cooked.width * cooked.height * 4;
+                bc_size += cooked_size(&cooked);
+
+                for (u32 m = 0; m < cooked.mip_count; ++m)
+                {
+                    rgba_mip_size +=
+                        texture_format_size(Texture_Format::RGBA8,
+                                            cooked.mips[m].width,
+                                            cooked.mips[m].height);
+                }
+            }
+
+            arena_clear(arena);
+
+            // Every page is read, like the upload does
+            start = platform_get_absolute_time();
+            expect_should_be(
+                true,
+                texture_cache_load(arena, image_path.buff, true, &cooked));
+
+            volatile u8 touched = 0;
+            for (u32 m = 0; m < cooked.mip_count; ++m)
+            {
+                for (u64 b = 0; b < cooked.mips[m].size; b += 4096)
+                    touched = touched ^ cooked.mips[m].data[b];
+            }
+
+            warm_time += platform_get_absolute_time() - start;
+
+            expect_should_not_be(nullptr, cooked.mapping.data);
+            texture_cache_close(&cooked);
+
+            arena_release(arena);
+        }
+
+        remove(cache_path.buff);
+        remove(image_path.buff);
+    }
+
+    CORE_INFO("Texture cache on %u textures: cold load %.2f ms, warm load "
+              "%.2f ms",
+              texture_count,
+              cold_time * 1000.0 / repeat_count,
+              warm_time * 1000.0 / repeat_count);
+
+    CORE_INFO("Texture GPU size: RGBA8 %.2f MiB, RGBA8 with mips %.2f MiB, "
+              "cooked BC with mips %.2f MiB",
+              (f64)rgba_size / MiB,
+              (f64)rgba_mip_size / MiB,
+              (f64)bc_size / MiB);
+
+    return true;
+#endif
+}
+
+void
+texture_cache_register_tests()
+{
+    test_arena = arena_create(64 * MiB);
+
+    test_manager_register_test(test_mip_chain,
+                               "Texture cache: box filtered mip chain");
+    test_manager_register_test(test_block_encoding_error,
+                               "Texture cache: BC1/BC3 encoding error");
+    test_manager_register_test(test_cache_round_trip,
+                               "Texture cache: container round trip");
+    test_manager_register_test(test_cache_load_benchmark,
+                               "Texture cache: cold/warm load benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void texture_cache_register_tests();